@@ -20,6 +20,7 @@
 #include <string_view>
 
 #include <esp_log.h>
+#include <esp_timer.h>
 
 #include "ArduinoJson.h"
 #include "binder.hpp"
@@ -30,10 +31,12 @@
 #include "misc/status_led.hpp"
 #include "network.hpp"
 #include "ota/ota.hpp"
+#include "profile_cache.hpp"
 #include "run_msg.hpp"
 #include "ruth_mqtt/mqtt.hpp"
 #include "sntp.hpp"
 #include "startup_msg.hpp"
+#include "watcher/watcher.hpp"
 
 namespace ruth {
 
@@ -43,6 +46,15 @@ static Core __singleton__;
 static StaticJsonDocument<2048> _profile;
 static StaticJsonDocument<1024> _ota_cmd;
 static firmware::OTA *_ota = nullptr;
+static Sntp *_sntp = nullptr;
+
+// boot stage timeouts, each restarts the device when exceeded (unless the engines
+// were started from the cached profile)
+static constexpr int64_t net_timeout_us = 15000 * 1000;
+static constexpr int64_t sntp_timeout_us = 10000 * 1000;
+static constexpr int64_t mqtt_connect_timeout_us = 60000 * 1000;
+static constexpr int64_t mqtt_ready_timeout_us = 10000 * 1000;
+static constexpr uint32_t profile_timeout_ms = 3333;
 
 Core::Core() : message::Handler("host", _max_queue_depth) {
   _heap_first = heap_caps_get_free_size(MALLOC_CAP_8BIT);
@@ -51,12 +63,19 @@ Core::Core() : message::Handler("host", _max_queue_depth) {
 
 void Core::boot() {
   Core &core = __singleton__;
-
-  StatusLED::init();
+  core._boot_at = esp_timer_get_time();
+
+  // boot proceeds in stages, each waits only for what it depends on:
+  //  1. wifi associates while the status led, pwm hardware and binder initialize
+  //  2. sntp and the mqtt connection are started together once the net is ready
+  //  3. the profile is requested once mqtt is ready
+  //  4. engines start once the profile is received and the time is set
+  //
+  // when a profile is cached (nvs) the engines start from it once the time is set (or sntp
+  // times out) and boot completes without the broker.  the profile then received is only
+  // applied when its version differs.  a broker outage never restarts a host running engines.
   Binder::init();
 
-  StatusLED::brighter();
-
   auto wifi = Binder::wifi();
 
   Net::Opts net_opts;
@@ -64,20 +83,24 @@ void Core::boot() {
   net_opts.passwd = wifi["passwd"];
   net_opts.notify_task = xTaskGetCurrentTaskHandle();
 
-  StatusLED::brighter();
   Net::start(net_opts);
-  uint32_t notify;
-  xTaskNotifyWait(0, ULONG_MAX, &notify, pdMS_TO_TICKS(15000));
 
-  if ((notify & Net::READY) == false) {
-    ESP_LOGW(TAG, "while waiting for net ready received %u instead of %u", notify, Net::READY);
+  StatusLED::init(); // also turns off every pwm pin
+  StatusLED::brighter();
+  core.bootStage("hardware");
+
+  if (core.bootWait(Net::READY, core._boot_at + net_timeout_us) == false) {
+    ESP_LOGW(TAG, "timeout waiting for net ready");
     vTaskDelay(pdMS_TO_TICKS(3333));
     esp_restart();
   }
 
+  core.bootStage("net");
   StatusLED::brighter();
 
-  core.sntp(); // only returns if SNTP succeeds
+  // the cached profile includes the name it was delivered to
+  const auto cached = ProfileCache::load() && ProfileCache::unpack(_profile);
+  if (cached) Net::setName(ProfileCache::hostname());
 
   filter::Opts opts;
   opts.first_level = Binder::env();
@@ -85,46 +108,88 @@ void Core::boot() {
   opts.hostname = Net::hostname();
 
   filter::Filter::init(opts);
-  core.startMqtt();
 
+  const auto sntp_at = esp_timer_get_time();
+  core.sntp();      // completes in parallel, waited for before starting engines
+  core.startMqtt(); // connects in parallel
+
+  if (cached) {
+    if (core.sntpWait(sntp_at) == false) ESP_LOGW(TAG, "starting engines from cached profile without time");
+
+    core.startEngines();
+    core.bootStage("engines (cached profile)");
+
+    if (core._engines_started) {
+      core.bootComplete();
+      core.watch();
+    }
+  }
+
+  core.mqttReady();
+  core.bootStage("mqtt");
   StatusLED::brighter();
 
   bool timeout;
-  auto wrapped_msg = core.waitForMessage(3333, &timeout);
+  auto wrapped_msg = core.waitForMessage(profile_timeout_ms, &timeout);
 
-  if (timeout) {
+  if (timeout && !cached) {
     ESP_LOGW(TAG, "timeout waiting for profile");
     vTaskDelay(pdMS_TO_TICKS(3333));
     esp_restart();
+  } else if (timeout) {
+    ESP_LOGW(TAG, "timeout waiting for profile, using cached version[%s]", ProfileCache::version());
+  } else {
+    core.bootStage("profile");
+    core.profile(std::move(wrapped_msg));
   }
 
-  StatusLED::brighter();
-  const char *hostname = wrapped_msg->hostnameFromFilter();
   StatusLED::brighter();
 
-  wrapped_msg->unpack(_profile);
-  StatusLED::brighter();
+  if (!core._engines_started) {
+    // engine readings are timestamped
+    if (core.sntpWait(sntp_at) == false) esp_restart();
 
-  Net::setName(hostname);
+    core.startEngines();
+    core.bootStage("engines");
+  }
 
-  core.startEngines();
+  if (!core._boot_complete) {
+    core.trackHeap();
+    StatusLED::percent(75);
+    core.bootComplete();
+    core.watch();
+  }
 
-  core.trackHeap();
-  StatusLED::percent(75);
-  core.bootComplete();
+  // send our boot stats, mqtt is ready (boot may have completed before from the cached profile)
+  const char *profile_name = _profile["meta"]["name"] | "unknown";
+  message::Boot msg(core._stack_size, profile_name);
+  MQTT::send(msg);
 
   StatusLED::off();
+}
+void Core::bootStage(const char *stage) {
+  const auto elapsed_ms = (esp_timer_get_time() - _boot_at) / 1000;
 
-  // if (Profile::watchStacks()) {
-  //   _watcher = new Watcher();
-  //   _watcher->start();
-  // }
+  ESP_LOGI(TAG, "boot stage[%s] at %lldms", stage, elapsed_ms);
 }
+
+bool Core::bootWait(uint32_t notifies, int64_t deadline_us) {
+  // notifies not waited for (e.g. sntp while waiting for mqtt) are kept for a later stage
+  while ((_boot_notifies & notifies) != notifies) {
+    const auto remaining_ms = (deadline_us - esp_timer_get_time()) / 1000;
+    if (remaining_ms <= 0) return false;
+
+    uint32_t notify = 0;
+    if (xTaskNotifyWait(0, ULONG_MAX, &notify, pdMS_TO_TICKS(remaining_ms) + 1) == pdTRUE) {
+      _boot_notifies |= notify;
+    }
+  }
+
+  return true;
+}
+
 void Core::bootComplete() {
-  // send our boot stats
-  const char *profile_name = _profile["meta"]["name"] | "unknown";
-  message::Boot msg(_stack_size, profile_name);
-  MQTT::send(msg);
+  _boot_complete = true;
 
   // lower our priority to not compete with actual work
   if (uxTaskPriorityGet(nullptr) > _priority) {
@@ -164,11 +229,42 @@ void Core::loop() {
       break;
 
     case DocKinds::PROFILE:
+      core.profile(std::move(msg));
       break;
     }
   }
 }
 
+void Core::mqttReady() {
+  // engines started from the cached profile keep running while the broker is unavailable
+  while (bootWait(MQTT::CONNECTED, esp_timer_get_time() + mqtt_connect_timeout_us) == false) {
+    ESP_LOGW(TAG, "timeout waiting for mqtt connection, notifies[0x%x]", _boot_notifies);
+
+    if (_engines_started == false) {
+      vTaskDelay(pdMS_TO_TICKS(10000));
+      esp_restart();
+    }
+  }
+
+  filter::Subscribe sub_filter;
+  MQTT::subscribe(sub_filter);
+
+  while (bootWait(MQTT::READY, esp_timer_get_time() + mqtt_ready_timeout_us) == false) {
+    ESP_LOGW(TAG, "timeout waiting for mqtt ready, notifies[0x%x]", _boot_notifies);
+
+    if (_engines_started == false) {
+      vTaskDelay(pdMS_TO_TICKS(10000));
+      esp_restart();
+    }
+  }
+
+  MQTT::registerHandler(this);
+
+  message::Startup msg;
+  MQTT::send(msg);
+
+  StatusLED::off();
+}
 void Core::ota(message::InWrapped msg) {
   using namespace firmware;
 
@@ -209,6 +305,38 @@ void Core::ota(message::InWrapped msg) {
   }
 }
 
+void Core::profile(message::InWrapped msg) {
+  const char *hostname = msg->hostnameFromFilter();
+
+  // profiles are delivered at every boot, typically unchanged
+  if (ProfileCache::matches(msg->packed(), msg->packedLen(), hostname)) {
+    ESP_LOGI(TAG, "profile version[%s] unchanged", ProfileCache::version());
+    return;
+  }
+
+  const auto saved = ProfileCache::save(msg->packed(), msg->packedLen(), hostname);
+
+  // the engines copy what they use from the profile, it is replaced while they run
+  ProfileCache::replace(msg->packed(), msg->packedLen(), hostname);
+  ProfileCache::unpack(_profile);
+
+  Net::setName(hostname);
+
+  // during boot the engines are started once the profile (and time) are ready
+  if ((_engines_started == false) && (_boot_complete == false)) return;
+
+  ESP_LOGI(TAG, "profile version[%s] changed, reconfiguring engines", ProfileCache::version());
+
+  if (startEngines() == false) {
+    // the saved profile is applied by the restart, otherwise keep what is running
+    if (saved) esp_restart();
+
+    ESP_LOGW(TAG, "profile requires a restart but could not be cached, ignored");
+  }
+
+  watch();
+}
+
 void Core::reportTimer(TimerHandle_t handle) {
   Core *core = (Core *)pvTimerGetTimerID(handle);
 
@@ -224,36 +352,46 @@ void Core::sntp() {
   opts.servers[1] = ntp_servers[1];
   opts.notify_task = xTaskGetCurrentTaskHandle();
 
-  Sntp sntp(opts);
-
-  uint32_t notify_val = 0;
+  // Sntp::READY is notified when the time is set
+  _sntp = new Sntp(opts);
+}
 
-  xTaskNotifyWait(0, ULONG_MAX, &notify_val, pdMS_TO_TICKS(10000));
+bool Core::sntpWait(int64_t sntp_at) {
+  if (_sntp == nullptr) return true;
 
-  if (notify_val != Sntp::READY) {
+  // on timeout sntp is kept, the time is set (and READY notified) whenever it syncs
+  if (bootWait(Sntp::READY, sntp_at + sntp_timeout_us) == false) {
     ESP_LOGW(TAG, "SNTP exceeded 10s");
-    esp_restart();
+    return false;
   }
+
+  delete _sntp;
+  _sntp = nullptr;
+  bootStage("sntp");
+
+  return true;
 }
 
-void Core::startEngines() {
+bool Core::startEngines() {
   StatusLED::brighter();
-  // if the engines are already started obviously don't start them again.
+  // engines already started are reconfigured in place to match the profile.
 
-  // secondly, if this host hasn't yet been assigned a name (it's new) then
-  // don't engines.  by not starting the engines we prevent sending device
+  // if this host hasn't yet been assigned a name (it's new) then don't start
+  // engines.  by not starting the engines we prevent sending device
   // readings which in turn will prevent device creation centrally.
 
   // in other words, we only want to create devices centrally once this host
   // has been assigned a name.
-  if (_engines_started || Net::hostIdAndNameAreEqual()) return;
+  if (Net::hostIdAndNameAreEqual()) return true;
 
   const JsonObject profile = _profile.as<JsonObject>();
   profile["hostname"] = Net::hostname();
   profile["unique_id"] = Net::macAddress();
-  core::Engines::startConfigured(profile);
+
+  if (core::Engines::configure(profile) == false) return false;
 
   _engines_started = true;
+  return true;
 }
 
 void Core::startMqtt() {
@@ -270,43 +408,33 @@ void Core::startMqtt() {
   opts.notify_task = xTaskGetCurrentTaskHandle();
 
   MQTT::initAndStart(opts);
+}
 
-  uint32_t notify;
-  xTaskNotifyWait(0, ULONG_MAX, &notify, pdMS_TO_TICKS(60000));
-
-  if ((notify & MQTT::CONNECTED) == false) {
-    ESP_LOGW(TAG, "while waiting for mqtt connection received %u instead of %u", notify, MQTT::CONNECTED);
-    vTaskDelay(pdMS_TO_TICKS(10000));
-    esp_restart();
-  }
-
-  filter::Subscribe sub_filter;
-  MQTT::subscribe(sub_filter);
-
-  xTaskNotifyWait(0, ULONG_MAX, &notify, pdMS_TO_TICKS(10000));
+void Core::trackHeap() {
+  message::Run msg;
 
-  if ((notify & MQTT::READY) == false) {
-    ESP_LOGW(TAG, "while waiting for mqtt ready received %u instead of %u", notify, MQTT::READY);
-    vTaskDelay(pdMS_TO_TICKS(10000));
+  if (msg.isHeapLow()) {
     esp_restart();
   }
 
-  MQTT::registerHandler(this);
-
-  message::Startup msg;
   MQTT::send(msg);
-
-  StatusLED::off();
 }
 
-void Core::trackHeap() {
-  message::Run msg;
+void Core::watch() {
+  // the profile watcher section enables the task watcher
+  const JsonObject watcher = _profile["watcher"];
 
-  if (msg.isHeapLow()) {
-    esp_restart();
+  if (watcher.isNull()) {
+    Watcher::stop();
+    return;
   }
 
-  MQTT::send(msg);
+  Watcher::Opts opts;
+  opts.interval_ms = watcher["interval_ms"] | opts.interval_ms;
+  opts.stack = watcher["stack"] | opts.stack;
+  opts.priority = watcher["pri"] | opts.priority;
+
+  Watcher::start(opts);
 }
 
 void Core::wantMessage(message::InWrapped &msg) {
@@ -52,11 +52,17 @@ public:
 private:
   // private functions for class
   void bootComplete();
+  void bootStage(const char *stage);
+  bool bootWait(uint32_t notifies, int64_t deadline_us);
+  void mqttReady();
   void ota(message::InWrapped msg);
+  void profile(message::InWrapped msg);
   void sntp();
-  void startEngines();
+  bool sntpWait(int64_t sntp_at);
+  bool startEngines();
   void startMqtt();
   void trackHeap();
+  void watch();
 
 private:
   enum DocKinds : uint32_t { PROFILE = 1, RESTART, OTA, BINDER };
@@ -75,13 +81,15 @@ private:
   static constexpr int _max_queue_depth = 6;
 
   // task tracking
+  bool _boot_complete = false;
   bool _engines_started = false;
 
+  // boot, notifies (from net, sntp and mqtt) accumulate so stages complete in any order
+  int64_t _boot_at = 0;
+  uint32_t _boot_notifies = 0;
+
   // host report timer
   TimerHandle_t _report_timer = nullptr;
-
-  // Task Stack Watcher
-  // Watcher_t *_watcher = nullptr;
 };
 
 } // namespace ruth
@@ -29,14 +29,18 @@
 namespace core {
 
 static lightdesk::LightDesk *desk = nullptr;
+static bool configured = false;
 
-void Engines::startConfigured(const JsonObject &profile) {
+bool Engines::configure(const JsonObject &profile) {
   const char *unique_id = profile["unique_id"];
   const JsonObject &pwm = profile["pwm"];
   const JsonObject &ds = profile["dalsemi"];
   const JsonObject &i2c = profile["i2c"];
   const JsonObject &lightdesk = profile["lightdesk"];
 
+  // the light desk and pwm engine share the pwm pins, switching between them needs a restart
+  if (configured && (lightdesk.isNull() == (desk != nullptr))) return false;
+
   if (pwm && !lightdesk) {
     using namespace pwm;
     Engine::Opts opts;
@@ -49,8 +53,12 @@ void Engines::startConfigured(const JsonObject &profile) {
     opts.report.send_ms = pwm["report"]["send_ms"];
 
     Engine::start(opts);
+  } else {
+    pwm::Engine::stop();
   }
 
+  uint8_t ds_buses = 0; // buses beyond those configured are stopped
+
   if (ds) {
     using namespace ds;
     Engine::Opts opts;
@@ -62,26 +70,59 @@ void Engines::startConfigured(const JsonObject &profile) {
     opts.report.priority = ds["report"]["pri"];
     opts.report.send_ms = ds["report"]["send_ms"];
     opts.report.loops_per_discover = ds["report"]["loops_per_discover"];
-
-    Engine::start(opts);
+    opts.report.change_ms = ds["report"]["change_ms"] | opts.report.change_ms;
+    opts.resolution = ds["resolution"];
+    opts.devices.capacity = ds["devices"]["capacity"] | opts.devices.capacity;
+    opts.devices.evict_after = ds["devices"]["evict_after"] | opts.devices.evict_after;
+
+    // each configured bus is an independent engine (tasks, devices and RMT channels),
+    // a profile without buses uses the single default bus
+    const JsonArrayConst buses = ds["buses"];
+
+    if (buses.isNull()) {
+      Engine::start(opts);
+      ds_buses = 1;
+    } else {
+      for (const JsonObjectConst bus : buses) {
+        Engine::Opts bus_opts = opts;
+
+        bus_opts.bus.num = ds_buses++;
+        bus_opts.bus.pin = bus["pin"] | opts.bus.pin;
+
+        Engine::start(bus_opts);
+      }
+    }
   }
 
+  for (auto num = ds_buses; num < ds::Bus::max_buses; num++) ds::Engine::stop(num);
+
   if (i2c) {
     using namespace i2c;
     Engine::Opts opts;
 
     opts.unique_id = unique_id;
+    opts.mplex = profile["misc"]["i2c_mplex"] | opts.mplex;
+    opts.sht31.mps = i2c["sht31"]["mps"] | opts.sht31.mps;
+    opts.sht31.samples = i2c["sht31"]["samples"] | opts.sht31.samples;
+    opts.mcp23008.inputs = i2c["mcp23008"]["inputs"] | opts.mcp23008.inputs;
+    opts.mcp23008.int_pin = i2c["mcp23008"]["int_pin"] | opts.mcp23008.int_pin;
+    opts.mcp23008.heartbeat_ms = i2c["mcp23008"]["heartbeat_ms"] | opts.mcp23008.heartbeat_ms;
+    opts.pca9685.pwm_hz = i2c["pca9685"]["pwm_hz"] | opts.pca9685.pwm_hz;
+    opts.pca9685.frame_ms = i2c["pca9685"]["frame_ms"] | opts.pca9685.frame_ms;
     opts.command.stack = i2c["command"]["stack"];
     opts.command.priority = i2c["command"]["pri"];
     opts.report.stack = i2c["report"]["stack"];
     opts.report.priority = i2c["report"]["pri"];
     opts.report.send_ms = i2c["report"]["send_ms"];
-    opts.report.loops_per_discover = i2c["report"]["loops_per_discover"];
+    opts.report.loops_per_discover = i2c["report"]["loops_per_discover"] | opts.report.loops_per_discover;
 
     Engine::start(opts);
+  } else {
+    i2c::Engine::stop();
   }
 
-  if (lightdesk) {
+  // light desk options apply at the next restart
+  if (lightdesk && (desk == nullptr)) {
     using namespace lightdesk;
 
     LightDesk::Opts opts;
@@ -90,8 +131,16 @@ void Engines::startConfigured(const JsonObject &profile) {
     opts.idle_shutdown_ms = lightdesk["idle_shutdown_ms"];
     opts.idle_check_ms = lightdesk["idle_check_ms"];
 
+    using pwm::Curve;
+    opts.curve.discoball = Curve::fromName(lightdesk["curve"]["discoball"], opts.curve.discoball);
+    opts.curve.elwire = Curve::fromName(lightdesk["curve"]["elwire"], opts.curve.elwire);
+    opts.curve.ledforest = Curve::fromName(lightdesk["curve"]["ledforest"], opts.curve.ledforest);
+
     desk = new LightDesk(opts);
   }
+
+  configured = true;
+  return true;
 }
 
 } // namespace core
@@ -30,7 +30,10 @@ public:
   Engines() = default;
   ~Engines() = default;
 
-  static void startConfigured(const JsonObject &profile);
+  // starts, reconfigures (in place) or stops the engines to match the profile.  returns
+  // false when the profile can only be applied by a restart (e.g. the light desk is added
+  // or removed).
+  static bool configure(const JsonObject &profile);
 };
 
 } // namespace core
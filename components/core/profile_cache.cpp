@@ -0,0 +1,167 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#include <cstring>
+
+#include <esp_log.h>
+#include <nvs.h>
+
+#include "profile_cache.hpp"
+
+namespace ruth {
+
+static const char *TAG = "ProfileCache";
+static const char *NVS_NAMESPACE = "ruth";
+static const char *KEY_HOSTNAME = "hostname";
+static const char *KEY_PROFILE = "profile";
+
+std::unique_ptr<char[]> ProfileCache::_packed;
+size_t ProfileCache::_packed_len = 0;
+char ProfileCache::_hostname[max_hostname_len] = {};
+char ProfileCache::_version[max_version_len] = {};
+
+// copies meta.version of a packed profile, empty when the profile has no version
+static void versionOf(const char *packed, size_t len, char *version, size_t version_len) {
+  StaticJsonDocument<JSON_OBJECT_SIZE(1) * 2> filter;
+  filter["meta"]["version"] = true;
+
+  // const input, the version is copied into the doc and the packed bytes are untouched
+  StaticJsonDocument<(JSON_OBJECT_SIZE(1) * 2) + 64> doc;
+  deserializeMsgPack(doc, packed, len, DeserializationOption::Filter(filter));
+
+  const char *found = doc["meta"]["version"] | "";
+  memccpy(version, found, 0x00, version_len);
+  version[version_len - 1] = 0x00;
+}
+
+void ProfileCache::adopt(std::unique_ptr<char[]> packed, size_t len) {
+  // the version is captured before the profile is unpacked (in place) by unpack()
+  versionOf(packed.get(), len, _version, max_version_len);
+
+  _packed = std::move(packed);
+  _packed_len = len;
+}
+
+bool ProfileCache::load() {
+  nvs_handle_t nvs;
+
+  // the namespace does not exist until the first profile is saved
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return false;
+
+  size_t len = 0;
+  size_t hostname_len = max_hostname_len;
+  std::unique_ptr<char[]> packed;
+
+  auto esp_rc = nvs_get_blob(nvs, KEY_PROFILE, nullptr, &len);
+  if (esp_rc == ESP_OK) esp_rc = nvs_get_str(nvs, KEY_HOSTNAME, _hostname, &hostname_len);
+
+  if ((esp_rc == ESP_OK) && (len > 0) && (len <= max_packed_len)) {
+    packed = std::make_unique<char[]>(len);
+    esp_rc = nvs_get_blob(nvs, KEY_PROFILE, packed.get(), &len);
+  }
+
+  nvs_close(nvs);
+
+  if ((esp_rc != ESP_OK) || !packed) {
+    ESP_LOGW(TAG, "load failed: %s bytes[%u]", esp_err_to_name(esp_rc), len);
+    _hostname[0] = 0x00;
+    return false;
+  }
+
+  adopt(std::move(packed), len);
+  ESP_LOGI(TAG, "loaded version[%s] hostname[%s] bytes[%u]", _version, _hostname, len);
+
+  return true;
+}
+
+bool ProfileCache::matches(const char *packed, size_t len, const char *hostname) {
+  if (!_packed) return false;
+
+  char version[max_version_len];
+  versionOf(packed, len, version, max_version_len);
+
+  // a profile without a version always replaces the profile in use
+  if (version[0] == 0x00) return false;
+
+  return (strcmp(version, _version) == 0) && (strcmp(hostname, _hostname) == 0);
+}
+
+void ProfileCache::replace(const char *packed, size_t len, const char *hostname) {
+  auto copy = std::make_unique<char[]>(len);
+  memcpy(copy.get(), packed, len);
+
+  memccpy(_hostname, hostname, 0x00, max_hostname_len);
+  _hostname[max_hostname_len - 1] = 0x00;
+
+  adopt(std::move(copy), len);
+}
+
+bool ProfileCache::save(const char *packed, size_t len, const char *hostname) {
+  char version[max_version_len];
+  versionOf(packed, len, version, max_version_len);
+
+  // without a version the cached profile could never be matched
+  if (version[0] == 0x00) {
+    ESP_LOGW(TAG, "profile has no version, not cached");
+    return false;
+  }
+
+  if (len > max_packed_len) {
+    ESP_LOGW(TAG, "profile too large to cache, bytes[%u]", len);
+    return false;
+  }
+
+  nvs_handle_t nvs;
+  auto esp_rc = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+
+  if (esp_rc == ESP_OK) {
+    esp_rc = nvs_set_blob(nvs, KEY_PROFILE, packed, len);
+    if (esp_rc == ESP_OK) esp_rc = nvs_set_str(nvs, KEY_HOSTNAME, hostname);
+    if (esp_rc == ESP_OK) esp_rc = nvs_commit(nvs);
+
+    nvs_close(nvs);
+  }
+
+  if (esp_rc != ESP_OK) {
+    ESP_LOGW(TAG, "save failed: %s", esp_err_to_name(esp_rc));
+    return false;
+  }
+
+  ESP_LOGI(TAG, "saved version[%s] hostname[%s] bytes[%u]", version, hostname, len);
+  return true;
+}
+
+bool ProfileCache::unpack(JsonDocument &doc) {
+  doc.clear();
+
+  if (!_packed) return false;
+
+  // zero copy, the strings of the doc reference (and rewrite) the retained packed bytes
+  auto err = deserializeMsgPack(doc, _packed.get(), _packed_len);
+
+  if (err) {
+    ESP_LOGW(TAG, "unpack failed: %s", err.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace ruth
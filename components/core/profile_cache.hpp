@@ -0,0 +1,70 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#ifndef core_profile_cache_hpp
+#define core_profile_cache_hpp
+
+#include <cstddef>
+#include <memory>
+
+#include "ArduinoJson.h"
+
+namespace ruth {
+
+// the last accepted profile, kept in nvs as the packed (msgpack) message along with the
+// hostname it was delivered to.  the profile document is unpacked in place so the packed
+// bytes are retained for as long as the profile is in use.
+class ProfileCache {
+public:
+  // restores the cached profile from nvs, returns false when nothing is cached
+  static bool load();
+
+  // true when the packed profile is the version (and hostname) in use
+  static bool matches(const char *packed, size_t len, const char *hostname);
+
+  // replaces the profile in use
+  static void replace(const char *packed, size_t len, const char *hostname);
+
+  // replaces the copy in nvs, the profile in use is unchanged
+  static bool save(const char *packed, size_t len, const char *hostname);
+
+  static const char *hostname() { return _hostname; }
+
+  // once after each load() or replace(), unpacking rewrites the packed bytes
+  static bool unpack(JsonDocument &doc);
+  static const char *version() { return _version; }
+
+private:
+  static void adopt(std::unique_ptr<char[]> packed, size_t len);
+
+private:
+  static constexpr size_t max_hostname_len = 32;
+  static constexpr size_t max_version_len = 40;
+  static constexpr size_t max_packed_len = 4096;
+
+  static std::unique_ptr<char[]> _packed;
+  static size_t _packed_len;
+  static char _hostname[max_hostname_len];
+  static char _version[max_version_len];
+};
+
+} // namespace ruth
+
+#endif
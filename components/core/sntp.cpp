@@ -49,7 +49,7 @@ Sntp::~Sntp() { _instance_ = nullptr; }
 void Sntp::sync_callback(struct timeval *tv) {
   if (tv->tv_sec > 1624113088) {
     sntp_set_time_sync_notification_cb(nullptr);
-    xTaskNotify(_instance_->_opts.notify_task, Sntp::READY, eSetValueWithOverwrite);
+    xTaskNotify(_instance_->_opts.notify_task, Sntp::READY, eSetBits);
   }
 }
 
@@ -0,0 +1,231 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// the boot stand-ins, see boot_sim.hpp
+
+#include <cstdio>
+#include <cstring>
+#include <sys/time.h>
+
+#include <esp_sntp.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "ArduinoJson.h"
+#include "binder.hpp"
+#include "boot_sim.hpp"
+#include "core.hpp"
+#include "host_broker.hpp"
+#include "host_rtos.h"
+#include "network.hpp"
+#include "ota/ota.hpp"
+#include "watcher/watcher.hpp"
+
+namespace boot_sim {
+
+Opts opts;
+uint64_t status_led_at_us = NOT_YET;
+uint64_t net_at_us = NOT_YET;
+uint64_t sntp_at_us = NOT_YET;
+uint64_t complete_at_us = NOT_YET;
+uint32_t restarts = 0;
+uint32_t watcher_starts = 0;
+
+void bootTask(void *) {
+  ruth::Core::boot();
+
+  for (;;) ruth::Core::loop();
+}
+
+std::string profile(const char *name, const char *version, bool watch) {
+  struct timeval now {};
+  gettimeofday(&now, nullptr);
+
+  StaticJsonDocument<256> doc;
+  doc["meta"]["name"] = name;
+  doc["meta"]["version"] = version;
+  doc["host"]["report_ms"] = 7000;
+  doc["mtime"] = ((uint64_t)now.tv_sec * 1000) + (now.tv_usec / 1000);
+  if (watch) doc["watcher"]["interval_ms"] = 30000;
+
+  std::string packed;
+  serializeMsgPack(doc, packed);
+
+  return packed;
+}
+
+void deliverProfile(const std::string &packed, const char *hostname) {
+  std::string topic = "ruth/c2/ruth.0123456789ab/host/profile/";
+
+  host::Broker::deliver(topic + hostname, packed);
+}
+
+uint64_t publishedAt(const char *part) {
+  for (const auto &msg : host::Broker::published) {
+    if (msg.topic.find(part) != std::string::npos) return msg.at_us;
+  }
+
+  return NOT_YET;
+}
+
+} // namespace boot_sim
+
+using namespace boot_sim;
+
+// calls fn from the esp_timer task after ms
+static void after(uint32_t ms, esp_timer_cb_t fn) {
+  esp_timer_handle_t timer;
+
+  esp_timer_create_args_t args = {};
+  args.callback = fn;
+  args.name = "boot_sim";
+  esp_timer_create(&args, &timer);
+  esp_timer_start_once(timer, ms * 1000ULL);
+}
+
+//
+// esp_system
+//
+
+extern "C" void esp_restart(void) {
+  restarts++;
+  printf("esp_restart at %.3fs\n", host_rtos_now_us() / 1e6);
+
+  vTaskDelete(nullptr);
+  for (;;) vTaskDelay(portMAX_DELAY);
+}
+
+extern "C" esp_reset_reason_t esp_reset_reason(void) { return ESP_RST_POWERON; }
+
+//
+// sntp client
+//
+
+static sntp_sync_time_cb_t sntp_cb = nullptr;
+
+static void timeSet(void *) {
+  sntp_at_us = host_rtos_now_us();
+
+  struct timeval now {};
+  gettimeofday(&now, nullptr);
+  if (sntp_cb) sntp_cb(&now);
+}
+
+extern "C" {
+void sntp_setoperatingmode(unsigned char) {}
+void sntp_set_sync_mode(sntp_sync_mode_t) {}
+void sntp_setservername(unsigned char, const char *) {}
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) { sntp_cb = callback; }
+void sntp_stop(void) {}
+
+void sntp_init(void) {
+  if (opts.sntp_ms != NEVER) after(opts.sntp_ms, timeSet);
+}
+}
+
+//
+// Binder, the embedded binder of a host
+//
+
+static Binder_t binder;
+static StaticJsonDocument<512> embed_doc;
+
+int64_t Binder::now() {
+  struct timeval now {};
+  gettimeofday(&now, nullptr);
+
+  return (now.tv_sec * 1000000L) + now.tv_usec;
+}
+
+void Binder::parse() {
+  deserializeJson(embed_doc, R"({"meta": {"env": "ruth"},
+                                 "wifi": {"ssid": "ssid", "passwd": "passwd"},
+                                 "mqtt": {"uri": "mqtt://broker", "user": "user", "passwd": "passwd"},
+                                 "ntp": ["ntp1", "ntp2"]})");
+
+  root = embed_doc.as<JsonObject>();
+  meta = root["meta"];
+}
+
+Binder_t *Binder::i() { return &binder; }
+
+namespace ruth {
+
+//
+// Net
+//
+
+static constexpr size_t name_max = 32;
+static TaskHandle_t net_notify = nullptr;
+static char host_name[name_max] = "ruth.0123456789ab";
+
+const uint8_t Net::_ca_start_[] = {0x00};
+const uint8_t Net::_ca_end_[] = {0x00};
+
+static void ipAcquired(void *) {
+  net_at_us = host_rtos_now_us();
+  xTaskNotify(net_notify, Net::READY, eSetBits);
+}
+
+bool Net::start(const Opts &opts) {
+  net_notify = opts.notify_task;
+  after(boot_sim::opts.net_ms, ipAcquired);
+
+  return true;
+}
+
+void Net::stop() {}
+
+const char *Net::hostID() { return "ruth.0123456789ab"; }
+bool Net::hostIdAndNameAreEqual() { return strcmp(hostID(), host_name) == 0; }
+const char *Net::hostname() { return host_name; }
+const char *Net::macAddress() { return "0123456789ab"; }
+
+void Net::setName(const char *name) {
+  memccpy(host_name, name, 0x00, name_max);
+  host_name[name_max - 1] = 0x00;
+}
+
+//
+// Watcher
+//
+
+void Watcher::start(const Opts &) { watcher_starts++; }
+void Watcher::stop() {}
+
+} // namespace ruth
+
+//
+// OTA, there is no firmware to fetch
+//
+
+namespace firmware {
+
+OTA::OTA(TaskHandle_t notify_task, const char *file, const char *ca_start)
+    : _notify_task(notify_task), _ca_start(ca_start) {}
+OTA::~OTA() {}
+
+void OTA::start() { xTaskNotify(_notify_task, ERROR, eSetValueWithOverwrite); }
+void OTA::captureBaseUrl(const char *) {}
+void OTA::handlePendingIfNeeded(const uint32_t) { complete_at_us = host_rtos_now_us(); }
+
+} // namespace firmware
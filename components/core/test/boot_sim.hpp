@@ -0,0 +1,89 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// stand-ins for the parts of the device ruth::Core boots on the host: Net (wifi associates
+// and acquires an ip after net_ms), the sntp client (the time is set sntp_ms after it starts),
+// Binder, OTA and Watcher.  engines_sim.cpp adds core::Engines (each profile configured is
+// recorded) and StatusLED, tests of the engines themselves link those instead.  mqtt is the host
+// broker (see host_broker.hpp), connected connect_ms after the client starts.
+//
+// esp_restart() records the restart then ends the calling task, the boot task of a test.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "host_rtos.h"
+
+namespace boot_sim {
+
+static constexpr uint32_t NEVER = UINT32_MAX;
+
+struct Opts {
+  uint32_t net_ms = 1800;  // from Net::start to an ip
+  uint32_t sntp_ms = 350;  // from sntp_init to the time set, NEVER when unreachable
+};
+
+struct Configured {
+  uint64_t at_us;
+  std::string profile; // meta.name of the profile
+  std::string hostname;
+};
+
+extern Opts opts;
+
+// when each stage completed (NOT_YET until then)
+static constexpr uint64_t NOT_YET = UINT64_MAX;
+extern uint64_t status_led_at_us; // StatusLED::init
+extern uint64_t net_at_us;        // ip acquired, Net::READY notified
+extern uint64_t sntp_at_us;       // time set, the sync notification made
+extern uint64_t complete_at_us;   // boot complete, OTA::handlePendingIfNeeded
+
+extern std::vector<Configured> configured; // core::Engines::configure
+extern uint32_t restarts;
+extern uint32_t watcher_starts;
+
+// Core::boot() then Core::loop(), as the app main task
+void bootTask(void *);
+
+// a profile (msgpack) as the server sends it, with a watcher section when watch
+std::string profile(const char *name, const char *version, bool watch = false);
+
+// the server delivers the profile to hostname (of this host)
+void deliverProfile(const std::string &packed, const char *hostname);
+
+// when the first message published to a topic containing part was published, NOT_YET if none
+uint64_t publishedAt(const char *part);
+
+// polls (each tick) until done() or timeout_ms passes, returns done()
+template <typename Done> bool waitUntil(Done done, uint32_t timeout_ms) {
+  const auto until_us = host_rtos_now_us() + (timeout_ms * 1000ULL);
+
+  while (!done() && (host_rtos_now_us() < until_us)) vTaskDelay(1);
+
+  return done();
+}
+
+} // namespace boot_sim
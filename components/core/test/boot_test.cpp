@@ -0,0 +1,126 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// the boot critical path of ruth::Core on the stand-ins (see boot_sim.hpp): wifi associates
+// while the hardware initializes, then sntp and the mqtt connection proceed together and the
+// engines start once both the time and the profile (the server's reply to the startup
+// message) are ready.  the time the engines start is checked against the critical path of the
+// stage durations and compared with the serial boot (each stage waited for in turn).
+//
+// by default the time is set while mqtt connects, "slow_sntp" sets it after the profile.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "boot_sim.hpp"
+#include "host_broker.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+
+using host::Broker;
+
+static constexpr uint64_t TICK_US = 1000000 / configTICK_RATE_HZ;
+static constexpr uint32_t CONNECT_MS = 600; // broker connection (tls) from the client start
+static constexpr uint32_t REPLY_MS = 80;    // the server replies to the startup message with the profile
+
+static bool slow_sntp = false;
+
+static int testMain() {
+  using namespace boot_sim;
+
+  if (slow_sntp) opts.sntp_ms = 1500;
+  Broker::opts.connect_ms = CONNECT_MS;
+
+  const auto start_at = host_rtos_now_us();
+  xTaskCreate(bootTask, "main", 4096, nullptr, 1, nullptr);
+
+  // the server, the profile follows the startup message
+  uint64_t connected_at = NOT_YET;
+  const auto started = waitUntil(
+      [&] {
+        if ((connected_at == NOT_YET) && Broker::connected()) connected_at = host_rtos_now_us();
+        return publishedAt("/host/startup") != NOT_YET;
+      },
+      30000);
+
+  CHECK(started, "no startup message");
+  if (!started) return host_test_result();
+
+  const auto startup_at = publishedAt("/host/startup");
+  vTaskDelay(pdMS_TO_TICKS(REPLY_MS));
+  const auto profile_at = host_rtos_now_us();
+  deliverProfile(profile("boot", "1"), "boot-host");
+
+  CHECK(waitUntil([] { return publishedAt("/host/boot/") != NOT_YET; }, 10000), "boot not complete");
+  CHECK(restarts == 0, "%u restarts", restarts);
+  CHECK(configured.size() == 1, "engines configured %zu times", configured.size());
+  if (configured.empty()) return host_test_result();
+
+  const auto &engines = configured.front();
+  CHECK(engines.profile == "boot", "engines started from profile '%s'", engines.profile.c_str());
+  CHECK(engines.hostname == "boot-host", "engines started as '%s'", engines.hostname.c_str());
+
+  // the hardware initializes while wifi associates, sntp and mqtt both start once the ip is
+  // acquired (the connection is seen on the next tick)
+  CHECK(status_led_at_us < net_at_us, "status led initialized at %.1fms", status_led_at_us / 1e3);
+  CHECK((sntp_at_us - net_at_us) == (opts.sntp_ms * 1000ULL), "sntp took %.1fms",
+        (sntp_at_us - net_at_us) / 1e3);
+
+  const auto connect_us = connected_at - net_at_us;
+  CHECK((connect_us >= (CONNECT_MS * 1000ULL)) && (connect_us <= ((CONNECT_MS * 1000ULL) + TICK_US)),
+        "mqtt connected %.1fms after the ip", connect_us / 1e3);
+
+  // the engines wait only for the time and the profile
+  const auto ready_at = std::max(sntp_at_us, profile_at);
+  CHECK((engines.at_us >= ready_at) && (engines.at_us <= (ready_at + TICK_US)),
+        "engines at %.1fms, time and profile ready at %.1fms", engines.at_us / 1e3, ready_at / 1e3);
+
+  // the stages as measured: net, sntp and mqtt (connect, subscribe then startup) plus the reply
+  const auto net_us = net_at_us - start_at;
+  const auto sntp_us = sntp_at_us - net_at_us;
+  const auto mqtt_us = startup_at - net_at_us;
+  const auto reply_us = profile_at - startup_at;
+
+  const auto critical_us = net_us + std::max(sntp_us, mqtt_us + reply_us);
+  const auto serial_us = net_us + sntp_us + mqtt_us + reply_us;
+  const auto engines_us = engines.at_us - start_at;
+
+  CHECK(engines_us <= (critical_us + TICK_US), "engines at %.1fms, critical path %.1fms", engines_us / 1e3,
+        critical_us / 1e3);
+  CHECK(engines_us < serial_us, "engines at %.1fms, serial %.1fms", engines_us / 1e3, serial_us / 1e3);
+
+  printf("boot%s: net %.0fms, sntp %.0fms, mqtt %.0fms + profile %.0fms, engines at %.0fms "
+         "(critical path %.0fms, serial %.0fms)\n",
+         slow_sntp ? " (slow sntp)" : "", net_us / 1e3, sntp_us / 1e3, mqtt_us / 1e3, reply_us / 1e3,
+         engines_us / 1e3, critical_us / 1e3, serial_us / 1e3);
+
+  return host_test_result();
+}
+
+int main(int argc, char *argv[]) {
+  slow_sntp = (argc > 1) && (strcmp(argv[1], "slow_sntp") == 0);
+
+  return host_rtos_run(testMain);
+}
@@ -0,0 +1,115 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// a boot from the profile cached in nvs while the broker is unavailable: the engines start
+// once the time is set (or sntp times out) and boot completes (the watcher, report timer and
+// pending ota image validation) without waiting for mqtt.  the broker stays offline beyond the
+// mqtt connect and ready timeouts without a restart.  once the broker returns the profile
+// delivered is only applied when its version differs from the cached profile.
+//
+// by default sntp sets the time, "no_sntp" never does.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "boot_sim.hpp"
+#include "host_broker.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "profile_cache.hpp"
+
+using host::Broker;
+
+static constexpr uint64_t TICK_US = 1000000 / configTICK_RATE_HZ;
+static constexpr uint64_t SNTP_TIMEOUT_US = 10000 * 1000; // Core gives up waiting for the time
+static constexpr uint32_t OFFLINE_MS = 150000;            // beyond the mqtt connect timeout, twice
+
+static bool no_sntp = false;
+
+static int testMain() {
+  using namespace boot_sim;
+
+  if (no_sntp) opts.sntp_ms = NEVER;
+  Broker::opts.online = false;
+
+  const auto cached = profile("cached", "1", true);
+  CHECK(ruth::ProfileCache::save(cached.data(), cached.size(), "boot-host"), "profile not cached");
+
+  const auto start_at = host_rtos_now_us();
+  xTaskCreate(bootTask, "main", 4096, nullptr, 1, nullptr);
+
+  CHECK(waitUntil([] { return complete_at_us != NOT_YET; }, 15000), "boot not complete");
+  vTaskDelay(pdMS_TO_TICKS(OFFLINE_MS));
+
+  CHECK(restarts == 0, "%u restarts while the broker is offline", restarts);
+  CHECK(configured.size() == 1, "engines configured %zu times", configured.size());
+  if (configured.empty()) return host_test_result();
+
+  const auto engines = configured.front(); // a copy, more are configured below
+  CHECK(engines.profile == "cached", "engines started from profile '%s'", engines.profile.c_str());
+  CHECK(engines.hostname == "boot-host", "engines started as '%s'", engines.hostname.c_str());
+
+  // the engines wait only for the time (or its timeout) after the ip
+  const auto ready_at = no_sntp ? (net_at_us + SNTP_TIMEOUT_US) : sntp_at_us;
+  CHECK((engines.at_us >= ready_at) && (engines.at_us <= (ready_at + TICK_US)),
+        "engines at %.1fms, ready at %.1fms", (engines.at_us - start_at) / 1e3, (ready_at - start_at) / 1e3);
+  CHECK(complete_at_us <= (engines.at_us + TICK_US), "boot complete at %.1fms",
+        (complete_at_us - start_at) / 1e3);
+  CHECK(watcher_starts == 1, "watcher started %u times", watcher_starts);
+  CHECK(publishedAt("/host/") == NOT_YET, "published while the broker is offline");
+
+  // the broker returns, the profile delivered (unchanged) leaves the engines running as is
+  const auto online_at = host_rtos_now_us();
+  Broker::connect();
+  CHECK(waitUntil([] { return publishedAt("/host/startup") != NOT_YET; }, 10000), "no startup message");
+
+  deliverProfile(cached, "boot-host");
+  CHECK(waitUntil([] { return publishedAt("/host/boot/") != NOT_YET; }, 10000), "no boot message");
+  CHECK(configured.size() == 1, "unchanged profile configured the engines");
+
+  // a new version reconfigures the running engines (and the watcher)
+  deliverProfile(profile("changed", "2", true), "boot-host");
+  CHECK(waitUntil([] { return configured.size() == 2; }, 10000), "changed profile not applied");
+  if (configured.size() == 2) {
+    const auto &profile = configured.back().profile;
+    CHECK(profile == "changed", "engines reconfigured from '%s'", profile.c_str());
+  }
+
+  CHECK(watcher_starts == 2, "watcher started %u times", watcher_starts);
+  CHECK(restarts == 0, "%u restarts", restarts);
+
+  printf("cached boot%s: engines at %.0fms, complete at %.0fms, no restart in %.0fs offline, "
+         "profile applied %.0fms after the broker returned\n",
+         no_sntp ? " (no sntp)" : "", (engines.at_us - start_at) / 1e3, (complete_at_us - start_at) / 1e3,
+         (online_at - start_at) / 1e6, (configured.back().at_us - online_at) / 1e3);
+
+  return host_test_result();
+}
+
+int main(int argc, char *argv[]) {
+  no_sntp = (argc > 1) && (strcmp(argv[1], "no_sntp") == 0);
+
+  return host_rtos_run(testMain);
+}
@@ -0,0 +1,56 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// core::Engines stand-in, each profile configured is recorded (see boot_sim.hpp).  with no
+// engines there is no pwm hardware, StatusLED only records when it was initialized.
+
+#include "boot_sim.hpp"
+#include "engines.hpp"
+#include "host_rtos.h"
+#include "misc/status_led.hpp"
+
+namespace boot_sim {
+std::vector<Configured> configured;
+}
+
+namespace core {
+
+bool Engines::configure(const JsonObject &profile) {
+  const char *name = profile["meta"]["name"] | "";
+  const char *hostname = profile["hostname"] | "";
+
+  boot_sim::configured.push_back({host_rtos_now_us(), name, hostname});
+
+  return true;
+}
+
+} // namespace core
+
+namespace ruth {
+
+void StatusLED::init() { boot_sim::status_led_at_us = host_rtos_now_us(); }
+void StatusLED::bright() {}
+void StatusLED::brighter() {}
+void StatusLED::dim() {}
+void StatusLED::dimmer() {}
+void StatusLED::off() {}
+void StatusLED::percent(float) {}
+
+} // namespace ruth
@@ -0,0 +1,153 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// nvs api stand-in, see nvs_sim.hpp
+
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <nvs.h>
+
+#include "nvs_sim.hpp"
+
+namespace {
+struct Handle {
+  std::string ns;
+  bool writable;
+};
+
+std::map<std::string, std::map<std::string, std::string>> namespaces;
+std::map<nvs_handle_t, Handle> handles;
+nvs_handle_t next_handle = 1;
+
+size_t used() {
+  size_t bytes = 0;
+
+  for (const auto &ns : namespaces) {
+    for (const auto &kv : ns.second) bytes += kv.second.size();
+  }
+
+  return bytes;
+}
+
+esp_err_t get(nvs_handle_t handle, const char *key, const std::string **value) {
+  auto h = handles.find(handle);
+  if (h == handles.end()) return ESP_ERR_INVALID_ARG;
+
+  auto &ns = namespaces[h->second.ns];
+  auto kv = ns.find(key);
+  if (kv == ns.end()) return ESP_ERR_NVS_NOT_FOUND;
+
+  *value = &kv->second;
+  return ESP_OK;
+}
+
+esp_err_t set(nvs_handle_t handle, const char *key, std::string value) {
+  auto h = handles.find(handle);
+  if (h == handles.end()) return ESP_ERR_INVALID_ARG;
+  if (!h->second.writable) return ESP_ERR_NVS_READ_ONLY;
+
+  auto &ns = namespaces[h->second.ns];
+  const size_t replaced = ns.count(key) ? ns[key].size() : 0;
+  if ((used() - replaced + value.size()) > nvs_sim::space) return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+
+  ns[key] = std::move(value);
+  nvs_sim::writes++;
+  return ESP_OK;
+}
+} // namespace
+
+namespace nvs_sim {
+
+size_t space = 16 * 1024;
+uint32_t commits = 0;
+uint32_t writes = 0;
+
+void erase() { namespaces.clear(); }
+
+} // namespace nvs_sim
+
+extern "C" {
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+  // read only, a namespace exists once something was written to it
+  if ((open_mode == NVS_READONLY) && (namespaces.count(name) == 0)) return ESP_ERR_NVS_NOT_FOUND;
+
+  namespaces[name];
+  handles[next_handle] = {name, open_mode == NVS_READWRITE};
+  *out_handle = next_handle++;
+
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) { handles.erase(handle); }
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  if (handles.count(handle) == 0) return ESP_ERR_INVALID_ARG;
+
+  nvs_sim::commits++;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+  const std::string *value;
+  const auto rc = get(handle, key, &value);
+  if (rc != ESP_OK) return rc;
+
+  // without a buffer the length is returned
+  if (out_value == nullptr) {
+    *length = value->size();
+    return ESP_OK;
+  }
+
+  if (*length < value->size()) return ESP_ERR_NVS_INVALID_LENGTH;
+
+  memcpy(out_value, value->data(), value->size());
+  *length = value->size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length) {
+  const std::string *value;
+  const auto rc = get(handle, key, &value);
+  if (rc != ESP_OK) return rc;
+
+  // lengths include the terminating nul
+  if (out_value == nullptr) {
+    *length = value->size() + 1;
+    return ESP_OK;
+  }
+
+  if (*length < (value->size() + 1)) return ESP_ERR_NVS_INVALID_LENGTH;
+
+  memcpy(out_value, value->c_str(), value->size() + 1);
+  *length = value->size() + 1;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+  return set(handle, key, std::string((const char *)value, length));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value) {
+  return set(handle, key, value);
+}
+}
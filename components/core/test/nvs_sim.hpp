@@ -0,0 +1,38 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// nvs for the host tests, the nvs api stand-in (nvs.h) keeps the namespaces in memory.  values
+// are written at once (as the nvs partition does), commit only counts.  a value that does not
+// fit the space remaining is refused.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nvs_sim {
+
+extern size_t space;      // bytes of values the partition holds
+extern uint32_t commits;  // nvs_commit() calls
+extern uint32_t writes;   // values written
+
+void erase(); // every namespace, as nvs_flash_erase()
+
+} // namespace nvs_sim
@@ -0,0 +1,142 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// ProfileCache on the nvs stand-in (nvs_sim.hpp): a saved profile is loaded (as at boot) and
+// unpacked, a profile matches only with the same version and hostname, profiles without a
+// version or too large are not cached and an nvs failure leaves the cached profile as it was.
+// replace() changes the profile in use without writing nvs.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "ArduinoJson.h"
+#include "host_test.h"
+#include "nvs_sim.hpp"
+#include "profile_cache.hpp"
+
+using ruth::ProfileCache;
+
+static std::string packed(const char *name, const char *version, size_t pad = 0) {
+  DynamicJsonDocument doc(pad + 256);
+  doc["meta"]["name"] = name;
+  if (version) doc["meta"]["version"] = version;
+  if (pad) doc["pad"] = std::string(pad, 'x');
+
+  std::string bytes;
+  serializeMsgPack(doc, bytes);
+
+  return bytes;
+}
+
+static bool matches(const std::string &bytes, const char *hostname) {
+  return ProfileCache::matches(bytes.data(), bytes.size(), hostname);
+}
+
+static bool save(const std::string &bytes, const char *hostname) {
+  return ProfileCache::save(bytes.data(), bytes.size(), hostname);
+}
+
+static std::string unpackedName() {
+  StaticJsonDocument<512> doc;
+  if (!ProfileCache::unpack(doc)) return "";
+
+  return doc["meta"]["name"] | "";
+}
+
+static void empty() {
+  const auto v1 = packed("one", "1");
+
+  CHECK(ProfileCache::load() == false, "loaded from empty nvs");
+  CHECK(ProfileCache::hostname()[0] == 0x00, "hostname '%s' without a profile", ProfileCache::hostname());
+  CHECK(matches(v1, "host-a") == false, "matched without a profile");
+
+  StaticJsonDocument<64> doc;
+  CHECK(ProfileCache::unpack(doc) == false, "unpacked without a profile");
+}
+
+static void saveLoad() {
+  const auto v1 = packed("one", "1");
+
+  CHECK(save(v1, "host-a"), "save failed");
+  CHECK(nvs_sim::commits == 1, "%u commits", nvs_sim::commits);
+
+  // saving leaves the profile in use (none) unchanged
+  CHECK(matches(v1, "host-a") == false, "matched before loaded");
+
+  CHECK(ProfileCache::load(), "load failed");
+  CHECK(strcmp(ProfileCache::version(), "1") == 0, "version '%s'", ProfileCache::version());
+  CHECK(strcmp(ProfileCache::hostname(), "host-a") == 0, "hostname '%s'", ProfileCache::hostname());
+  CHECK(unpackedName() == "one", "unpacked '%s'", unpackedName().c_str());
+}
+
+static void matching() {
+  CHECK(matches(packed("one", "1"), "host-a"), "same version and hostname not matched");
+  CHECK(matches(packed("renamed", "1"), "host-a"), "same version (other content) not matched");
+  CHECK(matches(packed("one", "2"), "host-a") == false, "other version matched");
+  CHECK(matches(packed("one", "1"), "host-b") == false, "other hostname matched");
+  CHECK(matches(packed("one", nullptr), "host-a") == false, "profile without a version matched");
+}
+
+static void refused() {
+  const auto writes = nvs_sim::writes;
+
+  CHECK(save(packed("none", nullptr), "host-a") == false, "saved without a version");
+  CHECK(save(packed("large", "3", 5000), "host-a") == false, "saved a profile too large");
+  CHECK(nvs_sim::writes == writes, "refused profiles written to nvs");
+
+  // nvs full, the profile saved before remains
+  nvs_sim::space = 16;
+  CHECK(save(packed("full", "4"), "host-a") == false, "saved beyond the nvs space");
+  nvs_sim::space = 16 * 1024;
+
+  CHECK(ProfileCache::load() && (strcmp(ProfileCache::version(), "1") == 0),
+        "after failed saves version '%s'", ProfileCache::version());
+}
+
+static void replacing() {
+  const auto writes = nvs_sim::writes;
+  const auto v5 = packed("five", "5");
+
+  ProfileCache::replace(v5.data(), v5.size(), "host-b");
+
+  CHECK(nvs_sim::writes == writes, "replace wrote nvs");
+  CHECK(strcmp(ProfileCache::version(), "5") == 0, "replaced version '%s'", ProfileCache::version());
+  CHECK(strcmp(ProfileCache::hostname(), "host-b") == 0, "replaced hostname '%s'", ProfileCache::hostname());
+  CHECK(matches(v5, "host-b"), "replaced profile not matched");
+  CHECK(unpackedName() == "five", "replaced unpacked '%s'", unpackedName().c_str());
+
+  // the next boot loads the copy in nvs
+  CHECK(ProfileCache::load() && (strcmp(ProfileCache::version(), "1") == 0), "reloaded version '%s'",
+        ProfileCache::version());
+}
+
+int main() {
+  empty();
+  saveLoad();
+  matching();
+  refused();
+  replacing();
+
+  printf("profile cache: save, load, match and replace\n");
+
+  return host_test_result();
+}
@@ -0,0 +1,257 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// profile changes delivered through the message path (the broker, ruth_mqtt and Core::loop)
+// to the engines themselves: core::Engines on the pwm engine (simulated LEDC), the ds engine
+// (simulated 1-Wire bus) and the i2c engine (simulated i2c bus).  each new version is applied
+// in place, without a restart:
+//  v1  pwm and i2c report every second, ds every 2s with change detection
+//  v2  pwm every 500ms, ds every 3s without change detection, i2c removed (stopped)
+//  v3  pwm removed (its pins turned off), ds change detection again, i2c restarted
+// the ds intervals are at least twice the DS18B20 convert (750ms) so each report converts.
+// then v4 adds the light desk, which shares the pwm pins and restarts the device.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "ArduinoJson.h"
+#include "boot_sim.hpp"
+#include "host_broker.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "i2c_sim.hpp"
+#include "ledc_sim.hpp"
+#include "lightdesk/lightdesk.hpp"
+#include "owb/owb_sim.h"
+#include "owb/owb_rmt.h"
+
+using host::Broker;
+
+static constexpr uint32_t SETTLE_MS = 1500; // a change applies by the next report (pwm)
+static constexpr uint32_t WINDOW_MS = 8000; // report intervals are measured over
+static constexpr uint32_t CHANGE_MS = 100;
+
+static owb_sim_driver_info owb_info = {};
+static OneWireBus *owb = nullptr;
+static std::string ds18b20, ds2408; // idents
+static constexpr int DS2408_DEVICE = 2;
+
+static i2c_sim::SHT31 sht31(0x44);
+static const char *SHT31_IDENT = "/i2c.0123456789ab.sht31.44/";
+static const char *PWM_IDENT = "/pwm.0123456789ab/";
+
+static uint32_t desks = 0;
+
+// the ds engine is started (by Engines::configure) without a bus, the simulated bus it is
+OneWireBus *owb_rmt_initialize(owb_rmt_driver_info *, uint8_t, rmt_channel_t, rmt_channel_t) {
+  return owb;
+}
+
+// the light desk (dmx and headunits) is not simulated, only its creation is counted
+lightdesk::LightDesk::LightDesk(const Opts &opts) { desks++; }
+
+static std::string identOf(int device) {
+  OneWireBus_ROMCode rom;
+  owb_sim_rom_code(&owb_info, device, &rom);
+
+  char ident[18];
+  char *p = ident + sprintf(ident, "ds.");
+  for (int b = 0; b < 7; b++) p += sprintf(p, "%02x", rom.bytes[b]);
+
+  return ident;
+}
+
+// messages published to topics containing part from from_us, the mean interval between them
+// (ms) in interval_ms
+static size_t published(const std::string &part, uint64_t from_us, double *interval_ms = nullptr) {
+  size_t count = 0;
+  uint64_t first_us = 0, last_us = 0;
+
+  for (const auto &msg : Broker::published) {
+    if ((msg.at_us < from_us) || (msg.topic.find(part) == std::string::npos)) continue;
+
+    if (count++ == 0) first_us = msg.at_us;
+    last_us = msg.at_us;
+  }
+
+  if (interval_ms) *interval_ms = (count > 1) ? ((last_us - first_us) / 1e3 / (count - 1)) : 0;
+
+  return count;
+}
+
+static bool intervalNear(const std::string &part, uint64_t from_us, uint32_t want_ms) {
+  double interval_ms = 0;
+  published(part, from_us, &interval_ms);
+
+  // reports follow a discover now and then, allow a tenth
+  const auto ok = (interval_ms > (want_ms * 0.9)) && (interval_ms < (want_ms * 1.1));
+  if (!ok) printf("%s interval %.1fms, want %ums\n", part.c_str(), interval_ms, want_ms);
+
+  return ok;
+}
+
+// the profile of a version, engines with a zero interval are not included
+struct Version {
+  const char *version;
+  uint32_t pwm_ms;
+  uint32_t ds_ms;
+  uint32_t change_ms;
+  uint32_t i2c_ms;
+  bool lightdesk;
+};
+
+static uint64_t mtimeNow() {
+  struct timeval now {};
+  gettimeofday(&now, nullptr);
+
+  return ((uint64_t)now.tv_sec * 1000) + (now.tv_usec / 1000);
+}
+
+static void deliver(const Version &v) {
+  DynamicJsonDocument doc(2048);
+  doc["meta"]["name"] = "engines";
+  doc["meta"]["version"] = v.version;
+  doc["mtime"] = mtimeNow();
+
+  auto tasks = [](JsonObject engine, uint32_t send_ms) {
+    engine["command"]["stack"] = 4096;
+    engine["command"]["pri"] = 13;
+    engine["report"]["stack"] = 4096;
+    engine["report"]["pri"] = 1;
+    engine["report"]["send_ms"] = send_ms;
+    return engine;
+  };
+
+  if (v.pwm_ms) tasks(doc.createNestedObject("pwm"), v.pwm_ms);
+  if (v.ds_ms) {
+    auto ds = tasks(doc.createNestedObject("dalsemi"), v.ds_ms);
+    ds["report"]["loops_per_discover"] = 10;
+    ds["report"]["change_ms"] = v.change_ms;
+  }
+  if (v.i2c_ms) tasks(doc.createNestedObject("i2c"), v.i2c_ms);
+  if (v.lightdesk) doc["lightdesk"]["dmx_port"] = 48005;
+
+  std::string packed;
+  serializeMsgPack(doc, packed);
+
+  boot_sim::deliverProfile(packed, "engines-host");
+}
+
+static void pwmCommand(uint8_t pin, const char *cmd) {
+  StaticJsonDocument<128> doc;
+  doc["mtime"] = mtimeNow();
+  doc["cmd"] = cmd;
+  doc["pin"] = pin;
+
+  std::string packed;
+  serializeMsgPack(doc, packed);
+
+  Broker::deliver("ruth/c2/ruth.0123456789ab/pwm/pwm.0123456789ab/pin-on", packed);
+}
+
+// the DS2408 reports a change of its inputs within the change interval (and its search).  the
+// change follows a full report, converting the DS18B20s holds the bus for most of a second.
+static bool changeReported(uint8_t inputs) {
+  const auto report_at = host_rtos_now_us();
+  boot_sim::waitUntil([&] { return published("/celsius/" + ds18b20, report_at) > 0; }, 5000);
+
+  const auto changed_at = host_rtos_now_us();
+  owb_sim_set_inputs(&owb_info, DS2408_DEVICE, inputs);
+
+  const auto status = "/status/" + ds2408;
+  return boot_sim::waitUntil([&] { return published(status, changed_at) > 0; }, CHANGE_MS + 50);
+}
+
+// applies the version then measures the report intervals, returns when the window starts
+static uint64_t apply(const Version &v) {
+  deliver(v);
+  vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+
+  const auto from_us = host_rtos_now_us();
+  vTaskDelay(pdMS_TO_TICKS(WINDOW_MS));
+
+  return from_us;
+}
+
+static int testMain() {
+  using namespace boot_sim;
+
+  owb_info.clock_us = host_rtos_now_us;
+  owb_info.busy_us = host_rtos_wait_us;
+  owb = owb_sim_initialize(&owb_info);
+  owb_sim_add_ds18b20(&owb_info, 0x00c0ffee0000, 21.0f, false);
+  owb_sim_add_ds18b20(&owb_info, 0x00c0ffee0001, 22.0f, false);
+  owb_sim_add_ds2408(&owb_info, 0x00c0ffee0002);
+  ds18b20 = identOf(0);
+  ds2408 = identOf(DS2408_DEVICE);
+
+  i2c_sim::add(&sht31);
+
+  xTaskCreate(bootTask, "main", 4096, nullptr, 1, nullptr);
+  CHECK(waitUntil([] { return publishedAt("/host/startup") != NOT_YET; }, 30000), "no startup message");
+
+  // v1, the engines start at boot
+  const auto v1_at = apply({"1", 1000, 2000, CHANGE_MS, 1000, false});
+  CHECK(publishedAt("/host/boot/engines") != NOT_YET, "boot not complete");
+  CHECK(intervalNear(PWM_IDENT, v1_at, 1000), "v1 pwm interval");
+  CHECK(intervalNear("/celsius/" + ds18b20, v1_at, 2000), "v1 ds interval");
+  CHECK(intervalNear(SHT31_IDENT, v1_at, 1000), "v1 i2c interval");
+  CHECK(changeReported(0xfe), "v1 DS2408 change not reported");
+
+  pwmCommand(1, "on");
+  CHECK(waitUntil([] { return ledc_sim::channel(1).duty > 0; }, 1000), "pwm pin 1 not on");
+
+  // v2, intervals changed in place, change detection disabled and i2c stopped
+  const auto v2_at = apply({"2", 500, 3000, 0, 0, false});
+  CHECK(intervalNear(PWM_IDENT, v2_at, 500), "v2 pwm interval");
+  CHECK(intervalNear("/celsius/" + ds18b20, v2_at, 3000), "v2 ds interval");
+  CHECK(published(SHT31_IDENT, v2_at) == 0, "i2c reported after removed");
+
+  owb_sim_set_inputs(&owb_info, DS2408_DEVICE, 0xfc);
+  CHECK(owb_sim_conditional(&owb_info, DS2408_DEVICE) == false, "DS2408 change detection still enabled");
+  CHECK(ledc_sim::channel(1).duty > 0, "pwm pin 1 turned off by a reconfigure");
+
+  // v3, pwm stopped (its pins off), change detection enabled again and i2c restarted
+  const auto v3_at = apply({"3", 0, 3000, CHANGE_MS, 1000, false});
+  CHECK(published(PWM_IDENT, v3_at) == 0, "pwm reported after removed");
+  CHECK(ledc_sim::channel(1).duty == 0, "pwm pin 1 duty %u after removed", ledc_sim::channel(1).duty);
+  CHECK(intervalNear("/celsius/" + ds18b20, v3_at, 3000), "v3 ds interval");
+  CHECK(intervalNear(SHT31_IDENT, v3_at, 1000), "v3 i2c interval");
+  CHECK(changeReported(0xff), "v3 DS2408 change not reported");
+
+  CHECK(restarts == 0, "%u restarts", restarts);
+
+  // v4, the light desk needs the pwm pins, the device restarts (from the cached v4)
+  deliver({"4", 0, 2000, CHANGE_MS, 1000, true});
+  CHECK(waitUntil([] { return restarts > 0; }, 1000), "no restart to add the light desk");
+  CHECK(desks == 0, "light desk created in place");
+
+  printf("profile: v1 to v3 applied in place (pwm, ds and i2c), v4 (light desk) restarted\n");
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
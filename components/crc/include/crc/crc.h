@@ -0,0 +1,54 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+
+#ifndef ruth_crc_h
+#define ruth_crc_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// table driven crc kernels shared by the 1-Wire and I2C devices.
+//
+// each function continues from the crc passed so a crc may be accumulated as
+// data arrives (pass the initial value for the first call).
+
+#define CRC8_MAXIM_INIT 0x00
+#define CRC8_SENSIRION_INIT 0xff
+#define CRC16_MAXIM_INIT 0x0000
+
+// 1-Wire rom codes and scratchpads, a buffer including its crc yields zero
+uint8_t crc8_maxim_update(uint8_t crc, const uint8_t *data, size_t len);
+
+// Sensirion (e.g. SHT31) measurement words
+uint8_t crc8_sensirion_update(uint8_t crc, const uint8_t *data, size_t len);
+
+// 1-Wire CRC16 (e.g. DS2408), devices transmit the inverted crc
+uint16_t crc16_maxim_update(uint16_t crc, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,235 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// cross checks the table driven crcs against bitwise references and the implementations
+// they replaced (owb crc8 table, ds checkCrc16 parity, SHT31 bitwise) then times them.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "crc/crc.h"
+#include "host_test.h"
+
+//
+// bitwise references
+//
+
+static uint8_t ref_crc8_maxim(uint8_t crc, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 0x01) ? (crc >> 1) ^ 0x8c : (crc >> 1);
+  }
+
+  return crc;
+}
+
+static uint8_t ref_crc8_sensirion(uint8_t crc, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+  }
+
+  return crc;
+}
+
+static uint16_t ref_crc16_maxim(uint16_t crc, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) crc = (crc & 0x0001) ? (crc >> 1) ^ 0xa001 : (crc >> 1);
+  }
+
+  return crc;
+}
+
+// ds::checkCrc16 before the crc component, the last two bytes are the inverted crc
+static bool old_check_crc16(const uint8_t *start, const uint8_t *end) {
+  static const uint8_t oddparity[16] = {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0};
+
+  uint16_t crc_calc = 0x00;
+  for (const uint8_t *p = start; p < (end - 2); p++) {
+    uint16_t cdata = (*p ^ crc_calc) & 0xff;
+    crc_calc >>= 8;
+
+    if (oddparity[cdata & 0x0f] ^ oddparity[cdata >> 4]) crc_calc ^= 0xc001;
+
+    cdata <<= 6;
+    crc_calc ^= cdata;
+    cdata <<= 1;
+    crc_calc ^= cdata;
+  }
+
+  crc_calc = ~crc_calc;
+
+  const uint8_t *inverted_crc = end - 2;
+  return (crc_calc & 0xff) == *inverted_crc++ && (crc_calc >> 8) == *inverted_crc;
+}
+
+// SHT31::crc before the crc component, two data bytes followed by their crc
+static bool old_sht31_crc(const uint8_t *data, size_t index) {
+  uint8_t crc = 0xff;
+
+  for (size_t j = 0; j < 2; j++) {
+    crc ^= data[j + index];
+
+    for (size_t i = 0; i < 8; i++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+  }
+
+  return (crc == data[index + 2]);
+}
+
+static uint32_t rng = 0x2545f491;
+
+static uint8_t random_byte(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+
+  return rng & 0xff;
+}
+
+//
+// tests
+//
+
+static void check_values(void) {
+  static const uint8_t check[] = "123456789";
+  const size_t len = sizeof(check) - 1;
+
+  // catalogued check values (CRC-8/MAXIM-DOW, CRC-8/NRSC-5 and CRC-16/ARC)
+  CHECK(crc8_maxim_update(CRC8_MAXIM_INIT, check, len) == 0xa1, "crc8 maxim check value");
+  CHECK(crc8_sensirion_update(CRC8_SENSIRION_INIT, check, len) == 0xf7, "crc8 sensirion check value");
+  CHECK(crc16_maxim_update(CRC16_MAXIM_INIT, check, len) == 0xbb3d, "crc16 maxim check value");
+
+  // the example in the SHT3x datasheet
+  static const uint8_t beef[] = {0xbe, 0xef};
+  CHECK(crc8_sensirion_update(CRC8_SENSIRION_INIT, beef, 2) == 0x92, "crc8 sensirion datasheet example");
+}
+
+static void exhaustive_single_byte(void) {
+  // every crc state with every data byte, streaming only ever continues from one of these
+  for (unsigned crc = 0; crc <= 0xff; crc++) {
+    for (unsigned b = 0; b <= 0xff; b++) {
+      const uint8_t data = b;
+
+      CHECK(crc8_maxim_update(crc, &data, 1) == ref_crc8_maxim(crc, &data, 1), "crc8 maxim %02x %02x", crc,
+            b);
+      CHECK(crc8_sensirion_update(crc, &data, 1) == ref_crc8_sensirion(crc, &data, 1),
+            "crc8 sensirion %02x %02x", crc, b);
+    }
+  }
+
+  for (unsigned crc = 0; crc <= 0xffff; crc++) {
+    for (unsigned b = 0; b <= 0xff; b++) {
+      const uint8_t data = b;
+
+      if (crc16_maxim_update(crc, &data, 1) != ref_crc16_maxim(crc, &data, 1)) {
+        CHECK(false, "crc16 maxim %04x %02x", crc, b);
+        return;
+      }
+    }
+  }
+}
+
+static void buffers(void) {
+  uint8_t buff[66];
+
+  for (int round = 0; round < 20000; round++) {
+    const size_t len = round % 65;
+    for (size_t i = 0; i < len; i++) buff[i] = random_byte();
+
+    // accumulated in two parts (as data arrives) matches a single pass
+    const size_t split = len ? (random_byte() % (len + 1)) : 0;
+
+    uint8_t crc8 = crc8_maxim_update(CRC8_MAXIM_INIT, buff, split);
+    crc8 = crc8_maxim_update(crc8, buff + split, len - split);
+    CHECK(crc8 == ref_crc8_maxim(CRC8_MAXIM_INIT, buff, len), "crc8 maxim len %zu split %zu", len, split);
+
+    uint8_t sens = crc8_sensirion_update(CRC8_SENSIRION_INIT, buff, split);
+    sens = crc8_sensirion_update(sens, buff + split, len - split);
+    CHECK(sens == ref_crc8_sensirion(CRC8_SENSIRION_INIT, buff, len), "crc8 sensirion len %zu", len);
+
+    uint16_t crc16 = crc16_maxim_update(CRC16_MAXIM_INIT, buff, split);
+    crc16 = crc16_maxim_update(crc16, buff + split, len - split);
+    CHECK(crc16 == ref_crc16_maxim(CRC16_MAXIM_INIT, buff, len), "crc16 maxim len %zu", len);
+
+    // a buffer followed by its crc8 yields zero (rom codes, scratchpads)
+    buff[len] = crc8;
+    CHECK(crc8_maxim_update(CRC8_MAXIM_INIT, buff, len + 1) == 0, "crc8 maxim residue len %zu", len);
+
+    // DS2408 style, the inverted crc16 follows the data and the old check agrees
+    const uint16_t inverted = ~crc16;
+    buff[len] = inverted & 0xff;
+    buff[len + 1] = inverted >> 8;
+    CHECK(old_check_crc16(buff, buff + len + 2), "old checkCrc16 disagrees len %zu", len);
+
+    buff[len + 1] ^= 0x01;
+    CHECK(!old_check_crc16(buff, buff + len + 2), "old checkCrc16 accepted a bad crc len %zu", len);
+
+    // SHT31 measurement word followed by its crc
+    if (len >= 2) {
+      buff[2] = crc8_sensirion_update(CRC8_SENSIRION_INIT, buff, 2);
+      CHECK(old_sht31_crc(buff, 0), "old SHT31 crc disagrees");
+    }
+  }
+}
+
+//
+// benchmark
+//
+
+static void benchmark(void) {
+  // a DS2408 channel access read (34 bytes) is the longest buffer checked
+  enum { LEN = 34, ROUNDS = 200000 };
+  uint8_t buff[LEN];
+  for (size_t i = 0; i < LEN; i++) buff[i] = random_byte();
+
+  volatile uint32_t sink = 0;
+  uint64_t start;
+
+  start = host_test_ns();
+  for (int i = 0; i < ROUNDS; i++) sink += crc16_maxim_update(CRC16_MAXIM_INIT, buff, LEN);
+  const double table16 = (double)(host_test_ns() - start) / ((double)ROUNDS * LEN);
+
+  start = host_test_ns();
+  for (int i = 0; i < ROUNDS; i++) sink += old_check_crc16(buff, buff + LEN);
+  const double parity16 = (double)(host_test_ns() - start) / ((double)ROUNDS * (LEN - 2));
+
+  start = host_test_ns();
+  for (int i = 0; i < ROUNDS; i++) sink += crc8_sensirion_update(CRC8_SENSIRION_INIT, buff, LEN);
+  const double table8 = (double)(host_test_ns() - start) / ((double)ROUNDS * LEN);
+
+  start = host_test_ns();
+  for (int i = 0; i < ROUNDS; i++) sink += ref_crc8_sensirion(CRC8_SENSIRION_INIT, buff, LEN);
+  const double bitwise8 = (double)(host_test_ns() - start) / ((double)ROUNDS * LEN);
+
+  printf("ns/byte crc16 table[%.2f] parity[%.2f] crc8 table[%.2f] bitwise[%.2f]\n", table16, parity16, table8,
+         bitwise8);
+}
+
+int main(void) {
+  check_values();
+  exhaustive_single_byte();
+  buffers();
+  benchmark();
+
+  return host_test_result();
+}
@@ -22,46 +22,63 @@
 
 #include <esp_attr.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
-#include "bus.hpp"
+#include "dev_ds/bus.hpp"
 #include "owb/owb.h"
+#include "ruth_log/dlog.hpp"
 
 namespace ds {
 
 static const char *TAG = "ds:bus";
 
-static TaskHandle_t bus_holder = nullptr;
-static SemaphoreHandle_t mutex = nullptr;
-static owb_rmt_driver_info rmt_driver = {};
-static OneWireBus *owb = nullptr;
-static uint8_t powered = false;
-
-static owb_status status = OWB_STATUS_OK;
-static OneWireBus_SearchState state = {};
-static bool present = false;
-
-static inline bool ok() { return status == OWB_STATUS_OK; }
+Bus::Bus(uint8_t num, uint8_t pin, uint32_t convert_frequency_ms)
+    : _num(num), _pin(pin), _convert_micros(1000 * convert_frequency_ms) {
+  // ensure the first call to convert performs a convert
+  _convert_last = esp_timer_get_time() - _convert_micros;
+}
 
-bool Bus::acquire(uint32_t timeout_ms) {
+bool Bus::acquire(uint32_t timeout_ms, Priority prio) {
 
   auto rc = false;
-  const UBaseType_t wait_ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+  UBaseType_t wait_ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
 
   auto bus_requestor = xTaskGetCurrentTaskHandle();
 
-  if (bus_requestor == bus_holder) {
+  if (bus_requestor == _holder) {
     return true;
   }
 
-  auto take_rc = xSemaphoreTake(mutex, wait_ticks);
+  const auto start_at = esp_timer_get_time();
+
+  if (prio == HIGH) {
+    _high_waiting++;
+  } else {
+    // defer to waiting high priority requestors so a yielding low priority holder
+    // doesn't immediately take the bus back
+    while ((_high_waiting > 0) && (wait_ticks > 0)) {
+      vTaskDelay(1);
+      if (wait_ticks != portMAX_DELAY) wait_ticks--;
+    }
+  }
+
+  auto take_rc = xSemaphoreTake(_mutex, wait_ticks);
+
+  if (prio == HIGH) _high_waiting--;
 
   if (take_rc == pdTRUE) {
-    bus_holder = bus_requestor;
-    ESP_LOGD(TAG, "ACQUIRE bus holder: %p", bus_holder);
+    _holder = bus_requestor;
+    ESP_LOGD(TAG, "ACQUIRE bus holder: %p", _holder);
     rc = true;
+
+    const auto wait_ms = (esp_timer_get_time() - start_at) / 1000;
+    size_t bucket = 0;
+    while ((bucket < (wait_buckets - 1)) && (wait_ms >= wait_bucket_ms[bucket])) bucket++;
+
+    _wait_hist[prio][bucket]++;
   } else {
     ESP_LOGW(TAG, "semaphore take failed: %d", take_rc);
   }
@@ -69,126 +86,159 @@ bool Bus::acquire(uint32_t timeout_ms) {
   return rc;
 }
 
-bool Bus::ensure() {
-  constexpr uint8_t pin = 14;
-  owb = owb_rmt_initialize(&rmt_driver, pin, RMT_CHANNEL_0, RMT_CHANNEL_1);
+void Bus::allowOverdrive(bool allow) {
+  _od_allowed = allow;
+
+  if (!allow && _od_active) exitOverdrive();
+}
+
+bool Bus::ensure(OneWireBus *owb) {
+  const auto tx_channel = (rmt_channel_t)(_num * 2);
+  const auto rx_channel = (rmt_channel_t)((_num * 2) + 1);
+
+  // an already initialized owb (e.g. the simulated backend) replaces the rmt backend
+  _owb = owb ? owb : owb_rmt_initialize(&_rmt_driver, _pin, tx_channel, rx_channel);
 
-  if (owb) {
-    owb_use_crc(owb, true);
+  if (_owb) {
+    owb_use_crc(_owb, true);
 
-    mutex = xSemaphoreCreateMutex();
-    xSemaphoreGive(mutex);
-    // checkPowered();
+    _mutex = xSemaphoreCreateMutex();
+    xSemaphoreGive(_mutex);
     return true;
   }
 
-  ESP_LOGW(TAG, "owb rmt initialization failed");
+  ESP_LOGW(TAG, "owb rmt initialization failed, bus[%u] pin[%u]", _num, _pin);
   return false;
 }
 
 IRAM_ATTR bool Bus::error() {
-  auto const rc = status != OWB_STATUS_OK;
+  auto const rc = _status != OWB_STATUS_OK;
 
   if (rc == true) {
-    ESP_LOGW(TAG, "error: %d", status);
+    DLOGW(TAG, "error: %d", _status);
   }
 
   return rc;
 }
 
-IRAM_ATTR void Bus::checkPowered() {
+bool Bus::checkPowered() {
   static const uint8_t read_powered_cmd[] = {0xcc, 0xb4};
   static constexpr size_t len = sizeof(read_powered_cmd);
 
+  _powered = false;
+
   if (reset()) {
-    status = owb_write_bytes(owb, read_powered_cmd, len);
+    _status = owb_write_bytes(_owb, read_powered_cmd, len);
 
-    if (ok()) {
-      status = owb_read_byte(owb, &powered);
-    }
+    // parasite powered devices pull the read slot low
+    uint8_t powered = 0x00;
+    if (ok()) _status = owb_read_byte(_owb, &powered);
+    if (ok()) _powered = powered & 0x01;
   }
+
+  reset();
+
+  return _powered;
 }
 
-IRAM_ATTR bool Bus::convert(bool &complete, bool cancel) {
-  static uint8_t convert_status = 0;
-  static bool in_progress = false;
+IRAM_ATTR bool Bus::convertStart() {
+  static const uint8_t convert_cmd[] = {0xcc, 0x44};
+  static constexpr size_t len = sizeof(convert_cmd);
 
-  if (cancel) {
-    reset();
-    in_progress = false;
-    complete = true;
-    return true;
-  }
+  if (reset()) {
+    _status = owb_write_bytes(_owb, convert_cmd, len);
 
-  // the in-progress code path is executed multiple times so it must be the most efficient
-  if (in_progress) {
-    // NOTE:  do not reset the bus while the convert is in progress
-    status = owb_read_byte(owb, &convert_status);
+    if (ok()) return true;
+  }
 
-    if (error()) {
-      convert(complete, true); // call ourself with cancel = true
-      return false;            // signal error
-    }
+  reset();
+  return false;
+}
 
-    // devices hold the bus low while converting; a non-zero indicates convert complete
-    if (convert_status) {
-      return convert(complete, true); // call ourself to reset the convert
-    }
+IRAM_ATTR bool Bus::convertWait(bool &complete) {
+  // NOTE:  do not reset the bus while the convert is in progress
+  //
+  // devices hold the bus low during read slots while converting.  the train of read slots is
+  // one rmt transaction (56 slots, ~4ms at standard speed) that always runs to the end, any
+  // slot reading high means the convert completed during the train.
+  uint8_t slots[7] = {};
+  _status = owb_read_bytes(_owb, slots, sizeof(slots));
 
-    complete = false;
-    return true;
+  if (error()) {
+    reset();
+    return false;
   }
 
-  // the start code path is executed once per convert
-  // convert not started, let's start it
-  static uint8_t convert_cmd[] = {0xcc, 0x44};
-  static constexpr size_t len = sizeof(convert_cmd);
+  complete = false;
+  for (auto slot : slots) complete = complete || slot;
 
-  if (reset()) {
-    status = owb_write_bytes(owb, convert_cmd, len);
+  // convert complete, reset the bus for the scratchpad reads that follow
+  if (complete) reset();
 
-    if (error()) {
-      convert(complete, true);
-      return false;
-    }
+  return true;
+}
 
-    complete = false;
-    in_progress = true;
-    return true;
+IRAM_ATTR bool Bus::enterOverdrive() {
+  // a standard speed reset followed by overdrive skip rom places every capable device into overdrive
+  _status = owb_reset(_owb, &_present);
+
+  if (ok() && _present) _status = owb_write_byte(_owb, OWB_ROM_SKIP_OVERDRIVE);
+  if (ok() && _present) _status = owb_set_speed(_owb, OWB_SPEED_OVERDRIVE);
+
+  _od_active = ok() && _present;
+
+  if (!_od_active) {
+    DLOGW(TAG, "enter overdrive failed: [%d]", _status);
+    _od_allowed = false;
+    owb_set_speed(_owb, OWB_SPEED_STANDARD);
   }
 
-  // the reset before starting the convert failed
-  convert(complete, true); // call ourself to reset
-  return false;
+  return _od_active;
 }
 
-IRAM_ATTR uint8_t Bus::lastStatus() { return status; }
+IRAM_ATTR void Bus::exitOverdrive() {
+  // a standard speed reset returns every device to standard speed
+  owb_set_speed(_owb, OWB_SPEED_STANDARD);
+  _status = owb_reset(_owb, &_present);
 
-// typedef enum
-// {
-//     OWB_STATUS_OK,
-//     OWB_STATUS_NOT_INITIALIZED,
-//     OWB_STATUS_PARAMETER_NULL,
-//     OWB_STATUS_DEVICE_NOT_RESPONDING,
-//     OWB_STATUS_CRC_FAILED,
-//     OWB_STATUS_TOO_MANY_BITS,
-//     OWB_STATUS_HW_ERROR
-// } owb_status;
+  _od_active = false;
+}
+
+bool Bus::probeOverdrive(const uint8_t *rom_code) {
+  auto capable = false;
+
+  if (_od_active) exitOverdrive();
 
-IRAM_ATTR bool Bus::ok() { return status == OWB_STATUS_OK; }
+  // overdrive match rom is sent at standard speed, the rom code that follows at overdrive
+  _status = owb_reset(_owb, &_present);
+
+  if (ok() && _present) _status = owb_write_byte(_owb, OWB_ROM_MATCH_OVERDRIVE);
+  if (ok() && _present) _status = owb_set_speed(_owb, OWB_SPEED_OVERDRIVE);
+  if (ok() && _present) _status = owb_write_bytes(_owb, rom_code, sizeof(OneWireBus_ROMCode));
+
+  // only the matched device, when capable, answers an overdrive reset with a presence pulse
+  if (ok() && _present) {
+    _status = owb_reset(_owb, &_present);
+    capable = ok() && _present;
+  }
+
+  exitOverdrive();
+
+  return capable;
+}
 
 bool Bus::release() {
   auto task = xTaskGetCurrentTaskHandle();
 
-  if (task != bus_holder) {
+  if (task != _holder) {
     return false;
   }
 
   auto rc = false;
 
-  ESP_LOGD(TAG, "RELEASE bus holder %p", bus_holder);
-  bus_holder = nullptr;
-  auto give_rc = xSemaphoreGive(mutex);
+  ESP_LOGD(TAG, "RELEASE bus holder %p", _holder);
+  _holder = nullptr;
+  auto give_rc = xSemaphoreGive(_mutex);
 
   if (give_rc == pdTRUE) {
     rc = true;
@@ -200,50 +250,105 @@ bool Bus::release() {
 }
 
 IRAM_ATTR bool Bus::reset() {
-  status = owb_reset(owb, &present);
-  if (status == OWB_STATUS_OK) return true;
+  _resets++;
 
-  ESP_LOGW(TAG, "reset failed: [%d]", status);
-  return false;
-}
+  if (_od_allowed && !_od_active) enterOverdrive();
+
+  _status = owb_reset(_owb, &_present);
+
+  if (_od_active && (!ok() || !_present)) {
+    // devices are no longer at overdrive (e.g. power glitch), fall back to standard speed
+    // until the next discover allows overdrive again
+    DLOGW(TAG, "overdrive reset failed, using standard speed");
+    _od_allowed = false;
+    exitOverdrive();
+  }
 
-IRAM_ATTR bool Bus::search(uint8_t *rom_code) {
+  if (_status == OWB_STATUS_OK) return true;
 
-  static bool in_progress = false;
+  DLOGW(TAG, "reset failed: [%d]", _status);
+  return false;
+}
 
+IRAM_ATTR bool Bus::search(uint8_t *rom_code, bool conditional, uint8_t family) {
   bool found = false;
 
+  // discovery is always performed at standard speed so devices without overdrive are found.
+  // conditional searches only involve known devices and may remain at overdrive.
+  if (_od_active && !conditional) exitOverdrive();
+
   if (reset()) {
-    if (in_progress) {
-      status = owb_search_next(owb, &state, &found);
+    if (_search_in_progress) {
+      _status = conditional ? owb_search_conditional_next(_owb, &_search_state, &found)
+                            : owb_search_next(_owb, &_search_state, &found);
+    } else if (family) {
+      // family search (Maxim AN187), the first search takes the path of the family code so
+      // devices of other families drop out at the first differing bit
+      _search_state = {};
+      _search_state.rom_code.fields.family[0] = family;
+      _search_state.last_discrepancy = 64;
+
+      _status = conditional ? owb_search_conditional_next(_owb, &_search_state, &found)
+                            : owb_search_next(_owb, &_search_state, &found);
     } else {
-      status = owb_search_first(owb, &state, &found);
+      _status = conditional ? owb_search_conditional_first(_owb, &_search_state, &found)
+                            : owb_search_first(_owb, &_search_state, &found);
     }
 
+    // a device of another family is found once the family is exhausted
+    if (family && found && (_search_state.rom_code.fields.family[0] != family)) found = false;
+
     if (ok() && found) {
       // a rom code was found, copy it to the caller and flag that a search
       // is in progress.
-      constexpr size_t len = sizeof(state.rom_code.bytes);
-      memcpy(rom_code, state.rom_code.bytes, len);
-      in_progress = true;
+      constexpr size_t len = sizeof(_search_state.rom_code.bytes);
+      memcpy(rom_code, _search_state.rom_code.bytes, len);
+      _search_in_progress = true;
       return true;
     }
   }
 
   // rom code not found, end of available devices or reset failed
-  in_progress = false;
+  _search_in_progress = false;
 
   return false;
 }
 
+bool Bus::writeThenHold(Bytes write, Len wlen, uint32_t hold_ms) {
+  auto rc = false;
+
+  if (reset()) {
+    _status = owb_write_bytes(_owb, write, wlen);
+    rc = ok();
+
+    // commands that write device eeprom (e.g. copy scratchpad) must not be interrupted by
+    // a reset until the write is complete
+    if (rc) vTaskDelay(pdMS_TO_TICKS(hold_ms));
+  }
+
+  reset();
+
+  return rc;
+}
+
+bool Bus::yield() {
+  if ((_high_waiting == 0) || (xTaskGetCurrentTaskHandle() != _holder)) return false;
+
+  release();
+  acquire(); // waits until the high priority requestor(s) have the bus
+
+  return true;
+}
+
 IRAM_ATTR bool Bus::writeThenRead(Bytes write, Len wlen, Bytes read, Len rlen) {
   auto rc = false;
 
   if (reset()) {
-    status = owb_write_bytes(owb, write, wlen);
+    _status = owb_write_bytes(_owb, write, wlen);
 
-    if (ok()) {
-      status = owb_read_bytes(owb, read, rlen);
+    // write only command sequences (e.g. write conditional search register) have nothing to read
+    if (ok() && rlen) {
+      _status = owb_read_bytes(_owb, read, rlen);
     }
 
     rc = true;
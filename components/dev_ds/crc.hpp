@@ -33,8 +33,12 @@ namespace ds {
 // };
 //
 // bool checkCrc16(const Crc16Opts &opts);
-bool checkCrc16(const uint8_t *start, const uint8_t *end);
+
+// continues the crc16 (seeded by crc16() over the command bytes) over data, the final
+// two bytes of data are the inverted crc sent by the device
+bool checkCrc16(uint16_t crc, const uint8_t *data, const size_t len);
 uint16_t crc8(const uint8_t *bytes, const size_t len);
+uint16_t crc16(const uint8_t *bytes, const size_t len);
 // uint16_t crc16(const Crc16Opts &opts);
 
 } // namespace ds
@@ -24,7 +24,7 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
-#include "bus.hpp"
+#include "dev_ds/bus.hpp"
 #include "dev_ds/ds.hpp"
 
 namespace ds {
@@ -32,29 +32,32 @@ static const char *TAG = "ds::device";
 
 inline auto now() { return esp_timer_get_time(); }
 
-Device::Device(const uint8_t *rom_code) : _timestamp(now()) {
+Device::Device(Bus *bus, const uint8_t *rom_code) : _bus(bus), _timestamp(now()) {
   // copy the rom code to the address
   memcpy(_addr, rom_code, sizeof(_addr));
 
   makeID();
 
-  // determine if this device requires a bus convert
+  // determine if this device requires a bus convert or may support overdrive
   switch (family()) {
   case 0x28:
     _needs_convert = true;
     break;
 
+  case 0x29:
+    _needs_convert = false;
+    // DS2408 supports overdrive, confirm this device responds at overdrive speed
+    _overdrive = _bus->probeOverdrive(_addr);
+    break;
+
   default:
     _needs_convert = false;
   }
 }
 
-IRAM_ATTR bool Device::acquireBus(uint32_t timeout_ms) { return Bus::acquire(timeout_ms); }
+IRAM_ATTR bool Device::acquireBus(uint32_t timeout_ms) { return _bus->acquire(timeout_ms); }
 
-uint8_t Device::busErrorCode() { return Bus::lastStatus(); }
-
-static uint32_t convert_micros = 0;
-static int64_t convert_last = 0;
+uint8_t Device::busErrorCode() { return _bus->lastStatus(); }
 
 IRAM_ATTR bool Device::convert() {
   bool complete = false;
@@ -63,41 +66,57 @@ IRAM_ATTR bool Device::convert() {
   // each device calls convert as part of it's status report.
   // but converts are a global operation on all temperature devices on the bus.
   // prevent repeated converts with a minimum time of 50% the reporting cycle.
-  const auto min_interval = convert_micros >> 1;
-  const auto since_last_convert = start_at - convert_last;
-  if (since_last_convert < min_interval) {
+  if (_bus->convertRecent(start_at)) {
 
     return true;
   }
 
-  while (Bus::convert(complete)) {
-    if (complete) break; // convert is complete
+  if (_bus->convertStart() == false) {
+    _bus->convertFinished(now());
+    return false;
+  }
+
+  // the bus knows the conversion time of the slowest (highest resolution) device present.
+  // no check is made until 3/4 of that time has passed.
+  const auto convert_max_us = _bus->convertMaxMicros();
+  const auto timeout_us = convert_max_us + Convert::TIMEOUT_MARGIN;
+  const auto early_ticks = pdMS_TO_TICKS((convert_max_us - (convert_max_us >> 2)) / 1000);
+  const auto resets = _bus->resets();
+
+  if (_bus->powered()) {
+    // externally powered devices convert without the bus, make it available to other tasks
+    // (e.g. switch commands) for the bulk of the conversion
+    _bus->release();
+    vTaskDelay(early_ticks);
+    _bus->acquire();
+  } else {
+    vTaskDelay(early_ticks);
+  }
 
-    vTaskDelay(Convert::CHECK_TICKS); // delay between checks
+  if (_bus->resets() != resets) {
+    // the bus was used by another task so read slots no longer report the conversion status,
+    // wait out the remainder of the conversion time
+    const int64_t remaining_us = convert_max_us - (now() - start_at);
+    if (remaining_us > 0) vTaskDelay(pdMS_TO_TICKS(remaining_us / 1000) + 1);
 
-    if ((now() - start_at) > Convert::TIMEOUT) {
+    complete = true;
+  }
+
+  while (!complete && _bus->convertWait(complete)) {
+    if ((now() - start_at) > timeout_us) {
       ESP_LOGW(TAG, "convert timeout");
-      Bus::convert(complete, true);
+      _bus->reset();
       break;
     }
   }
 
   // once a convert (success or failure) is complete note the time to prevent subsequent converts
   // before the next reporting cycle
-  convert_last = now();
+  _bus->convertFinished(now());
 
   return complete;
 }
 
-bool Device::initBus(uint32_t convert_frequency_ms) {
-  // the value passed is in ms and we need micros
-  convert_micros = 1000 * convert_frequency_ms;
-  // ensure the first call to convert performs a convert
-  convert_last = now() - convert_micros;
-
-  return Bus::ensure();
-}
-
 void Device::makeID() {
   auto *p = _ident;
   *p++ = 'd';
@@ -117,20 +136,26 @@ void Device::makeID() {
   *p = 0x00; // null terminate the ident
 }
 
+bool Device::matchRomThenHold(Bytes write, Len wlen, uint32_t hold_ms) {
+  auto *p = write;
+  *p++ = 0x55;                  // byte 0: match rom
+  memcpy(p, addr(), addrLen()); // bytes 1-8: rom to match
+
+  return _bus->writeThenHold(write, wlen, hold_ms);
+}
+
 IRAM_ATTR bool Device::matchRomThenRead(Bytes write, Len wlen, Bytes read, Len rlen) {
   // setup the match rom command but don't touch byte 9 which is the device specific command
   auto *p = write;
   *p++ = 0x55;                  // byte 0: match rom
   memcpy(p, addr(), addrLen()); // bytes 1-8: rom to match
 
-  return Bus::writeThenRead(write, wlen, read, rlen);
+  return _bus->writeThenRead(write, wlen, read, rlen);
 }
 
-IRAM_ATTR bool Device::releaseBus() { return Bus::release(); }
-
-IRAM_ATTR bool Device::resetBus() { return Bus::reset(); }
+IRAM_ATTR bool Device::releaseBus() { return _bus->release(); }
 
-IRAM_ATTR bool Device::search(uint8_t *rom_code) { return Bus::search(rom_code); }
+IRAM_ATTR bool Device::resetBus() { return _bus->reset(); }
 
 IRAM_ATTR uint32_t Device::updateSeenTimestamp() {
   const auto now_us = now();
@@ -29,7 +29,64 @@
 
 namespace ds {
 
-DS1820::DS1820(const uint8_t *addr) : Device(addr) { _mutable = false; }
+DS1820::DS1820(Bus *bus, const uint8_t *addr) : Device(bus, addr) { _mutable = false; }
+
+// conversion time doubles with each additional bit of resolution (9-bit is 93.75ms)
+uint32_t DS1820::convertMicros() const { return 93750 << (_resolution - 9); }
+
+IRAM_ATTR bool DS1820::readScratchpad(uint8_t *data) {
+  uint8_t cmd[10];
+  cmd[9] = 0xbe; // DS1820 read scratchpad
+
+  if (matchRomThenRead(cmd, sizeof(cmd), data, 9) == false) return false;
+
+  auto crc = crc8(data, 9);
+  if (crc != 0x00) {
+    ESP_LOGD(ident(), "crc failure: 0x%02x", crc);
+    return false;
+  }
+
+  // config register bits 5-6 are the resolution (less 9 bits)
+  _resolution = ((data[4] >> 5) & 0x03) + 9;
+
+  return true;
+}
+
+bool DS1820::resolution(uint8_t bits) {
+  uint8_t data[9];
+
+  if (readScratchpad(data) == false) return false;
+  if ((bits == 0) || (bits == _resolution)) return true; // nothing to change, save eeprom writes
+
+  if ((bits < 9) || (bits > 12)) {
+    ESP_LOGW(ident(), "invalid resolution: %u", bits);
+    return false;
+  }
+
+  // write scratchpad requires TH and TL (preserved) followed by the config register
+  uint8_t write_cmd[13];
+  write_cmd[9] = 0x4e;                      // write scratchpad
+  write_cmd[10] = data[2];                  // TH
+  write_cmd[11] = data[3];                  // TL
+  write_cmd[12] = ((bits - 9) << 5) | 0x1f; // config, low bits read as one
+  matchRomThenRead(write_cmd, sizeof(write_cmd), nullptr, 0);
+
+  // confirm the scratchpad before copying it to eeprom
+  if ((readScratchpad(data) == false) || (_resolution != bits)) {
+    ESP_LOGW(ident(), "set resolution %u failed", bits);
+    return false;
+  }
+
+  // copy scratchpad to eeprom so the resolution survives a power cycle (up to 10ms)
+  uint8_t copy_cmd[10];
+  copy_cmd[9] = 0x48;
+
+  const auto rc = matchRomThenHold(copy_cmd, sizeof(copy_cmd), 10);
+
+  ESP_LOGI(ident(), "resolution %u bits %s", bits, rc ? "saved" : "not saved");
+
+  return rc;
+}
 
 IRAM_ATTR bool DS1820::report() {
   auto rc = false;
@@ -43,20 +100,9 @@ IRAM_ATTR bool DS1820::report() {
   uint16_t raw = 0;
   if (rc) {
 
-    static uint8_t cmd[10];
-    static constexpr size_t cmd_len = sizeof(cmd);
-    static uint8_t data[9];
-    static constexpr size_t data_len = sizeof(data);
-
-    cmd[9] = 0xbe; // DS1820 read scratchpad
+    uint8_t data[9];
 
-    if (matchRomThenRead(cmd, cmd_len, data, data_len) == false) return false;
-    auto crc = crc8(data, data_len);
-    if (crc != 0x00) {
-      ESP_LOGD(ident(), "crc failure: 0x%02x", crc);
-
-      rc = false; // transmission error
-    }
+    rc = readScratchpad(data);
 
     // convert the data from the scratchpad to a raw temperature
     raw = (data[1] << 8) | data[0];
@@ -18,6 +18,8 @@
     https://www.wisslanding.com
 */
 
+#include <cstring>
+
 #include <esp_log.h>
 
 #include "ArduinoJson.h"
@@ -29,13 +31,50 @@
 
 namespace ds {
 
-DS2408::DS2408(const uint8_t *addr) : Device(addr) { _mutable = true; }
+DS2408::DS2408(Bus *bus, const uint8_t *addr) : Device(bus, addr) { _mutable = true; }
+
+bool DS2408::conditionalSearch(uint8_t mask, uint8_t polarity, uint8_t control) {
+  // write conditional search registers 0x8b (channel mask), 0x8c (polarity) and 0x8d (control),
+  // writing control clears the power on reset latch (PORL)
+  uint8_t write_cmd[15];
+  write_cmd[9] = 0xcc;  // write conditional search register
+  write_cmd[10] = 0x8b; // target address (low)
+  write_cmd[11] = 0x00; // target address (high)
+  write_cmd[12] = mask;
+  write_cmd[13] = polarity;
+  write_cmd[14] = control;
+
+  if (matchRomThenRead(write_cmd, sizeof(write_cmd), nullptr, 0) == false) return false;
+  if (resetActivity() == false) return false;
+
+  // confirm the device accepted the configuration
+  uint8_t regs[num_registers];
+  if (readRegisters(regs) == false) return false;
+
+  const auto rc = (regs[CS_MASK] == mask) && (regs[CS_POLARITY] == polarity) &&
+                  ((regs[CONTROL] & (Control::PLS | Control::CT | Control::PORL)) == control);
+
+  if (!rc) ESP_LOGW(ident(), "conditional search config failed ctrl[%02x]", regs[CONTROL]);
 
-static StaticJsonDocument<1024> cmd_doc;
+  return rc;
+}
+
+bool DS2408::disableChangeDetect() {
+  // no pins selected, with PORL cleared the device never responds to conditional search
+  return conditionalSearch(0x00, 0x00, 0x00);
+}
+
+bool DS2408::enableChangeDetect() {
+  // all pins selected, condition is any activity latch set (PLS=1, CT=0 is OR)
+  return conditionalSearch(0xff, 0xff, Control::PLS);
+}
 
 IRAM_ATTR bool DS2408::execute(message::InWrapped msg) {
   auto execute_rc = true;
 
+  // on the stack of the calling command task (one per bus)
+  StaticJsonDocument<256> cmd_doc;
+
   if (msg->unpack(cmd_doc)) {
     const char *refid = msg->refidFromFilter();
     const JsonObject root = cmd_doc.as<JsonObject>();
@@ -58,13 +97,10 @@ IRAM_ATTR bool DS2408::execute(message::InWrapped msg) {
   return execute_rc;
 }
 
-IRAM_ATTR bool DS2408::report() {
-
+IRAM_ATTR void DS2408::publish(bool ok, uint8_t states_raw) {
   message::States states(ident());
-  uint8_t states_raw;
-  auto rc = status(states_raw);
 
-  if (rc) {
+  if (ok) {
     updateSeenTimestamp();
 
     for (auto i = 0; i < num_pins; i++) {
@@ -79,31 +115,98 @@ IRAM_ATTR bool DS2408::report() {
   states.finalize();
 
   ruth::MQTT::send(states);
+}
+
+IRAM_ATTR bool DS2408::readRegisters(uint8_t *regs) {
+  uint8_t read_cmd[12];
+  read_cmd[9] = 0xf0;  // read pio registers
+  read_cmd[10] = 0x88; // target address (low)
+  read_cmd[11] = 0x00; // target address (high)
+
+  // the crc16 sent after the registers covers the command and target address too
+  const auto crc = crc16(read_cmd + 9, 3);
+
+  uint8_t data[num_registers + 2];
+  if ((matchRomThenRead(read_cmd, sizeof(read_cmd), data, sizeof(data)) == false) ||
+      (checkCrc16(crc, data, sizeof(data)) == false)) {
+    _latch.invalidate();
+    return false;
+  }
+
+  memcpy(regs, data, num_registers);
+  _latch.store(regs[OUTPUT_LATCH]);
+
+  return true;
+}
+
+IRAM_ATTR bool DS2408::report() {
+  uint8_t states_raw;
+  auto rc = status(states_raw);
+
+  publish(rc, states_raw);
+
+  return rc;
+}
+
+IRAM_ATTR bool DS2408::reportChange() {
+  // reset the activity latch before reading the pin states so a change after the read is latched
+  // and found by the next conditional search
+  auto rc = resetActivity();
+
+  uint8_t regs[num_registers];
+  if (rc) rc = readRegisters(regs);
+
+  if (rc && (regs[CONTROL] & Control::PORL)) {
+    // the device was power cycled and lost the conditional search configuration
+    ESP_LOGI(ident(), "power on reset detected, enabling change detect");
+    enableChangeDetect();
+  }
+
+  // invert states; device considers on as false, off as true
+  const uint8_t states = rc ? (~regs[PIO_LOGIC] & 0xff) : 0;
+
+  publish(rc, states);
 
   return rc;
 }
 
+IRAM_ATTR bool DS2408::resetActivity() {
+  uint8_t reset_cmd[10];
+  reset_cmd[9] = 0xc3; // reset activity latches
+
+  uint8_t confirm = 0x00;
+  if (matchRomThenRead(reset_cmd, sizeof(reset_cmd), &confirm, sizeof(confirm)) == false) return false;
+
+  // the device responds with 0xaa once the latches are reset
+  return confirm == 0xaa;
+}
+
 IRAM_ATTR bool DS2408::setPin(uint8_t pin, const char *cmd) {
   auto rc = false;
 
-  uint8_t asis_states;
-  if (status(asis_states)) {
+  // the write is derived from the output latch, not the sensed pin states: a pin pulled low by
+  // its load (or used as an input) senses as on while its latch is off.  the cached latch avoids
+  // reading the registers before the write.
+  uint8_t asis_latch;
+  uint8_t regs[num_registers];
+  if (_latch.get(asis_latch) || (readRegisters(regs) && _latch.get(asis_latch))) {
     uint8_t cmd_state;
     uint8_t cmd_mask;
 
     if (cmdToMaskAndState(pin, cmd, cmd_mask, cmd_state)) {
-      const uint8_t new_states = ~(asis_states ^ ((asis_states ^ cmd_state) & cmd_mask));
+      // the latch is inverted, a cleared bit turns the pin on
+      const uint8_t new_latch = (asis_latch & ~cmd_mask) | (~cmd_state & cmd_mask);
 
-      ESP_LOGD(ident(), "asis_states[%02x] new_states[%02x]", asis_states, new_states);
+      ESP_LOGD(ident(), "asis_latch[%02x] new_latch[%02x]", asis_latch, new_latch);
 
-      static uint8_t set_pin_cmd[12];
-      static constexpr size_t pin_cmd_len = sizeof(set_pin_cmd);
+      uint8_t set_pin_cmd[12];
+      constexpr size_t pin_cmd_len = sizeof(set_pin_cmd);
       set_pin_cmd[9] = 0x5a; // set command
-      set_pin_cmd[10] = new_states;
-      set_pin_cmd[11] = ~new_states;
+      set_pin_cmd[10] = new_latch;
+      set_pin_cmd[11] = ~new_latch;
 
-      static uint8_t check[2];
-      static constexpr size_t check_len = sizeof(check);
+      uint8_t check[2];
+      constexpr size_t check_len = sizeof(check);
 
       if (matchRomThenRead(set_pin_cmd, pin_cmd_len, check, check_len)) {
         // check what the device returned to determine success or failure
@@ -111,15 +214,20 @@ IRAM_ATTR bool DS2408::setPin(uint8_t pin, const char *cmd) {
         // byte 1: new_state
         uint8_t conf_byte = check[0];
         uint8_t dev_state = check[1];
-        if ((conf_byte == 0xaa) || (dev_state == new_states)) {
+        if ((conf_byte == 0xaa) || (dev_state == new_latch)) {
           rc = true;
+          _latch.store(new_latch); // write confirmed, cache the latch
         } else if (((conf_byte & 0xa0) == 0xa0) || ((conf_byte & 0x0a) == 0x0a)) {
-          ESP_LOGW(ident(), "SET OK-PARTIAL conf[%02x] req[%02x] dev[%02x]", conf_byte, new_states,
+          ESP_LOGW(ident(), "SET OK-PARTIAL conf[%02x] req[%02x] dev[%02x]", conf_byte, new_latch,
                    dev_state);
           rc = true;
+          _latch.invalidate(); // device state is uncertain, read before the next write
         } else {
-          ESP_LOGW(ident(), "SET FAILED conf[%02x] req[%02x] dev[%02x]", conf_byte, new_states, dev_state);
+          ESP_LOGW(ident(), "SET FAILED conf[%02x] req[%02x] dev[%02x]", conf_byte, new_latch, dev_state);
+          _latch.invalidate();
         }
+      } else {
+        _latch.invalidate();
       }
     }
   }
@@ -152,42 +260,25 @@ IRAM_ATTR bool DS2408::cmdToMaskAndState(uint8_t pin, const char *cmd, uint8_t &
 
 IRAM_ATTR bool DS2408::status(uint8_t &states, uint64_t *elapsed_us) {
   // status (state of pins) of a DS2408 device
-  // one contiguous array of bytes to:
   //  1. match the rom and initiate channel access read mode
   //  2. receive 32 bytes of channel access data from the device
   //
-  // this is one contiguous array because the DS2408 sends an inverted CRC as the
-  // final two bytes that includes the last byte of the channel access commmand.  by
-  // making this one contiguous buffer we can use pointer math to compute the crc16.
-
-  static uint8_t read_cmd[] = {0x55,                   // byte 0: match ROM
-                               0x00, 0x00, 0x00, 0x00, // byte 1-4: rom bytes
-                               0x00, 0x00, 0x00, 0x00, // byte 1-8: rom bytes
-                               0xf5,                   // byte 9: channel access read cmd
-                               0x00, 0x00, 0x00, 0x00, // bytes 10-41: channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00, 0x00, 0x00, // channel state data
-                               0x00, 0x00};            // bytes 42-43: CRC16
+  // the DS2408 sends an inverted CRC as the final two bytes that includes the channel
+  // access command byte.  the crc is started over the command and continued over the data.
+
+  uint8_t read_cmd[10];
+  read_cmd[9] = 0xf5; // channel access read cmd
+
+  uint8_t data[32 + 2]; // channel state data then the crc16
 
   auto rc = false;
   auto start_at = esp_timer_get_time();
 
-  static uint8_t *cmd = read_cmd;
-  static constexpr size_t cmd_len = 10;
-  static uint8_t *data = read_cmd + cmd_len;
-  static constexpr size_t data_len = sizeof(read_cmd) - cmd_len;
+  const auto crc = crc16(read_cmd + 9, 1);
 
-  if (matchRomThenRead(cmd, cmd_len, data, data_len) == false) return false;
-  // calculate the start/end of the block for the crc16 validation
-  const uint8_t *crc_start = data - 1; // include the channel access read byte 0xf5
-  const uint8_t *crc_end = data + data_len;
+  if (matchRomThenRead(read_cmd, sizeof(read_cmd), data, sizeof(data)) == false) return false;
 
-  if (checkCrc16(crc_start, crc_end)) {
+  if (checkCrc16(crc, data, sizeof(data))) {
     rc = true; // success
 
     // invert states; device considers on as false, off as true
@@ -0,0 +1,126 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+
+#ifndef ruth_ds_bus_hpp
+#define ruth_ds_bus_hpp
+
+#include <atomic>
+#include <memory>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "owb/owb.h"
+#include "owb/owb_rmt.h"
+
+namespace ds {
+typedef uint8_t Byte;
+typedef uint8_t *Bytes;
+typedef const size_t Len;
+typedef uint8_t *RomCode;
+
+class Bus {
+public:
+  // each bus consumes two of the eight RMT channels (tx and rx)
+  static constexpr uint8_t max_buses = 4;
+
+  // high priority requestors (commands) are granted the bus ahead of low priority requestors
+  // (reports), low priority holders yield between devices when a high priority requestor waits
+  enum Priority : size_t { LOW = 0, HIGH, PRIORITIES };
+
+  // acquire wait time histogram, the final bucket counts waits beyond the last bound
+  static constexpr size_t wait_buckets = 5;
+  static constexpr uint32_t wait_bucket_ms[wait_buckets - 1] = {1, 10, 100, 1000};
+
+public:
+  Bus(uint8_t num, uint8_t pin, uint32_t convert_frequency_ms);
+  ~Bus() = default;
+
+  Bus(const Bus &) = delete;
+  void operator=(const Bus &) = delete;
+
+  bool acquire(uint32_t timeout_ms = UINT32_MAX, Priority prio = LOW);
+  void allowOverdrive(bool allow);
+  bool checkPowered();
+  bool ensure(OneWireBus *owb = nullptr);
+  bool error();
+
+  bool convertStart();
+  bool convertWait(bool &complete);
+  inline void convertFinished(int64_t at) { _convert_last = at; }
+  inline void convertFrequency(uint32_t ms) { _convert_micros = 1000 * ms; }
+  inline uint32_t convertMaxMicros() const { return _convert_max_us; }
+  inline void convertMaxMicros(uint32_t us) { _convert_max_us = us; }
+  inline bool convertRecent(int64_t at) const { return (at - _convert_last) < (_convert_micros >> 1); }
+  uint8_t lastStatus() const { return _status; }
+  uint8_t num() const { return _num; }
+  bool ok() const { return _status == OWB_STATUS_OK; }
+  bool powered() const { return _powered; } // no device on the bus is parasite powered
+  bool probeOverdrive(const uint8_t *rom_code);
+  bool release();
+  bool reset();
+  uint32_t resets() const { return _resets; } // detects bus use by another task
+  // conditional search (0xEC) finds only devices meeting their alarm / activity condition,
+  // a family (non-zero) limits the search to devices of that family
+  bool search(RomCode rom_code, bool conditional = false, uint8_t family = 0x00);
+
+  const uint32_t *waitHistogram(Priority prio) const { return _wait_hist[prio]; }
+  bool yield();
+
+  bool writeThenHold(Bytes write, Len wlen, uint32_t hold_ms);
+  bool writeThenRead(Bytes write, Len wlen, Bytes read, Len rlen);
+
+private:
+  bool enterOverdrive();
+  void exitOverdrive();
+
+private:
+  const uint8_t _num;
+  const uint8_t _pin;
+
+  TaskHandle_t _holder = nullptr;
+  SemaphoreHandle_t _mutex = nullptr;
+  std::atomic<uint32_t> _high_waiting{0};
+  uint32_t _wait_hist[PRIORITIES][wait_buckets] = {};
+  owb_rmt_driver_info _rmt_driver = {};
+  OneWireBus *_owb = nullptr;
+  bool _powered = false;
+
+  owb_status _status = OWB_STATUS_OK;
+  OneWireBus_SearchState _search_state = {};
+  bool _search_in_progress = false;
+  bool _present = false;
+  uint32_t _resets = 0;
+
+  // converts are a bus wide operation shared by all temperature devices on the bus
+  uint32_t _convert_micros = 0;
+  int64_t _convert_last = 0;
+  uint32_t _convert_max_us = 750000; // slowest device conversion time, 12-bit resolution by default
+
+  // overdrive is allowed by the engine when every known device supports it and becomes
+  // active once the devices have been placed into overdrive by an overdrive skip rom
+  bool _od_allowed = false;
+  bool _od_active = false;
+};
+} // namespace ds
+
+#endif
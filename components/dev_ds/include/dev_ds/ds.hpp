@@ -28,33 +28,38 @@
 #include "message/in.hpp"
 
 namespace ds {
+class Bus;
+
 class Device {
 
 public:
-  enum Convert : uint32_t { CHECK_TICKS = pdMS_TO_TICKS(30), TIMEOUT = 800000 };
+  enum Convert : uint32_t { TIMEOUT_MARGIN = 50000 };
   enum Notifies : uint32_t { BUS_NEEDED = 0xb000, BUS_RELEASED = 0xb001 };
 
 public:
-  Device(const uint8_t *rom_code);
+  Device(Bus *bus, const uint8_t *rom_code);
+  virtual ~Device() = default;
 
-  static bool acquireBus(uint32_t timeout_ms = UINT32_MAX);
+  bool acquireBus(uint32_t timeout_ms = UINT32_MAX);
   inline const uint8_t *addr() const { return _addr; }
   inline size_t addrLen() const { return _addr_max_len; }
+  inline Bus *bus() const { return _bus; }
+  virtual uint32_t convertMicros() const { return 0; } // worst case conversion time, if any
   inline uint8_t crc() const { return _addr[AddressIndex::CRC]; }
+  virtual bool disableChangeDetect() { return false; } // no longer respond to conditional search
+  virtual bool enableChangeDetect() { return false; }  // respond to conditional search on change
   virtual bool execute(message::InWrapped msg) { return false; }
   inline uint8_t family() const { return _addr[AddressIndex::FAMILY]; }
   const char *ident() const { return _ident; }
   static size_t identMaxLen() { return _ident_max_len; }
-  static bool initBus(uint32_t convert_frequency_ms);
   bool isMutable() const { return _mutable; }
 
   uint64_t lastSeen() const { return _timestamp; }
+  bool overdrive() const { return _overdrive; }
 
   virtual bool report() = 0;
-  static bool releaseBus();
-
-  static bool search(uint8_t *rom_code);
-  static void setReportFrequency(uint32_t micros);
+  virtual bool reportChange() { return false; } // device responded to conditional search
+  bool releaseBus();
 
   uint32_t updateSeenTimestamp();
 
@@ -63,13 +68,15 @@ protected:
   typedef const size_t Len;
 
 protected:
-  static uint8_t busErrorCode();
-  static bool convert();
+  uint8_t busErrorCode();
+  bool convert();
+  bool matchRomThenHold(Bytes write, Len write_len, uint32_t hold_ms);
   bool matchRomThenRead(Bytes write, Len write_len, Bytes read, Len read_len);
 
-  static bool resetBus();
+  bool resetBus();
 
 protected:
+  Bus *_bus = nullptr;
   bool _mutable = false;
 
   // byte 0: family code, bytes 1-6: serial number, byte & crc
@@ -79,9 +86,9 @@ protected:
   static constexpr size_t _ident_max_len = 18;
   char _ident[_ident_max_len];
   bool _needs_convert;
+  bool _overdrive = false; // device confirmed to communicate at overdrive speed
 
 private:
-  static bool ensureBus();
   void makeID();
 
 private:
@@ -30,12 +30,22 @@ namespace ds {
 class DS1820 : public Device {
 
 public:
-  DS1820(const uint8_t *addr);
+  DS1820(Bus *bus, const uint8_t *addr);
 
+  uint32_t convertMicros() const override;
   bool report() override;
 
+  // bits (9-12) are written to the scratchpad and copied to eeprom only when they differ
+  // from the device configuration; zero leaves the device as is
+  bool resolution(uint8_t bits);
+  uint8_t resolution() const { return _resolution; }
+
 private:
   bool celsius(float &val);
+  bool readScratchpad(uint8_t *data);
+
+private:
+  uint8_t _resolution = 12; // power on default
 };
 } // namespace ds
 
@@ -25,23 +25,40 @@
 
 #include "ArduinoJson.h"
 #include "dev_ds/ds.hpp"
+#include "misc/states_cache.hpp"
 #include "message/in.hpp"
 
 namespace ds {
 class DS2408 : public Device {
 
 public:
-  DS2408(const uint8_t *addr);
+  DS2408(Bus *bus, const uint8_t *addr);
 
+  bool disableChangeDetect() override;
+  bool enableChangeDetect() override;
   bool execute(message::InWrapped msg) override;
   bool report() override;
+  bool reportChange() override;
 
   static constexpr size_t num_pins = 8;
 
+private:
+  // PIO registers 0x88 - 0x8f as returned by read pio registers
+  enum Register : size_t { PIO_LOGIC = 0, OUTPUT_LATCH, ACTIVITY_LATCH, CS_MASK, CS_POLARITY, CONTROL };
+  enum Control : uint8_t { PLS = 0x01, CT = 0x02, ROS = 0x04, PORL = 0x08 };
+  static constexpr size_t num_registers = 8;
+
 private:
   bool cmdToMaskAndState(uint8_t pin, const char *cmd, uint8_t &mask, uint8_t &state);
+  bool conditionalSearch(uint8_t mask, uint8_t polarity, uint8_t control);
+  void publish(bool ok, uint8_t states);
+  bool readRegisters(uint8_t *regs);
+  bool resetActivity();
   bool setPin(uint8_t pin, const char *cmd);
   bool status(uint8_t &states, uint64_t *elapsed_us = nullptr);
+
+private:
+  ruth::StatesCache<uint8_t> _latch; // output latch (register 0x89), a set bit is an off pin
 };
 } // namespace ds
 
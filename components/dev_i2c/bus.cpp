@@ -22,7 +22,9 @@
 
 #include <driver/i2c.h>
 #include <esp_attr.h>
+#include <esp_log.h>
 #include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
@@ -35,32 +37,144 @@ static constexpr uint64_t rst_sel = GPIO_SEL_21;
 static constexpr gpio_num_t sda_pin = GPIO_NUM_23;
 static constexpr gpio_num_t scl_pin = GPIO_NUM_22;
 static constexpr TickType_t cmd_timeout = pdMS_TO_TICKS(100);
+static constexpr UBaseType_t queue_depth = 8;
+static constexpr UBaseType_t task_stack = 3072;
+static constexpr UBaseType_t task_priority = 5; // above the engine tasks, drains the queue promptly
 
-DRAM_ATTR SemaphoreHandle_t Bus::mutex = nullptr;
+static const char *TAG = "i2c:bus";
+
+DRAM_ATTR QueueHandle_t Bus::queue = nullptr;
 DRAM_ATTR static i2c_config_t i2c_config = {};
 DRAM_ATTR static gpio_config_t rst_pin_config = {};
 
-DRAM_ATTR esp_err_t Bus::status = ESP_FAIL;
 DRAM_ATTR static int timeout_default = 0;
+DRAM_ATTR static int timeout_active = 0;
+// multiplexer state, only the bus task reads or changes it (see Bus::mplex)
+DRAM_ATTR static bool mplex_enabled = false;
+DRAM_ATTR static uint16_t mplex_selected = UINT16_MAX; // unknown, always select
+
+// one command link (start, addr, write, restart, addr, read, stop) reused by every transaction
+DRAM_ATTR static uint8_t cmd_link_buff[I2C_LINK_RECOMMENDED_SIZE(2)];
+
+Txn::Txn(uint8_t addr, uint8_t channel, float timeout_scale)
+    : _addr(addr), _channel(channel), _timeout_scale(timeout_scale) {
+  _complete = xSemaphoreCreateBinaryStatic(&_complete_buff);
+}
+
+IRAM_ATTR bool Bus::execute(Txn &txn) {
+  if (submit(txn) == false) return false;
+
+  // the bus task always completes a queued transaction (the command itself has a timeout)
+  xSemaphoreTake(txn._complete, portMAX_DELAY);
+
+  return txn.ok();
+}
+
+void Bus::mplex(bool enable) {
+  // changed by the bus task in queue order, txns queued before the change complete with the
+  // state they were submitted with
+  Txn txn(mplex_addr);
+  txn._kind = enable ? Txn::MPLEX_ON : Txn::MPLEX_OFF;
+
+  execute(txn);
+}
+
+IRAM_ATTR bool Bus::probe(uint8_t addr, uint8_t channel) {
+  Txn txn(addr, channel);
+
+  return execute(txn);
+}
+
+IRAM_ATTR void Bus::run(void *data) {
+  Txn *txn = nullptr;
+
+  for (;;) {
+    if (xQueueReceive(queue, &txn, portMAX_DELAY) == pdTRUE) {
+      transact(*txn);
+
+      // the txn may be released or resubmitted by the submitter once complete.  complete it
+      // before the done callback (which may resubmit it) and don't touch it afterwards.
+      const auto done = txn->_done;
+      auto *done_ctx = txn->_done_ctx;
+
+      xSemaphoreGive(txn->_complete);
+      if (done) done(*txn, done_ctx);
+    }
+  }
+}
+
+IRAM_ATTR bool Bus::selectChannel(uint8_t channel) {
+  // devices not behind the multiplexer are addressed with every channel deselected so
+  // they are never confused with a device on a channel
+  const uint8_t want = (channel == Device::NO_CHANNEL) ? 0x00 : (0x01 << channel);
+
+  if (want == mplex_selected) return true;
+
+  auto cmd = i2c_cmd_link_create_static(cmd_link_buff, sizeof(cmd_link_buff));
+  i2c_master_start(cmd);
+  i2c_master_write_byte(cmd, (mplex_addr << 1) | I2C_MASTER_WRITE, true);
+  i2c_master_write_byte(cmd, want, true);
+  i2c_master_stop(cmd);
+
+  const auto rc = i2c_master_cmd_begin(I2C_NUM_0, cmd, cmd_timeout);
+  i2c_cmd_link_delete_static(cmd);
 
-IRAM_ATTR bool Bus::executeCmd(i2c_cmd_handle_t cmd, const float timeout_scale) {
-  Bus::status = ESP_FAIL;
+  mplex_selected = (rc == ESP_OK) ? want : UINT16_MAX;
 
-  if (Bus::acquire(10000) == true) {
-    const int timeout = timeout_default * timeout_scale;
+  return rc == ESP_OK;
+}
+
+IRAM_ATTR bool Bus::submit(Txn &txn, TickType_t wait) {
+  txn._status = ESP_FAIL;
+  xSemaphoreTake(txn._complete, 0); // clear a completion not waited for (e.g. submit with onDone)
 
-    if (timeout != timeout_default) i2c_set_timeout(I2C_NUM_0, timeout);
+  auto *txn_ptr = &txn;
+  if (xQueueSendToBack(queue, &txn_ptr, wait) == pdTRUE) return true;
 
-    // execute queued i2c cmd
-    Bus::status = i2c_master_cmd_begin(I2C_NUM_0, cmd, cmd_timeout);
-    i2c_cmd_link_delete(cmd);
+  ESP_LOGW(TAG, "queue txn failed addr[0x%02x]", txn._addr);
+  return false;
+}
+
+IRAM_ATTR void Bus::transact(Txn &txn) {
+  if (txn._kind != Txn::DEVICE) {
+    mplex_enabled = (txn._kind == Txn::MPLEX_ON);
+    mplex_selected = UINT16_MAX;
+    txn._status = ESP_OK;
+    return;
+  }
+
+  if (mplex_enabled && (selectChannel(txn._channel) == false)) {
+    txn._status = ESP_FAIL;
+    return;
+  }
+
+  auto cmd = i2c_cmd_link_create_static(cmd_link_buff, sizeof(cmd_link_buff));
+
+  i2c_master_start(cmd);
+
+  if (txn._tx_len || (txn._rx_len == 0)) {
+    i2c_master_write_byte(cmd, (txn._addr << 1) | I2C_MASTER_WRITE, true);
+
+    if (txn._tx_len) i2c_master_write(cmd, txn._tx, txn._tx_len, true);
+    if (txn._rx_len) i2c_master_start(cmd); // repeated start, no stop between write and read
+  }
+
+  if (txn._rx_len) {
+    i2c_master_write_byte(cmd, (txn._addr << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(cmd, txn._rx, txn._rx_len, I2C_MASTER_LAST_NACK);
+  }
 
-    if (timeout != timeout_default) i2c_set_timeout(I2C_NUM_0, timeout_default);
+  i2c_master_stop(cmd);
 
-    Bus::release();
+  // only change the clock stretching timeout when it differs from the previous transaction
+  const int timeout = timeout_default * txn._timeout_scale;
+  if (timeout != timeout_active) {
+    i2c_set_timeout(I2C_NUM_0, timeout);
+    timeout_active = timeout;
   }
 
-  return Bus::status == ESP_OK;
+  txn._status = i2c_master_cmd_begin(I2C_NUM_0, cmd, cmd_timeout);
+  i2c_cmd_link_delete_static(cmd);
 }
 
 bool Bus::init() {
@@ -83,21 +197,22 @@ bool Bus::init() {
   if (i2c_driver_install(I2C_NUM_0, i2c_config.mode, 0, 0, 0) != ESP_OK) return false;
 
   i2c_get_timeout(I2C_NUM_0, &timeout_default);
+  timeout_active = timeout_default;
   i2c_filter_enable(I2C_NUM_0, 2);
 
   // simply pull up the reset pin
   // previous reset logic no longer required; esp-idf has bus clear logic
 
   constexpr auto power_on_ticks = pdMS_TO_TICKS(500);
-  Bus::status = gpio_set_level(rst_pin, 1); // bring all devices online
-  vTaskDelay(power_on_ticks);               // give time for devices to initialize
+  const auto rc = gpio_set_level(rst_pin, 1); // bring all devices online
+  vTaskDelay(power_on_ticks);                 // give time for devices to initialize
 
-  if (Bus::status != ESP_OK) return false;
+  if (rc != ESP_OK) return false;
 
-  mutex = xSemaphoreCreateMutex();
-  if (mutex == nullptr) return false;
+  queue = xQueueCreate(queue_depth, sizeof(Txn *));
+  if (queue == nullptr) return false;
 
-  return release();
+  return xTaskCreate(&run, TAG, task_stack, nullptr, task_priority, nullptr) == pdPASS;
 }
 
 } // namespace i2c
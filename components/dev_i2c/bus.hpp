@@ -24,34 +24,96 @@
 #include <memory>
 
 #include <driver/i2c.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+#include "dev_i2c/i2c.hpp"
 
 namespace i2c {
 
-class Bus {
+// a device transaction, usually a device member built once and reused:
+//   START, addr+W, write bytes, [repeated START, addr+R, read bytes], STOP
+//
+// a transaction without write bytes only reads, without write or read bytes it only
+// addresses the device (e.g. probe for an ACK).  devices behind the multiplexer are
+// reached by selecting their channel first.
+class Txn {
 public:
-  inline static bool acquire(const uint32_t timeout_ms) {
-    const UBaseType_t wait_ticks = pdMS_TO_TICKS(timeout_ms);
-    return xSemaphoreTake(mutex, wait_ticks) == pdTRUE;
+  typedef void (*Done)(Txn &txn, void *ctx);
+
+public:
+  Txn(uint8_t addr, uint8_t channel = Device::NO_CHANNEL, float timeout_scale = 1.0);
+  Txn(const Txn &) = delete;
+  void operator=(const Txn &) = delete;
+
+  inline uint8_t addr() const { return _addr; }
+  inline uint8_t channel() const { return _channel; }
+  inline bool ok() const { return _status == ESP_OK; }
+  inline void onDone(Done done, void *ctx) {
+    _done = done;
+    _done_ctx = ctx;
   }
 
-  inline static i2c_cmd_handle_t createCmd() {
-    auto cmd = i2c_cmd_link_create();
+  inline void read(uint8_t *rx, size_t len) {
+    _rx = rx;
+    _rx_len = len;
+  }
 
-    i2c_master_start(cmd);
+  inline esp_err_t status() const { return _status; }
 
-    return cmd;
+  inline void write(const uint8_t *tx, size_t len) {
+    _tx = tx;
+    _tx_len = len;
   }
 
-  static bool executeCmd(i2c_cmd_handle_t cmd, const float timeout_scale = 1.0);
+private:
+  friend class Bus;
+
+  // a multiplexer state change (Bus::mplex) is queued like a device txn, nothing is sent
+  enum Kind : uint8_t { DEVICE = 0, MPLEX_OFF, MPLEX_ON };
+
+  const uint8_t _addr;
+  const uint8_t _channel;
+  const float _timeout_scale; // clock stretching allowance (e.g. device measurement)
+
+  const uint8_t *_tx = nullptr;
+  size_t _tx_len = 0;
+  uint8_t *_rx = nullptr;
+  size_t _rx_len = 0;
+
+  Kind _kind = DEVICE;
+  esp_err_t _status = ESP_FAIL;
+  Done _done = nullptr;
+  void *_done_ctx = nullptr;
+
+  StaticSemaphore_t _complete_buff;
+  SemaphoreHandle_t _complete;
+};
+
+// transactions are queued to a single bus task that executes them back to back using one
+// preallocated command link
+class Bus {
+public:
+  static constexpr uint8_t mplex_addr = 0x70; // TCA9548A
+
+public:
+  static bool execute(Txn &txn); // submit and wait for completion
 
-  inline static bool error() { return status != ESP_OK; }
-  inline static esp_err_t errorCode() { return status; }
   static bool init();
-  inline static bool release() { return xSemaphoreGive(mutex) == pdTRUE; }
+  static void mplex(bool enable); // select channels (or none) for txns queued after the change
+  static bool probe(uint8_t addr, uint8_t channel = Device::NO_CHANNEL);
+  // txn must remain valid until done, false when not queued within wait (e.g. the queue is
+  // full and the caller can't block)
+  static bool submit(Txn &txn, TickType_t wait = portMAX_DELAY);
+
+private:
+  static void run(void *data); // task loop
+  static bool selectChannel(uint8_t channel);
+  static void transact(Txn &txn);
 
 private:
-  static SemaphoreHandle_t mutex;
-  static esp_err_t status;
+  static QueueHandle_t queue;
 };
 } // namespace i2c
 
@@ -28,8 +28,9 @@ namespace i2c {
 
 static const char *unique_id = nullptr;
 
-IRAM_ATTR Device::Device(const uint8_t addr, const char *description, const bool is_mutable)
-    : _addr(addr), _mutable(is_mutable), _description(description) {
+IRAM_ATTR Device::Device(const uint8_t addr, const uint8_t channel, const char *description,
+                         const bool is_mutable)
+    : _addr(addr), _channel(channel), _mutable(is_mutable), _description(description) {
   _seen_at = esp_timer_get_time();
   makeID();
 }
@@ -57,6 +58,13 @@ IRAM_ATTR void Device::makeID() {
   p--;
   *p++ = '.';
 
+  // devices behind the multiplexer may share an address, include the channel
+  if (_channel != NO_CHANNEL) {
+    *p++ = 'c';
+    *p++ = '0' + _channel;
+    *p++ = '.';
+  }
+
   if (_addr < 0x10) *p++ = '0';       // zero pad values less than 0x10
   itoa(_addr, p, 16);                 // convert to hex
   p = (_addr < 0x10) ? p + 1 : p + 2; // move pointer forward based on zero padding
@@ -64,6 +72,36 @@ IRAM_ATTR void Device::makeID() {
   *p = 0x00; // null terminate the ident
 }
 
+bool Device::mplexEnable() {
+  // an unconfigured PCA9685 also answers at the multiplexer address (ALLCALL) so an ACK is
+  // not enough.  confirm by writing the control register then reading it back, a PCA9685
+  // returns the register addressed instead (ALLCALLADR 0xe0, MODE1 0x11).  the channels
+  // written are selected for the read so a PCA9685 behind them answers too, the wired-AND
+  // read back only needs to be within the control written.  probed with the multiplexer
+  // disabled and always left with every channel deselected.
+  Bus::mplex(false);
+
+  auto found = true;
+  for (const uint8_t control : {0x05, 0x00}) {
+    uint8_t readback = 0xff;
+
+    Txn write_txn(Bus::mplex_addr);
+    write_txn.write(&control, sizeof(control));
+
+    Txn read_txn(Bus::mplex_addr);
+    read_txn.read(&readback, sizeof(readback));
+
+    const auto rc = Bus::execute(write_txn) && Bus::execute(read_txn);
+    found = found && rc && ((readback & ~control) == 0x00);
+  }
+
+  Bus::mplex(found);
+
+  return found;
+}
+
+IRAM_ATTR bool Device::probe(uint8_t addr, uint8_t channel) { return Bus::probe(addr, channel); }
+
 IRAM_ATTR int Device::readAddr() const { return (_addr << 1) | I2C_MASTER_READ; }
 
 void Device::setUniqueId(const char *id) { unique_id = id; }
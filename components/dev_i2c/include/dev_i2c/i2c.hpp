@@ -30,12 +30,16 @@ class Device {
 public:
   static constexpr bool MUTABLE = true;
   static constexpr bool IMMUTABLE = false;
+  static constexpr uint8_t NO_CHANNEL = 0xff; // not behind the multiplexer
+  static constexpr uint8_t mplex_channels = 8;
 
 public:
-  Device(const uint8_t addr, const char *description, const bool is_mutable = IMMUTABLE);
+  Device(const uint8_t addr, const uint8_t channel, const char *description,
+         const bool is_mutable = IMMUTABLE);
   virtual ~Device() = default;
 
   uint8_t addr() const { return _addr; }
+  uint8_t channel() const { return _channel; }
   static void delay(uint32_t ms);
   const char *description() const { return _description; };
   virtual bool execute(message::InWrapped msg) { return false; }
@@ -44,8 +48,13 @@ public:
   static constexpr size_t identMaxLen() { return _ident_max_len; }
   static bool initHardware();
   bool isMutable() const { return _mutable; }
+  static bool mplexEnable(); // true when the multiplexer is present
 
   void makeID();
+  virtual bool reportChange() { return false; } // interrupt driven, true when a change was reported
+  bool missing() const { return _missing; }
+  void missing(bool is_missing) { _missing = is_missing; }
+  static bool probe(uint8_t addr, uint8_t channel = NO_CHANNEL);
   virtual bool report() = 0;
   static void setUniqueId(const char *);
   uint32_t seen();
@@ -59,11 +68,13 @@ protected:
   static constexpr size_t _ident_max_len = 45;
 
   const uint8_t _addr;
+  const uint8_t _channel;
   const bool _mutable;
   char _ident[_ident_max_len];
 
 private:
-  int64_t _seen_at; // µs since boot
+  int64_t _seen_at;      // µs since boot
+  bool _missing = false; // failed to report, re-probed by discover
   const char *_description = nullptr;
 };
 } // namespace i2c
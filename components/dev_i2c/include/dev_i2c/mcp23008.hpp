@@ -21,42 +21,52 @@
 #ifndef ruth_dev_mcp23008_hpp
 #define ruth_dev_mcp23008_hpp
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
 #include "dev_i2c/i2c.hpp"
+#include "misc/states_cache.hpp"
 
 namespace i2c {
 
 class MCP23008 : public Device {
 public:
-  MCP23008(uint8_t addr = 0x20);
+  struct Opts {
+    uint8_t inputs = 0x00;         // pins configured as inputs (IODIR), a change interrupts
+    int int_pin = -1;              // gpio connected to INT (open drain, shared), -1 polls inputs
+    uint32_t heartbeat_ms = 60000; // report interval when input changes are interrupt driven
+  };
+
+public:
+  MCP23008(uint8_t addr, uint8_t channel, const Opts &opts);
 
   bool execute(message::InWrapped msg) override;
   bool report() override;
+  bool reportChange() override;
 
 public:
   static constexpr size_t num_pins = 8;
 
 private:
   bool cmdToMaskAndState(uint8_t pin, const char *cmd, uint8_t &mask, uint8_t &state);
+  bool configure();
+  inline bool interruptDriven() const { return (_opts.inputs != 0x00) && (_opts.int_pin >= 0); }
+  void publish(uint8_t states_raw);
+  bool readRegister(uint8_t reg, uint8_t &val);
   bool refreshStates(int64_t *elapsed_us = nullptr);
   bool setPin(uint8_t pin, const char *cmd);
 
-  inline bool states(uint8_t &states) const {
-    states = _states;
-    return _states_rc;
-  };
-
-  inline bool statesStore(const bool rc, const uint8_t states) {
-    if (rc) {
-      _states = states;
-      _states_rc = rc;
-    }
+private:
+  const Opts _opts;
+  bool _configured = false; // register file written since discovered or last error
+  int64_t _reported_at = 0;
 
-    return rc;
-  }
+  ruth::StatesCache<uint8_t> _states; // updated by reports and confirmed writes
 
-private:
-  uint8_t _states = 0x00;
-  bool _states_rc = false;
+  // the interrupt, report and command tasks each use the device, held across every multiple
+  // transaction sequence and the members above
+  StaticSemaphore_t _mutex_buff;
+  SemaphoreHandle_t _mutex;
 };
 
 } // namespace i2c
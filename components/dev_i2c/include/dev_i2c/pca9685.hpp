@@ -0,0 +1,82 @@
+/*
+    i2c/pca9685.hpp - Ruth I2C PCA9685 Device
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef ruth_dev_pca9685_hpp
+#define ruth_dev_pca9685_hpp
+
+#include <memory>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include "dev_i2c/i2c.hpp"
+
+namespace i2c {
+
+class Txn;
+
+// 16 channel, 12-bit PWM.  commands update a shadow of the channel registers, changes made
+// within a frame are written together as one auto-increment transaction.
+class PCA9685 : public Device {
+public:
+  struct Opts {
+    uint32_t pwm_hz = 1000; // output frequency (24Hz to 1526Hz)
+    uint32_t frame_ms = 20; // channel changes within a frame are coalesced into one write
+  };
+
+public:
+  PCA9685(uint8_t addr, uint8_t channel, const Opts &opts);
+  ~PCA9685() override;
+
+  bool execute(message::InWrapped msg) override;
+  static bool identify(uint8_t addr, uint8_t channel); // MODE1 and PRE_SCALE read back
+  bool report() override;
+
+public:
+  static constexpr size_t num_channels = 16;
+  static constexpr uint16_t duty_max = 4096; // full on
+
+private:
+  bool configure();               // also rewrites every channel
+  static void flush(void *data); // frame timer
+  static void flushed(Txn &txn, void *ctx);
+  bool readRegister(uint8_t reg, uint8_t &val);
+  static bool registerOf(uint8_t addr, uint8_t channel, uint8_t reg, uint8_t &val);
+  void schedule();
+  void update(uint8_t pin, uint16_t duty);
+
+private:
+  const Opts _opts;
+  bool _configured = false; // mode and prescale written since discovered or last error
+
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED; // guards the shadow and flags below
+  uint16_t _duty[num_channels] = {};
+  uint16_t _dirty = 0x0000; // channels changed since the last flush
+  bool _scheduled = false;  // frame timer running
+  bool _in_flight = false;  // flush queued to the bus task
+
+  esp_timer_handle_t _frame_timer = nullptr;
+  std::unique_ptr<Txn> _txn;               // flush transaction, reused
+  uint8_t _tx[1 + (num_channels * 4)] = {}; // first register then ON_L, ON_H, OFF_L, OFF_H by channel
+};
+
+} // namespace i2c
+
+#endif
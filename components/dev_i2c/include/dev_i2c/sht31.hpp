@@ -27,12 +27,42 @@ namespace i2c {
 
 class SHT31 : public Device {
 public:
-  SHT31(uint8_t addr = 0x44);
+  struct Opts {
+    float mps = 0; // periodic measurements per second (0.5, 1, 2, 4 or 10), zero is single shot
 
+    // each report reads one sample and publishes the moving average of the last samples
+    // reports (up to max_samples).  the average is over reports (send_ms), not the
+    // measurement rate, so a step change is fully reflected samples reports later
+    uint8_t samples = 1;
+  };
+
+public:
+  SHT31(uint8_t addr, uint8_t channel, const Opts &opts);
+
+  static bool identify(uint8_t addr, uint8_t channel); // status read with a valid crc
   bool report() override;
 
+public:
+  static constexpr size_t max_samples = 8;
+
 private:
   bool crc(const uint8_t *data, const size_t index = 0);
+  bool fetch(uint8_t *rx, size_t len);
+  bool measure(uint8_t *rx, size_t len);
+  bool startPeriodic();
+
+private:
+  Opts _opts;
+
+  bool _periodic = false;
+  int64_t _periodic_at = 0; // µs since boot
+  int64_t _period_us = 0;
+
+  // ring of the samples of recent reports, the moving average
+  float _temp_c[max_samples] = {};
+  float _relhum[max_samples] = {};
+  size_t _sample_next = 0;
+  size_t _sample_count = 0;
 };
 
 } // namespace i2c
@@ -39,7 +39,16 @@ static const char *cmd_text[] = {"on", "off"};
 constexpr size_t ON = 0;
 constexpr size_t OFF = 1;
 
-IRAM_ATTR MCP23008::MCP23008(uint8_t addr) : Device(addr, dev_description, MUTABLE) {}
+// register       register      register          register
+// 0x00 - IODIR   0x01 - IPOL   0x02 - GPINTEN    0x03 - DEFVAL
+// 0x04 - INTCON  0x05 - IOCON  0x06 - GPPU       0x07 - INTF
+// 0x08 - INTCAP  0x09 - GPIO   0x0a - OLAT
+enum Register : uint8_t { IODIR = 0, IPOL, GPINTEN, DEFVAL, INTCON, IOCON, GPPU, INTF, INTCAP, GPIO, OLAT };
+
+IRAM_ATTR MCP23008::MCP23008(uint8_t addr, uint8_t channel, const Opts &opts)
+    : Device(addr, channel, dev_description, MUTABLE), _opts(opts) {
+  _mutex = xSemaphoreCreateMutexStatic(&_mutex_buff);
+}
 
 IRAM_ATTR bool MCP23008::cmdToMaskAndState(uint8_t pin, const char *cmd, uint8_t &mask, uint8_t &state) {
   // guard against empty cmd or pin
@@ -66,6 +75,37 @@ IRAM_ATTR bool MCP23008::cmdToMaskAndState(uint8_t pin, const char *cmd, uint8_t
   return rc;
 }
 
+bool MCP23008::configure() {
+  constexpr uint8_t seqop_disable = 0x20;
+  constexpr uint8_t int_open_drain = 0x04; // INT may be shared by several devices
+
+  // the device keeps its registers across an ESP32 restart so IOCON (and SEQOP) may be
+  // anything.  IOCON is written first then each register on its own, a single register
+  // write never depends on the address pointer incrementing.
+  //
+  // inputs interrupt on any change (compared to their previous value) and are pulled up.
+  // OLAT is not written so outputs are unchanged (e.g. after an ESP32 restart).
+  const uint8_t regs[][2] = {
+      {IOCON, seqop_disable | int_open_drain},
+      {IODIR, _opts.inputs},
+      {IPOL, 0x00},
+      {GPINTEN, _opts.inputs},
+      {DEFVAL, 0x00},
+      {INTCON, 0x00},
+      {GPPU, _opts.inputs},
+  };
+
+  auto rc = true;
+  Txn txn(_addr, _channel);
+
+  for (size_t i = 0; rc && (i < (sizeof(regs) / sizeof(regs[0]))); i++) {
+    txn.write(regs[i], sizeof(regs[i]));
+    rc = Bus::execute(txn);
+  }
+
+  return rc;
+}
+
 IRAM_ATTR bool MCP23008::execute(message::InWrapped msg) {
   auto execute_rc = true;
 
@@ -87,84 +127,108 @@ IRAM_ATTR bool MCP23008::execute(message::InWrapped msg) {
   return execute_rc;
 }
 
-IRAM_ATTR bool MCP23008::refreshStates(int64_t *elapsed_us) {
-  static auto once = true;
+IRAM_ATTR void MCP23008::publish(uint8_t states_raw) {
+  message::States states_rpt(_ident);
 
-  // register       register      register          register
-  // 0x00 - IODIR   0x01 - IPOL   0x02 - GPINTEN    0x03 - DEFVAL
-  // 0x04 - INTCON  0x05 - IOCON  0x06 - GPPU       0x07 - INTF
-  // 0x08 - INTCAP  0x09 - GPIO   0x0a - OLAT
+  for (size_t i = 0; i < num_pins; i++) {
+    const char *state = (states_raw & (0x01 << i)) ? cmd_text[ON] : cmd_text[OFF];
 
-  if (once) {
-    constexpr size_t bytes = 11;
-    constexpr uint8_t iocon = 0x05;
-    constexpr uint8_t seqop_disable = 0x20;
-    uint8_t tx[bytes] = {};
+    states_rpt.addPin(i, state);
+  }
 
-    auto cmd = Bus::createCmd();
-    tx[iocon] = seqop_disable; // disable sequential byte mode
+  states_rpt.finalize();
 
-    // address the device for write
-    i2c_master_write_byte(cmd, writeAddr(), I2C_MASTER_ACK);
-    // MCP23008 defaults to SEQOP at POR, write the entire byte stream
-    i2c_master_write(cmd, tx, bytes, I2C_MASTER_ACK);
-    i2c_master_stop(cmd);
+  ruth::MQTT::send(states_rpt);
+}
 
-    Bus::executeCmd(cmd);
+IRAM_ATTR bool MCP23008::readRegister(uint8_t reg, uint8_t &val) {
+  // write the register to read then restart and read it
+  Txn txn(_addr, _channel);
+  txn.write(&reg, sizeof(reg));
+  txn.read(&val, sizeof(val));
 
-    once = false;
-  }
+  return Bus::execute(txn);
+}
 
-  constexpr uint8_t gpio_reg = 0x09;
-  auto cmd = Bus::createCmd();
+IRAM_ATTR bool MCP23008::refreshStates(int64_t *elapsed_us) {
+  // caller holds the mutex.
+  // each instance configures its own registers, an error reconfigures (e.g. power cycled)
+  if (!_configured) _configured = configure();
 
-  // send a START and device address with the read flag
-  // read 11 bytes of control register data.
-  i2c_master_start(cmd);
-  i2c_master_write_byte(cmd, writeAddr(), I2C_MASTER_ACK); // address the MCP23008
-  i2c_master_write_byte(cmd, gpio_reg, I2C_MASTER_ACK);    // write the register to read
-  i2c_master_start(cmd);                                   // restart
-  i2c_master_write_byte(cmd, readAddr(), I2C_MASTER_ACK);  // signal to read
   uint8_t gpio_port_val = 0x00;
-  i2c_master_read_byte(cmd, &gpio_port_val, I2C_MASTER_LAST_NACK); // read the register
-  i2c_master_stop(cmd);
-
-  auto rc = Bus::executeCmd(cmd);
+  auto rc = readRegister(GPIO, gpio_port_val);
 
   ESP_LOGD(_ident, "gpio_port 0x%02x %s", gpio_port_val, (rc) ? "true" : "false");
-  statesStore(rc, gpio_port_val);
+  _states.store(rc, gpio_port_val);
+
+  if (!rc) _configured = false;
 
   return rc;
 }
 
 IRAM_ATTR bool MCP23008::report() {
+  // with input changes interrupt driven the periodic report is only a heartbeat
+  const auto now = esp_timer_get_time();
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+  if (interruptDriven() && _configured && ((now - _reported_at) < (_opts.heartbeat_ms * 1000LL))) {
+    xSemaphoreGive(_mutex);
+    return true;
+  }
+
   refreshStates();
 
   uint8_t states_raw;
-  if (states(states_raw)) {
-    message::States states_rpt(_ident);
+  const auto rc = _states.get(states_raw);
+  if (rc) _reported_at = now;
+  xSemaphoreGive(_mutex);
 
-    for (size_t i = 0; i < num_pins; i++) {
-      const char *state = (states_raw & (0x01 << i)) ? cmd_text[ON] : cmd_text[OFF];
+  if (rc) publish(states_raw);
 
-      states_rpt.addPin(i, state);
-    }
+  return rc;
+}
 
-    states_rpt.finalize();
+IRAM_ATTR bool MCP23008::reportChange() {
+  if (!interruptDriven()) return false;
 
-    ruth::MQTT::send(states_rpt);
-    return true;
+  // held from INTF through INTCAP so a report or command can't read GPIO (clearing the
+  // interrupt) or reconfigure between them
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  auto rc = _configured;
+
+  // INTF identifies the pins that interrupted, none when another device on the shared line did
+  uint8_t intf = 0x00;
+  if (rc) rc = readRegister(INTF, intf) && ((intf & _opts.inputs) != 0x00);
+
+  // INTCAP holds the pin states when the interrupt occurred, reading it clears the interrupt
+  uint8_t intcap = 0x00;
+  if (rc) {
+    rc = readRegister(INTCAP, intcap);
+    _states.store(rc, intcap);
   }
 
-  return false;
+  xSemaphoreGive(_mutex);
+
+  if (rc) publish(intcap);
+
+  return rc;
 }
 
 IRAM_ATTR bool MCP23008::setPin(uint8_t pin, const char *cmd) {
   uint8_t have_states;
 
-  // NOTE: check has side-effect of rejecting cmds until first report
-  if (states(have_states) == false) {
-    return false;
+  // held through the OLAT write so the states read (or cached) are the states changed
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+
+  // only read the device when the cache is invalid (error, age or no report yet)
+  if (_states.get(have_states) == false) {
+    if (refreshStates() == false) {
+      xSemaphoreGive(_mutex);
+      return false;
+    }
+
+    _states.get(have_states);
   }
 
   auto rc = false;
@@ -172,22 +236,21 @@ IRAM_ATTR bool MCP23008::setPin(uint8_t pin, const char *cmd) {
   uint8_t cmd_mask;
 
   if (cmdToMaskAndState(pin, cmd, cmd_mask, cmd_state)) {
-    constexpr uint8_t olat_reg = 0x0a;
     // next olat is the XOR of have_state and mask and cmd pin
     const uint8_t olat_val = have_states ^ ((have_states ^ cmd_state) & cmd_mask);
 
     ESP_LOGD(_ident, "have_states[%02x] olat[%02x]", have_states, olat_val);
 
-    auto cmd = Bus::createCmd();
-    i2c_master_write_byte(cmd, writeAddr(), I2C_MASTER_ACK);
-    i2c_master_write_byte(cmd, olat_reg, I2C_MASTER_ACK);
-    i2c_master_write_byte(cmd, olat_val, I2C_MASTER_ACK);
-    i2c_master_stop(cmd);
+    const uint8_t tx[] = {OLAT, olat_val};
+    Txn txn(_addr, _channel);
+    txn.write(tx, sizeof(tx));
 
-    rc = Bus::executeCmd(cmd);
-    statesStore(rc, olat_val);
+    rc = Bus::execute(txn);
+    _states.store(rc, olat_val); // an error invalidates the cache
   }
 
+  xSemaphoreGive(_mutex);
+
   return rc;
 }
 
@@ -0,0 +1,300 @@
+/*
+    i2c/pca9685.cpp - Ruth I2C Device PCA9685
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <esp_attr.h>
+#include <esp_log.h>
+
+#include "ArduinoJson.h"
+#include "bus.hpp"
+#include "dev_i2c/pca9685.hpp"
+#include "message/ack_msg.hpp"
+#include "message/states_msg.hpp"
+#include "ruth_mqtt/mqtt.hpp"
+
+namespace i2c {
+static const char *dev_description = "pca9685";
+static StaticJsonDocument<512> cmd_doc;
+
+// register        register          register
+// 0x00 - MODE1    0x01 - MODE2      0x06 - LED0_ON_L (four per channel, through 0x45)
+// 0xfe - PRE_SCALE
+enum Register : uint8_t { MODE1 = 0x00, MODE2 = 0x01, LED0_ON_L = 0x06, PRE_SCALE = 0xfe };
+enum Mode1 : uint8_t { ALLCALL = 0x01, SLEEP = 0x10, AI = 0x20, RESTART = 0x80 };
+constexpr uint8_t outdrv = 0x04; // MODE2, totem pole outputs
+constexpr uint8_t full = 0x10;   // ON_H / OFF_H bit 4, output fully on / off
+constexpr uint32_t osc_hz = 25000000;
+
+IRAM_ATTR static void encode(uint8_t pin, uint16_t duty, uint8_t *regs) {
+  // stagger the ON time of each channel so the outputs don't all switch at once
+  const uint16_t on = (pin * 256) & 0x0fff;
+  const uint16_t off = (on + duty) & 0x0fff;
+
+  regs[0] = (duty >= PCA9685::duty_max) ? 0x00 : (on & 0xff);
+  regs[1] = (duty >= PCA9685::duty_max) ? full : (on >> 8);
+  regs[2] = (duty == 0) ? 0x00 : (off & 0xff);
+  regs[3] = (duty == 0) ? full : ((duty >= PCA9685::duty_max) ? 0x00 : (off >> 8));
+}
+
+PCA9685::PCA9685(uint8_t addr, uint8_t channel, const Opts &opts)
+    : Device(addr, channel, dev_description, MUTABLE), _opts(opts), _txn(new Txn(addr, channel)) {
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = flush;
+  timer_args.arg = this;
+  timer_args.dispatch_method = ESP_TIMER_TASK;
+  timer_args.name = dev_description;
+
+  esp_timer_create(&timer_args, &_frame_timer);
+
+  _txn->onDone(flushed, this);
+}
+
+PCA9685::~PCA9685() {
+  if (_frame_timer) {
+    esp_timer_stop(_frame_timer);
+    esp_timer_delete(_frame_timer);
+  }
+}
+
+bool PCA9685::configure() {
+  // the prescaler may only be written while the oscillator is stopped (SLEEP).  ALLCALL is
+  // disabled, it's default address (0x70) is the multiplexer.
+  auto prescale = std::lround((float)osc_hz / (4096.0f * _opts.pwm_hz)) - 1;
+  prescale = (prescale < 3) ? 3 : ((prescale > 255) ? 255 : prescale);
+
+  const uint8_t sleep[] = {MODE1, SLEEP | AI};
+  const uint8_t prescaler[] = {PRE_SCALE, (uint8_t)prescale};
+  const uint8_t wake[] = {MODE1, AI, outdrv}; // MODE1 then MODE2 by auto-increment
+
+  Txn txn(_addr, _channel);
+  txn.write(sleep, sizeof(sleep));
+  auto rc = Bus::execute(txn);
+
+  txn.write(prescaler, sizeof(prescaler));
+  if (rc) rc = Bus::execute(txn);
+
+  txn.write(wake, sizeof(wake));
+  if (rc) rc = Bus::execute(txn);
+
+  _configured = rc;
+
+  // the oscillator is stable 500µs after waking, every channel is then rewritten so RESTART
+  // is not required
+  if (rc) {
+    delay(1);
+
+    portENTER_CRITICAL(&_mux);
+    _dirty = 0xffff;
+    portEXIT_CRITICAL(&_mux);
+
+    schedule();
+  }
+
+  ESP_LOGD(_ident, "configure prescale[%ld] %s", prescale, rc ? "ok" : "failed");
+
+  return rc;
+}
+
+IRAM_ATTR bool PCA9685::execute(message::InWrapped msg) {
+  auto execute_rc = false;
+
+  if (msg->unpack(cmd_doc)) {
+    const char *refid = msg->refidFromFilter();
+    message::Ack ack_msg(refid); // create ack msg early to capture execute us
+
+    const JsonObject root = cmd_doc.as<JsonObject>();
+    const char *cmd = root["cmd"] | "";
+    const char *type = root["params"]["type"] | "";
+    const uint8_t pin = root["pin"] | (uint8_t)num_channels;
+
+    if (!_configured) configure();
+
+    if (_configured && (pin < num_channels)) {
+      execute_rc = true;
+
+      if (strcmp(cmd, "on") == 0) {
+        update(pin, duty_max);
+      } else if (strcmp(cmd, "off") == 0) {
+        update(pin, 0);
+      } else if (strcmp(type, "fixed") == 0) {
+        auto percent = root["params"]["percent"].as<float>();
+        percent = (percent <= 100.0f) ? ((percent >= 0.0f) ? percent : 0.0f) : 100.0f;
+
+        update(pin, std::lround((percent * duty_max) / 100.0f));
+      } else {
+        execute_rc = false; // effects (e.g. random) are only available on PulseWidth
+      }
+    }
+
+    const bool ack = root["ack"] | true;
+
+    if (ack && execute_rc) ruth::MQTT::send(ack_msg);
+  }
+
+  return execute_rc;
+}
+
+IRAM_ATTR void PCA9685::flush(void *data) {
+  auto *pca = (PCA9685 *)data;
+  size_t len = 0;
+
+  portENTER_CRITICAL(&pca->_mux);
+  pca->_scheduled = false;
+
+  const uint16_t dirty = pca->_dirty;
+
+  // one write from the first through the last changed channel, unchanged channels between
+  // them are rewritten with their current value
+  if (dirty && pca->_configured && !pca->_in_flight) {
+    const uint8_t first = __builtin_ctz(dirty);
+    const uint8_t last = 31 - __builtin_clz(dirty);
+
+    pca->_tx[0] = LED0_ON_L + (first * 4);
+    for (uint8_t pin = first; pin <= last; pin++) {
+      encode(pin, pca->_duty[pin], pca->_tx + 1 + ((pin - first) * 4));
+    }
+
+    len = 1 + ((last - first + 1) * 4);
+    pca->_dirty = 0x0000;
+    pca->_in_flight = true;
+  }
+  portEXIT_CRITICAL(&pca->_mux);
+
+  if (len == 0) return;
+
+  pca->_txn->write(pca->_tx, len);
+
+  // the esp_timer task (shared by every timer) never waits for space in the bus queue, when
+  // full the channels are flushed a frame later
+  if (Bus::submit(*(pca->_txn), 0) == false) {
+    portENTER_CRITICAL(&pca->_mux);
+    pca->_dirty |= dirty;
+    pca->_in_flight = false;
+    portEXIT_CRITICAL(&pca->_mux);
+
+    pca->schedule();
+  }
+}
+
+IRAM_ATTR void PCA9685::flushed(Txn &txn, void *ctx) {
+  auto *pca = (PCA9685 *)ctx;
+  const auto ok = txn.ok(); // the txn may be resubmitted once no longer in flight
+
+  // invoked by the bus task, changes made while the flush was in flight are scheduled now
+  portENTER_CRITICAL(&pca->_mux);
+  pca->_in_flight = false;
+
+  if (!ok) {
+    // the next command or report reconfigures the device and rewrites every channel
+    pca->_configured = false;
+    pca->_dirty = 0xffff;
+  }
+  portEXIT_CRITICAL(&pca->_mux);
+
+  if (ok) pca->schedule();
+}
+
+bool PCA9685::identify(uint8_t addr, uint8_t channel) {
+  // the SHT31 address range overlaps, an SHT31 NACKs a read without a measurement pending.
+  // the prescaler is never below 3.
+  uint8_t mode1 = 0x00;
+  uint8_t prescale = 0x00;
+
+  return registerOf(addr, channel, MODE1, mode1) && registerOf(addr, channel, PRE_SCALE, prescale) &&
+         (prescale >= 3);
+}
+
+IRAM_ATTR bool PCA9685::readRegister(uint8_t reg, uint8_t &val) {
+  return registerOf(_addr, _channel, reg, val);
+}
+
+IRAM_ATTR bool PCA9685::registerOf(uint8_t addr, uint8_t channel, uint8_t reg, uint8_t &val) {
+  Txn txn(addr, channel);
+  txn.write(&reg, sizeof(reg));
+  txn.read(&val, sizeof(val));
+
+  return Bus::execute(txn);
+}
+
+IRAM_ATTR bool PCA9685::report() {
+  // a device reset (e.g. power cycled) returns to SLEEP with the default prescaler
+  uint8_t mode1 = 0x00;
+  if (readRegister(MODE1, mode1) == false) {
+    _configured = false;
+    return false;
+  }
+
+  if ((!_configured || (mode1 & SLEEP)) && !configure()) return false;
+
+  uint16_t duty[num_channels];
+  portENTER_CRITICAL(&_mux);
+  memcpy(duty, _duty, sizeof(duty));
+  portEXIT_CRITICAL(&_mux);
+
+  // States holds pointers to the status text, it must remain valid until sent
+  char fixed[num_channels][12];
+  message::States states_rpt(_ident);
+
+  for (size_t i = 0; i < num_channels; i++) {
+    if (duty[i] == 0) {
+      states_rpt.addPin(i, "off");
+    } else if (duty[i] >= duty_max) {
+      states_rpt.addPin(i, "on");
+    } else {
+      memcpy(fixed[i], "fixed ", 6);
+      itoa(duty[i], fixed[i] + 6, 10);
+      states_rpt.addPin(i, fixed[i]);
+    }
+  }
+
+  states_rpt.finalize();
+
+  ruth::MQTT::send(states_rpt);
+
+  return true;
+}
+
+IRAM_ATTR void PCA9685::schedule() {
+  auto start = false;
+
+  // a flush in flight schedules the next frame once complete
+  portENTER_CRITICAL(&_mux);
+  if (_dirty && !_scheduled && !_in_flight) {
+    _scheduled = true;
+    start = true;
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  if (start) esp_timer_start_once(_frame_timer, _opts.frame_ms * 1000);
+}
+
+IRAM_ATTR void PCA9685::update(uint8_t pin, uint16_t duty) {
+  portENTER_CRITICAL(&_mux);
+  _duty[pin] = duty;
+  _dirty |= (0x01 << pin);
+  portEXIT_CRITICAL(&_mux);
+
+  schedule();
+}
+
+} // namespace i2c
@@ -23,6 +23,7 @@
 #include <esp_log.h>
 
 #include "bus.hpp"
+#include "crc/crc.h"
 #include "dev_i2c/sht31.hpp"
 #include "relhum_msg.hpp"
 #include "ruth_mqtt/mqtt.hpp"
@@ -30,34 +31,59 @@
 namespace i2c {
 static const char *dev_description = "sht31";
 
-SHT31::SHT31(uint8_t addr) : Device(addr, dev_description) {}
+// periodic mode commands (medium repeatability) by measurements per second
+static const struct {
+  float mps;
+  uint8_t cmd[2];
+} periodic_cmds[] = {
+    {0.5, {0x20, 0x24}}, {1.0, {0x21, 0x26}}, {2.0, {0x22, 0x20}}, {4.0, {0x23, 0x22}}, {10.0, {0x27, 0x21}}};
+
+SHT31::SHT31(uint8_t addr, uint8_t channel, const Opts &opts)
+    : Device(addr, channel, dev_description), _opts(opts) {
+  if (_opts.samples < 1) _opts.samples = 1;
+  if (_opts.samples > max_samples) _opts.samples = max_samples;
+}
 
 IRAM_ATTR bool SHT31::crc(const uint8_t *data, size_t index) {
-  uint8_t crc = 0xFF;
-
-  for (uint32_t j = 0; j < 2; j++) {
-    // crc ^= *data++;
-    crc ^= data[j + index];
-
-    for (uint32_t i = 8; i; --i) {
-      crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
-    }
-  }
+  // each measurement is a two byte word followed by it's crc
+  const uint8_t crc = crc8_sensirion_update(CRC8_SENSIRION_INIT, data + index, 2);
 
   return (crc == data[index + 2]);
 }
 
-IRAM_ATTR bool SHT31::report() {
-  auto rc = false;
-  auto start_at = esp_timer_get_time();
+IRAM_ATTR bool SHT31::fetch(uint8_t *rx, size_t len) {
+  // the device measures on its own, fetch data reads the latest measurement without clock
+  // stretching (the device NACKs when no new measurement is available)
+  static const uint8_t fetch_data[] = {0xe0, 0x00};
+
+  Txn txn(_addr, _channel);
+  txn.write(fetch_data, sizeof(fetch_data));
+  txn.read(rx, len);
+
+  return Bus::execute(txn);
+}
 
+IRAM_ATTR bool SHT31::measure(uint8_t *rx, size_t len) {
   constexpr uint8_t single_shot = 0x2c; // with clock stretching
   constexpr uint8_t medium_repeatability = 0x0d;
-  uint8_t tx[] = {
+  const uint8_t tx[] = {
       single_shot,         // single-shot measurement, with clock stretching
       medium_repeatability // medium-repeatability measurement
   };
 
+  // clock stretching is leveraged in the event the device requires time
+  // to execute the command (e.g. temperature conversion)
+  // use timeout scale to adjust time to wait for clock, if needed
+  Txn txn(_addr, _channel, 5.0);
+  txn.write(tx, sizeof(tx));
+  txn.read(rx, len);
+
+  return Bus::execute(txn);
+}
+
+IRAM_ATTR bool SHT31::report() {
+  const auto start_at = esp_timer_get_time();
+
   uint8_t rx[] = {
       0x00, 0x00, // tempC high byte, low byte
       0x00,       // crc8 of temp
@@ -65,51 +91,85 @@ IRAM_ATTR bool SHT31::report() {
       0x00        // crc8 of relh
   };
 
-  auto cmd = Bus::createCmd();
+  if (_opts.mps > 0) {
+    if (!_periodic && !startPeriodic()) return false;
 
-  // queue the WRITE for device and check for ACK
-  i2c_master_write_byte(cmd, writeAddr(), true);
+    if (fetch(rx, sizeof(rx)) == false) {
+      // the first measurement is available one period after starting periodic mode
+      if ((start_at - _periodic_at) < (2 * _period_us)) return true;
 
-  // queue the device command bytes
-  i2c_master_write(cmd, tx, sizeof(tx), I2C_MASTER_ACK);
+      // otherwise the device was likely reset (periodic mode lost), restart it next report
+      _periodic = false;
+      return false;
+    }
+  } else if (measure(rx, sizeof(rx)) == false) {
+    return false;
+  }
 
-  // start a new command sequence without sending a stop
-  i2c_master_start(cmd);
+  if (!crc(rx) || !crc(rx, 3)) {
+    auto status = RelHum({_ident, RelHum::Status::CRC_MISMATCH, 0, 0, 0, 0});
+    ruth::MQTT::send(status);
+    return true;
+  }
 
-  // queue the READ for device and check for ACK
-  i2c_master_write_byte(cmd, readAddr(), true);
+  // conversion from SHT31 datasheet
+  const uint16_t stc = (rx[0] << 8) | rx[1];
+  const uint16_t srh = (rx[3] << 8) | rx[4];
+
+  // the sample of this report replaces the oldest, the moving average of the last samples
+  // reports is published
+  _temp_c[_sample_next] = ((175.0f * stc) / 65535.0f) - 45.0f;
+  _relhum[_sample_next] = (100.0f * srh) / 65535.0f;
+  _sample_next = (_sample_next + 1) % _opts.samples;
+  if (_sample_count < _opts.samples) _sample_count++;
+
+  float tc = 0;
+  float rh = 0;
+  for (size_t i = 0; i < _sample_count; i++) {
+    tc += _temp_c[i];
+    rh += _relhum[i];
+  }
 
-  // queue the READ of number of bytes
-  i2c_master_read(cmd, rx, sizeof(rx), I2C_MASTER_LAST_NACK);
+  tc /= _sample_count;
+  rh /= _sample_count;
 
-  // always queue the stop command
-  i2c_master_stop(cmd);
+  const auto read_us = esp_timer_get_time() - start_at;
 
-  // clock stretching is leveraged in the event the device requires time
-  // to execute the command (e.g. temperature conversion)
-  // use timeout scale to adjust time to wait for clock, if needed
-  rc = Bus::executeCmd(cmd, 5.0);
+  auto status = RelHum({_ident, RelHum::Status::OK, tc, rh, read_us, 0});
+  ruth::MQTT::send(status);
 
-  if (rc) {
-    if (crc(rx) && crc(rx, 3)) {
-      // conversion from SHT31 datasheet
-      uint16_t stc = (rx[0] << 8) | rx[1];
-      uint16_t srh = (rx[3] << 8) | rx[4];
+  return true;
+}
 
-      float tc = (float)((stc * 175) / 0xffff) - 45;
-      float rh = (float)((srh * 100) / 0xffff);
+bool SHT31::identify(uint8_t addr, uint8_t channel) {
+  // the status word and its crc, an ACK alone may be a device of another kind
+  static const uint8_t read_status[] = {0xf3, 0x2d};
+  uint8_t rx[3] = {};
 
-      const auto read_us = esp_timer_get_time() - start_at;
+  Txn txn(addr, channel);
+  txn.write(read_status, sizeof(read_status));
+  txn.read(rx, sizeof(rx));
 
-      auto status = RelHum({_ident, RelHum::Status::OK, tc, rh, read_us, 0});
-      ruth::MQTT::send(status);
-    } else { // crc did not match
-      auto status = RelHum({_ident, RelHum::Status::CRC_MISMATCH, 0, 0, 0, 0});
-      ruth::MQTT::send(status);
-    }
+  return Bus::execute(txn) && (crc8_sensirion_update(CRC8_SENSIRION_INIT, rx, 2) == rx[2]);
+}
+
+bool SHT31::startPeriodic() {
+  // use the fastest supported rate not exceeding the configured rate
+  const auto *periodic = &periodic_cmds[0];
+  for (const auto &entry : periodic_cmds) {
+    if (entry.mps <= _opts.mps) periodic = &entry;
   }
 
-  return rc;
+  Txn txn(_addr, _channel);
+  txn.write(periodic->cmd, sizeof(periodic->cmd));
+
+  _periodic = Bus::execute(txn);
+  _periodic_at = esp_timer_get_time();
+  _period_us = 1000000 / periodic->mps;
+
+  ESP_LOGD(_ident, "periodic mps[%0.1f] %s", periodic->mps, _periodic ? "started" : "failed");
+
+  return _periodic;
 }
 
 } // namespace i2c
@@ -0,0 +1,129 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// Bus (transactions queued to the bus task) on the simulated i2c bus.  a multiplexer state
+// change (Bus::mplex) is ordered with the transactions queued before it: a task above the bus
+// task (like the engine interrupt task) queues transactions to a device behind a channel then
+// disables the multiplexer, the queued transactions still select their channel.  the channel
+// is only written when it changes.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "bus.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "i2c_sim.hpp"
+
+using namespace i2c;
+
+static i2c_sim::Mux mux;
+static i2c_sim::Registers behind(0x44, 3);
+static i2c_sim::Registers root(0x20);
+
+static SemaphoreHandle_t done;
+
+struct Counts {
+  uint32_t ok = 0;
+  uint32_t failed = 0;
+};
+
+static void counted(Txn &txn, void *ctx) {
+  auto *counts = (Counts *)ctx;
+  txn.ok() ? counts->ok++ : counts->failed++;
+}
+
+static void orderedTask(void *) {
+  constexpr size_t count = 4;
+  // outlive the task, a txn may complete after it ends when the change isn't ordered
+  static uint8_t tx[count][2];
+  static std::unique_ptr<Txn> txns[count];
+  static Counts counts;
+
+  Bus::mplex(true);
+  const auto mux_writes = mux.writes;
+
+  // above the bus task, every txn is queued before the bus task runs
+  for (size_t i = 0; i < count; i++) {
+    tx[i][0] = i;
+    tx[i][1] = 0xa0 + i;
+
+    txns[i].reset(new Txn(behind.addr, behind.channel));
+    txns[i]->write(tx[i], sizeof(tx[i]));
+    txns[i]->onDone(counted, &counts);
+
+    Bus::submit(*txns[i]);
+  }
+
+  Bus::mplex(false); // waits for the change, made after the txns queued above
+
+  CHECK(counts.ok == count, "queued txns ok %u failed %u", counts.ok, counts.failed);
+  for (size_t i = 0; i < count; i++) CHECK(behind.regs[i] == (0xa0 + i), "reg %zu %02x", i, behind.regs[i]);
+  CHECK((mux.writes - mux_writes) == 1, "selects for one channel %u", mux.writes - mux_writes);
+
+  xSemaphoreGive(done);
+  vTaskDelete(nullptr);
+}
+
+static void selects() {
+  Bus::mplex(true);
+  const auto mux_writes = mux.writes;
+
+  // alternating between the bus and a channel selects each time, repeats don't
+  for (int i = 0; i < 3; i++) {
+    CHECK(Bus::probe(root.addr), "root probe %d", i);
+    CHECK(Bus::probe(behind.addr, behind.channel), "behind probe %d", i);
+    CHECK(Bus::probe(behind.addr, behind.channel), "behind probe again %d", i);
+  }
+
+  CHECK((mux.writes - mux_writes) == 6, "alternating selects %u", mux.writes - mux_writes);
+  CHECK(mux.control == (0x01 << behind.channel), "control %02x", mux.control);
+
+  // disabled, txns leave the multiplexer as is
+  Bus::mplex(false);
+  CHECK(Bus::probe(root.addr), "root probe disabled");
+  CHECK(mux.control == (0x01 << behind.channel), "disabled control %02x", mux.control);
+}
+
+static int testMain() {
+  i2c_sim::add(&mux);
+  i2c_sim::add(&behind);
+  i2c_sim::add(&root);
+
+  CHECK(Bus::init(), "bus init");
+
+  done = xSemaphoreCreateBinary();
+  xTaskCreate(orderedTask, "ordered", 4096, nullptr, 13, nullptr);
+  xSemaphoreTake(done, portMAX_DELAY);
+
+  selects();
+
+  printf("i2c bus: %u links, %u bytes, %.2fms\n", i2c_sim::stats.links, i2c_sim::stats.bytes,
+         i2c_sim::stats.bus_us / 1e3);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
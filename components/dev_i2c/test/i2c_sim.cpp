@@ -0,0 +1,435 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// simulated i2c bus and the i2c master driver stand-in, see i2c_sim.hpp
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+#include <driver/i2c.h>
+
+#include "crc/crc.h"
+#include "host_gpio.h"
+#include "host_rtos.h"
+#include "i2c_sim.hpp"
+
+namespace i2c_sim {
+
+uint32_t clock_hz = 100000;
+Stats stats;
+gpio_num_t int_pin = GPIO_NUM_NC;
+
+static std::vector<Device *> devices;
+static Mux *mux = nullptr;
+
+void add(Device *device) {
+  devices.push_back(device);
+
+  if (auto *m = dynamic_cast<Mux *>(device)) mux = m;
+}
+
+void clear() {
+  devices.clear();
+  mux = nullptr;
+  stats = Stats();
+  int_pin = GPIO_NUM_NC;
+}
+
+void updateInt() {
+  if (int_pin == GPIO_NUM_NC) return;
+
+  auto asserted = false;
+  for (auto *device : devices) asserted = asserted || (device->present && device->interrupting());
+
+  host_gpio_drive(int_pin, asserted ? 0 : 1);
+}
+
+static bool reachable(const Device *device) {
+  if (!device->present) return false;
+  if (device->channel == NO_CHANNEL) return true;
+
+  return mux && mux->present && (mux->control & (0x01 << device->channel));
+}
+
+bool Registers::write(uint8_t byte) {
+  if (_first) {
+    _ptr = byte;
+    _first = false;
+    return true;
+  }
+
+  written(_ptr, byte);
+  writes++;
+  if (autoIncrement()) _ptr++;
+
+  return true;
+}
+
+uint8_t Registers::read() {
+  const auto val = regs[_ptr];
+  if (autoIncrement()) _ptr++;
+
+  return val;
+}
+
+void PCA9685::powerOn() {
+  for (auto &reg : regs) reg = 0x00;
+
+  regs[0x00] = 0x11; // MODE1, SLEEP | ALLCALL
+  regs[0x01] = 0x04; // MODE2, OUTDRV
+  regs[0x02] = 0xe2; // SUBADR1 through 3 then ALLCALLADR
+  regs[0x03] = 0xe4;
+  regs[0x04] = 0xe8;
+  regs[0x05] = 0xe0;
+  regs[0xfe] = 0x1e; // PRE_SCALE, 200Hz
+
+  // every channel full off
+  for (uint8_t ch = 0; ch < 16; ch++) regs[0x09 + (ch * 4)] = 0x10;
+}
+
+void PCA9685::written(uint8_t reg, uint8_t val) {
+  // the prescaler is write protected while the oscillator runs
+  if ((reg == 0xfe) && !(regs[0x00] & 0x10)) return;
+
+  regs[reg] = val;
+}
+
+void SHT31::powerOn() {
+  period_us = 0;
+  _cmd_len = 0;
+  _data_len = 0;
+  _measurement = false;
+  _status = 0x0010;
+}
+
+bool SHT31::start(uint8_t a, bool read) {
+  _cmd_len = 0;
+  _data_next = 0;
+
+  // a read with no data pending (e.g. fetch data with no new measurement) is not acknowledged
+  return !read || (_data_len > 0);
+}
+
+bool SHT31::write(uint8_t byte) {
+  if (_cmd_len == sizeof(_cmd)) return false;
+
+  _cmd[_cmd_len++] = byte;
+  if (_cmd_len == sizeof(_cmd)) command((_cmd[0] << 8) | _cmd[1]);
+
+  return true;
+}
+
+uint8_t SHT31::read() {
+  if ((_data_next == 0) && _measurement) measurements++;
+
+  return (_data_next < _data_len) ? _data[_data_next++] : 0xff;
+}
+
+void SHT31::stop() {
+  // the data of a command is read once
+  if (_data_next == 0) return;
+
+  _data_len = 0;
+  _measurement = false;
+}
+
+void SHT31::command(uint16_t cmd) {
+  // periodic mode, medium repeatability, by period
+  static const struct {
+    uint16_t cmd;
+    uint32_t period_us;
+  } periodic[] = {{0x2024, 2000000}, {0x2126, 1000000}, {0x2220, 500000}, {0x2322, 250000}, {0x2721, 100000}};
+
+  _data_len = 0;
+  _measurement = false;
+
+  switch (cmd) {
+  case 0x2c0d: // single shot, medium repeatability, clock stretching (up to 6ms)
+    if (period_us == 0) {
+      measurement();
+      hold_us = 6000;
+    }
+    return;
+
+  case 0xe000: // fetch data, measurements are numbered by period since periodic mode started
+    if (period_us) {
+      const uint64_t available = (host_rtos_now_us() - periodic_at_us) / period_us;
+
+      if (available > _fetched) {
+        _fetched = available;
+        measurement();
+      }
+    }
+    return;
+
+  case 0x3093: // break
+    period_us = 0;
+    return;
+
+  case 0x30a2: // soft reset
+    powerOn();
+    return;
+
+  case 0xf32d: // status
+    respond(_status);
+    return;
+
+  case 0x3041: // clear status
+    _status = 0x0000;
+    return;
+  }
+
+  for (const auto &entry : periodic) {
+    if (entry.cmd != cmd) continue;
+
+    period_us = entry.period_us;
+    periodic_at_us = host_rtos_now_us();
+    _fetched = 0;
+  }
+}
+
+void SHT31::measurement() {
+  respond(std::lround(((celsius + 45.0f) * 65535.0f) / 175.0f));
+  respond(std::lround((relhum * 65535.0f) / 100.0f));
+  _measurement = true;
+}
+
+void SHT31::respond(uint16_t word) {
+  uint8_t *p = _data + _data_len;
+
+  p[0] = word >> 8;
+  p[1] = word & 0xff;
+  p[2] = crc8_sensirion_update(CRC8_SENSIRION_INIT, p, 2);
+  _data_len += 3;
+}
+
+// MCP23008 registers
+enum Register : uint8_t { IODIR = 0, IPOL, GPINTEN, DEFVAL, INTCON, IOCON, GPPU, INTF, INTCAP, GPIO, OLAT };
+
+void MCP23008::powerOn() {
+  for (auto &reg : regs) reg = 0x00;
+
+  regs[IODIR] = 0xff;
+}
+
+void MCP23008::drive(uint8_t driven) {
+  const uint8_t changed = (levels ^ driven) & regs[IODIR] & regs[GPINTEN] & ~regs[INTCON];
+  levels = driven;
+
+  // the capture of a pending interrupt is kept until it is cleared
+  if (changed && (regs[INTF] == 0x00)) {
+    regs[INTF] = changed;
+    regs[INTCAP] = gpio();
+  }
+
+  updateInt();
+}
+
+uint8_t MCP23008::gpio() const {
+  const uint8_t inputs = regs[IODIR];
+
+  return ((levels ^ regs[IPOL]) & inputs) | (regs[OLAT] & ~inputs);
+}
+
+uint8_t MCP23008::read() {
+  const uint8_t reg = _ptr;
+  const uint8_t val = (reg == GPIO) ? gpio() : regs[reg];
+
+  // reading GPIO or INTCAP clears the interrupt
+  if ((reg == INTCAP) || (reg == GPIO)) regs[INTF] = 0x00;
+  if (autoIncrement()) _ptr = (reg == OLAT) ? IODIR : (reg + 1);
+
+  return val;
+}
+
+void MCP23008::written(uint8_t reg, uint8_t val) {
+  if ((reg == INTF) || (reg == INTCAP)) return; // read only
+
+  regs[(reg == GPIO) ? OLAT : reg] = val;
+}
+
+} // namespace i2c_sim
+
+using namespace i2c_sim;
+
+namespace {
+struct Link {
+  enum Kind : uint8_t { START, WRITE, READ, STOP };
+
+  struct Op {
+    Kind kind;
+    bool ack_en;
+    uint8_t byte;
+    const uint8_t *tx;
+    uint8_t *rx;
+    size_t len;
+  };
+
+  Op ops[12];
+  size_t count = 0;
+
+  esp_err_t add(const Op &op) {
+    if (count == (sizeof(ops) / sizeof(Op))) return ESP_ERR_NO_MEM;
+
+    ops[count++] = op;
+    return ESP_OK;
+  }
+};
+
+static_assert(sizeof(Link) <= I2C_LINK_RECOMMENDED_SIZE(0), "link exceeds the buffer");
+
+int timeout = 32000;
+} // namespace
+
+extern "C" {
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size) {
+  return (size >= sizeof(Link)) ? new (buffer) Link() : nullptr;
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd) {}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd) { return ((Link *)cmd)->add({Link::START}); }
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en) {
+  return ((Link *)cmd)->add({Link::WRITE, ack_en, data, nullptr, nullptr, 1});
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t *data, size_t len, bool ack_en) {
+  return ((Link *)cmd)->add({Link::WRITE, ack_en, 0, data, nullptr, len});
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack) {
+  return ((Link *)cmd)->add({Link::READ, false, 0, nullptr, data, len});
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd) { return ((Link *)cmd)->add({Link::STOP}); }
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks) {
+  const auto &link = *(Link *)cmd;
+  std::vector<Device *> addressed;
+  bool addressing = false;
+  uint32_t bits = 0;
+  uint32_t stretch_us = 0;
+  esp_err_t rc = ESP_OK;
+
+  for (size_t i = 0; (i < link.count) && (rc == ESP_OK); i++) {
+    const auto &op = link.ops[i];
+
+    switch (op.kind) {
+    case Link::START:
+      bits++;
+      addressing = true;
+      break;
+
+    case Link::WRITE:
+      for (size_t b = 0; (b < op.len) && (rc == ESP_OK); b++) {
+        const uint8_t byte = op.tx ? op.tx[b] : op.byte;
+        bool ack = false;
+
+        if (addressing) {
+          // the device set is chosen by the address, the multiplexer channels as they are now
+          addressing = false;
+          addressed.clear();
+
+          for (auto *device : devices) {
+            if (reachable(device) && device->answers(byte >> 1)) addressed.push_back(device);
+          }
+
+          for (auto *device : addressed) {
+            device->txns++;
+            ack = device->start(byte >> 1, byte & 0x01) || ack;
+          }
+        } else {
+          for (auto *device : addressed) ack = device->write(byte) || ack;
+        }
+
+        bits += 9;
+        stats.bytes++;
+
+        if (!ack && op.ack_en) {
+          stats.nacks++;
+          rc = ESP_FAIL;
+        }
+      }
+      break;
+
+    case Link::READ:
+      for (auto *device : addressed) {
+        stretch_us = std::max(stretch_us, device->hold_us);
+        device->hold_us = 0;
+      }
+
+      for (size_t b = 0; b < op.len; b++) {
+        uint8_t byte = 0xff; // released, wired-AND of the devices driving it
+        for (auto *device : addressed) byte &= device->read();
+
+        op.rx[b] = byte;
+        bits += 9;
+        stats.bytes++;
+      }
+      break;
+
+    case Link::STOP:
+      bits++;
+      for (auto *device : addressed) device->stop();
+      addressed.clear();
+      break;
+    }
+  }
+
+  // an aborted link ends with STOP
+  if (rc != ESP_OK) {
+    bits++;
+    for (auto *device : addressed) device->stop();
+  }
+
+  const uint32_t us = (((uint64_t)bits * 1000000) / clock_hz) + stretch_us;
+  stats.links++;
+  stats.bus_us += us;
+  host_rtos_wait_us(us);
+
+  updateInt();
+
+  return rc;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf) {
+  if (conf->master.clk_speed) clock_hz = conf->master.clk_speed;
+  return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_buf, size_t tx_buf, int flags) {
+  return ESP_OK;
+}
+
+esp_err_t i2c_filter_enable(i2c_port_t port, uint8_t cyc_num) { return ESP_OK; }
+
+esp_err_t i2c_get_timeout(i2c_port_t port, int *val) {
+  *val = timeout;
+  return ESP_OK;
+}
+
+esp_err_t i2c_set_timeout(i2c_port_t port, int val) {
+  timeout = val;
+  return ESP_OK;
+}
+}
@@ -0,0 +1,208 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// simulated i2c bus for the host tests, the i2c master driver stand-in (driver/i2c.h) executes
+// each command link against the devices added here.  devices are on the bus itself or behind a
+// channel of the TCA9548A multiplexer, only reachable while their channel is selected.  every
+// device answering an address takes part (wired-AND reads, any ACK acknowledges).
+//
+// the bus time of each command link (nine clocks a byte plus START / STOP at clock_hz and any
+// clock stretching) is waited on the host runtime so other tasks run meanwhile.  the open drain
+// INT line shared by the devices (int_pin) is driven through the host gpio after each link.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <driver/gpio.h>
+
+namespace i2c_sim {
+
+constexpr uint8_t NO_CHANNEL = 0xff;
+
+class Device {
+public:
+  Device(uint8_t addr, uint8_t channel = NO_CHANNEL) : addr(addr), channel(channel) {}
+  virtual ~Device() = default;
+
+  virtual bool answers(uint8_t a) const { return a == addr; }
+  virtual bool start(uint8_t a, bool read) { return true; } // addressed (START or repeated START), ACK
+  virtual bool write(uint8_t byte) = 0;                     // ACK
+  virtual uint8_t read() = 0;
+  virtual void stop() {}
+  virtual bool interrupting() const { return false; } // holding the shared INT line low
+
+public:
+  const uint8_t addr;
+  const uint8_t channel;
+  bool present = true;
+  uint32_t txns = 0;    // addressed (START or repeated START) while reachable
+  uint32_t hold_us = 0; // SCL held low (clock stretching) before the next byte read
+};
+
+// a register pointer then auto incremented register writes, reads continue from the pointer
+class Registers : public Device {
+public:
+  Registers(uint8_t addr, uint8_t channel = NO_CHANNEL) : Device(addr, channel) {}
+
+  bool start(uint8_t a, bool read) override {
+    _first = !read;
+    return true;
+  }
+  bool write(uint8_t byte) override;
+  uint8_t read() override;
+
+  uint8_t regs[256] = {};
+  uint32_t writes = 0; // data bytes written (the register pointer excluded)
+
+protected:
+  virtual bool autoIncrement() const { return true; }
+  virtual void written(uint8_t reg, uint8_t val) { regs[reg] = val; }
+
+  uint8_t _ptr = 0;
+  bool _first = false;
+};
+
+// TCA9548A, one control register of the selected channels.  a write is applied at STOP so the
+// channels selected when addressed remain connected through the rest of the transaction.
+class Mux : public Device {
+public:
+  Mux(uint8_t addr = 0x70) : Device(addr) {}
+
+  bool write(uint8_t byte) override {
+    _pending = byte;
+    _written = true;
+    writes++;
+    return true;
+  }
+
+  uint8_t read() override { return control; }
+
+  void stop() override {
+    if (_written) control = _pending;
+    _written = false;
+  }
+
+  uint8_t control = 0x00; // power on, every channel deselected
+  uint32_t writes = 0;
+
+private:
+  uint8_t _pending = 0x00;
+  bool _written = false;
+};
+
+// PCA9685, MODE1 (power on SLEEP | ALLCALL) selects auto-increment and ALLCALL (0x70), the
+// prescaler is only written while asleep
+class PCA9685 : public Registers {
+public:
+  PCA9685(uint8_t addr, uint8_t channel = NO_CHANNEL) : Registers(addr, channel) { powerOn(); }
+
+  bool answers(uint8_t a) const override { return (a == addr) || ((a == 0x70) && (regs[0x00] & 0x01)); }
+  void powerOn();
+
+  // 12-bit ON / OFF counts of a channel, with the full on / off bits (bit 12)
+  uint16_t on(uint8_t ch) const { return regs[0x06 + (ch * 4)] | (regs[0x07 + (ch * 4)] << 8); }
+  uint16_t off(uint8_t ch) const { return regs[0x08 + (ch * 4)] | (regs[0x09 + (ch * 4)] << 8); }
+
+protected:
+  bool autoIncrement() const override { return regs[0x00] & 0x20; }
+  void written(uint8_t reg, uint8_t val) override;
+};
+
+// SHT31, two byte commands: single shot (clock stretched for the measurement), periodic mode
+// (measurements at the rate commanded, fetch data reads the latest once and NACKs the read
+// when none is new), status, break and soft reset.  measurements are of celsius and relhum.
+class SHT31 : public Device {
+public:
+  SHT31(uint8_t addr, uint8_t channel = NO_CHANNEL) : Device(addr, channel) {}
+
+  bool start(uint8_t a, bool read) override;
+  bool write(uint8_t byte) override;
+  uint8_t read() override;
+  void stop() override;
+
+  void powerOn();
+
+  float celsius = 20.0f;
+  float relhum = 50.0f;
+  uint32_t measurements = 0; // read by the master (single shot or fetched)
+  uint64_t periodic_at_us = 0;
+  uint32_t period_us = 0; // periodic mode running when not zero
+
+private:
+  void command(uint16_t cmd);
+  void respond(uint16_t word); // the word then its crc
+  void measurement();
+
+  uint8_t _cmd[2] = {};
+  size_t _cmd_len = 0;
+  uint8_t _data[6] = {};
+  size_t _data_len = 0;
+  size_t _data_next = 0;
+  bool _measurement = false; // the data pending is a measurement
+  uint64_t _fetched = 0;     // periodic measurements fetched (by number since started)
+  uint16_t _status = 0x0010; // system reset detected
+};
+
+// MCP23008, Registers with SEQOP (IOCON) disabling auto-increment and GPIO computed from the
+// levels driven on the input pins (IODIR) and the output latch.  an input change with GPINTEN
+// set (INTCON compare to previous) captures INTF and INTCAP then holds INT asserted until
+// GPIO or INTCAP is read.
+class MCP23008 : public Registers {
+public:
+  MCP23008(uint8_t addr, uint8_t channel = NO_CHANNEL) : Registers(addr, channel) { powerOn(); }
+
+  uint8_t read() override;
+  bool interrupting() const override { return regs[0x07] != 0x00; }
+
+  void powerOn();
+  void drive(uint8_t levels); // the levels of the input pins, an interrupt may follow
+
+  uint8_t levels = 0xff; // input pins, pulled up
+
+protected:
+  bool autoIncrement() const override { return !(regs[0x05] & 0x20); }
+  void written(uint8_t reg, uint8_t val) override;
+
+private:
+  uint8_t gpio() const;
+};
+
+struct Stats {
+  uint32_t links = 0; // command links executed (i2c_master_cmd_begin)
+  uint32_t bytes = 0; // bytes on the bus, addresses included
+  uint32_t nacks = 0;
+  uint64_t bus_us = 0;
+};
+
+extern uint32_t clock_hz;
+extern Stats stats;
+extern gpio_num_t int_pin; // the shared INT line, GPIO_NUM_NC when not connected
+
+// devices are owned by the test, the multiplexer (when added) is found by its type
+void add(Device *device);
+void clear();
+
+// drives int_pin low while any device is interrupting (e.g. after a test changes inputs)
+void updateInt();
+
+} // namespace i2c_sim
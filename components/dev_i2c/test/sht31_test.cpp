@@ -0,0 +1,129 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// SHT31 on the simulated i2c bus: bus time of a reading in single shot mode (clock stretched
+// through the conversion) and in periodic mode (fetch data only), then the moving average of
+// the samples of recent reports following a step change.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "ArduinoJson.h"
+#include "dev_i2c/sht31.hpp"
+#include "filter/filter.hpp"
+#include "host_broker.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "i2c_sim.hpp"
+#include "ruth_mqtt/mqtt.hpp"
+
+using host::Broker;
+
+static constexpr int REPORTS = 10;
+static constexpr uint32_t SEND_MS = 1000;
+
+static i2c_sim::SHT31 single_sim(0x44);
+static i2c_sim::SHT31 periodic_sim(0x45);
+
+// the temperature published by the last report of the ident, NAN when not ok
+static float lastCelsius(const char *ident) {
+  const std::string level = std::string("/relhum/") + ident + "/ok";
+
+  for (auto it = Broker::published.rbegin(); it != Broker::published.rend(); ++it) {
+    if (it->topic.find(level) == std::string::npos) continue;
+
+    StaticJsonDocument<256> doc;
+    deserializeMsgPack(doc, it->data);
+    return doc["temp_c"] | NAN;
+  }
+
+  return NAN;
+}
+
+// bus time of each reading by the reports (one a send interval) of the device
+static double busPerReading(i2c::SHT31 &sht31, i2c_sim::SHT31 &sim) {
+  const auto bus_us = i2c_sim::stats.bus_us;
+  const auto measurements = sim.measurements;
+
+  for (int i = 0; i < REPORTS; i++) {
+    CHECK(sht31.report(), "%s report %d", sht31.ident(), i);
+    vTaskDelay(pdMS_TO_TICKS(SEND_MS));
+  }
+
+  const auto readings = sim.measurements - measurements;
+  CHECK(readings >= (REPORTS - 1), "%s readings %u of %d reports", sht31.ident(), readings, REPORTS);
+
+  return readings ? (double)(i2c_sim::stats.bus_us - bus_us) / readings : 0;
+}
+
+static void busTime() {
+  i2c::SHT31 single(single_sim.addr, i2c::Device::NO_CHANNEL, {0, 1});
+  i2c::SHT31 periodic(periodic_sim.addr, i2c::Device::NO_CHANNEL, {1.0, 1});
+
+  const auto single_us = busPerReading(single, single_sim);
+  const auto periodic_us = busPerReading(periodic, periodic_sim);
+
+  CHECK(periodic_sim.period_us == 1000000, "periodic period %uus", periodic_sim.period_us);
+  CHECK((periodic_us * 4) < single_us, "periodic %.0fus single shot %.0fus a reading", periodic_us,
+        single_us);
+
+  printf("sht31: bus a reading single shot %.2fms periodic %.2fms\n", single_us / 1e3, periodic_us / 1e3);
+}
+
+static void movingAverage() {
+  constexpr uint8_t samples = 4;
+  i2c::SHT31 sht31(single_sim.addr, i2c::Device::NO_CHANNEL, {0, samples});
+
+  single_sim.celsius = 20.0f;
+  for (int i = 0; i < samples; i++) sht31.report();
+
+  // each report moves the average a quarter of the step, complete after samples reports
+  single_sim.celsius = 24.0f;
+  for (int i = 1; i <= samples + 1; i++) {
+    sht31.report();
+
+    const auto want = 20.0f + std::min(i, (int)samples);
+    const auto tc = lastCelsius(sht31.ident());
+    CHECK(std::fabs(tc - want) < 0.01f, "report %d after the step %.3fC, want %.1fC", i, tc, want);
+  }
+}
+
+static int testMain() {
+  static filter::Opts filter_opts{"ruth", "host", "host"};
+  filter::Filter::init(filter_opts);
+
+  ruth::MQTT::ConnOpts conn_opts{"host", "mqtt://broker", "user", "passwd", xTaskGetCurrentTaskHandle()};
+  ruth::MQTT::initAndStart(conn_opts);
+
+  i2c_sim::add(&single_sim);
+  i2c_sim::add(&periodic_sim);
+
+  i2c::Device::setUniqueId("host");
+  i2c::Device::initHardware();
+
+  busTime();
+  movingAverage();
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
@@ -21,103 +21,71 @@
 */
 
 #include <algorithm>
-#include <cstdlib>
+#include <cstring>
 
+#include <esp_attr.h>
 #include <esp_log.h>
 
 #include "dev_pwm/cmd.hpp"
 
 namespace pwm {
 
-// NOTE:  all members assigned in constructor definition are constants or
-//        statics and do not need to be copied
+// default fade rate (duty per ms)
+static constexpr uint32_t fade_step = 15;
+static constexpr uint32_t fade_ms = 70;
 
-Command::Command(Hardware *hardware, const JsonObject &obj) : _hw(hardware) {
+// long fades are split into hardware fades of at most this duration.  a replacing command (or
+// on / off) stops the hardware fade in progress (see Hardware::fadeTo / updateDuty)
+static constexpr uint32_t fade_max_ms = 1000;
 
-  // REMINDER: we must always make a local copy of relevant info from the JsonObject
-  auto name = obj["cmd"].as<const char *>();
-  constexpr size_t name_len = sizeof(_name) / sizeof(char) - 1;
-  memccpy(_name, name, 0x00, name_len);
+void Command::fadeTo(uint32_t fade_to, uint32_t ms) {
+  if (ms == 0) {
+    const auto duty = getDuty();
+    const uint32_t delta = (duty > fade_to) ? (duty - fade_to) : (fade_to - duty);
 
-  _task.priority = obj["pri"] | 15;
-  _task.stack = obj["stack"] | 2560;
+    ms = (delta / fade_step) * fade_ms;
+  }
 
-  // grab the task handle of the caller to use for later task notifications
-  _parent = xTaskGetCurrentTaskHandle();
+  _fade_to = fade_to;
+  _fade_ms = ms;
+  _fading = true;
 }
 
-Command::~Command() {
-  // ensure the task is stopped and deleted from the run queue
-  kill();
+void Command::name(const char *name) {
+  // REMINDER: we must always make a local copy of relevant info from the JsonObject
+  constexpr size_t name_len = sizeof(_name) / sizeof(char) - 1;
+  memset(_name, 0x00, sizeof(_name));
+  memccpy(_name, name, 0x00, name_len);
 }
 
-void Command::fadeTo(uint32_t fade_to) {
-  const auto step = 15;
-  const auto delay_ms = 70;
-
-  auto current_duty = getDuty();
-  auto direction = (fade_to < current_duty) ? -1 : 1;
-
-  uint32_t steps = labs(current_duty - fade_to) / step;
-
-  auto new_duty = current_duty;
-
-  for (uint32_t i = 0; (i < steps) && keepRunning(); i++) {
-    new_duty += (direction * step);
-    _hw->updateDuty(new_duty);
-
-    pause(delay_ms);
-  }
-}
+void Command::start(const JsonObject &obj) {
+  name(obj["cmd"] | "");
 
-void Command::pause(uint32_t ms) {
-  _notify_val = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+  _fading = false;
 
-  if (_notify_val > 0) {
-    _run = false;
-  }
+  configure(obj);
 }
 
-bool Command::run() {
-  auto rc = false;
+IRAM_ATTR uint32_t Command::step() {
+  // a fade in progress completes before the effect continues.  the hardware performs each
+  // fade (or part of a long fade), the fade end wakes the scheduler to step again.
+  if (_fading) {
+    const int64_t duty = getDuty();
 
-  if (_loop_func) {
-    rc = true;
+    if ((duty != _fade_to) && (_fade_ms > 0)) {
+      const auto ms = std::min(_fade_ms, fade_max_ms);
+      const uint32_t duty_next = duty + (((_fade_to - duty) * ms) / _fade_ms);
 
-    char task_name[ruth::task_max_name_len];
+      _fade_ms -= ms;
+      if (_hw->fadeTo(duty_next, ms)) return FADING;
+    }
 
-    auto *p = task_name;
-    *p++ = 'p';
-    *p++ = 'w';
-    *p++ = 'm';
-    *p++ = ':';
-
-    constexpr size_t capacity = sizeof(task_name) / sizeof(char) - 5;
-    memccpy(p, hardware()->shortName(), 0x00, capacity);
-    xTaskCreate(&runTask, task_name, _task.stack, _task.data, _task.priority, &_task.handle);
+    // fade complete (or the hardware fade failed)
+    if (duty != _fade_to) setDuty(_fade_to);
+    _fading = false;
   }
 
-  return rc;
-}
-
-void Command::runTask(void *task_instance) {
-  Command *cmd = (Command *)task_instance;
-
-  cmd->_loop_func(cmd->_task.data);
-
-  xTaskNotify(cmd->_parent, 0, eIncrement);
-  cmd->kill();
-}
-
-void Command::kill() {
-  // nothing to stop
-  if (_task.handle == nullptr) return;
-
-  TaskHandle_t to_delete = _task.handle;
-  _task.handle = nullptr;
-
-  // inform FreeRTOS to remove this task from the scheduler
-  vTaskDelete(to_delete); // end of task
+  return effect();
 }
 
 } // namespace pwm
@@ -22,13 +22,15 @@
 
 #include <algorithm>
 
+#include <esp_attr.h>
 #include <esp_log.h>
 
 #include "dev_pwm/cmd_fixed.hpp"
 
 namespace pwm {
 
-Fixed::Fixed(Hardware *hardware, const JsonObject &cmd) : Command(hardware, cmd) {
+void Fixed::configure(const JsonObject &cmd) {
+  opts = Opts();
 
   JsonObject params = cmd["params"];
 
@@ -37,26 +39,15 @@ Fixed::Fixed(Hardware *hardware, const JsonObject &cmd) : Command(hardware, cmd)
     auto percent = params["percent"].as<float>();
     percent = (percent <= 100.0f) ? percent : 100.0f;
 
-    opts.duty = hardware->dutyPercent(percent);
+    opts.duty = hardware()->dutyPercent(percent);
   }
-
-  loopData(this);
-  loopFunction(&loop);
-}
-
-Fixed::~Fixed() {
-  kill(); // kill our process, if running, before memory is released
 }
 
-IRAM_ATTR void Fixed::loop(void *task_data) {
-  Fixed *obj = (Fixed *)task_data;
-
-  do {
-    obj->setDuty(obj->opts.duty);
-
-    obj->pause(1000);
+IRAM_ATTR uint32_t Fixed::effect() {
+  // periodically reapply the duty
+  setDuty(opts.duty);
 
-  } while (obj->keepRunning());
+  return 1000;
 }
 
 } // namespace pwm
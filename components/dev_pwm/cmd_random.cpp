@@ -22,7 +22,9 @@
 
 #include <algorithm>
 
+#include <esp_attr.h>
 #include <esp_log.h>
+#include <esp_system.h>
 
 #include "dev_pwm/cmd_random.hpp"
 
@@ -33,7 +35,8 @@ static uint32_t _primes[] = {2,   3,   5,   7,   11,  13,  17,  19,  23,  29,  3
                              127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197,
                              199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277};
 
-Random::Random(Hardware *hardware, const JsonObject &cmd) : Command(hardware, cmd) {
+void Random::configure(const JsonObject &cmd) {
+  opts = Opts();
 
   JsonObject params = cmd["params"];
 
@@ -48,54 +51,53 @@ Random::Random(Hardware *hardware, const JsonObject &cmd) : Command(hardware, cm
     opts.num_primes = (num_primes > (availablePrimes() - 1)) ? opts.num_primes : num_primes;
 
     opts.step = params["step"] | opts.step;
+    if (opts.step == 0) opts.step = 1;
     opts.step_ms = params["step_ms"] | opts.step_ms;
   }
 
-  loopData(this);
-  loopFunction(&loop);
-}
+  // pick a random starting point
+  _duty = randomNum((opts.max - opts.min) + opts.min);
+  _pause_ms = 0;
 
-Random::~Random() {
-  kill(); // kill our process, if running, before memory is released
+  fadeTo(_duty);
 }
 
-IRAM_ATTR void Random::loop(void *task_data) {
-  Random *obj = (Random *)task_data;
+IRAM_ATTR uint32_t Random::effect() {
+  // a run that reached the range limit pauses once its fade ends
+  if (_pause_ms) {
+    const auto pause_ms = _pause_ms;
+    _pause_ms = 0;
 
-  // pick a random starting point
-  const auto duty_max = obj->opts.max;
-  const auto duty_min = obj->opts.min;
-  const auto step_ms = obj->opts.step_ms;
-  auto duty = randomNum((duty_max - duty_min) + duty_min);
+    return pause_ms;
+  }
+
+  // pick a random direction and number of steps, each step lasts step ms
+  const int32_t direction = randomDirection();
+  const uint32_t steps = randomPrime();
+  const uint32_t step_ms = randomPrime() + opts.step_ms;
 
-  obj->fadeTo(duty);
+  if (direction == 0) return steps * step_ms;
 
-  do {
-    // pick a random initial direction and number of steps
-    auto direction = randomDirection();
-    auto steps = randomPrime();
+  // the steps within range (duty remains between min and max, exclusive)
+  const int64_t limit = (direction > 0) ? ((int64_t)opts.max - 1 - _duty) : ((int64_t)_duty - opts.min - 1);
+  const uint32_t in_range = (limit > 0) ? (limit / opts.step) : 0;
 
-    auto in_range = true;
-    auto pause_ms = randomPrime() + step_ms;
+  // out of range, pause (once the fade ends) then start a new run
+  const uint32_t pause_ms = (in_range < steps) ? (randomPrime() * opts.step_ms) : 0;
+  const auto run_steps = std::min(steps, in_range);
 
-    for (uint32_t i = 0; (i < steps) && obj->keepRunning() && in_range; i++) {
-      uint32_t next_duty = duty + (obj->opts.step * direction);
+  if (run_steps == 0) return pause_ms;
 
-      if ((next_duty >= duty_max) || (next_duty <= duty_min)) {
-        obj->pause(randomPrime() * step_ms);
-        in_range = false;
-        break;
-      }
+  _pause_ms = pause_ms;
 
-      duty = next_duty;
-      obj->_hw->updateDuty(next_duty);
+  // the run is a single fade performed by the hardware
+  _duty += direction * (int32_t)(run_steps * opts.step);
+  fadeTo(_duty, run_steps * step_ms);
 
-      obj->pause(pause_ms);
-    }
-  } while (obj->keepRunning());
+  return 0; // the fade starts with the next step
 }
 
-IRAM_ATTR uint32_t Random::availablePrimes() {
+IRAM_ATTR size_t Random::availablePrimes() {
   constexpr size_t num_primes = (sizeof(_primes) / sizeof(uint32_t)) - 1;
 
   return num_primes;
@@ -104,7 +106,7 @@ IRAM_ATTR uint32_t Random::availablePrimes() {
 IRAM_ATTR int32_t Random::randomDirection() {
   static const int32_t direction[] = {0, -1, 1};
 
-  return direction[randomNum(3)];
+  return direction[randomNum(3) - 1]; // randomNum() is one based
 }
 
 IRAM_ATTR uint32_t Random::randomNum(uint32_t modulo) { return (esp_random() % modulo) + 1; }
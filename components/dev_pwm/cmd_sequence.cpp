@@ -0,0 +1,91 @@
+/*
+    dev_pwm/cmds/cmd_sequence.cpp
+    Ruth PWM Sequence Command Class Implementation
+
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+#include "dev_pwm/cmd_sequence.hpp"
+
+namespace pwm {
+
+void Sequence::configure(const JsonObject &cmd) {
+  JsonObject seq = cmd["seq"];
+
+  name(seq["name"] | "seq");
+
+  // a seq without steps runs the steps previously loaded
+  JsonArray steps = seq["steps"];
+
+  if (steps) {
+    _count = 0;
+    _period_ms = 0;
+
+    // every step lasts at least a tick, a repeating seq of zero length steps would otherwise
+    // always be due and the scheduler task would never block
+    constexpr uint32_t min_step_ms = portTICK_PERIOD_MS;
+
+    for (JsonObject step : steps) {
+      if (_count == max_steps) break;
+
+      // the step duty is a level when the pin has a curve, mapped once here
+      const uint32_t ms = step["ms"] | 0;
+      _steps[_count].duty = hardware()->level(step["duty"] | 0);
+      _steps[_count].ms = (ms < min_step_ms) ? min_step_ms : ms;
+      _period_ms += _steps[_count].ms;
+      _count++;
+    }
+  }
+
+  _repeat = seq["repeat"] | false;
+  _sync = seq["sync"] | false;
+  _started = false;
+  _next = 0;
+}
+
+IRAM_ATTR uint32_t Sequence::effect() {
+  if (_count == 0) return DONE;
+
+  if (!_started) {
+    _started = true;
+
+    // wait for the next period boundary
+    if (_sync && _period_ms) {
+      const uint32_t into_period = (esp_timer_get_time() / 1000) % _period_ms;
+
+      if (into_period) return _period_ms - into_period;
+    }
+  }
+
+  if (_next == _count) {
+    if (!_repeat) return DONE;
+
+    _next = 0;
+  }
+
+  const auto &step = _steps[_next++];
+  setDuty(step.duty);
+
+  return step.ms;
+}
+
+} // namespace pwm
@@ -0,0 +1,141 @@
+/*
+    dev_pwm/curve.cpp
+    Ruth PWM Perceptual Curves
+
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include <esp_attr.h>
+
+#include "dev_pwm/curve.hpp"
+
+namespace pwm {
+
+// each table samples a curve at 256 intervals of the 13-bit level, the level is interpolated
+// between samples.  the final sample (level 8192) bounds the interpolation and is placed so
+// the top level (8191) maps to duty_max.
+typedef std::array<uint16_t, 257> Table;
+
+static constexpr uint32_t duty_max = 8191;
+static constexpr uint32_t interval_bits = 5;
+static constexpr uint32_t interval_mask = (1 << interval_bits) - 1;
+static constexpr uint32_t intervals = (duty_max + 1) >> interval_bits;
+
+// std::exp, std::log and std::pow are not constexpr
+static constexpr double cx_exp(double y) {
+  // taylor series of a small fraction of y then squared back
+  const double x = y / 32;
+  double term = 1;
+  double sum = 1;
+
+  for (int k = 1; k < 20; k++) {
+    term *= x / k;
+    sum += term;
+  }
+
+  for (int k = 0; k < 5; k++) sum *= sum;
+
+  return sum;
+}
+
+static constexpr double cx_log(double x) {
+  // reduce to [0.5, 1) then the atanh series
+  int exp2 = 0;
+  while (x < 0.5) {
+    x *= 2;
+    exp2--;
+  }
+
+  while (x >= 1.0) {
+    x /= 2;
+    exp2++;
+  }
+
+  const double z = (x - 1) / (x + 1);
+  double term = z;
+  double sum = 0;
+
+  for (int k = 0; k < 30; k++) {
+    sum += term / ((2 * k) + 1);
+    term *= z * z;
+  }
+
+  return (2 * sum) + (exp2 * 0.6931471805599453);
+}
+
+template <typename F> static constexpr Table makeTable(F f) {
+  Table table = {};
+
+  for (size_t i = 0; i < intervals; i++) {
+    table[i] = (uint16_t)((f((double)i / intervals) * (duty_max + 1)) + 0.5);
+  }
+
+  // the top level is interval_mask / (interval_mask + 1) through the last interval, a curve
+  // steeper than linear falls short of duty_max there.  extend the final sample just enough
+  // (rounded up) that the interpolation reaches duty_max exactly.
+  const uint32_t short_by = duty_max - table[intervals - 1];
+  const uint32_t extend = ((short_by << interval_bits) + interval_mask - 1) / interval_mask;
+  table[intervals] = table[intervals - 1] + extend;
+
+  return table;
+}
+
+static constexpr Table linear_table = makeTable([](double x) { return x; });
+
+// gamma 2.2
+static constexpr Table gamma_table = makeTable([](double x) {
+  // pow(x, 2.2)
+  return (x > 0) ? cx_exp(2.2 * cx_log(x)) : 0;
+});
+
+// CIE 1931 lightness to relative luminance
+static constexpr Table cie_table = makeTable([](double x) {
+  const double l = x * 100;
+  const double y = (l + 16) / 116;
+
+  return (l <= 8) ? (l / 903.3) : (y * y * y);
+});
+
+DRAM_ATTR static const Table *tables[] = {&linear_table, &gamma_table, &cie_table};
+
+Curve::Kind Curve::fromName(const char *name, Kind fallback) {
+  if (name == nullptr) return fallback;
+
+  if (strcmp(name, "linear") == 0) return LINEAR;
+  if (strcmp(name, "gamma") == 0) return GAMMA;
+  if (strcmp(name, "cie") == 0) return CIE;
+
+  return fallback;
+}
+
+IRAM_ATTR uint32_t Curve::map(Kind kind, uint32_t level) {
+  // no branches, the linear curve is a table too
+  const auto &table = *tables[kind];
+  level = std::min(level, duty_max);
+
+  const uint32_t i = level >> interval_bits;
+  const uint32_t frac = level & interval_mask;
+
+  return table[i] + (((table[i + 1] - table[i]) * frac) >> interval_bits);
+}
+
+} // namespace pwm
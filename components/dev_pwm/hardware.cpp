@@ -25,6 +25,7 @@
 #include <esp_attr.h>
 
 #include "dev_pwm/hardware.hpp"
+#include "dev_pwm/scheduler.hpp"
 
 namespace pwm {
 
@@ -42,6 +43,12 @@ static constexpr uint64_t pwm_gpio_pin_sel =
 
 static const char *pin_name[num_channels] = {"led.0", "pin.1", "pin.2", "pin.3", "pin.4"};
 
+IRAM_ATTR static bool fadeEnd(const ledc_cb_param_t *param, void *user_arg) {
+  if (param->event != LEDC_FADE_END_EVT) return false;
+
+  return Scheduler::fadeEndFromISR((uintptr_t)user_arg);
+}
+
 // construct a new Hardware with a known address and compute the id
 Hardware::Hardware(uint8_t pin_num) : _pin_num(pin_num) {
   _last_rc = allOff();
@@ -112,6 +119,14 @@ void Hardware::ensureChannel(uint8_t num) {
 
   _last_rc = ledc_channel_config(config);
 
+  // the pin number is passed to the fade end callback
+  ledc_cbs_t callbacks = {};
+  callbacks.fade_cb = fadeEnd;
+
+  if (_last_rc == ESP_OK) {
+    _last_rc = ledc_cb_register(config->speed_mode, config->channel, &callbacks, (void *)(uintptr_t)num);
+  }
+
   if (_last_rc == ESP_OK) {
     _channel_configured[num] = true;
   }
@@ -142,6 +157,22 @@ void Hardware::ensureTimer() {
   _last_rc = ledc_fade_func_install(ESP_INTR_FLAG_LEVEL1);
 }
 
+IRAM_ATTR bool Hardware::fadeTo(uint32_t duty, uint32_t ms) {
+  const ledc_mode_t mode = channel_config[_pin_num].speed_mode;
+  const ledc_channel_t channel = numToChannelMap[_pin_num];
+
+  if (duty > _duty_max) duty = _duty_max;
+
+  // the driver holds a new fade until the fade in progress ends, stop it (where it is) instead
+  ledc_fade_stop(mode, channel);
+  _last_rc = ledc_set_fade_with_time(mode, channel, duty, ms);
+  if (_last_rc == ESP_OK) _last_rc = ledc_fade_start(mode, channel, LEDC_FADE_NO_WAIT);
+
+  if (_last_rc == ESP_OK) return true;
+
+  return false;
+}
+
 const char *Hardware::shortName() const { return pin_name[_pin_num]; }
 
 bool Hardware::stop(uint32_t final_duty) {
@@ -160,6 +191,8 @@ IRAM_ATTR bool Hardware::updateDuty(uint32_t new_duty) {
 
   if (new_duty > _duty_max) new_duty = _duty_max;
 
+  // as fadeTo(), the duty written applies now rather than at the end of a fade in progress
+  ledc_fade_stop(mode, channel);
   _last_rc = ledc_set_duty_and_update(mode, channel, new_duty, 0);
 
   if (_last_rc == ESP_OK) return true;
@@ -22,16 +22,17 @@
 #define _ruth_pwm_cmd_hpp
 
 #include "ArduinoJson.h"
-#include "misc/ruth_task.hpp"
 
 #include "dev_pwm/hardware.hpp"
 
 namespace pwm {
 
+// an effect state machine advanced by the Scheduler.  each PulseWidth owns one instance of
+// every command, starting a command reconfigures the instance (nothing is allocated).
 class Command {
 public:
-  Command(Hardware *hardware, const JsonObject &obj);
-  virtual ~Command();
+  Command(Hardware *hardware) : _hw(hardware) {}
+  virtual ~Command() = default;
 
   Command() = delete;                 // no default cmds
   Command(const Command &s) = delete; // no copies
@@ -39,47 +40,34 @@ public:
   // member access
   const char *name() { return _name; }
 
-  // public API for task info and control
-  void kill();
-  void notify() const { xTaskNotify(_task.handle, 0, eIncrement); }
-  bool run();
-  bool running() const { return (_task.handle == nullptr) ? false : true; }
+  void start(const JsonObject &cmd); // copies the name then configures from the cmd
+  uint32_t step();                    // advance the effect, returns ms to the next step, FADING or DONE
+
+public:
+  static constexpr uint32_t FADING = UINT32_MAX;   // next step when the hardware fade ends
+  static constexpr uint32_t DONE = UINT32_MAX - 1; // effect complete, never stepped again
 
 protected:
-  void fadeTo(uint32_t duty);
+  virtual void configure(const JsonObject &cmd) = 0;
+  virtual uint32_t effect() = 0; // returns ms until the next step
+
+  void fadeTo(uint32_t duty, uint32_t ms = 0); // zero ms fades at the default rate
   uint32_t getDuty() { return _hw->duty(); };
   inline Hardware *hardware() { return _hw; }
-  inline bool keepRunning() const { return _run; }
-  inline void loopData(Command *obj) { _task.data = obj; }
-  void loopFunction(ruth::TaskFunc_t *func) { _loop_func = func; }
-  uint32_t notifyValue() const { return _notify_val; }
-  void pause(uint32_t);
+  void name(const char *name); // replaces the name copied from the cmd by start()
   inline bool setDuty(uint32_t duty) { return _hw->updateDuty(duty); }
-  xTaskHandle taskHandle() { return _task.handle; }
-  const char *taskName(xTaskHandle handle = nullptr) { return pcTaskGetTaskName(handle); }
 
 protected:
   Hardware *_hw;
 
 private:
-  char _name[32] = {};           // name of this cmd
-  xTaskHandle _parent = nullptr; // task handle of parent for notification purposes
-
-  // Task Specific member variables
-  uint32_t _notify_val = 0;
+  char _name[32] = {}; // name of this cmd
 
-  ruth::TaskFunc_t *_loop_func = nullptr; // pointer to the loop func for the task
-  Command *_loop_data = nullptr;          // pointer to pass to the loop func
-
-  bool _run = true;
-
-  ruth::Task _task = {};
-
-private:
-  static void runTask(void *task_instance);
+  bool _fading = false;
+  uint32_t _fade_to = 0;
+  uint32_t _fade_ms = 0; // remaining
 };
 
-typedef std::unique_ptr<Command> CmdWrapped;
 } // namespace pwm
 
 #endif
@@ -28,11 +28,11 @@ namespace pwm {
 
 class Fixed : public Command {
 public:
-  Fixed(Hardware *hardware, const JsonObject &cmd);
-  ~Fixed();
+  Fixed(Hardware *hardware) : Command(hardware) {}
 
 protected:
-  static void loop(void *task_data);
+  void configure(const JsonObject &cmd) override;
+  uint32_t effect() override;
 
 private:
   struct Opts {
@@ -28,11 +28,11 @@ namespace pwm {
 
 class Random : public Command {
 public:
-  Random(Hardware *hardware, const JsonObject &cmd);
-  ~Random();
+  Random(Hardware *hardware) : Command(hardware) {}
 
 protected:
-  static void loop(void *task_data);
+  void configure(const JsonObject &cmd) override;
+  uint32_t effect() override;
 
 private:
   struct Opts {
@@ -52,6 +52,10 @@ private:
 
 private:
   Opts opts;
+
+  // effect state, each run of steps in one direction is a single fade
+  uint32_t _duty = 0;
+  uint32_t _pause_ms = 0; // after a run that reached the range limit
 };
 
 } // namespace pwm
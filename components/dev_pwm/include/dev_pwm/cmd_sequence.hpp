@@ -0,0 +1,64 @@
+/*
+    include/pwm/cmds/sequence.hpp - Ruth PWM Sequence Command Class
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef _ruth_pwm_cmd_sequence_hpp
+#define _ruth_pwm_cmd_sequence_hpp
+
+#include "ArduinoJson.h"
+#include "dev_pwm/cmd.hpp"
+
+namespace pwm {
+
+// a list of {duty, ms} steps parsed once from the seq command then stepped by the Scheduler.
+// steps are scheduled from the previous step's due time (not when it ran) so sequences don't
+// drift, sync starts a sequence at the next multiple of its period (since boot) so sequences
+// with the same period on several pins run phase-locked.
+class Sequence : public Command {
+public:
+  Sequence(Hardware *hardware) : Command(hardware) {}
+
+public:
+  static constexpr size_t max_steps = 32;
+
+protected:
+  void configure(const JsonObject &cmd) override;
+  uint32_t effect() override;
+
+private:
+  struct Step {
+    uint16_t duty;
+    uint32_t ms;
+  };
+
+private:
+  Step _steps[max_steps] = {};
+  size_t _count = 0;
+  uint32_t _period_ms = 0; // sum of the step durations
+
+  bool _repeat = false;
+  bool _sync = false;
+
+  bool _started = false;
+  size_t _next = 0;
+};
+
+} // namespace pwm
+
+#endif
@@ -0,0 +1,41 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef _ruth_pwm_curve_hpp
+#define _ruth_pwm_curve_hpp
+
+#include <cstdint>
+
+namespace pwm {
+
+// perceptual dimming curves for 13-bit duty (the LEDC resolution).  a level (linear to the
+// eye) maps to the duty producing that brightness.
+class Curve {
+public:
+  enum Kind : uint8_t { LINEAR = 0, GAMMA, CIE };
+
+public:
+  static Kind fromName(const char *name, Kind fallback = LINEAR); // "linear", "gamma" or "cie"
+  static uint32_t map(Kind kind, uint32_t level);
+};
+
+} // namespace pwm
+
+#endif
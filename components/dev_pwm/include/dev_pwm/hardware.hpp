@@ -23,6 +23,7 @@
 
 #include <memory>
 
+#include "dev_pwm/curve.hpp"
 #include "esp_err.h"
 
 namespace pwm {
@@ -34,14 +35,21 @@ public:
 
   static esp_err_t allOff();
 
+  Curve::Kind curve() const { return _curve; }
+  void curve(Curve::Kind kind) { _curve = kind; }
+
   uint32_t duty(bool *changed = nullptr);
   uint32_t dutyMax() const { return _duty_max; };
   uint32_t dutyMin() const { return _duty_min; };
-  uint32_t dutyPercent(const float percent) const { return uint32_t((float)_duty_max * (percent / 100)); }
+  uint32_t dutyPercent(const float percent) const {
+    return level(uint32_t((float)_duty_max * (percent / 100)));
+  }
+  bool fadeTo(uint32_t duty, uint32_t ms); // non-blocking, the fade end notifies the pwm::Scheduler
   esp_err_t lastRC() const { return _last_rc; }
   bool off() { return updateDuty(dutyMin()); }
   bool on() { return updateDuty(dutyMax()); }
 
+  inline uint32_t level(uint32_t level) const { return Curve::map(_curve, level); } // duty for the level
   inline uint8_t pinNum() const { return _pin_num; }
 
   Hardware *self() { return this; }
@@ -49,6 +57,7 @@ public:
   bool stop(uint32_t final_duty);
 
   bool updateDuty(uint32_t duty);
+  bool updateLevel(uint32_t level) { return updateDuty(Curve::map(_curve, level)); }
 
 private:
   void ensureChannel(uint8_t num);
@@ -66,6 +75,7 @@ private:
   static constexpr uint32_t _duty_max = 0x1fff;
   static constexpr uint32_t _duty_min = 0;
   uint32_t _duty;
+  Curve::Kind _curve = Curve::LINEAR; // applied to levels and percents, not duty
 
   esp_err_t _last_rc = ESP_OK;
 };
@@ -28,6 +28,9 @@
 
 #include "ArduinoJson.h"
 #include "dev_pwm/cmd.hpp"
+#include "dev_pwm/cmd_fixed.hpp"
+#include "dev_pwm/cmd_random.hpp"
+#include "dev_pwm/cmd_sequence.hpp"
 #include "dev_pwm/hardware.hpp"
 
 namespace device {
@@ -38,24 +41,29 @@ public:
 
   inline uint8_t devAddr() const { return pinNum(); }
   bool execute(const JsonObject &root);
-  // bool execute(const char *cmd);
-  bool execute(pwm::CmdWrapped cmd);
   const char *id() const { return shortName(); }
 
   void makeStatus();
+  void off(); // stops the running cmd, if any
 
   const char *status() const { return _status; }
 
 private:
-  enum CmdType : uint32_t { NO_MATCH = 0, ON, OFF, FIXED, RANDOM };
+  enum CmdType : uint32_t { NO_MATCH = 0, ON, OFF, FIXED, RANDOM, SEQUENCE };
 
 private:
   CmdType cmdType(const JsonObject &root) const;
   inline void cmdBasic(const CmdType type) { updateDuty(type == CmdType::ON ? dutyMax() : dutyMin()); }
+  void cmdStart(pwm::Command *cmd, const JsonObject &root);
 
 private:
   char _status[32];
-  pwm::CmdWrapped _cmd;
+
+  // commands are reconfigured in place by each start, _cmd is the running command (if any)
+  pwm::Fixed _fixed;
+  pwm::Random _random;
+  pwm::Sequence _sequence;
+  pwm::Command *_cmd = nullptr;
 };
 } // namespace device
 
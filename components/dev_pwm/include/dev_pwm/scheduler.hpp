@@ -0,0 +1,57 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef _ruth_pwm_scheduler_hpp
+#define _ruth_pwm_scheduler_hpp
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "dev_pwm/cmd.hpp"
+
+namespace pwm {
+
+// a single task advances the running command of every pin, each at its next due time
+class Scheduler {
+public:
+  // replaces the command of the pin (nullptr stops it), once returned the previous command is
+  // no longer stepped and may be reconfigured
+  static void attach(uint8_t pin_num, Command *cmd);
+  static bool fadeEndFromISR(uint8_t pin_num); // true when a higher priority task was woken
+
+public:
+  static constexpr size_t max_pins = 5;
+
+private:
+  static void ensure();
+  static void run(void *data); // task loop
+
+private:
+  static Command *_cmds[max_pins];
+  static int64_t _due_at[max_pins]; // µs since boot
+  static volatile bool _fade_end[max_pins];
+  static SemaphoreHandle_t _mutex;  // held while stepping and attaching
+  static TaskHandle_t _task;
+};
+
+} // namespace pwm
+
+#endif
@@ -25,14 +25,14 @@
 #include <esp_attr.h>
 #include <esp_log.h>
 
-#include "dev_pwm/cmd_fixed.hpp"
-#include "dev_pwm/cmd_random.hpp"
 #include "dev_pwm/pwm.hpp"
+#include "dev_pwm/scheduler.hpp"
 
 namespace device {
 
 // construct a new PulseWidth with a known address
-PulseWidth::PulseWidth(uint8_t pin_num) : pwm::Hardware(pin_num) {
+PulseWidth::PulseWidth(uint8_t pin_num)
+    : pwm::Hardware(pin_num), _fixed(this), _random(this), _sequence(this) {
   updateDuty(0);
 
   // default status to off
@@ -45,6 +45,8 @@ PulseWidth::PulseWidth(uint8_t pin_num) : pwm::Hardware(pin_num) {
 }
 
 IRAM_ATTR PulseWidth::CmdType PulseWidth::cmdType(const JsonObject &root) const {
+  if (root["seq"]) return CmdType::SEQUENCE;
+
   const char *cmd = root["cmd"];
 
   if (cmd == nullptr) return CmdType::NO_MATCH;
@@ -64,27 +66,55 @@ IRAM_ATTR PulseWidth::CmdType PulseWidth::cmdType(const JsonObject &root) const
   return CmdType::NO_MATCH;
 }
 
+IRAM_ATTR void PulseWidth::cmdStart(pwm::Command *cmd, const JsonObject &root) {
+  // detach the running command first, the command to start may be the running command
+  pwm::Scheduler::attach(pinNum(), nullptr);
+
+  cmd->start(root);
+  _cmd = cmd;
+
+  pwm::Scheduler::attach(pinNum(), cmd);
+}
+
 IRAM_ATTR bool PulseWidth::execute(const JsonObject &root) {
   auto rc = true;
 
+  // any cmd may select the curve used by this and later cmds (e.g. fixed percent)
+  curve(pwm::Curve::fromName(root["curve"], curve()));
+
   auto cmd_type = cmdType(root);
 
   switch (cmd_type) {
   case CmdType::ON:
   case CmdType::OFF:
-    if (_cmd) _cmd.reset(nullptr);
+    if (_cmd) {
+      pwm::Scheduler::attach(pinNum(), nullptr);
+      _cmd = nullptr;
+    }
 
     cmdBasic(cmd_type);
     break;
 
   case CmdType::FIXED:
-    _cmd.reset(new pwm::Fixed(self(), root));
-    rc = _cmd->run();
+    cmdStart(&_fixed, root);
     break;
 
   case CmdType::RANDOM:
-    _cmd.reset(new pwm::Random(self(), root));
-    rc = _cmd->run();
+    cmdStart(&_random, root);
+    break;
+
+  case CmdType::SEQUENCE:
+    if (root["seq"]["run"] | true) {
+      cmdStart(&_sequence, root);
+    } else {
+      // only load the steps, a running sequence is stopped first
+      if (_cmd == &_sequence) {
+        pwm::Scheduler::attach(pinNum(), nullptr);
+        _cmd = nullptr;
+      }
+
+      _sequence.start(root);
+    }
     break;
 
   default:
@@ -133,4 +163,13 @@ IRAM_ATTR void PulseWidth::makeStatus() {
 
   itoa(duty_now, p, 10);
 }
+
+void PulseWidth::off() {
+  if (_cmd) {
+    pwm::Scheduler::attach(pinNum(), nullptr);
+    _cmd = nullptr;
+  }
+
+  cmdBasic(CmdType::OFF);
+}
 } // namespace device
@@ -0,0 +1,118 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#include "dev_pwm/scheduler.hpp"
+
+namespace pwm {
+
+static constexpr UBaseType_t task_stack = 2560;
+static constexpr UBaseType_t task_priority = 15;
+
+DRAM_ATTR Command *Scheduler::_cmds[max_pins] = {};
+DRAM_ATTR int64_t Scheduler::_due_at[max_pins] = {};
+DRAM_ATTR volatile bool Scheduler::_fade_end[max_pins] = {};
+DRAM_ATTR SemaphoreHandle_t Scheduler::_mutex = nullptr;
+DRAM_ATTR TaskHandle_t Scheduler::_task = nullptr;
+static StaticSemaphore_t mutex_buff;
+
+IRAM_ATTR void Scheduler::attach(uint8_t pin_num, Command *cmd) {
+  if (pin_num >= max_pins) return;
+
+  ensure();
+
+  xSemaphoreTake(_mutex, portMAX_DELAY);
+  _cmds[pin_num] = cmd;
+  _due_at[pin_num] = 0; // step immediately
+  _fade_end[pin_num] = false;
+  xSemaphoreGive(_mutex);
+
+  // wake the task to compute the next due time
+  if (cmd) xTaskNotifyGive(_task);
+}
+
+IRAM_ATTR bool Scheduler::fadeEndFromISR(uint8_t pin_num) {
+  if ((pin_num >= max_pins) || (_task == nullptr)) return false;
+
+  _fade_end[pin_num] = true;
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(_task, &woken);
+
+  return woken == pdTRUE;
+}
+
+void Scheduler::ensure() {
+  // commands are attached by a single task (pwm command), no need to guard creation
+  if (_task) return;
+
+  _mutex = xSemaphoreCreateMutexStatic(&mutex_buff);
+  xTaskCreate(&run, "pwm:sched", task_stack, nullptr, task_priority, &_task);
+}
+
+IRAM_ATTR void Scheduler::run(void *data) {
+  for (;;) {
+    int64_t next_at = INT64_MAX;
+
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    const auto now = esp_timer_get_time();
+
+    for (size_t i = 0; i < max_pins; i++) {
+      auto *cmd = _cmds[i];
+
+      // a command waiting for a hardware fade is due when it ends
+      if (_fade_end[i]) {
+        _fade_end[i] = false;
+        _due_at[i] = now;
+      }
+
+      if (cmd == nullptr) continue;
+
+      if (_due_at[i] <= now) {
+        const auto ms = cmd->step();
+
+        // the next step is due relative to when this step was due so the steps of a command
+        // don't accumulate the scheduling latency.  a command that fell a step behind restarts
+        // from now.
+        auto next = _due_at[i] + (ms * 1000LL);
+        if (next <= now) next = now + (ms * 1000LL);
+
+        _due_at[i] = (ms >= Command::DONE) ? INT64_MAX : next;
+      }
+
+      if (_due_at[i] < next_at) next_at = _due_at[i];
+    }
+    xSemaphoreGive(_mutex);
+
+    // sleep until the earliest due step (at least one tick), a fade end or an attach
+    TickType_t wait = portMAX_DELAY;
+    if (next_at != INT64_MAX) {
+      const auto wait_ms = (next_at - esp_timer_get_time() + 999) / 1000;
+      wait = (wait_ms > 0) ? pdMS_TO_TICKS(wait_ms) : 0;
+      if ((wait_ms > 0) && (wait == 0)) wait = 1;
+    }
+
+    if (wait) ulTaskNotifyTake(pdTRUE, wait);
+  }
+}
+
+} // namespace pwm
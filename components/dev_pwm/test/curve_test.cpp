@@ -0,0 +1,130 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+// walks every level of every curve (endpoints, monotonicity, distance from the exact curve)
+// then times the table lookup against computing the curve directly.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "dev_pwm/curve.hpp"
+#include "host_test.h"
+
+using namespace pwm;
+
+static constexpr uint32_t duty_max = 8191;
+static constexpr Curve::Kind kinds[] = {Curve::LINEAR, Curve::GAMMA, Curve::CIE};
+static const char *names[] = {"linear", "gamma", "cie"};
+
+static double exact(Curve::Kind kind, uint32_t level) {
+  const double x = (double)level / duty_max;
+
+  switch (kind) {
+  case Curve::GAMMA:
+    return std::pow(x, 2.2) * duty_max;
+
+  case Curve::CIE: {
+    const double l = x * 100;
+    return ((l <= 8) ? (l / 903.3) : std::pow((l + 16) / 116, 3)) * duty_max;
+  }
+
+  default:
+    return x * duty_max;
+  }
+}
+
+static void endpoints() {
+  for (const auto kind : kinds) {
+    CHECK(Curve::map(kind, 0) == 0, "%s map(0) %u", names[kind], Curve::map(kind, 0));
+    CHECK(Curve::map(kind, duty_max) == duty_max, "%s map(%u) %u", names[kind], duty_max,
+          Curve::map(kind, duty_max));
+
+    // levels beyond the 13-bit range are clamped
+    CHECK(Curve::map(kind, duty_max + 1) == duty_max, "%s above range", names[kind]);
+    CHECK(Curve::map(kind, UINT32_MAX) == duty_max, "%s at UINT32_MAX", names[kind]);
+  }
+}
+
+static void everyLevel() {
+  for (const auto kind : kinds) {
+    uint32_t prev = 0;
+    double worst = 0;
+
+    for (uint32_t level = 0; level <= duty_max; level++) {
+      const auto duty = Curve::map(kind, level);
+
+      CHECK(duty >= prev, "%s not monotonic at %u (%u < %u)", names[kind], level, duty, prev);
+      CHECK(duty <= duty_max, "%s level %u duty %u", names[kind], level, duty);
+      if (kind == Curve::LINEAR) CHECK(duty == level, "linear level %u duty %u", level, duty);
+
+      worst = std::fmax(worst, std::fabs(duty - exact(kind, level)));
+      prev = duty;
+    }
+
+    // interpolation between 256 samples, within 0.1% of full scale
+    CHECK(worst <= 8.0, "%s worst error %.2f", names[kind], worst);
+    printf("%-6s worst error %.2f\n", names[kind], worst);
+  }
+}
+
+static void fromName() {
+  CHECK(Curve::fromName("linear") == Curve::LINEAR, "linear");
+  CHECK(Curve::fromName("gamma") == Curve::GAMMA, "gamma");
+  CHECK(Curve::fromName("cie") == Curve::CIE, "cie");
+  CHECK(Curve::fromName("bogus", Curve::CIE) == Curve::CIE, "fallback");
+  CHECK(Curve::fromName(nullptr, Curve::GAMMA) == Curve::GAMMA, "nullptr fallback");
+}
+
+static void benchmark() {
+  constexpr size_t rounds = 200;
+  constexpr size_t maps = rounds * (duty_max + 1);
+
+  using clock = std::chrono::steady_clock;
+  auto ns = [](clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / maps;
+  };
+
+  volatile uint32_t sink = 0;
+  auto start = clock::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (uint32_t level = 0; level <= duty_max; level++) sink = sink + Curve::map(Curve::GAMMA, level);
+  }
+  const auto table = ns(start);
+
+  start = clock::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (uint32_t level = 0; level <= duty_max; level++) {
+      sink = sink + (uint32_t)(std::pow((double)level / duty_max, 2.2) * duty_max + 0.5);
+    }
+  }
+  const auto direct = ns(start);
+
+  printf("ns/map gamma table[%.1f] pow[%.1f]\n", table, direct);
+}
+
+int main() {
+  endpoints();
+  everyLevel();
+  fromName();
+  benchmark();
+
+  return host_test_result();
+}
@@ -0,0 +1,188 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// simulated LEDC channels and the LEDC driver stand-in, see ledc_sim.hpp
+
+#include <driver/ledc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "host_rtos.h"
+#include "ledc_sim.hpp"
+
+namespace {
+struct State {
+  ledc_sim::Channel pub;
+
+  uint32_t fade_from = 0;
+  uint32_t fade_to = 0;
+  uint64_t fade_at_us = 0;
+  uint64_t fade_us = 0;
+  esp_timer_handle_t fade_timer = nullptr;
+
+  ledc_cb_t fade_cb = nullptr;
+  void *fade_arg = nullptr;
+};
+
+State channels[LEDC_CHANNEL_MAX];
+
+uint32_t dutyNow(const State &s) {
+  if (!s.pub.fading || (s.fade_us == 0)) return s.pub.duty;
+
+  const int64_t elapsed = host_rtos_now_us() - s.fade_at_us;
+  const int64_t delta = (int64_t)s.fade_to - s.fade_from;
+
+  return s.fade_from + ((delta * elapsed) / (int64_t)s.fade_us);
+}
+
+void fadeEnd(void *arg) {
+  auto &s = *(State *)arg;
+  const uint32_t num = &s - channels;
+
+  s.pub.duty = s.fade_to;
+  s.pub.fading = false;
+  s.pub.fade_ends++;
+
+  if (s.fade_cb) {
+    const ledc_cb_param_t param{LEDC_FADE_END_EVT, LEDC_HIGH_SPEED_MODE, num, s.fade_to};
+    s.fade_cb(&param, s.fade_arg);
+  }
+}
+
+// the driver holds requests until the fade in progress ends
+void waitFade(State &s) {
+  const auto at_us = host_rtos_now_us();
+
+  while (s.pub.fading) vTaskDelay(1);
+
+  s.pub.blocked_us += host_rtos_now_us() - at_us;
+}
+
+State *stateOf(ledc_channel_t channel) { return (channel < LEDC_CHANNEL_MAX) ? &channels[channel] : nullptr; }
+} // namespace
+
+namespace ledc_sim {
+
+void (*on_update)(uint8_t num, uint32_t duty) = nullptr;
+
+Channel channel(uint8_t num) {
+  auto pub = channels[num].pub;
+  pub.duty = dutyNow(channels[num]);
+
+  return pub;
+}
+
+} // namespace ledc_sim
+
+extern "C" {
+
+esp_err_t ledc_cb_register(ledc_mode_t mode, ledc_channel_t channel, ledc_cbs_t *cbs, void *user_arg) {
+  auto *s = stateOf(channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+
+  s->fade_cb = cbs->fade_cb;
+  s->fade_arg = user_arg;
+  return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config) {
+  auto *s = stateOf(config->channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+
+  s->pub.duty = config->duty;
+
+  if (s->fade_timer == nullptr) {
+    esp_timer_create_args_t args = {};
+    args.callback = fadeEnd;
+    args.arg = s;
+    args.name = "ledc fade";
+    esp_timer_create(&args, &s->fade_timer);
+  }
+
+  return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags) { return ESP_OK; }
+
+esp_err_t ledc_fade_start(ledc_mode_t mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode) {
+  auto *s = stateOf(channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+
+  s->fade_from = s->pub.duty;
+  s->fade_at_us = host_rtos_now_us();
+  s->pub.fading = true;
+  s->pub.fades++;
+  esp_timer_start_once(s->fade_timer, s->fade_us);
+
+  if (fade_mode == LEDC_FADE_WAIT_DONE) waitFade(*s);
+  return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t mode, ledc_channel_t channel) {
+  auto *s = stateOf(channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+  if (!s->pub.fading) return ESP_OK;
+
+  esp_timer_stop(s->fade_timer);
+  s->pub.duty = dutyNow(*s);
+  s->pub.fading = false;
+  s->pub.fade_stops++;
+  return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel) {
+  auto *s = stateOf(channel);
+  return s ? dutyNow(*s) : 0;
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint) {
+  auto *s = stateOf(channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+
+  waitFade(*s);
+  s->pub.duty = duty;
+  s->pub.updates++;
+
+  if (ledc_sim::on_update) ledc_sim::on_update(channel, duty);
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t mode, ledc_channel_t channel, uint32_t target_duty,
+                                  int max_fade_time_ms) {
+  auto *s = stateOf(channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+
+  waitFade(*s);
+  s->fade_to = target_duty;
+  s->fade_us = max_fade_time_ms * 1000ULL;
+  return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t mode, ledc_channel_t channel, uint32_t idle_level) {
+  auto *s = stateOf(channel);
+  if (s == nullptr) return ESP_ERR_INVALID_ARG;
+
+  waitFade(*s);
+  return ESP_OK;
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config) { return ESP_OK; }
+}
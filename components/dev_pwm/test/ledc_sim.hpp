@@ -0,0 +1,49 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// simulated LEDC channels for the host tests, the driver stand-in (driver/ledc.h) changes the
+// duty of a channel at once or by a fade over virtual time.  a fade end is signalled from the
+// esp_timer task through the callback registered for the channel.  as the driver does, a duty
+// write or fade requested while a fade is in progress waits for it to end unless the fade is
+// stopped first (ledc_fade_stop, the duty remains where the fade was and no fade end follows).
+
+#pragma once
+
+#include <cstdint>
+
+namespace ledc_sim {
+
+struct Channel {
+  uint32_t duty = 0;        // now, part way through a fade in progress
+  uint32_t updates = 0;     // immediate duty writes
+  uint32_t fades = 0;       // fades started
+  uint32_t fade_ends = 0;   // fade end callbacks
+  uint32_t fade_stops = 0;  // fades stopped while in progress
+  uint64_t blocked_us = 0;  // requests waiting for a fade in progress to end
+  bool fading = false;
+};
+
+// the channel as of now (a fade in progress is interpolated)
+Channel channel(uint8_t num);
+
+// called with each immediate duty write (when set), e.g. to time the steps of a command
+extern void (*on_update)(uint8_t num, uint32_t duty);
+
+} // namespace ledc_sim
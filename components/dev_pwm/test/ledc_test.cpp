@@ -0,0 +1,164 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// the LEDC stand-in and Hardware: a duty write (on / off or a replacing command) or a new fade
+// requested part way through a hardware fade applies at once.  the fade in progress is stopped
+// where it is, no fade end follows and nothing waits for it.
+
+#include <cstdint>
+#include <cstdio>
+
+#include "ArduinoJson.h"
+#include "dev_pwm/pwm.hpp"
+#include "dev_pwm/scheduler.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "ledc_sim.hpp"
+
+static constexpr uint64_t TICK_US = 1000000 / configTICK_RATE_HZ;
+
+// the first step fades to full over fade ms (three hardware fades), then done
+class Fader : public pwm::Command {
+public:
+  Fader(pwm::Hardware *hardware) : Command(hardware) {}
+
+  uint32_t fade_ms = 3000;
+  uint32_t steps = 0;
+
+protected:
+  void configure(const JsonObject &cmd) override { steps = 0; }
+
+  uint32_t effect() override {
+    if (++steps > 1) return DONE;
+
+    fadeTo(hardware()->dutyMax(), fade_ms);
+    return 0;
+  }
+};
+
+static void startFader(uint8_t pin, Fader &fader) {
+  StaticJsonDocument<64> doc;
+  fader.start(doc.to<JsonObject>());
+  pwm::Scheduler::attach(pin, &fader);
+}
+
+// off part way through the fade of a running command
+static void offDuringFade(device::PulseWidth *pin) {
+  static Fader fader(pin);
+  const uint8_t num = pin->pinNum();
+
+  startFader(num, fader);
+  vTaskDelay(pdMS_TO_TICKS(500));
+
+  const auto before = ledc_sim::channel(num);
+  CHECK(before.fading && (before.duty > 0), "not fading before off, duty %u", before.duty);
+
+  StaticJsonDocument<64> off;
+  off["cmd"] = "off";
+
+  const auto at_us = host_rtos_now_us();
+  pin->execute(off.as<JsonObject>());
+  const auto off_us = host_rtos_now_us() - at_us;
+
+  auto after = ledc_sim::channel(num);
+  CHECK(off_us == 0, "off took %.1fms", off_us / 1e3);
+  CHECK(after.duty == 0, "duty after off %u", after.duty);
+  CHECK(after.blocked_us == before.blocked_us, "off blocked %.1fms",
+        (after.blocked_us - before.blocked_us) / 1e3);
+  CHECK((after.fade_stops - before.fade_stops) == 1, "fades stopped %u",
+        after.fade_stops - before.fade_stops);
+
+  // the stopped fade neither ends later nor steps the command again
+  vTaskDelay(pdMS_TO_TICKS(3000));
+  after = ledc_sim::channel(num);
+  CHECK(after.duty == 0, "duty %u after the fade would have ended", after.duty);
+  CHECK(after.fade_ends == before.fade_ends, "fade ends %u", after.fade_ends - before.fade_ends);
+  CHECK(fader.steps == 1, "fader stepped %u times", fader.steps);
+
+  printf("ledc: off at %u of %u duty mid fade applied in %.1fms\n", before.duty, pin->dutyMax(),
+         off_us / 1e3);
+}
+
+// a fixed command replacing a fading command sets its duty at the first step
+static void fixedDuringFade(device::PulseWidth *pin) {
+  static Fader fader(pin);
+  const uint8_t num = pin->pinNum();
+
+  startFader(num, fader);
+  vTaskDelay(pdMS_TO_TICKS(500));
+
+  StaticJsonDocument<256> fixed;
+  fixed["cmd"] = "fixed";
+  fixed["params"]["type"] = "fixed";
+  fixed["params"]["percent"] = 10;
+
+  const auto before = ledc_sim::channel(num);
+  pin->execute(fixed.as<JsonObject>());
+  vTaskDelay(2);
+
+  const auto set = ledc_sim::channel(num);
+  CHECK(!set.fading && (set.duty < before.duty), "fixed duty %u (was %u)", set.duty, before.duty);
+  CHECK(set.blocked_us == before.blocked_us, "fixed blocked %.1fms",
+        (set.blocked_us - before.blocked_us) / 1e3);
+
+  vTaskDelay(pdMS_TO_TICKS(3000));
+  const auto later = ledc_sim::channel(num);
+  CHECK(later.duty == set.duty, "duty %u then %u", set.duty, later.duty);
+
+  pin->off();
+}
+
+// a fade replacing a fade starts from the duty reached and ends on its own time
+static void fadeDuringFade(pwm::Hardware *hw) {
+  const uint8_t num = hw->pinNum();
+  const auto before = ledc_sim::channel(num);
+
+  hw->fadeTo(hw->dutyMax(), 1000);
+  vTaskDelay(pdMS_TO_TICKS(300));
+
+  const auto reached = ledc_sim::channel(num).duty;
+  const auto at_us = host_rtos_now_us();
+  CHECK(hw->fadeTo(0, 200), "second fade failed");
+  CHECK(host_rtos_now_us() == at_us, "second fade waited %.1fms", (host_rtos_now_us() - at_us) / 1e3);
+
+  const auto fading = ledc_sim::channel(num);
+  CHECK(fading.fading && (fading.duty == reached), "second fade from %u (reached %u)", fading.duty, reached);
+
+  vTaskDelay(pdMS_TO_TICKS(200) + 1);
+  const auto after = ledc_sim::channel(num);
+  CHECK(!after.fading && (after.duty == 0), "duty after second fade %u", after.duty);
+  CHECK((after.fade_ends - before.fade_ends) == 1, "fade ends %u", after.fade_ends - before.fade_ends);
+  CHECK(after.blocked_us == before.blocked_us, "fades blocked %.1fms",
+        (after.blocked_us - before.blocked_us) / 1e3);
+}
+
+static int testMain() {
+  static device::PulseWidth *pins[pwm::Scheduler::max_pins];
+
+  for (uint8_t pin = 0; pin < pwm::Scheduler::max_pins; pin++) pins[pin] = new device::PulseWidth(pin);
+
+  offDuringFade(pins[1]);
+  fixedDuringFade(pins[2]);
+  fadeDuringFade(pins[3]);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
@@ -0,0 +1,218 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// pwm::Scheduler on the virtual clock: commands on several pins stepped at their intervals
+// without drift, a replaced command no longer stepped, a command done and a fade split into
+// hardware fades (the effect continues once the last ends).  then starting and replacing the
+// commands of PulseWidth allocates nothing.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "ArduinoJson.h"
+#include "dev_pwm/pwm.hpp"
+#include "dev_pwm/scheduler.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "ledc_sim.hpp"
+
+static std::atomic<uint32_t> allocations{0};
+
+void *operator new(size_t size) {
+  allocations++;
+
+  if (void *p = malloc(size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static constexpr uint64_t TICK_US = 1000000 / configTICK_RATE_HZ;
+
+// records the virtual time of each step, steps every interval (done after max steps).  the
+// first step may fade to full over fade ms.
+class Ticker : public pwm::Command {
+public:
+  Ticker(pwm::Hardware *hardware, uint32_t interval_ms) : Command(hardware), interval_ms(interval_ms) {
+    at.reserve(1024);
+  }
+
+  const uint32_t interval_ms;
+  uint32_t steps_max = UINT32_MAX;
+  uint32_t fade_ms = 0;
+  std::vector<uint64_t> at;
+
+protected:
+  void configure(const JsonObject &cmd) override { at.clear(); }
+
+  uint32_t effect() override {
+    at.push_back(host_rtos_now_us());
+
+    if ((at.size() == 1) && fade_ms) {
+      fadeTo(hardware()->dutyMax(), fade_ms);
+      return 0;
+    }
+
+    return (at.size() >= steps_max) ? DONE : interval_ms;
+  }
+};
+
+static void startTicker(uint8_t pin, Ticker &ticker) {
+  StaticJsonDocument<64> doc;
+  ticker.start(doc.to<JsonObject>());
+  pwm::Scheduler::attach(pin, &ticker);
+}
+
+// the latest step relative to its due time (from the first step), the steps do not drift
+static uint64_t lateness(const Ticker &ticker) {
+  uint64_t late_max = 0;
+
+  for (size_t i = 0; i < ticker.at.size(); i++) {
+    const uint64_t due = ticker.at[0] + (i * ticker.interval_ms * 1000ULL); // an early step wraps
+    late_max = std::max(late_max, ticker.at[i] - due);
+  }
+
+  return late_max;
+}
+
+static void cadence(pwm::Hardware **hw) {
+  static Ticker tickers[] = {{hw[1], 10}, {hw[2], 7}, {hw[3], 13}, {hw[4], 100}};
+  constexpr uint32_t run_ms = 2000;
+
+  for (uint8_t pin = 1; pin <= 4; pin++) startTicker(pin, tickers[pin - 1]);
+  vTaskDelay(pdMS_TO_TICKS(run_ms));
+  for (uint8_t pin = 1; pin <= 4; pin++) pwm::Scheduler::attach(pin, nullptr);
+
+  uint64_t late_max = 0;
+  for (const auto &ticker : tickers) {
+    const size_t want = run_ms / ticker.interval_ms;
+    const auto steps = ticker.at.size();
+    const auto late = lateness(ticker);
+
+    CHECK((steps >= want) && (steps <= (want + 1)), "%ums steps %zu want %zu", ticker.interval_ms, steps,
+          want);
+    CHECK(late <= TICK_US, "%ums late by %.1fms", ticker.interval_ms, late / 1e3);
+    late_max = std::max(late_max, late);
+  }
+
+  printf("scheduler: 4 pins at 10, 7, 13 and 100ms for %ums, steps late at most %.1fms\n", run_ms,
+         late_max / 1e3);
+}
+
+static void replaceAndDone(pwm::Hardware **hw) {
+  static Ticker replaced(hw[1], 10);
+  static Ticker replacing(hw[1], 10);
+  static Ticker done(hw[2], 10);
+
+  startTicker(1, replaced);
+  done.steps_max = 5;
+  startTicker(2, done);
+  vTaskDelay(pdMS_TO_TICKS(100));
+
+  const auto steps = replaced.at.size();
+  const auto replaced_at = host_rtos_now_us();
+  startTicker(1, replacing);
+  vTaskDelay(pdMS_TO_TICKS(100));
+
+  CHECK(replaced.at.size() == steps, "replaced stepped %zu times after", replaced.at.size() - steps);
+  CHECK(!replacing.at.empty() && ((replacing.at[0] - replaced_at) <= TICK_US), "replacing first step");
+  CHECK(done.at.size() == 5, "done after %zu steps", done.at.size());
+
+  pwm::Scheduler::attach(1, nullptr);
+  pwm::Scheduler::attach(2, nullptr);
+}
+
+static void fade(pwm::Hardware **hw) {
+  static Ticker fading(hw[3], 10);
+  fading.fade_ms = 2500;
+  fading.steps_max = 2;
+
+  const auto before = ledc_sim::channel(3);
+  startTicker(3, fading);
+  vTaskDelay(pdMS_TO_TICKS(3000));
+
+  const auto after = ledc_sim::channel(3);
+  CHECK(fading.at.size() == 2, "fading steps %zu", fading.at.size());
+
+  // three hardware fades (1000, 1000 and 500ms), the effect continues when the last ends
+  CHECK((after.fades - before.fades) == 3, "hardware fades %u", after.fades - before.fades);
+  CHECK((after.fade_ends - before.fade_ends) == 3, "fade ends %u", after.fade_ends - before.fade_ends);
+  CHECK(after.duty == hw[3]->dutyMax(), "duty after fade %u", after.duty);
+
+  if (fading.at.size() == 2) {
+    const auto fade_us = fading.at[1] - fading.at[0];
+    CHECK((fade_us >= 2500000) && (fade_us <= (2500000 + TICK_US)), "fade took %.1fms", fade_us / 1e3);
+  }
+
+  pwm::Scheduler::attach(3, nullptr);
+}
+
+static void noAllocation(device::PulseWidth **pins) {
+  StaticJsonDocument<256> fixed;
+  fixed["cmd"] = "fixed";
+  fixed["params"]["type"] = "fixed";
+  fixed["params"]["percent"] = 50;
+
+  StaticJsonDocument<256> random;
+  random["cmd"] = "random";
+  random["params"]["type"] = "random";
+
+  // the scheduler task exists once the first command was attached
+  pins[1]->execute(fixed.as<JsonObject>());
+
+  const uint32_t before = allocations;
+  for (int i = 0; i < 100; i++) {
+    for (uint8_t pin = 1; pin <= 4; pin++) {
+      pins[pin]->execute(((i + pin) % 2) ? fixed.as<JsonObject>() : random.as<JsonObject>());
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+
+  const uint32_t made = allocations - before;
+  CHECK(made == 0, "%u allocations starting 400 commands", made);
+  printf("scheduler: 400 fixed and random commands started and replaced, %u allocations\n", made);
+
+  for (uint8_t pin = 1; pin <= 4; pin++) pins[pin]->off();
+}
+
+static int testMain() {
+  static device::PulseWidth *pins[pwm::Scheduler::max_pins];
+  static pwm::Hardware *hw[pwm::Scheduler::max_pins];
+
+  for (uint8_t pin = 0; pin < pwm::Scheduler::max_pins; pin++) {
+    hw[pin] = pins[pin] = new device::PulseWidth(pin);
+  }
+
+  cadence(hw);
+  replaceAndDone(hw);
+  fade(hw);
+  noAllocation(pins);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
@@ -0,0 +1,144 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// Sequence step timing on the virtual clock: the duty of each step is written when due (from
+// the first step, no drift across repeats) and a step shorter than a tick lasts a tick, so a
+// repeating seq of zero length steps neither starves the scheduler task nor delays other pins.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "ArduinoJson.h"
+#include "dev_pwm/pwm.hpp"
+#include "dev_pwm/scheduler.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "ledc_sim.hpp"
+
+static constexpr uint64_t TICK_US = 1000000 / configTICK_RATE_HZ;
+
+struct Write {
+  uint8_t num;
+  uint64_t at_us;
+  uint32_t duty;
+};
+
+static std::vector<Write> writes;
+
+static void recordWrite(uint8_t num, uint32_t duty) { writes.push_back({num, host_rtos_now_us(), duty}); }
+
+static std::vector<Write> writesOf(uint8_t num) {
+  std::vector<Write> of;
+  for (const auto &w : writes) {
+    if (w.num == num) of.push_back(w);
+  }
+
+  return of;
+}
+
+static void startSeq(device::PulseWidth *pin, const uint32_t (*steps)[2], size_t count) {
+  DynamicJsonDocument doc(2048);
+  auto seq = doc.createNestedObject("seq");
+  seq["name"] = "seq";
+  seq["repeat"] = true;
+
+  auto list = seq.createNestedArray("steps");
+  for (size_t i = 0; i < count; i++) {
+    auto step = list.createNestedObject();
+    step["duty"] = steps[i][0];
+    step["ms"] = steps[i][1];
+  }
+
+  pin->execute(doc.as<JsonObject>());
+}
+
+// the writes of a repeating seq against the steps, returns the latest write relative to its due
+// time (the first write plus the durations of the steps before)
+static uint64_t checkSteps(const char *label, const std::vector<Write> &got, const uint32_t (*steps)[2],
+                           size_t count, uint32_t min_ms) {
+  uint64_t due = got.empty() ? 0 : got[0].at_us;
+  uint64_t late_max = 0;
+
+  for (size_t i = 0; i < got.size(); i++) {
+    const auto &step = steps[i % count];
+
+    if (got[i].duty != step[0]) {
+      CHECK(false, "%s write %zu duty %u want %u", label, i, got[i].duty, step[0]);
+      break;
+    }
+
+    if (got[i].at_us < due) {
+      CHECK(false, "%s write %zu early by %.1fms", label, i, (due - got[i].at_us) / 1e3);
+      break;
+    }
+
+    if ((got[i].at_us - due) > late_max) late_max = got[i].at_us - due;
+    due += ((step[1] < min_ms) ? min_ms : step[1]) * 1000ULL;
+  }
+
+  CHECK(late_max <= TICK_US, "%s step late by %.1fms", label, late_max / 1e3);
+  return late_max;
+}
+
+static int testMain() {
+  static device::PulseWidth *pins[pwm::Scheduler::max_pins];
+  for (uint8_t pin = 0; pin < pwm::Scheduler::max_pins; pin++) pins[pin] = new device::PulseWidth(pin);
+
+  static constexpr uint32_t timed[][2] = {{1000, 10}, {2000, 30}, {3000, 7}, {4000, 13}};
+  static constexpr uint32_t zero[][2] = {{100, 0}, {200, 1}, {300, 0}};
+  constexpr size_t timed_count = sizeof(timed) / sizeof(timed[0]);
+  constexpr size_t zero_count = sizeof(zero) / sizeof(zero[0]);
+  constexpr uint32_t run_ms = 1200;
+  constexpr uint32_t min_ms = portTICK_PERIOD_MS;
+
+  writes.reserve(4096);
+  ledc_sim::on_update = recordWrite;
+
+  // the timed seq alone, then alongside the seq of zero length steps
+  startSeq(pins[1], timed, timed_count);
+  vTaskDelay(pdMS_TO_TICKS(run_ms / 2));
+  startSeq(pins[2], zero, zero_count);
+  vTaskDelay(pdMS_TO_TICKS(run_ms / 2));
+
+  ledc_sim::on_update = nullptr;
+  pins[1]->off();
+  pins[2]->off();
+
+  const auto timed_writes = writesOf(1);
+  const auto zero_writes = writesOf(2);
+  const size_t timed_want = (run_ms * timed_count) / (10 + 30 + 7 + 13);
+  const size_t zero_want = (run_ms / 2) / min_ms;
+
+  CHECK((timed_writes.size() >= timed_want) && (timed_writes.size() <= (timed_want + 1)),
+        "timed writes %zu want %zu", timed_writes.size(), timed_want);
+  CHECK((zero_writes.size() >= zero_want) && (zero_writes.size() <= (zero_want + 1)),
+        "zero length writes %zu want %zu", zero_writes.size(), zero_want);
+
+  const auto timed_late = checkSteps("timed", timed_writes, timed, timed_count, min_ms);
+  checkSteps("zero length", zero_writes, zero, zero_count, min_ms);
+
+  printf("sequence: %zu timed steps late at most %.1fms, %zu zero length steps one %ums tick each\n",
+         timed_writes.size(), timed_late / 1e3, zero_writes.size(), min_ms);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
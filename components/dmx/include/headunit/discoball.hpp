@@ -28,12 +28,13 @@ namespace dmx {
 class DiscoBall : public PulseWidthHeadUnit {
 
 public:
-  DiscoBall(uint8_t pwm_num) : PulseWidthHeadUnit(pwm_num){};
+  DiscoBall(uint8_t pwm_num, pwm::Curve::Kind curve = pwm::Curve::LINEAR)
+      : PulseWidthHeadUnit(pwm_num, curve){};
 
   void handleMsg(const JsonObject &obj) override {
-    const uint32_t duty = obj[_id] | 0;
+    const uint32_t level = obj[_id] | 0;
 
-    updateDuty(duty);
+    updateLevel(level);
   }
 
 private:
@@ -30,12 +30,14 @@ namespace dmx {
 class ElWire : public PulseWidthHeadUnit {
 
 public:
-  ElWire(uint8_t pwm_num) : PulseWidthHeadUnit(pwm_num) { snprintf(_id.data(), _id.size(), "EL%u", pwm_num); }
+  ElWire(uint8_t pwm_num, pwm::Curve::Kind curve = pwm::Curve::LINEAR) : PulseWidthHeadUnit(pwm_num, curve) {
+    snprintf(_id.data(), _id.size(), "EL%u", pwm_num);
+  }
 
   void handleMsg(const JsonObject &obj) override {
-    const uint32_t duty = obj[_id.data()] | 0;
+    const uint32_t level = obj[_id.data()] | 0;
 
-    updateDuty(duty);
+    updateLevel(level);
   }
 
 private:
@@ -30,12 +30,13 @@ typedef class LedForest LedForest_t;
 class LedForest : public PulseWidthHeadUnit {
 
 public:
-  LedForest(uint8_t pwm_num) : PulseWidthHeadUnit(pwm_num) {}
+  LedForest(uint8_t pwm_num, pwm::Curve::Kind curve = pwm::Curve::LINEAR)
+      : PulseWidthHeadUnit(pwm_num, curve) {}
 
   void handleMsg(const JsonObject &obj) override {
-    const uint32_t duty = obj[_id] | 0;
+    const uint32_t level = obj[_id] | 0;
 
-    updateDuty(duty);
+    updateLevel(level);
   }
 
 private:
@@ -31,7 +31,7 @@ namespace dmx {
 
 class PulseWidthHeadUnit : public HeadUnit, public pwm::Hardware {
 public:
-  PulseWidthHeadUnit(uint8_t num) : Hardware(num) {}
+  PulseWidthHeadUnit(uint8_t num, pwm::Curve::Kind curve) : Hardware(num) { Hardware::curve(curve); }
   virtual ~PulseWidthHeadUnit() = default;
 
 public:
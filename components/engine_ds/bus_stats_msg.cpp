@@ -0,0 +1,49 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+
+#include "bus_stats_msg.hpp"
+
+namespace ds {
+
+BusStats::BusStats(const char *ident, const Bus &bus) : message::Out(512) {
+  _filter.addLevel("immut");
+  _filter.addLevel("bus");
+  _filter.addLevel(ident);
+
+  JsonObject root = rootObject();
+  root["bus"] = bus.num();
+
+  // bucket upper bounds, the final bucket is unbounded
+  JsonArray bounds = root.createNestedArray("wait_ms");
+  for (auto ms : Bus::wait_bucket_ms) bounds.add(ms);
+
+  const char *names[Bus::PRIORITIES] = {"report", "command"};
+  for (size_t prio = Bus::LOW; prio < Bus::PRIORITIES; prio++) {
+    JsonArray hist = root.createNestedArray(names[prio]);
+    const uint32_t *counts = bus.waitHistogram((Bus::Priority)prio);
+
+    for (size_t i = 0; i < Bus::wait_buckets; i++) hist.add(counts[i]);
+  }
+}
+
+void BusStats::assembleData(JsonObject &root) {}
+
+} // namespace ds
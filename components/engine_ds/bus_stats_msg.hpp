@@ -18,36 +18,24 @@
     https://www.wisslanding.com
 */
 
-#ifndef ruth_ds_bus_hpp
-#define ruth_ds_bus_hpp
+
+#ifndef ds_bus_stats_message_hpp
+#define ds_bus_stats_message_hpp
 
 #include <memory>
 
+#include "dev_ds/bus.hpp"
+#include "message/out.hpp"
+
 namespace ds {
-typedef uint8_t Byte;
-typedef uint8_t *Bytes;
-typedef const size_t Len;
-typedef uint8_t *RomCode;
 
-class Bus {
+class BusStats : public message::Out {
 public:
-  static bool acquire(uint32_t timeout_ms = UINT32_MAX);
-  static bool ensure();
-  static bool error();
-
-  static bool convert(bool &complete, bool cancel = false);
-  static uint8_t lastStatus();
-  static bool ok();
-  static bool release();
-  static bool reset();
-  static bool search(RomCode rom_code);
-
-  static bool writeThenRead(Bytes write, Len wlen, Bytes read, Len rlen);
-  static bool writeThenRead(Bytes write, Len wlen, Byte read);
+  BusStats(const char *ident, const Bus &bus);
+  ~BusStats() = default;
 
 private:
-  static void checkPowered();
+  void assembleData(JsonObject &data);
 };
 } // namespace ds
-
 #endif
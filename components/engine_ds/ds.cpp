@@ -18,10 +18,14 @@
       https://www.wisslanding.com
   */
 
+#include <cstdio>
+#include <cstring>
+
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
+#include "bus_stats_msg.hpp"
 #include "dev_ds/ds.hpp"
 #include "dev_ds/ds1820.hpp"
 #include "dev_ds/ds2408.hpp"
@@ -33,9 +37,19 @@ using namespace ruth;
 
 static const char *TAG_RPT = "ds:report";
 static const char *TAG_CMD = "ds:cmd";
-static Engine *_instance_ = nullptr;
-
-Engine::Engine(const Opts &opts) : Handler("ds", max_queue_depth), _opts(opts) {}
+static Engine *_instances_[Bus::max_buses] = {};
+
+// pass the send frequency to the Bus to control the frequency of temperature converts
+Engine::Engine(const Opts &opts)
+    : Handler("ds", max_queue_depth), _opts(opts), _bus(opts.bus.num, opts.bus.pin, opts.report.send_ms),
+      _known(opts.devices.capacity, opts.devices.evict_after) {
+  resolutions(opts.resolution);
+  _opts.resolution = JsonObjectConst(); // copied, the profile may be replaced
+
+  _known_mutex = xSemaphoreCreateMutex();
+  _wake = xSemaphoreCreateBinary();
+  _ended = xSemaphoreCreateCounting(Tasks::COMMAND + 1, 0);
+}
 
 IRAM_ATTR void Engine::command(void *task_data) {
   Engine *ds = (Engine *)task_data;
@@ -43,39 +57,44 @@ IRAM_ATTR void Engine::command(void *task_data) {
   ds->notifyThisTask(Notifies::QUEUED_MSG);
   MQTT::registerHandler(ds);
 
-  ESP_LOGD(TAG_CMD, "task started");
+  ESP_LOGD(TAG_CMD, "task started bus[%u]", ds->_bus.num());
 
-  for (;;) {
+  while (ds->_stopping == false) {
     UBaseType_t notify_val;
     auto msg = ds->waitForNotifyOrMessage(&notify_val);
 
     if (msg) {
       const char *ident = msg->identFromFilter();
 
+      // find the device while holding the bus, discover may evict it.
+      // commands are high priority, the report task yields to them between devices.
+      ds->_bus.acquire(UINT32_MAX, Bus::HIGH);
+
       Device *cmd_device = ds->findDevice(ident);
+      if (cmd_device) cmd_device->execute(std::move(msg));
 
-      if (cmd_device) {
-        Device::acquireBus();
-        cmd_device->execute(std::move(msg));
-        Device::releaseBus();
-      }
+      ds->_bus.release();
 
-    } else {
+    } else if ((notify_val & Notifies::CMD_ENDING) == 0) {
       ESP_LOGW(TAG_CMD, "unhandled notify: 0x%x", notify_val);
     }
   }
+
+  MQTT::unregisterHandler(ds);
+
+  ds->_tasks[COMMAND] = nullptr;
+  xSemaphoreGive(ds->_ended);
+  vTaskDelete(nullptr);
 }
 
 IRAM_ATTR void Engine::discover(const uint32_t loops_per_discover) {
-  static uint32_t loop_count = 0;
-
   // don't discover until enough loops have passed.
   // using a countdown we are assured the first call will always perform a discover.
-  if (loop_count == 0) {
+  if (_discover_countdown == 0) {
     // it is time for a discover, reset the loop count and proceed with the discover
-    loop_count = loops_per_discover;
+    _discover_countdown = loops_per_discover;
   } else {
-    loop_count--;
+    _discover_countdown--;
     return;
   }
 
@@ -83,126 +102,318 @@ IRAM_ATTR void Engine::discover(const uint32_t loops_per_discover) {
   bool found;
   uint32_t found_count = 0;
 
+  // discover at standard speed, newly found devices may not support overdrive
+  _bus.allowOverdrive(false);
+
   do {
-    found = Device::search(rom_code);
+    found = _bus.search(rom_code);
 
     if (found) {
       found_count++;
 
-      for (size_t i = 0; i < max_devices; i++) {
-        constexpr size_t rom_len = sizeof(rom_code);
-        Device *entry = _known[i];
+      // known devices are simply marked as seen
+      if (_known.seen(rom_code)) continue;
 
-        if (entry == nullptr) {
-          // we've reached the end of the known devices and the rom code isn't known.
-          // add the rom code as a known device and get out of this loop
-          Device *new_device = nullptr; // we never delete a device so no reason to use smart pointer
+      Device *new_device = nullptr;
 
-          const uint8_t family = rom_code[0];
-          switch (family) {
-          case 0x28:
-            new_device = new DS1820(rom_code);
-            break;
+      const uint8_t family = rom_code[0];
+      switch (family) {
+      case 0x28: {
+        auto *ds1820 = new DS1820(&_bus, rom_code);
 
-          case 0x29:
-            new_device = new DS2408(rom_code);
-            break;
+        // always called, reads the configured resolution even when the profile has none
+        ds1820->resolution(resolutionFor(ds1820->ident()));
+        new_device = ds1820;
+      } break;
 
-          default:
-            ESP_LOGW(TAG_RPT, "unhandled family: 0x%02x", family);
-            break;
-          }
+      case 0x29:
+        new_device = new DS2408(&_bus, rom_code);
+        break;
 
-          if (new_device) {
-            ESP_LOGD(new_device->ident(), "new device");
-            _known[i] = new_device;
-          }
+      default:
+        ESP_LOGW(TAG_RPT, "unhandled family: 0x%02x", family);
+        break;
+      }
 
-          break;
-        }
+      if (new_device) {
+        ESP_LOGD(new_device->ident(), "new device");
 
-        if (memcmp(entry->addr(), rom_code, rom_len) == 0) {
-          // we already know this device
-          entry->updateSeenTimestamp();
-          break;
-        }
+        xSemaphoreTake(_known_mutex, portMAX_DELAY);
+        _known.add(new_device);
+        xSemaphoreGive(_known_mutex);
+
+        if (_opts.report.change_ms) new_device->enableChangeDetect();
       }
     }
 
   } while (found);
 
-  ESP_LOGD(TAG_RPT, "discovered %d devices", found_count);
+  // a search ended by a bus error says nothing about which devices are present, don't age
+  size_t evicted = 0;
+  if (_bus.ok()) {
+    xSemaphoreTake(_known_mutex, portMAX_DELAY);
+    evicted = _known.age();
+    xSemaphoreGive(_known_mutex);
+  }
+
+  // converts only release the bus while waiting when no device is parasite powered
+  _bus.checkPowered();
+
+  // overdrive is only used when every known device is capable.
+  // converts wait for the slowest (highest resolution) device present.
+  size_t idx;
+  uint32_t convert_max_us = 0;
+  auto overdrive = (_known.count() > 0);
+  for (auto *device = _known.first(idx); device; device = _known.next(idx)) {
+    overdrive = overdrive && device->overdrive();
+
+    if (device->convertMicros() > convert_max_us) convert_max_us = device->convertMicros();
+  }
+
+  _bus.allowOverdrive(overdrive);
+  if (convert_max_us) _bus.convertMaxMicros(convert_max_us);
+
+  ESP_LOGD(TAG_RPT, "bus[%u] discovered %d devices known[%u] evicted[%u] overdrive[%d]", _bus.num(),
+           found_count, _known.count(), evicted, overdrive);
+
+  // publish the bus acquire wait histograms with each discover
+  char ident[12];
+  snprintf(ident, sizeof(ident), "ds.bus%u", _bus.num());
+  BusStats stats(ident, _bus);
+  MQTT::send(stats);
 }
 
 IRAM_ATTR Device *Engine::findDevice(const char *ident) {
-  Device *found = nullptr;
+  // other tasks look up devices while the report task adds and evicts them.  the device
+  // returned is only valid while the caller holds the bus (discover evicts with the bus held).
+  xSemaphoreTake(_known_mutex, portMAX_DELAY);
+  auto *device = _known.find(ident);
+  xSemaphoreGive(_known_mutex);
 
-  for (auto i = 0; i < max_devices; i++) {
-    Device *device = _known[i];
+  return device;
+}
 
-    if (device == nullptr) {
-      break;
+IRAM_ATTR void Engine::report(void *data) {
+  TickType_t last_wake;
+  TickType_t report_at = 0; // when the last full report began
+  bool reported = false;
+
+  Engine *ds = (Engine *)data;
+  const auto &opts = ds->_opts.report; // reconfigured in place, read each pass
+
+  ESP_LOGD(TAG_RPT, "task started bus[%u]", ds->_bus.num());
+
+  while (ds->_stopping == false) {
+    // with change detection the task wakes at the change interval and performs a full
+    // report (and discover) every send_ms.  the report is due by time, not a count of passes,
+    // as a full report (converting) overruns the change interval.
+    const auto send_ticks = pdMS_TO_TICKS(opts.send_ms);
+    const auto change_ticks = pdMS_TO_TICKS(opts.change_ms);
+    const auto change_detect = (change_ticks > 0) && (change_ticks < send_ticks);
+
+    last_wake = xTaskGetTickCount();
+    const auto report_due = !reported || ((last_wake - report_at) >= send_ticks);
+
+    if (!report_due && !change_detect) {
+      // woken early by reconfigure(), the report is not yet due
+    } else if (ds->_bus.acquire(1000)) {
+      if (report_due) {
+        report_at = last_wake;
+        reported = true;
+
+        // important to discover first especially at startup
+        ds->discover(opts.loops_per_discover);
+
+        size_t idx;
+        for (auto *device = ds->_known.first(idx); device; device = ds->_known.next(idx)) {
+          device->report();
+          ds->_bus.yield(); // let a pending command use the bus
+        }
+      } else {
+        ds->reportChanges();
+      }
+
+      ds->_bus.release();
+
+    } else {
+      ESP_LOGW(TAG_RPT, "timeout acquiring bus[%u]", ds->_bus.num());
     }
 
-    if (strncmp(device->ident(), ident, Device::identMaxLen()) == 0) {
-      found = device;
-      break;
+    // wait for the next report or change pass, stop() and reconfigure() give _wake to end it early
+    const auto now = xTaskGetTickCount();
+    const auto since_report = now - report_at;
+    auto wait = (since_report < send_ticks) ? (send_ticks - since_report) : 0;
+
+    if (change_detect) {
+      const auto since_wake = now - last_wake;
+      const TickType_t change_wait = (since_wake < change_ticks) ? (change_ticks - since_wake) : 0;
+      if (change_wait < wait) wait = change_wait;
     }
+
+    if (wait) xSemaphoreTake(ds->_wake, wait);
   }
 
-  return found;
+  ds->_tasks[REPORT] = nullptr;
+  xSemaphoreGive(ds->_ended);
+  vTaskDelete(nullptr);
 }
 
-IRAM_ATTR void Engine::report(void *data) {
-  static TickType_t last_wake;
+void Engine::reconfigure(const Opts &opts) {
+  // the report task reads the opts while discovering, hold the bus while they change
+  _bus.acquire(UINT32_MAX, Bus::HIGH);
 
-  Engine *ds = (Engine *)data;
+  // change detection is enabled or disabled on the known devices when change_ms turns on or off
+  const auto change_detect = opts.report.change_ms > 0;
+  const auto change_toggled = (_opts.report.change_ms > 0) != change_detect;
 
-  const auto send_ms = ds->_opts.report.send_ms;
-  const auto loops_per_discover = ds->_opts.report.loops_per_discover;
+  _opts.report = opts.report;
+  _opts.command = opts.command;
+  _bus.convertFrequency(opts.report.send_ms);
+  resolutions(opts.resolution);
 
-  ESP_LOGD(TAG_RPT, "task started");
+  // known devices are updated now, new devices as they are discovered
+  size_t idx;
+  for (auto *device = _known.first(idx); device; device = _known.next(idx)) {
+    if (change_toggled) change_detect ? device->enableChangeDetect() : device->disableChangeDetect();
 
-  for (;;) {
-    last_wake = xTaskGetTickCount();
-    if (Device::acquireBus(1000)) {
-      // important to discover first especially at startup
-      ds->discover(loops_per_discover);
+    // only writes the scratchpad (and eeprom) when the resolution changed
+    if (device->family() == 0x28) {
+      static_cast<DS1820 *>(device)->resolution(resolutionFor(device->ident()));
+    }
+  }
 
-      for (size_t i = 0; (i < max_devices) && (ds->_known[i]); i++) {
-        Device *device = ds->_known[i];
+  _bus.release();
 
-        // if (device == nullptr) break; // reached the end of known devices
+  // a stopped engine has no tasks, the priorities apply when they are created.  the report task
+  // is woken so the new intervals apply now rather than after the interval in progress.
+  if (_tasks[REPORT]) {
+    vTaskPrioritySet(_tasks[REPORT], opts.report.priority);
+    xSemaphoreGive(_wake);
+  }
 
-        device->report();
-      }
+  if (_tasks[COMMAND]) vTaskPrioritySet(_tasks[COMMAND], opts.command.priority);
+}
 
-      Device::releaseBus();
+IRAM_ATTR void Engine::reportChanges() {
+  // collect the devices responding to conditional search first, reporting a change resets the
+  // device activity latch which would disturb the search in progress.  any responders beyond
+  // max_changes_per_search keep their latch set and are found by the next search.
+  //
+  // DS18B20s also respond when their alarm flag is set (with the factory TH / TL that is
+  // most of them) and, by family code, are found first.  the search is limited to the DS2408
+  // family so they drop out at the first bit rather than each costing a search.
+  constexpr uint8_t family = 0x29;
+  uint8_t rom_codes[max_changes_per_search][8];
+  size_t count = 0;
+
+  while ((count < max_changes_per_search) && _bus.search(rom_codes[count], true, family)) count++;
+
+  // finish the search so the next begins with a fresh search state
+  if (count == max_changes_per_search) {
+    uint8_t discard[8];
+    while (_bus.search(discard, true, family)) {
+    }
+  }
 
-    } else {
-      ESP_LOGW(TAG_RPT, "timeout acquiring bus");
+  for (size_t i = 0; i < count; i++) {
+    Device *device = _known.find(rom_codes[i]);
+
+    if (device) device->reportChange();
+  }
+}
+
+uint8_t Engine::resolutionFor(const char *ident) const {
+  for (const auto &res : _resolutions) {
+    if (res.ident[0] == 0x00) break;
+
+    if (strncmp(res.ident, ident, sizeof(res.ident)) == 0) return res.bits;
+  }
+
+  return _resolution_default;
+}
+
+void Engine::resolutions(JsonObjectConst res) {
+  size_t count = 0;
+
+  _resolution_default = res["default"] | 0;
+
+  for (const JsonPairConst kv : res) {
+    const char *ident = kv.key().c_str();
+    if (strcmp(ident, "default") == 0) continue;
+
+    if (count == max_resolutions) {
+      ESP_LOGW(TAG_RPT, "bus[%u] resolutions exceed max[%u]", _bus.num(), max_resolutions);
+      break;
     }
 
-    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(send_ms));
+    auto &entry = _resolutions[count++];
+    memccpy(entry.ident, ident, 0x00, sizeof(entry.ident) - 1);
+    entry.bits = kv.value() | 0;
   }
+
+  if (count < max_resolutions) _resolutions[count].ident[0] = 0x00;
 }
 
 void Engine::start(const Opts &opts) {
-  if (_instance_) return;
+  const auto num = opts.bus.num;
+
+  if (num >= Bus::max_buses) {
+    ESP_LOGW(TAG_RPT, "bus[%u] exceeds max buses[%u]", num, Bus::max_buses);
+    return;
+  }
+
+  auto *engine = _instances_[num];
+
+  if (engine) {
+    // a stop in progress completes before the tasks are started again.  each task gives
+    // _ended as it exits, a count left by an earlier stop only costs a recheck.
+    while (engine->_stopping && (engine->_tasks[REPORT] || engine->_tasks[COMMAND])) {
+      xSemaphoreTake(engine->_ended, portMAX_DELAY);
+    }
+
+    engine->reconfigure(opts);
+    if (engine->_stopping == false) return;
 
-  // pass the send frequency to the Bus to control the frequency of temperature converts
-  const auto send_ms = opts.report.send_ms;
-  Device::initBus(send_ms);
+    engine->_stopping = false;
+    xSemaphoreTake(engine->_wake, 0); // clear a wake the ended report task never took
+  } else {
+    engine = new Engine(opts);
+
+    if (engine->_bus.ensure(opts.bus.owb) == false) {
+      delete engine;
+      return;
+    }
+
+    _instances_[num] = engine;
+  }
 
-  _instance_ = new Engine(opts);
+  // each bus has it's own report and command tasks so a slow bus never delays another
+  char task_name[16];
+  snprintf(task_name, sizeof(task_name), "%s.%u", TAG_RPT, num);
+  xTaskCreate(&report, task_name, opts.report.stack, engine, opts.report.priority, &(engine->_tasks[REPORT]));
 
-  xTaskCreate(&report, TAG_RPT, opts.report.stack, _instance_, opts.report.priority,
-              &(_instance_->_tasks[REPORT]));
+  snprintf(task_name, sizeof(task_name), "%s.%u", TAG_CMD, num);
+  xTaskCreate(&command, task_name, opts.command.stack, engine, opts.command.priority,
+              &(engine->_tasks[COMMAND]));
+}
+
+void Engine::stop(uint8_t num) {
+  auto *engine = (num < Bus::max_buses) ? _instances_[num] : nullptr;
+
+  if ((engine == nullptr) || (engine->_tasks[COMMAND] == nullptr)) return;
 
-  xTaskCreate(&command, TAG_CMD, opts.command.stack, _instance_, opts.command.priority,
-              &(_instance_->_tasks[COMMAND]));
+  engine->_stopping = true;
+
+  // the command task ends once notified, the report task once woken (or at the end of a
+  // report in progress).  _wake is a semaphore, not a notify, so it is safe to give even
+  // if the report task has already ended.
+  xTaskNotify(engine->_tasks[COMMAND], Notifies::CMD_ENDING, eSetBits);
+  xSemaphoreGive(engine->_wake);
 }
 
-void Engine::wantMessage(message::InWrapped &msg) { msg->want(DocKinds::CMD); }
+void Engine::wantMessage(message::InWrapped &msg) {
+  // every bus engine registers as a ds handler, only want commands for devices on this bus
+  if (findDevice(msg->identFromFilter())) msg->want(DocKinds::CMD);
+}
 
 } // namespace ds
@@ -24,9 +24,13 @@
 #include <cstdlib>
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include "ArduinoJson.h"
+#include "dev_ds/bus.hpp"
 #include "dev_ds/ds.hpp"
+#include "engine_ds/registry.hpp"
 #include "message/handler.hpp"
 #include "message/in.hpp"
 
@@ -37,6 +41,21 @@ public:
   struct Opts {
     const char *unique_id;
 
+    struct {
+      uint8_t num = 0; // selects the RMT channels (num * 2, num * 2 + 1)
+      uint8_t pin = 14;
+      OneWireBus *owb = nullptr; // an initialized bus (e.g. the host simulation) replaces the rmt bus
+    } bus;
+
+    // DS18B20 resolution (bits) by ident with an optional "default", e.g.
+    // {"default": 10, "ds.28ff641e8216c3": 12}.  copied by the engine.
+    JsonObjectConst resolution;
+
+    struct {
+      size_t capacity = 25; // initial, the registry grows as devices are discovered
+      uint32_t evict_after = 5; // discover cycles a device may be missing before it is removed
+    } devices;
+
     struct {
       UBaseType_t stack = 4096;
       UBaseType_t priority = 1;
@@ -47,6 +66,7 @@ public:
       UBaseType_t priority = 1;
       uint32_t send_ms = 7000;
       uint32_t loops_per_discover = 10;
+      uint32_t change_ms = 0; // conditional search interval between reports, zero disables
     } report;
   };
 
@@ -60,8 +80,12 @@ private:
 public:
   static void command(void *data); // task loop
   static void report(void *data);  // task loop (reports and discover)
+
+  // starts the engine for the bus or, when already running, applies the report intervals,
+  // resolutions and task priorities in place.  the bus pin, device capacity and stack sizes
+  // apply at the next restart of the device.
   static void start(const Opts &opts);
-  void stop();
+  static void stop(uint8_t num); // the tasks end, the bus and known devices are kept
 
   void wantMessage(message::InWrapped &msg) override;
 
@@ -71,15 +95,33 @@ private:
 private:
   void discover(const uint32_t loops_per_discover);
   Device *findDevice(const char *ident);
+  void reconfigure(const Opts &opts);
+  void reportChanges();
+  uint8_t resolutionFor(const char *ident) const;
+  void resolutions(JsonObjectConst res);
 
 private:
   Opts _opts;
-  Device *_known[25] = {};
+  Bus _bus;
+  Registry _known;
+  SemaphoreHandle_t _known_mutex = nullptr; // held by lookups from other tasks and add / age
+  uint32_t _discover_countdown = 0;
+
+  // resolutions copied from the opts, the profile they were read from may be replaced
+  struct {
+    char ident[18];
+    uint8_t bits;
+  } _resolutions[8] = {};
+  uint8_t _resolution_default = 0;
 
   TaskHandle_t _tasks[Tasks::COMMAND + 1] = {};
+  volatile bool _stopping = false;
+  SemaphoreHandle_t _wake = nullptr;  // given by stop() and reconfigure() to end the report wait early
+  SemaphoreHandle_t _ended = nullptr; // given by each task as it ends, start() waits on it
 
-  static constexpr size_t max_devices = sizeof(_known) / sizeof(Device *);
   static constexpr size_t max_queue_depth = 5;
+  static constexpr size_t max_changes_per_search = 8;
+  static constexpr size_t max_resolutions = sizeof(_resolutions) / sizeof(_resolutions[0]);
 };
 } // namespace ds
 
@@ -0,0 +1,103 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+
+#ifndef ruth_ds_registry_hpp
+#define ruth_ds_registry_hpp
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "dev_ds/ds.hpp"
+
+namespace ds {
+
+// Registry of known devices keyed by rom code (family and serial, the crc is implied).
+//
+// An open addressing (linear probe) table sized to twice the capacity rounded up
+// to a power of two.  An add beyond the capacity doubles the capacity and rehashes
+// the known devices into a new table.  The device ident is derived from the same
+// bytes so lookups by ident parse the ident to the key rather than maintain a
+// second table.
+//
+// Not thread safe.  Mutation (add, age) is performed by the report task while holding
+// the bus, the report task may look up and iterate freely.  Lookups from other tasks
+// must be serialized with add and age by the owner (see ds::Engine::findDevice), keys
+// are 64 bits, add may replace the table and age deletes the devices it removes.
+class Registry {
+public:
+  typedef uint64_t Key;
+
+public:
+  Registry(size_t capacity, uint32_t evict_after);
+  ~Registry();
+
+  Registry(const Registry &) = delete;
+  void operator=(const Registry &) = delete;
+
+  void add(Device *device); // takes ownership, the device must not be known
+
+  // remove (and delete) devices not seen for evict_after discover cycles
+  size_t age();
+
+  inline size_t capacity() const { return _capacity; }
+  inline size_t count() const { return _count; }
+
+  Device *find(const uint8_t *rom_code);
+  Device *find(const char *ident);
+
+  // iteration over the populated slots, e.g. for (auto *d = first(i); d; d = next(i))
+  Device *first(size_t &idx);
+  Device *next(size_t &idx);
+
+  static Key key(const uint8_t *rom_code);
+  static Key key(const char *ident);
+
+  bool seen(const uint8_t *rom_code); // true when known, device is marked seen this cycle
+
+private:
+  struct Slot {
+    Key key;
+    Device *device;
+    uint32_t missed; // consecutive discover cycles the device was not found
+    bool seen;       // found during the current discover cycle
+  };
+
+  static constexpr Key EMPTY = 0;       // family code zero is never a valid device
+  static constexpr Key REMOVED = ~0ULL; // beyond the 56 bits used by a key
+
+private:
+  Slot &freeSlot(Key k);
+  void grow();
+  static uint32_t hash(Key k);
+  Slot *lookup(Key key);
+  void remove(size_t idx);
+
+private:
+  size_t _capacity;
+  const uint32_t _evict_after;
+  size_t _mask = 0;
+  size_t _count = 0;
+  Slot *_slots = nullptr;
+};
+
+} // namespace ds
+
+#endif
@@ -0,0 +1,240 @@
+/*
+    Ruth
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+
+#include <cstring>
+
+#include <esp_attr.h>
+#include <esp_log.h>
+
+#include "engine_ds/registry.hpp"
+
+namespace ds {
+
+static const char *TAG = "ds:registry";
+
+// the key is the family code and serial number (rom bytes 0-6), little endian
+static constexpr size_t key_bytes = 7;
+static constexpr size_t ident_prefix_len = 3; // ds.
+
+Registry::Registry(size_t capacity, uint32_t evict_after)
+    : _capacity(capacity ? capacity : 1), _evict_after(evict_after ? evict_after : 1) {
+
+  // keep the load factor at or below 50% so probe sequences stay short
+  size_t slots = 2;
+  while (slots < (_capacity * 2)) slots <<= 1;
+
+  _mask = slots - 1;
+  _slots = new Slot[slots]();
+}
+
+Registry::~Registry() {
+  for (size_t i = 0; i <= _mask; i++) {
+    if (_slots[i].device) delete _slots[i].device;
+  }
+
+  delete[] _slots;
+}
+
+void Registry::add(Device *device) {
+  if (_count >= _capacity) grow();
+
+  const auto k = key(device->addr());
+  Slot &slot = freeSlot(k);
+
+  slot.device = device;
+  slot.missed = 0;
+  slot.seen = true;
+  slot.key = k;
+
+  _count++;
+}
+
+IRAM_ATTR size_t Registry::age() {
+  size_t evicted = 0;
+
+  for (size_t i = 0; i <= _mask; i++) {
+    Slot &slot = _slots[i];
+
+    if ((slot.key == EMPTY) || (slot.key == REMOVED)) continue;
+
+    if (slot.seen) {
+      slot.seen = false;
+      slot.missed = 0;
+    } else if (++slot.missed >= _evict_after) {
+      ESP_LOGI(TAG, "evicting %s, missed %u discovers", slot.device->ident(), slot.missed);
+      remove(i);
+      evicted++;
+    }
+  }
+
+  return evicted;
+}
+
+IRAM_ATTR Device *Registry::find(const uint8_t *rom_code) {
+  auto *slot = lookup(key(rom_code));
+
+  return slot ? slot->device : nullptr;
+}
+
+IRAM_ATTR Device *Registry::find(const char *ident) {
+  auto *slot = lookup(key(ident));
+
+  return slot ? slot->device : nullptr;
+}
+
+IRAM_ATTR Device *Registry::first(size_t &idx) {
+  idx = 0;
+  return ((_slots[0].key != EMPTY) && (_slots[0].key != REMOVED)) ? _slots[0].device : next(idx);
+}
+
+IRAM_ATTR Device *Registry::next(size_t &idx) {
+  for (idx++; idx <= _mask; idx++) {
+    const Slot &slot = _slots[idx];
+
+    if ((slot.key != EMPTY) && (slot.key != REMOVED)) return slot.device;
+  }
+
+  return nullptr;
+}
+
+Registry::Slot &Registry::freeSlot(Key k) {
+  // the caller has confirmed the key is not present, the first free slot in the probe sequence
+  for (size_t idx = hash(k) & _mask;; idx = (idx + 1) & _mask) {
+    Slot &slot = _slots[idx];
+
+    if ((slot.key == EMPTY) || (slot.key == REMOVED)) return slot;
+  }
+}
+
+void Registry::grow() {
+  // double the table keeping the load factor at or below 50%.  the devices are rehashed into
+  // the new table which also discards the removed slots.
+  Slot *old_slots = _slots;
+  const size_t old_mask = _mask;
+
+  _capacity *= 2;
+  _mask = (_mask << 1) | 1;
+  _slots = new Slot[_mask + 1]();
+
+  for (size_t i = 0; i <= old_mask; i++) {
+    const Slot &slot = old_slots[i];
+
+    if ((slot.key != EMPTY) && (slot.key != REMOVED)) freeSlot(slot.key) = slot;
+  }
+
+  delete[] old_slots;
+
+  ESP_LOGI(TAG, "grew to capacity[%u] slots[%u]", _capacity, _mask + 1);
+}
+
+IRAM_ATTR uint32_t Registry::hash(Key k) {
+  // murmur3 finalizer, serial numbers are sequential within a production lot
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+
+  return (uint32_t)k;
+}
+
+IRAM_ATTR Registry::Key Registry::key(const uint8_t *rom_code) {
+  Key k = 0;
+
+  for (size_t i = 0; i < key_bytes; i++) {
+    k |= (Key)rom_code[i] << (i * 8);
+  }
+
+  return k;
+}
+
+IRAM_ATTR Registry::Key Registry::key(const char *ident) {
+  // the ident is the prefix followed by the key bytes as zero padded hex (see Device::makeID)
+  if ((ident == nullptr) || (strncmp(ident, "ds.", ident_prefix_len) != 0)) return EMPTY;
+
+  const char *p = ident + ident_prefix_len;
+  Key k = 0;
+
+  for (size_t i = 0; i < (key_bytes * 2); i++, p++) {
+    uint8_t nibble;
+
+    if ((*p >= '0') && (*p <= '9')) {
+      nibble = *p - '0';
+    } else if ((*p >= 'a') && (*p <= 'f')) {
+      nibble = *p - 'a' + 10;
+    } else {
+      return EMPTY; // not a ds ident
+    }
+
+    // two hex digits per byte, most significant digit first
+    const size_t shift = ((i / 2) * 8) + ((i % 2) ? 0 : 4);
+    k |= (Key)nibble << shift;
+  }
+
+  return (*p == 0x00) ? k : EMPTY;
+}
+
+IRAM_ATTR Registry::Slot *Registry::lookup(Key k) {
+  if (k == EMPTY) return nullptr;
+
+  // removed slots are probed through, an empty slot ends the probe sequence
+  size_t idx = hash(k) & _mask;
+  for (size_t probes = 0; probes <= _mask; probes++, idx = (idx + 1) & _mask) {
+    Slot &slot = _slots[idx];
+
+    if (slot.key == k) return &slot;
+    if (slot.key == EMPTY) break;
+  }
+
+  return nullptr;
+}
+
+IRAM_ATTR bool Registry::seen(const uint8_t *rom_code) {
+  auto *slot = lookup(key(rom_code));
+
+  if (slot == nullptr) return false;
+
+  slot->seen = true;
+  slot->device->updateSeenTimestamp();
+
+  return true;
+}
+
+void Registry::remove(size_t idx) {
+  Slot &slot = _slots[idx];
+  Device *device = slot.device;
+
+  slot.key = REMOVED;
+  slot.device = nullptr;
+  _count--;
+
+  delete device;
+
+  // when the following slot is empty no probe sequence passes through this slot, reclaim it
+  // and any removed slots immediately before it so removed slots don't accumulate
+  if (_slots[(idx + 1) & _mask].key == EMPTY) {
+    for (size_t i = idx; _slots[i].key == REMOVED; i = (i - 1) & _mask) {
+      _slots[i].key = EMPTY;
+    }
+  }
+}
+
+} // namespace ds
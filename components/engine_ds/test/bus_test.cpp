@@ -0,0 +1,133 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// Bus::acquire() priorities and Bus::yield(): a low priority holder (a report cycle of
+// devices) and a high priority requestor (commands arriving at random).  the acquire wait
+// histogram of the commands is compared with the holder yielding between devices and not.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "engine_host.hpp"
+
+static constexpr int DEVICES = 50;
+static constexpr uint32_t DEVICE_US = 20000; // bus time of each device in the report cycle
+static constexpr int COMMANDS = 40;
+
+static SimBus sim;
+static ds::Bus *bus = nullptr; // created by the test task, the constructor reads the clock
+
+static bool yielding = false;
+static volatile bool reporting = true;
+static volatile uint32_t report_yields = 0;
+
+static void reportTask(void *) {
+  while (reporting) {
+    bus->acquire(UINT32_MAX, ds::Bus::LOW);
+
+    for (int i = 0; i < DEVICES; i++) {
+      host_rtos_wait_us(DEVICE_US);
+      if (yielding && bus->yield()) report_yields++;
+    }
+
+    bus->release();
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+
+  vTaskDelete(nullptr);
+}
+
+// acquire wait of commands, the histogram counts of the commands and their longest wait
+static uint64_t commands(uint32_t *counts) {
+  uint32_t before[ds::Bus::wait_buckets];
+  memcpy(before, bus->waitHistogram(ds::Bus::HIGH), sizeof(before));
+
+  uint64_t wait_max = 0;
+  uint32_t rng = 0x1234;
+  for (int i = 0; i < COMMANDS; i++) {
+    rng = (rng * 1103515245) + 12345;
+    vTaskDelay(pdMS_TO_TICKS(10 + ((rng >> 16) % 90)));
+
+    const auto start_at = host_rtos_now_us();
+    bus->acquire(UINT32_MAX, ds::Bus::HIGH);
+    wait_max = std::max(wait_max, host_rtos_now_us() - start_at);
+
+    host_rtos_wait_us(3000); // the command
+    bus->release();
+  }
+
+  const auto *after = bus->waitHistogram(ds::Bus::HIGH);
+  for (size_t b = 0; b < ds::Bus::wait_buckets; b++) counts[b] = after[b] - before[b];
+
+  return wait_max;
+}
+
+static void printHistogram(const char *label, const uint32_t *counts, uint64_t wait_max) {
+  printf("%-12s", label);
+  for (size_t b = 0; b < ds::Bus::wait_buckets; b++) {
+    if (b < (ds::Bus::wait_buckets - 1)) {
+      printf(" <%ums:%2u", ds::Bus::wait_bucket_ms[b], counts[b]);
+    } else {
+      printf(" more:%2u", counts[b]);
+    }
+  }
+
+  printf("  max %.1fms\n", wait_max / 1e3);
+}
+
+static int testMain() {
+  sim.init(0x00a0a0a00000, 0, 0);
+  bus = new ds::Bus(0, 0, 1000);
+  bus->ensure(sim.owb);
+
+  xTaskCreate(reportTask, "report", 4096, nullptr, 1, nullptr);
+
+  // the holder keeps the bus for the whole cycle (a second), commands wait for the cycle end
+  uint32_t held[ds::Bus::wait_buckets];
+  const auto held_max = commands(held);
+
+  // the holder yields between devices, commands wait at most for the device in progress
+  yielding = true;
+  uint32_t yielded[ds::Bus::wait_buckets];
+  const auto yielded_max = commands(yielded);
+
+  reporting = false;
+
+  uint32_t total = 0;
+  for (auto c : yielded) total += c;
+  CHECK(total == COMMANDS, "histogram counted %u of %d commands", total, COMMANDS);
+
+  // yielding, every wait is within one device (the 100ms bucket and below)
+  CHECK((yielded[3] + yielded[4]) == 0, "yielding waits beyond 100ms: %u", yielded[3] + yielded[4]);
+  CHECK(yielded_max <= DEVICE_US, "yielding wait %.1fms", yielded_max / 1e3);
+  CHECK(report_yields > 0, "no yields");
+
+  // holding, most commands arrive mid cycle and wait beyond 100ms
+  CHECK((held[3] + held[4]) > (COMMANDS / 2), "holding waits beyond 100ms: %u", held[3] + held[4]);
+
+  printHistogram("holding", held, held_max);
+  printHistogram("yielding", yielded, yielded_max);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
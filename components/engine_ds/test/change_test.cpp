@@ -0,0 +1,216 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// DS2408 change detection (Engine::reportChanges) on a simulated bus of DS2408s and
+// DS18B20s (which also answer conditional search, their alarm flag is set): switch changes
+// are reported by the next conditional search, unchanged devices are not, and a burst of
+// changes beyond one search is reported by the searches that follow.  the bus time of a
+// conditional search is compared with polling every DS2408 with a channel access read.
+// change_ms lowered to zero (in place) disables the conditional search of the DS2408s,
+// raised again the changes are once more reported by the next search.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "engine_host.hpp"
+
+static constexpr int DS18B20_COUNT = 20;
+static constexpr int DS2408_COUNT = 40;
+static constexpr int DEVICE_COUNT = DS18B20_COUNT + DS2408_COUNT;
+static constexpr uint32_t CHANGE_MS = 100;
+
+static SimBus sim;
+
+// bus time of a channel access read of every DS2408, as a report cycle performs them
+static uint64_t pollBusTime() {
+  const auto start_us = sim.info.bus_time_us;
+
+  for (int device = DS18B20_COUNT; device < DEVICE_COUNT; device++) {
+    OneWireBus_ROMCode rom;
+    uint8_t samples[34];
+    bool present = false;
+
+    owb_sim_rom_code(&sim.info, device, &rom);
+
+    owb_reset(sim.owb, &present);
+    owb_write_byte(sim.owb, OWB_ROM_MATCH);
+    owb_write_rom_code(sim.owb, rom);
+    owb_write_byte(sim.owb, 0xf5);
+    owb_read_bytes(sim.owb, samples, sizeof(samples));
+  }
+
+  return sim.info.bus_time_us - start_us;
+}
+
+// the device (index of the sim) reports the states within the change interval and search
+static uint64_t changeLatency(int device, uint8_t inputs) {
+  const char *ident = sim.idents[device].c_str();
+  const auto changed_at = host_rtos_now_us();
+
+  owb_sim_set_inputs(&sim.info, device, inputs);
+
+  const auto want = ~inputs & 0xff;
+  const Broker::Published *msg = nullptr;
+  waitUntil(
+      [&] {
+        msg = lastPublished("status", ident, changed_at);
+        return msg && (statesOf(*msg) == want);
+      },
+      1000);
+
+  CHECK(msg && (statesOf(*msg) == want), "device %d change to %02x not reported", device, want);
+
+  return msg ? (msg->at_us - changed_at) : 0;
+}
+
+static void changes() {
+  uint64_t latency_max = 0, latency_sum = 0;
+  constexpr int count = 20;
+
+  for (int i = 0; i < count; i++) {
+    // a switch closes (the pin is pulled low) part way into an interval
+    vTaskDelay(pdMS_TO_TICKS(37));
+
+    const int device = DS18B20_COUNT + ((i * 7) % DS2408_COUNT);
+    const auto latency = changeLatency(device, (uint8_t) ~(0x01 << (i % 8)));
+
+    latency_max = std::max(latency_max, latency);
+    latency_sum += latency;
+  }
+
+  // the change waits for the next search, then its own search and report
+  CHECK(latency_max < (CHANGE_MS * 1000) + 50000, "change latency %.1fms", latency_max / 1e3);
+
+  printf("%d changes: latency avg %.1fms max %.1fms (change_ms %u)\n", count, latency_sum / 1e3 / count,
+         latency_max / 1e3, CHANGE_MS);
+}
+
+static void idle(uint64_t poll_us) {
+  // nothing changes, with no DS2408 responding the family search ends on a DS18B20
+  const auto start_at = host_rtos_now_us();
+  const auto bus_start_us = sim.info.bus_time_us;
+
+  vTaskDelay(pdMS_TO_TICKS(10000));
+
+  const auto elapsed_us = host_rtos_now_us() - start_at;
+  const auto bus_us = sim.info.bus_time_us - bus_start_us;
+  const auto intervals = elapsed_us / (CHANGE_MS * 1000);
+  const auto search_us = bus_us / intervals;
+
+  CHECK(countPublished("status", start_at) == 0, "%zu unchanged devices reported",
+        countPublished("status", start_at));
+  CHECK(search_us < (poll_us / 4), "conditional search %.2fms, poll %.2fms", search_us / 1e3, poll_us / 1e3);
+
+  printf("idle: conditional search %.2fms of bus per %ums interval (%.1f%% busy), "
+         "polling %d DS2408s %.2fms\n",
+         search_us / 1e3, CHANGE_MS, (bus_us * 100.0) / elapsed_us, DS2408_COUNT, poll_us / 1e3);
+}
+
+static void burst() {
+  // more devices change at once than one search reports, the rest keep their activity latch
+  // set and are found by the following searches.  two pins close, none of the changes above
+  // left a device in this state.
+  constexpr int count = 12;
+  const auto changed_at = host_rtos_now_us();
+
+  for (int i = 0; i < count; i++) owb_sim_set_inputs(&sim.info, DS18B20_COUNT + (i * 3), 0x3f);
+
+  auto all_reported = [&] {
+    for (int i = 0; i < count; i++) {
+      const auto *msg = lastPublished("status", sim.idents[DS18B20_COUNT + (i * 3)].c_str(), changed_at);
+      if (!msg || (statesOf(*msg) != 0xc0)) return false;
+    }
+
+    return true;
+  };
+
+  // at standard speed each search and each report takes about 15ms and 22ms, the first eight
+  // fill about two intervals and the rest follow in the next
+  CHECK(waitUntil(all_reported, 10 * CHANGE_MS), "burst of %d changes not reported", count);
+
+  uint64_t last_us = 0;
+  const auto reports = countPublished("status", changed_at, nullptr, &last_us);
+  CHECK(reports == count, "burst of %d changes reported %zu times", count, reports);
+
+  printf("burst of %d changes: reported in %.1fms\n", count, (last_us - changed_at) / 1e3);
+}
+
+// DS2408s that would respond to a conditional search
+static int conditionalResponders() {
+  int count = 0;
+
+  for (int device = DS18B20_COUNT; device < DEVICE_COUNT; device++) {
+    if (owb_sim_conditional(&sim.info, device)) count++;
+  }
+
+  return count;
+}
+
+static void disabled(ds::Engine::Opts &opts) {
+  // reconfigured in place, changes no longer make the DS2408s respond
+  opts.report.change_ms = 0;
+  ds::Engine::start(opts);
+
+  for (int i = 0; i < 4; i++) owb_sim_set_inputs(&sim.info, DS18B20_COUNT + i, 0x0f);
+  CHECK(conditionalResponders() == 0, "%d DS2408s respond with change detection disabled",
+        conditionalResponders());
+
+  // enabled again, the activity latched while disabled is reset and a later change is reported
+  // by the next search (the full report remains send_ms after the last)
+  opts.report.change_ms = CHANGE_MS;
+  ds::Engine::start(opts);
+  CHECK(conditionalResponders() == 0, "%d DS2408s respond once enabled", conditionalResponders());
+
+  const auto latency = changeLatency(DS18B20_COUNT + 5, 0xf0);
+  CHECK(latency < (CHANGE_MS * 1000) + 50000, "re-enabled change latency %.1fms", latency / 1e3);
+
+  printf("change detection disabled then enabled in place: latency %.1fms\n", latency / 1e3);
+}
+
+static int testMain() {
+  hostStart();
+
+  sim.init(0x00c0d0e00000, DS18B20_COUNT, DS2408_COUNT);
+  const auto poll_us = pollBusTime();
+
+  ds::Engine::Opts opts;
+  opts.bus.owb = sim.owb;
+  opts.report.send_ms = 60000; // only the change detection reports during the test
+  opts.report.change_ms = CHANGE_MS;
+
+  const auto start_at = host_rtos_now_us();
+  ds::Engine::start(opts);
+
+  uint64_t last_us = 0;
+  CHECK(waitUntil([&] { return reportedOn(sim, start_at, last_us) == DEVICE_COUNT; }, 10000),
+        "devices not reported");
+
+  changes();
+  idle(poll_us);
+  burst();
+  disabled(opts);
+
+  ds::Engine::stop(opts.bus.num);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
@@ -0,0 +1,137 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// DS1820::resolution() on simulated DS18B20s: the configured resolution is read without
+// writing, a change is written to the scratchpad (TH / TL preserved) and copied to eeprom so
+// it survives a power cycle, invalid resolutions are refused.  then the engine applies the
+// resolutions of a profile (default and by ident) as devices are discovered.
+
+#include <cstdint>
+#include <cstdio>
+
+#include "dev_ds/ds1820.hpp"
+#include "engine_host.hpp"
+
+static constexpr int DS18B20_COUNT = 4;
+
+static SimBus sim;
+
+// transactions (a reset before and after each) since the resets given
+static uint32_t transactionsSince(uint32_t resets) { return (sim.info.resets - resets) / 2; }
+
+// the scratchpad of a device read directly from the simulated bus
+static void scratchpad(int device, uint8_t *data) {
+  OneWireBus_ROMCode rom;
+  bool present = false;
+
+  owb_sim_rom_code(&sim.info, device, &rom);
+
+  owb_reset(sim.owb, &present);
+  owb_write_byte(sim.owb, OWB_ROM_MATCH);
+  owb_write_rom_code(sim.owb, rom);
+  owb_write_byte(sim.owb, 0xbe);
+  owb_read_bytes(sim.owb, data, 9);
+  owb_reset(sim.owb, &present);
+}
+
+static void direct() {
+  ds::Bus bus(0, 0, 1000);
+  bus.ensure(sim.owb);
+
+  OneWireBus_ROMCode rom;
+  owb_sim_rom_code(&sim.info, 0, &rom);
+  ds::DS1820 ds1820(&bus, rom.bytes);
+
+  // zero and the configured resolution only read the scratchpad
+  auto resets = sim.info.resets;
+  CHECK(ds1820.resolution(0) && (ds1820.resolution() == 12), "read resolution %u", ds1820.resolution());
+  CHECK(ds1820.resolution(12), "resolution 12 (as is)");
+  CHECK(transactionsSince(resets) == 2, "as is transactions %u", transactionsSince(resets));
+
+  // read, write, confirm then copy to eeprom
+  resets = sim.info.resets;
+  CHECK(ds1820.resolution(9) && (ds1820.resolution() == 9), "resolution 9 is %u", ds1820.resolution());
+  CHECK(transactionsSince(resets) == 4, "change transactions %u", transactionsSince(resets));
+  CHECK(ds1820.convertMicros() == 93750, "9-bit convert %uus", ds1820.convertMicros());
+
+  uint8_t data[9];
+  scratchpad(0, data);
+  CHECK((data[2] == 0x4b) && (data[3] == 0x46), "th / tl %02x %02x", data[2], data[3]);
+  CHECK(data[4] == 0x1f, "config %02x", data[4]);
+
+  // the eeprom copy is recalled at power on
+  owb_sim_set_present(&sim.info, 0, false);
+  owb_sim_set_present(&sim.info, 0, true);
+  scratchpad(0, data);
+  CHECK(data[4] == 0x1f, "config after power cycle %02x", data[4]);
+
+  // refused without writing
+  resets = sim.info.resets;
+  CHECK(ds1820.resolution(13) == false, "resolution 13 accepted");
+  CHECK(ds1820.resolution(8) == false, "resolution 8 accepted");
+  CHECK(transactionsSince(resets) == 2, "invalid transactions %u", transactionsSince(resets));
+  CHECK(ds1820.resolution() == 9, "resolution after invalid %u", ds1820.resolution());
+
+  CHECK(ds1820.resolution(12) && (ds1820.resolution() == 12), "resolution 12 is %u", ds1820.resolution());
+}
+
+static void engine() {
+  StaticJsonDocument<256> profile;
+  profile["default"] = 10;
+  profile[sim.idents[2]] = 11;
+
+  ds::Engine::Opts opts;
+  opts.bus.owb = sim.owb;
+  opts.report.send_ms = 60000;
+  opts.resolution = profile.as<JsonObjectConst>();
+
+  const auto start_at = host_rtos_now_us();
+  ds::Engine::start(opts);
+
+  uint64_t last_us = 0;
+  CHECK(waitUntil([&] { return reportedOn(sim, start_at, last_us) == DS18B20_COUNT; }, 10000),
+        "devices not reported");
+
+  ds::Engine::stop(opts.bus.num);
+
+  for (int i = 0; i < DS18B20_COUNT; i++) {
+    uint8_t data[9];
+    scratchpad(i, data);
+
+    const int bits = 9 + ((data[4] >> 5) & 0x03);
+    const int want = (i == 2) ? 11 : 10;
+    CHECK(bits == want, "device %d resolution %d", i, bits);
+  }
+}
+
+static int testMain() {
+  hostStart();
+
+  sim.init(0x00f0a0b00000, DS18B20_COUNT, 0);
+
+  direct();
+  engine();
+
+  printf("resolution: read, change and eeprom copy on %d devices\n", DS18B20_COUNT);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
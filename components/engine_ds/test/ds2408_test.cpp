@@ -0,0 +1,108 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// DS2408 commands (DS2408::setPin) through the engine on the simulated bus: the 1-Wire
+// transactions (resets) and bus time of each command.  the first command reads the output
+// latch, the rest write from the cached latch.  a pin pulled low by its load is left off.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+#include "engine_host.hpp"
+
+static constexpr int DS2408_COUNT = 4;
+
+static SimBus sim;
+
+struct Cost {
+  uint32_t transactions;
+  uint64_t bus_us;
+};
+
+static Cost command(int device, const char *refid, uint8_t pin, const char *cmd) {
+  const auto resets = sim.info.resets;
+  const auto bus_us = sim.info.bus_time_us;
+
+  CHECK(commandLatency(sim.idents[device].c_str(), refid, pin, cmd) > 0, "command %s not acked", refid);
+
+  // a transaction begins and ends with a reset (Bus::writeThenRead)
+  return Cost{(sim.info.resets - resets) / 2, sim.info.bus_time_us - bus_us};
+}
+
+static void transactions() {
+  // no command yet, the reports are channel access reads of the pins and not the latch
+  const auto first = command(0, "first", 0, "on");
+  CHECK(first.transactions == 2, "first command %u transactions", first.transactions);
+
+  Cost most{};
+  for (int i = 0; i < 16; i++) {
+    char refid[16];
+    snprintf(refid, sizeof(refid), "cmd%d", i);
+
+    const auto cost = command(0, refid, i % 8, (i < 8) ? "on" : "off");
+    most.transactions = std::max(most.transactions, cost.transactions);
+    most.bus_us = std::max(most.bus_us, cost.bus_us);
+  }
+
+  CHECK(most.transactions == 1, "cached command %u transactions", most.transactions);
+  CHECK(owb_sim_outputs(&sim.info, 0) == 0xff, "outputs %02x", owb_sim_outputs(&sim.info, 0));
+
+  printf("command transactions: first %u (bus %.2fms), cached %u (bus %.2fms)\n", first.transactions,
+         first.bus_us / 1e3, most.transactions, most.bus_us / 1e3);
+}
+
+static void loadHeldLow() {
+  // pin 2 is held low by its load while its latch is off, it senses as on.  turning pin 5 on
+  // must leave the latch of pin 2 off.
+  owb_sim_set_inputs(&sim.info, 1, 0xfb);
+
+  command(1, "held", 5, "on");
+  CHECK(owb_sim_outputs(&sim.info, 1) == 0xdf, "outputs %02x", owb_sim_outputs(&sim.info, 1));
+
+  command(1, "held-off", 5, "off");
+  CHECK(owb_sim_outputs(&sim.info, 1) == 0xff, "outputs %02x", owb_sim_outputs(&sim.info, 1));
+}
+
+static int testMain() {
+  hostStart();
+
+  sim.init(0x00e0f0a00000, 0, DS2408_COUNT);
+
+  ds::Engine::Opts opts;
+  opts.bus.owb = sim.owb;
+  opts.report.send_ms = 60000; // the bus is idle between commands
+
+  const auto start_at = host_rtos_now_us();
+  ds::Engine::start(opts);
+
+  uint64_t last_us = 0;
+  CHECK(waitUntil([&] { return reportedOn(sim, start_at, last_us) == DS2408_COUNT; }, 10000),
+        "devices not reported");
+
+  transactions();
+  loadHeldLow();
+
+  ds::Engine::stop(opts.bus.num);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
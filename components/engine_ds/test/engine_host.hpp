@@ -0,0 +1,204 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// shared by the engine host tests: simulated buses of devices, the messages the engines
+// publish (captured by the host broker) and commands delivered through it.  each test is
+// a single translation unit.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#include "ArduinoJson.h"
+#include "engine_ds/ds.hpp"
+#include "filter/filter.hpp"
+#include "host_broker.hpp"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "owb/owb_sim.h"
+#include "ruth_mqtt/mqtt.hpp"
+
+using host::Broker;
+
+// filter and mqtt as ruth::Core sets them up, the broker accepts the connection
+inline void hostStart() {
+  static filter::Opts filter_opts{"ruth", "host", "host"};
+  filter::Filter::init(filter_opts);
+
+  ruth::MQTT::ConnOpts conn_opts{"host", "mqtt://broker", "user", "passwd", xTaskGetCurrentTaskHandle()};
+  ruth::MQTT::initAndStart(conn_opts);
+}
+
+// polls (each tick) until done() or timeout_ms passes, returns done()
+template <typename Done> bool waitUntil(Done done, uint32_t timeout_ms) {
+  const auto until_us = host_rtos_now_us() + (timeout_ms * 1000ULL);
+
+  while (!done() && (host_rtos_now_us() < until_us)) vTaskDelay(1);
+
+  return done();
+}
+
+// Bus::ensure() is always given the simulated bus
+OneWireBus *owb_rmt_initialize(owb_rmt_driver_info *, uint8_t, rmt_channel_t, rmt_channel_t) {
+  return nullptr;
+}
+
+struct SimBus {
+  owb_sim_driver_info info = {};
+  OneWireBus *owb = nullptr;
+  std::vector<std::string> idents; // the DS18B20s then the DS2408s
+
+  void init(uint64_t serial_base, int ds18b20s, int ds2408s) {
+    info.clock_us = host_rtos_now_us;
+    info.busy_us = host_rtos_wait_us;
+    owb = owb_sim_initialize(&info);
+    owb_use_crc(owb, true);
+
+    for (int i = 0; i < (ds18b20s + ds2408s); i++) {
+      const uint64_t serial = serial_base + (i * 0x10001);
+      const auto device = (i < ds18b20s) ? owb_sim_add_ds18b20(&info, serial, celsiusOf(i), false)
+                                         : owb_sim_add_ds2408(&info, serial);
+
+      OneWireBus_ROMCode rom;
+      owb_sim_rom_code(&info, device, &rom);
+
+      char ident[18];
+      char *p = ident + sprintf(ident, "ds.");
+      for (int b = 0; b < 7; b++) p += sprintf(p, "%02x", rom.bytes[b]);
+
+      idents.emplace_back(ident);
+    }
+  }
+
+  static float celsiusOf(int device) { return 18.0f + (device * 0.0625f); }
+};
+
+inline uint64_t mtimeNow() {
+  struct timeval now {};
+  gettimeofday(&now, nullptr);
+
+  return ((uint64_t)now.tv_sec * 1000) + (now.tv_usec / 1000);
+}
+
+// published messages of a kind (e.g. "celsius") since at_us, optionally for one ident
+inline size_t countPublished(const char *kind, uint64_t since_us, const char *ident = nullptr,
+                             uint64_t *last_us = nullptr) {
+  const std::string level = std::string("/") + kind + "/";
+  size_t count = 0;
+
+  for (const auto &msg : Broker::published) {
+    if (msg.at_us < since_us) continue;
+    if (msg.topic.find(level) == std::string::npos) continue;
+    if (ident && (msg.topic.find(ident) == std::string::npos)) continue;
+
+    count++;
+    if (last_us) *last_us = msg.at_us;
+  }
+
+  return count;
+}
+
+// first message of a kind at or after since_us, zero when none
+inline uint64_t firstPublished(const char *kind, uint64_t since_us) {
+  const std::string level = std::string("/") + kind + "/";
+
+  for (const auto &msg : Broker::published) {
+    if ((msg.at_us >= since_us) && (msg.topic.find(level) != std::string::npos)) return msg.at_us;
+  }
+
+  return 0;
+}
+
+inline void sendCommand(const char *ident, const char *refid, uint8_t pin, const char *cmd) {
+  StaticJsonDocument<128> doc;
+  doc["mtime"] = mtimeNow();
+  doc["cmd"] = cmd;
+  doc["pin"] = pin;
+  doc["ack"] = true;
+
+  std::string packed;
+  serializeMsgPack(doc, packed);
+
+  Broker::deliver(std::string("ruth/c2/host/ds/") + ident + "/" + refid, packed);
+}
+
+// virtual time from the command to its ack, zero when no ack within a second
+inline uint64_t commandLatency(const char *ident, const char *refid, uint8_t pin, const char *cmd) {
+  const auto sent_at = host_rtos_now_us();
+  sendCommand(ident, refid, pin, cmd);
+
+  for (int i = 0; i < 500; i++) {
+    uint64_t ack_at = 0;
+    if (countPublished("cmdack", sent_at, refid, &ack_at)) return ack_at - sent_at;
+
+    vTaskDelay(1);
+  }
+
+  return 0;
+}
+
+// the pins reported on by a states message as a mask, -1 when the message is not ok
+inline int statesOf(const Broker::Published &msg) {
+  if (msg.topic.find("/ok") == std::string::npos) return -1;
+
+  StaticJsonDocument<1024> doc; // eight pins, each a nested array
+  deserializeMsgPack(doc, msg.data);
+
+  int states = 0;
+  for (JsonArrayConst pin : doc["pins"].as<JsonArrayConst>()) {
+    if (strcmp(pin[1] | "", "on") == 0) states |= 0x01 << (pin[0] | 0);
+  }
+
+  return states;
+}
+
+// the last message of a kind for the ident at or after since_us, nullptr when none
+inline const Broker::Published *lastPublished(const char *kind, const char *ident, uint64_t since_us) {
+  const std::string level = std::string("/") + kind + "/" + ident;
+  const Broker::Published *last = nullptr;
+
+  for (const auto &msg : Broker::published) {
+    if ((msg.at_us >= since_us) && (msg.topic.find(level) != std::string::npos)) last = &msg;
+  }
+
+  return last;
+}
+
+// devices of the bus reporting at or after since_us, the time of the last report in last_us
+inline size_t reportedOn(const SimBus &bus, uint64_t since_us, uint64_t &last_us) {
+  size_t count = 0;
+
+  for (const auto &ident : bus.idents) {
+    uint64_t at_us = 0;
+    if (countPublished("celsius", since_us, ident.c_str(), &at_us) ||
+        countPublished("status", since_us, ident.c_str(), &at_us)) {
+      count++;
+      last_us = std::max(last_us, at_us);
+    }
+  }
+
+  return count;
+}
@@ -0,0 +1,182 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// the ds engine (report and command tasks, dev_ds devices and bus) on the simulated 1-Wire
+// bus with hundreds of devices: discovery, a full report cycle and command latency, idle
+// and while a report is in progress.  then the devices split across two buses, each with
+// its own engine, report in parallel.  times are the virtual time of the host runtime, the
+// simulated slots wait on the bus (like rmt_write_items) so the other tasks run meanwhile.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "engine_host.hpp"
+
+static constexpr int DS18B20_COUNT = 200;
+static constexpr int DS2408_COUNT = 100;
+static constexpr int DEVICE_COUNT = DS18B20_COUNT + DS2408_COUNT;
+
+static SimBus sim;
+
+// returns the time from start to the last device reported
+static uint64_t discoverAndReport(const ds::Engine::Opts &opts) {
+  const auto start_at = host_rtos_now_us();
+  const auto host_start = host_test_ns();
+
+  ds::Engine::start(opts);
+
+  // discover then report every device, the first BusStats message ends the discover
+  uint64_t celsius_at = 0, states_at = 0;
+  size_t celsius = 0, states = 0;
+  for (auto waited_ms = 0; waited_ms < 60000; waited_ms += 10) {
+    celsius = countPublished("celsius", start_at, nullptr, &celsius_at);
+    states = countPublished("status", start_at, nullptr, &states_at);
+    if ((celsius >= DS18B20_COUNT) && (states >= DS2408_COUNT)) break;
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+
+  const auto host_ms = (host_test_ns() - host_start) / 1e6;
+  const auto discovered_at = firstPublished("bus", start_at);
+  CHECK(discovered_at > 0, "no discover");
+
+  CHECK(celsius == DS18B20_COUNT, "celsius reports %zu", celsius);
+  CHECK(states == DS2408_COUNT, "states reports %zu", states);
+  CHECK(countPublished("error", start_at) == 0, "error reports");
+
+  // each DS18B20 reported the temperature of its simulated device
+  size_t matched = 0;
+  for (const auto &msg : Broker::published) {
+    if ((msg.at_us < start_at) || (msg.topic.find("/celsius/") == std::string::npos)) continue;
+
+    StaticJsonDocument<256> doc;
+    deserializeMsgPack(doc, msg.data);
+
+    for (int i = 0; i < DS18B20_COUNT; i++) {
+      if (msg.topic.find(sim.idents[i]) == std::string::npos) continue;
+      if (std::fabs((doc["val"] | 0.0f) - SimBus::celsiusOf(i)) < 0.01f) matched++;
+    }
+  }
+
+  CHECK(matched == DS18B20_COUNT, "celsius values matched %zu", matched);
+
+  const auto report_end = std::max(celsius_at, states_at);
+  printf("discover %d devices: %.1fms, report cycle: %.1fms (bus %.1fms), host %.1fms\n", DEVICE_COUNT,
+         (discovered_at - start_at) / 1e3, (report_end - discovered_at) / 1e3, sim.info.bus_time_us / 1e3,
+         host_ms);
+
+  return report_end - start_at;
+}
+
+static void commands() {
+  const char *ident = sim.idents[DS18B20_COUNT + 7].c_str();
+  char refid[16];
+
+  // idle, the report task is waiting out the send interval
+  uint64_t idle_max = 0;
+  for (int i = 0; i < 8; i++) {
+    snprintf(refid, sizeof(refid), "idle%d", i);
+    const auto latency = commandLatency(ident, refid, i, (i % 2) ? "on" : "off");
+
+    CHECK(latency > 0, "idle command %d not acked", i);
+    idle_max = std::max(idle_max, latency);
+  }
+
+  CHECK(owb_sim_outputs(&sim.info, DS18B20_COUNT + 7) == 0x55, "outputs %02x",
+        owb_sim_outputs(&sim.info, DS18B20_COUNT + 7));
+
+  // while reporting, wait for the next report cycle to begin then command mid cycle
+  const auto cycle_at = host_rtos_now_us();
+  while (countPublished("celsius", cycle_at) < (DS18B20_COUNT / 2)) vTaskDelay(1);
+
+  const auto latency = commandLatency(ident, "busy", 0, "on");
+  CHECK(latency > 0, "command during report not acked");
+
+  // the report task yields the bus between devices, the command waits at most one device report
+  // (the longest, a DS2408 channel access read at standard speed, is about 26ms)
+  CHECK(latency < (idle_max + 30000), "command during report waited %.1fms", latency / 1e3);
+
+  printf("command latency: idle max %.2fms, during report %.2fms\n", idle_max / 1e3, latency / 1e3);
+}
+
+// the devices split across two buses, each engine discovers and reports its bus while the
+// other does.  single_us is the time one bus took for all the devices.
+static void parallelBuses(uint64_t single_us) {
+  static SimBus buses[2];
+  ds::Engine::Opts opts[2];
+
+  for (int i = 0; i < 2; i++) {
+    buses[i].init(0x00d0e0f00000 + (i * 0x100000), DS18B20_COUNT / 2, DS2408_COUNT / 2);
+
+    opts[i].bus.num = i + 1;
+    opts[i].bus.owb = buses[i].owb;
+    opts[i].report.send_ms = 30000;
+  }
+
+  const auto start_at = host_rtos_now_us();
+  for (auto &o : opts) ds::Engine::start(o);
+
+  uint64_t last_us[2] = {};
+  size_t reported[2] = {};
+  for (auto waited_ms = 0; waited_ms < 60000; waited_ms += 10) {
+    for (int i = 0; i < 2; i++) reported[i] = reportedOn(buses[i], start_at, last_us[i]);
+    if ((reported[0] == buses[0].idents.size()) && (reported[1] == buses[1].idents.size())) break;
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+
+  for (int i = 0; i < 2; i++) {
+    CHECK(reported[i] == buses[i].idents.size(), "bus %d reported %zu devices", i + 1, reported[i]);
+  }
+
+  // the buses overlap, the slowest takes about half the time of one bus with every device
+  const auto parallel_us = std::max(last_us[0], last_us[1]) - start_at;
+  CHECK(parallel_us < (single_us * 6 / 10), "two buses took %.1fms", parallel_us / 1e3);
+
+  printf("two buses of %d devices: discover and report %.1fms (bus1 %.1fms, bus2 %.1fms), one bus %.1fms\n",
+         DEVICE_COUNT / 2, parallel_us / 1e3, (last_us[0] - start_at) / 1e3, (last_us[1] - start_at) / 1e3,
+         single_us / 1e3);
+
+  for (auto &o : opts) ds::Engine::stop(o.bus.num);
+}
+
+static int testMain() {
+  hostStart();
+
+  sim.init(0x00a0b0c00000, DS18B20_COUNT, DS2408_COUNT);
+
+  ds::Engine::Opts opts;
+  opts.bus.owb = sim.owb; // the registry grows from the default capacity as devices are found
+  opts.report.send_ms = 30000; // at standard speed a cycle of this many devices takes seconds
+
+  const auto single_us = discoverAndReport(opts);
+  commands();
+
+  ds::Engine::stop(opts.bus.num);
+
+  parallelBuses(single_us);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
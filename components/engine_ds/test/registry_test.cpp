@@ -0,0 +1,274 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// exercises the registry (insert, growth, find, age, remove and removed slot reuse) with
+// hundreds of rom codes then times lookups against the linear scans the registry replaced.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "engine_ds/registry.hpp"
+#include "host_test.h"
+
+using namespace ds;
+
+struct Rom {
+  uint8_t bytes[8];
+};
+
+// serial numbers are sequential within a production lot, the worst case for a weak hash
+static Rom makeRom(uint32_t serial, uint8_t family = 0x28) {
+  Rom rom = {};
+  rom.bytes[0] = family;
+  for (size_t i = 1; i < 7; i++, serial >>= 8) rom.bytes[i] = serial & 0xff;
+
+  return rom;
+}
+
+static size_t iterated(Registry &registry) {
+  size_t idx;
+  size_t count = 0;
+  for (auto *device = registry.first(idx); device; device = registry.next(idx)) count++;
+
+  return count;
+}
+
+static void addAndFind() {
+  constexpr size_t count = 300;
+  Registry registry(count, 3);
+
+  for (uint32_t i = 0; i < count; i++) {
+    auto rom = makeRom(0x1000 + i, (i % 2) ? 0x29 : 0x28);
+    registry.add(new Device(rom.bytes));
+  }
+
+  CHECK(registry.count() == count, "count %zu", registry.count());
+  CHECK(registry.capacity() == count, "capacity %zu", registry.capacity());
+  CHECK(iterated(registry) == count, "iterated %zu", iterated(registry));
+
+  for (uint32_t i = 0; i < count; i++) {
+    auto rom = makeRom(0x1000 + i, (i % 2) ? 0x29 : 0x28);
+    auto *device = registry.find(rom.bytes);
+
+    CHECK(device && (memcmp(device->addr(), rom.bytes, 7) == 0), "find by rom %u", i);
+    CHECK(device && (registry.find(device->ident()) == device), "find by ident %u", i);
+  }
+
+  auto rom = makeRom(0xffff);
+  CHECK(registry.find(rom.bytes) == nullptr, "found a device never added");
+
+  // idents that are not ds rom codes
+  const char *not_idents[] = {nullptr, "", "ds.", "ds.2800100000000", "ds.28001000000000x",
+                              "ds.280010000000000", "ds.28001000000000 ", "pwm.1", "DS.28001000000000"};
+  for (auto *ident : not_idents) {
+    CHECK(registry.find(ident) == nullptr, "found ident [%s]", ident ? ident : "null");
+  }
+}
+
+static void grow() {
+  // a registry sized for a few devices discovers hundreds, each growth rehashes the devices
+  // known (and skips the removed slots) into a table twice the size
+  constexpr size_t count = 300;
+  Registry registry(4, 1);
+
+  // every fifth device is missing from the discover that follows the one adding it so the
+  // tables grown have removed slots
+  auto discover = [&registry](uint32_t added) {
+    for (uint32_t j = 0; j < added; j++) {
+      if ((j % 5) != 2) registry.seen(makeRom(0x2000 + j).bytes);
+    }
+
+    registry.age();
+  };
+
+  for (uint32_t i = 0; i < count; i++) {
+    registry.add(new Device(makeRom(0x2000 + i).bytes));
+
+    if ((i % 5) == 4) discover(i + 1);
+  }
+
+  discover(count);
+
+  const size_t expected = count - (count / 5);
+  CHECK(registry.count() == expected, "count after growth %zu", registry.count());
+  CHECK(registry.capacity() == 256, "capacity after growth %zu", registry.capacity());
+  CHECK(iterated(registry) == expected, "iterated after growth %zu", iterated(registry));
+
+  size_t found = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const auto *device = registry.find(makeRom(0x2000 + i).bytes);
+
+    CHECK((device != nullptr) == ((i % 5) != 2), "serial %u present[%d]", i, device != nullptr);
+    found += (device && (registry.find(device->ident()) == device));
+  }
+
+  CHECK(found == expected, "found by ident after growth %zu", found);
+}
+
+static void ageAndEvict() {
+  constexpr size_t count = 200;
+  constexpr uint32_t evict_after = 3;
+  Registry registry(count, evict_after);
+
+  for (uint32_t i = 0; i < count; i++) registry.add(new Device(makeRom(i + 1).bytes));
+
+  // added devices are seen in the cycle they were added
+  CHECK(registry.age() == 0, "evicted devices just added");
+
+  const auto deleted_at = Device::deleted;
+
+  // only the even serials are found by the following discovers
+  for (uint32_t cycle = 1; cycle <= evict_after; cycle++) {
+    for (uint32_t i = 0; i < count; i += 2) registry.seen(makeRom(i + 1).bytes);
+
+    const auto evicted = registry.age();
+    CHECK(evicted == ((cycle == evict_after) ? count / 2 : 0), "cycle %u evicted %zu", cycle, evicted);
+  }
+
+  CHECK(Device::deleted - deleted_at == count / 2, "deleted %zu", Device::deleted - deleted_at);
+  CHECK(registry.count() == count / 2, "count after evict %zu", registry.count());
+  CHECK(iterated(registry) == count / 2, "iterated after evict %zu", iterated(registry));
+
+  for (uint32_t i = 0; i < count; i++) {
+    const bool present = registry.find(makeRom(i + 1).bytes) != nullptr;
+    CHECK(present == ((i % 2) == 0), "serial %u present[%d]", i + 1, present);
+  }
+}
+
+static void churn() {
+  // sensors are swapped continuously, removed slots are reused and probe sequences that pass
+  // through them still find the devices beyond
+  constexpr size_t capacity = 64;
+  Registry registry(capacity, 1);
+  uint32_t next_serial = 1;
+  std::vector<uint32_t> live;
+
+  for (int cycle = 0; cycle < 500; cycle++) {
+    // as discover does: known devices are seen, new devices added to keep the bus at
+    // capacity then the registry is aged.  a quarter of the devices are replaced each cycle.
+    std::vector<uint32_t> kept;
+    for (size_t i = 0; i < live.size(); i++) {
+      if (((i + cycle) % 4) != 0) {
+        registry.seen(makeRom(live[i]).bytes);
+        kept.push_back(live[i]);
+      }
+    }
+
+    while (registry.count() < capacity) {
+      registry.add(new Device(makeRom(next_serial).bytes));
+      kept.push_back(next_serial++);
+    }
+
+    registry.age();
+    live = kept;
+
+    if (registry.count() != live.size()) {
+      CHECK(false, "cycle %d count %zu live %zu", cycle, registry.count(), live.size());
+      return;
+    }
+
+    for (auto serial : live) {
+      if (registry.find(makeRom(serial).bytes) == nullptr) {
+        CHECK(false, "cycle %d lost serial %u", cycle, serial);
+        return;
+      }
+    }
+
+    CHECK(registry.find(makeRom(next_serial + 1).bytes) == nullptr, "cycle %d found unknown", cycle);
+  }
+}
+
+static void benchmark() {
+  // the linear arrays the registry replaced: memcmp by rom code, strncmp by ident
+  constexpr size_t count = 500;
+  constexpr size_t rounds = 200;
+  Registry registry(count, 5);
+  std::vector<Device *> linear;
+  std::vector<Rom> roms;
+
+  for (uint32_t i = 0; i < count; i++) {
+    roms.push_back(makeRom(0x4000 + i));
+    auto *device = new Device(roms.back().bytes);
+    registry.add(device);
+    linear.push_back(device);
+  }
+
+  using clock = std::chrono::steady_clock;
+  auto ns = [](clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count() / (count * rounds);
+  };
+
+  size_t found = 0;
+  auto start = clock::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (const auto &rom : roms) found += registry.find(rom.bytes) != nullptr;
+  }
+  const auto hashed_rom = ns(start);
+
+  start = clock::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (const auto *device : linear) found += registry.find(device->ident()) != nullptr;
+  }
+  const auto hashed_ident = ns(start);
+
+  start = clock::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (const auto &rom : roms) {
+      for (const auto *device : linear) {
+        if (memcmp(device->addr(), rom.bytes, 8) == 0) {
+          found++;
+          break;
+        }
+      }
+    }
+  }
+  const auto linear_rom = ns(start);
+
+  start = clock::now();
+  for (size_t r = 0; r < rounds; r++) {
+    for (const auto *want : linear) {
+      for (const auto *device : linear) {
+        if (strncmp(device->ident(), want->ident(), 18) == 0) {
+          found++;
+          break;
+        }
+      }
+    }
+  }
+  const auto linear_ident = ns(start);
+
+  CHECK(found == (count * rounds * 4), "benchmark found %zu", found);
+
+  printf("%zu devices, ns/lookup rom hashed[%.1f] linear[%.1f] ident hashed[%.1f] linear[%.1f]\n", count,
+         hashed_rom, linear_rom, hashed_ident, linear_ident);
+}
+
+int main() {
+  addAndFind();
+  grow();
+  ageAndEvict();
+  churn();
+  benchmark();
+
+  return host_test_result();
+}
@@ -0,0 +1,58 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef ruth_dev_ds_hpp
+#define ruth_dev_ds_hpp
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace ds {
+
+// host stand in for the Device the registry holds, only the members the registry uses.
+// the ident is made as Device::makeID does (ds. then the family and serial in hex).
+class Device {
+public:
+  Device(const uint8_t *rom_code) {
+    memcpy(_addr, rom_code, sizeof(_addr));
+
+    auto *p = _ident + snprintf(_ident, sizeof(_ident), "ds.");
+    for (size_t i = 0; i < (sizeof(_addr) - 1); i++) p += snprintf(p, 3, "%02x", _addr[i]);
+  }
+
+  virtual ~Device() { deleted++; }
+
+  const uint8_t *addr() const { return _addr; }
+  const char *ident() const { return _ident; }
+  uint32_t updateSeenTimestamp() { return ++seen; }
+
+public:
+  uint32_t seen = 0;
+  static inline size_t deleted = 0;
+
+private:
+  uint8_t _addr[8];
+  char _ident[18];
+};
+
+} // namespace ds
+
+#endif
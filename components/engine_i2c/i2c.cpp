@@ -18,12 +18,16 @@
       https://www.wisslanding.com
   */
 
+#include <cstring>
+
+#include <driver/gpio.h>
 #include <esp_log.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
 #include "dev_i2c/i2c.hpp"
 #include "dev_i2c/mcp23008.hpp"
+#include "dev_i2c/pca9685.hpp"
 #include "dev_i2c/sht31.hpp"
 #include "engine_i2c/i2c.hpp"
 #include "ruth_mqtt/mqtt.hpp"
@@ -33,16 +37,40 @@ using namespace ruth;
 
 static const char *TAG_RPT = "i2c:report";
 static const char *TAG_CMD = "i2c:cmd";
-static const uint8_t discover_addresses[] = {0x44, 0x20};
+static const char *TAG_INT = "i2c:int";
 static Engine *_instance_ = nullptr;
 static TickType_t last_wake;
+DRAM_ATTR static gpio_num_t int_pin = GPIO_NUM_NC;
+
+static Device *makeMCP23008(uint8_t addr, uint8_t channel, const Engine::Opts &opts) {
+  return new MCP23008(addr, channel, opts.mcp23008);
+}
+
+static Device *makePCA9685(uint8_t addr, uint8_t channel, const Engine::Opts &opts) {
+  return new PCA9685(addr, channel, opts.pca9685);
+}
+
+static Device *makeSHT31(uint8_t addr, uint8_t channel, const Engine::Opts &opts) {
+  return new SHT31(addr, channel, opts.sht31);
+}
+
+// addresses each supported device may be configured for.  the SHT31 addresses are within the
+// PCA9685 range so an ACK alone doesn't tell them apart, the first candidate to confirm the
+// device's identity makes it (the PCA9685 check only reads, the SHT31 check writes a command).
+static const struct {
+  uint8_t first;
+  uint8_t last;
+  Device *(*make)(uint8_t addr, uint8_t channel, const Engine::Opts &opts);
+  bool (*identify)(uint8_t addr, uint8_t channel); // nullptr, the ACK is enough
+} candidates[] = {{0x40, 0x47, makePCA9685, PCA9685::identify},
+                  {0x44, 0x45, makeSHT31, SHT31::identify},
+                  {0x20, 0x27, makeMCP23008, nullptr}};
 
 Engine::Engine(const Opts &opts) : Handler("i2c", max_queue_depth), _opts(opts) {
   Device::setUniqueId(opts.unique_id);
 
-  // create the devices we support
-  _devices[0] = new MCP23008();
-  _devices[1] = new SHT31();
+  _wake = xSemaphoreCreateBinary();
+  _ended = xSemaphoreCreateCounting(Tasks::INTERRUPT + 1, 0);
 }
 
 IRAM_ATTR void Engine::command(void *task_data) {
@@ -51,56 +79,247 @@ IRAM_ATTR void Engine::command(void *task_data) {
   i2c->notifyThisTask(Notifies::QUEUED_MSG);
   MQTT::registerHandler(i2c);
 
-  for (;;) {
+  while (i2c->_stopping == false) {
     UBaseType_t notify_val;
     auto msg = i2c->waitForNotifyOrMessage(&notify_val);
 
     if (msg) {
-      // only look at mutable devices. since we only support mcp23008
-      // the first mutable found is the one we want.
-      for (auto i = 0; i < device_count; i++) {
+      auto device = i2c->findDevice(msg->identFromFilter());
+
+      if (device && device->isMutable()) device->execute(std::move(msg));
+    }
+  }
+
+  MQTT::unregisterHandler(i2c);
+
+  i2c->_tasks[COMMAND] = nullptr;
+  xSemaphoreGive(i2c->_ended);
+  vTaskDelete(nullptr);
+}
+
+IRAM_ATTR void Engine::discover(const uint32_t loops_per_discover) {
+  // don't discover until enough loops have passed.
+  // using a countdown we are assured the first call will always perform a discover.
+  if (_discover_countdown == 0) {
+    _discover_countdown = loops_per_discover;
+  } else {
+    _discover_countdown--;
+    return;
+  }
+
+  // known devices are the cached scan, only those that failed to report are probed again
+  for (size_t i = 0; i < _device_count; i++) {
+    auto device = _devices[i];
+
+    if (device->missing() && Device::probe(device->addr(), device->channel())) device->missing(false);
+  }
+
+  if (_opts.mplex && !_mplex_found) {
+    _mplex_found = Device::mplexEnable();
+    ESP_LOGI(TAG_RPT, "multiplexer %s", _mplex_found ? "found" : "not found");
+  }
+
+  discoverChannel(Device::NO_CHANNEL);
+
+  if (_mplex_found) {
+    for (uint8_t channel = 0; channel < Device::mplex_channels; channel++) discoverChannel(channel);
+  }
+}
+
+void Engine::discoverChannel(uint8_t channel) {
+  for (const auto &candidate : candidates) {
+    for (uint8_t addr = candidate.first; addr <= candidate.last; addr++) {
+      // devices not behind the multiplexer also answer when a channel is selected
+      if (known(addr, channel) || known(addr, Device::NO_CHANNEL)) continue;
+
+      if (Device::probe(addr, channel) == false) continue;
+      if (candidate.identify && (candidate.identify(addr, channel) == false)) continue;
+
+      if (_device_count == max_devices) {
+        ESP_LOGW(TAG_RPT, "max devices[%u] reached, ignoring addr[0x%02x]", max_devices, addr);
+        return;
+      }
+
+      _devices[_device_count] = candidate.make(addr, channel, _opts);
+      _device_count++; // publish to the command task once constructed
+
+      ESP_LOGI(TAG_RPT, "discovered %s", _devices[_device_count - 1]->ident());
+    }
+  }
+}
+
+IRAM_ATTR Device *Engine::findDevice(const char *ident) {
+  if (ident == nullptr) return nullptr;
+
+  for (size_t i = 0; i < _device_count; i++) {
+    auto device = _devices[i];
+
+    if (strncmp(device->ident(), ident, Device::identMaxLen()) == 0) return device;
+  }
+
+  return nullptr;
+}
+
+IRAM_ATTR static void interruptISR(void *task) {
+  BaseType_t woken = pdFALSE;
+
+  // INT is level triggered, disabled until the interrupt task has serviced the devices
+  gpio_intr_disable(int_pin);
+  vTaskNotifyGiveFromISR((TaskHandle_t)task, &woken);
+
+  if (woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+IRAM_ATTR void Engine::interrupt(void *data) {
+  Engine *i2c = (Engine *)data;
+  const auto pin = (gpio_num_t)i2c->_opts.mcp23008.int_pin;
+  constexpr size_t max_passes = 4;
+  constexpr TickType_t asserted_backoff = pdMS_TO_TICKS(100);
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    if (i2c->_stopping) break;
+
+    // INT is shared (open drain), ask every device until the line is released
+    for (size_t pass = 0; pass < max_passes; pass++) {
+      for (size_t i = 0; i < i2c->_device_count; i++) {
         auto device = i2c->devices(i);
 
-        if (device->isMutable()) {
-          device->execute(std::move(msg));
-          break;
-        }
+        if (!device->missing()) device->reportChange();
       }
+
+      if (gpio_get_level(pin) == 1) break;
+    }
+
+    // a line still asserted (e.g. inputs changing faster than they are read) interrupts again
+    // once enabled, after a backoff so the bus isn't monopolized
+    if (gpio_get_level(pin) == 0) {
+      ESP_LOGW(TAG_INT, "INT still asserted, pin[%d]", pin);
+      vTaskDelay(asserted_backoff);
     }
+
+    gpio_intr_enable(pin);
+  }
+
+  gpio_isr_handler_remove(pin);
+
+  i2c->_tasks[INTERRUPT] = nullptr;
+  xSemaphoreGive(i2c->_ended);
+  vTaskDelete(nullptr);
+}
+
+bool Engine::known(uint8_t addr, uint8_t channel) {
+  for (size_t i = 0; i < _device_count; i++) {
+    auto device = _devices[i];
+
+    if ((device->addr() == addr) && (device->channel() == channel)) return true;
   }
+
+  return false;
 }
 
 IRAM_ATTR void Engine::report(void *data) {
   Engine *i2c = (Engine *)data;
-  const auto send_ms = i2c->_opts.report.send_ms;
+  const auto &opts = i2c->_opts.report; // reconfigured in place, read each pass
 
-  Device::initHardware();
+  // the bus is initialized once, a restarted report task reuses it
+  if (i2c->_hardware_ready == false) {
+    Device::initHardware();
+    i2c->_hardware_ready = true;
+  }
 
-  for (;;) {
+  while (i2c->_stopping == false) {
     last_wake = xTaskGetTickCount();
 
-    for (auto i = 0; i < device_count; i++) {
+    i2c->discover(opts.loops_per_discover);
+
+    for (size_t i = 0; i < i2c->_device_count; i++) {
       auto device = i2c->devices(i);
-      device->report();
+
+      // missing devices are skipped until a discover finds them again
+      if (device->missing()) continue;
+      if (device->report() == false) device->missing(true);
     }
 
-    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(send_ms));
+    // sleep until the next report unless stop() gives _wake first
+    const auto elapsed = xTaskGetTickCount() - last_wake;
+    const auto interval = pdMS_TO_TICKS(opts.send_ms);
+    if (elapsed < interval) xSemaphoreTake(i2c->_wake, interval - elapsed);
   }
+
+  i2c->_tasks[REPORT] = nullptr;
+  xSemaphoreGive(i2c->_ended);
+  vTaskDelete(nullptr);
 }
 
 void Engine::start(const Opts &opts) {
-  if (_instance_) return;
+  if (_instance_ == nullptr) _instance_ = new Engine(opts);
+
+  auto *i2c = _instance_;
+  auto &tasks = i2c->_tasks;
+
+  // a stop in progress completes before the tasks are started again, block until each
+  // running task has given _ended (a leftover count just means another check)
+  while (i2c->_stopping && (tasks[REPORT] || tasks[COMMAND] || tasks[INTERRUPT])) {
+    xSemaphoreTake(i2c->_ended, portMAX_DELAY);
+  }
+
+  i2c->_opts.report = opts.report;
+  i2c->_opts.command = opts.command;
+  i2c->_opts.interrupt.priority = opts.interrupt.priority;
 
-  _instance_ = new Engine(opts);
+  if ((i2c->_stopping == false) && tasks[COMMAND]) {
+    vTaskPrioritySet(tasks[REPORT], opts.report.priority);
+    vTaskPrioritySet(tasks[COMMAND], opts.command.priority);
+    if (tasks[INTERRUPT]) vTaskPrioritySet(tasks[INTERRUPT], opts.interrupt.priority);
+    return;
+  }
+
+  i2c->_stopping = false;
+  xSemaphoreTake(i2c->_wake, 0); // discard a wake given after the last report wait
+
+  // known devices were made with the device opts of the first start, keep using them
+  const auto &dev_opts = i2c->_opts;
+
+  xTaskCreate(&report, TAG_RPT, opts.report.stack, i2c, opts.report.priority, &tasks[REPORT]);
+  xTaskCreate(&command, TAG_CMD, opts.command.stack, i2c, opts.command.priority, &tasks[COMMAND]);
+
+  if ((dev_opts.mcp23008.int_pin >= 0) && (dev_opts.mcp23008.inputs != 0x00)) {
+    TaskHandle_t &int_task = tasks[INTERRUPT];
+    xTaskCreate(&interrupt, TAG_INT, opts.interrupt.stack, i2c, opts.interrupt.priority, &int_task);
 
-  TaskHandle_t &report_task = _instance_->_tasks[REPORT];
+    // INT is active low and open drain.  level triggered, an edge is lost when a device
+    // asserts the line while another holds it low
+    int_pin = (gpio_num_t)dev_opts.mcp23008.int_pin;
+    gpio_config_t int_pin_config = {};
+    int_pin_config.pin_bit_mask = 1ULL << int_pin;
+    int_pin_config.mode = GPIO_MODE_INPUT;
+    int_pin_config.pull_up_en = GPIO_PULLUP_ENABLE;
+    int_pin_config.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    int_pin_config.intr_type = GPIO_INTR_LOW_LEVEL;
 
-  xTaskCreate(&report, TAG_RPT, opts.report.stack, _instance_, opts.report.priority, &report_task);
+    gpio_install_isr_service(0); // ESP_ERR_INVALID_STATE when already installed
+    gpio_isr_handler_add(int_pin, interruptISR, int_task);
+    gpio_config(&int_pin_config); // enables the interrupt, pending when INT is already low
+  }
+}
+
+void Engine::stop() {
+  if ((_instance_ == nullptr) || (_instance_->_tasks[COMMAND] == nullptr)) return;
 
-  TaskHandle_t &cmd_task = _instance_->_tasks[COMMAND];
-  xTaskCreate(&command, TAG_CMD, opts.command.stack, _instance_, opts.command.priority, &cmd_task);
+  auto &tasks = _instance_->_tasks;
+  _instance_->_stopping = true;
+
+  // the command and interrupt tasks end once notified, the report task once _wake is given
+  // (or when a report in progress finishes)
+  xTaskNotify(tasks[COMMAND], Notifies::CMD_ENDING, eSetBits);
+  if (tasks[INTERRUPT]) xTaskNotifyGive(tasks[INTERRUPT]);
+  xSemaphoreGive(_instance_->_wake);
 }
 
-void Engine::wantMessage(message::InWrapped &msg) { msg->want(DocKinds::CMD); }
+void Engine::wantMessage(message::InWrapped &msg) {
+  if (findDevice(msg->identFromFilter())) msg->want(DocKinds::CMD);
+}
 
 } // namespace i2c
@@ -21,12 +21,17 @@
 #ifndef ruth_i2c_engine_hpp
 #define ruth_i2c_engine_hpp
 
+#include <atomic>
 #include <cstdlib>
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include "dev_i2c/i2c.hpp"
+#include "dev_i2c/mcp23008.hpp"
+#include "dev_i2c/pca9685.hpp"
+#include "dev_i2c/sht31.hpp"
 #include "message/handler.hpp"
 #include "message/in.hpp"
 
@@ -36,6 +41,15 @@ class Engine : public message::Handler {
 public:
   struct Opts {
     const char *unique_id;
+    bool mplex = false; // probe channels of the TCA9548A multiplexer
+    SHT31::Opts sht31;
+    MCP23008::Opts mcp23008;
+    PCA9685::Opts pca9685;
+
+    struct {
+      UBaseType_t stack = 3072;
+      UBaseType_t priority = 13; // above report, input changes are published promptly
+    } interrupt;
 
     struct {
       UBaseType_t stack = 4096;
@@ -51,18 +65,24 @@ public:
   };
 
   enum Notifies : UBaseType_t { QUEUED_MSG = 0xa000, CMD_ENDING = 0x9000 };
-  enum Tasks : size_t { CORE = 0, REPORT, COMMAND };
+  enum Tasks : size_t { CORE = 0, REPORT, COMMAND, INTERRUPT };
 
 private:
   Engine(const Opts &opts);
   ~Engine() = default;
 
 public:
-  static void command(void *data); // task loop
+  static void command(void *data);   // task loop
+  static void interrupt(void *data); // task loop (input changes signalled by INT)
   Device *devices(const size_t idx) const { return _devices[idx]; }
+  Device *findDevice(const char *ident);
   static void report(void *data); // task loop (reports and discover)
+
+  // starts the engine or, when already running, applies the report intervals and task
+  // priorities in place.  device options, the interrupt pin and stack sizes apply at the
+  // next restart of the device.
   static void start(const Opts &opts);
-  void stop();
+  static void stop(); // the tasks end, the bus and known devices are kept
 
   void wantMessage(message::InWrapped &msg) override;
 
@@ -70,12 +90,26 @@ private:
   enum DocKinds : uint32_t { CMD = 1 };
 
 private:
-  Device *_devices[2] = {};
+  void discover(const uint32_t loops_per_discover);
+  void discoverChannel(uint8_t channel);
+  bool known(uint8_t addr, uint8_t channel);
+
+private:
+  // devices are only added (by the report task), the command task reads up to _device_count
+  Device *_devices[16] = {};
+  std::atomic<size_t> _device_count{0};
   Opts _opts;
 
-  TaskHandle_t _tasks[Tasks::COMMAND + 1] = {};
+  uint32_t _discover_countdown = 0;
+  bool _hardware_ready = false;
+  bool _mplex_found = false;
+
+  TaskHandle_t _tasks[Tasks::INTERRUPT + 1] = {};
+  volatile bool _stopping = false;
+  SemaphoreHandle_t _wake = nullptr;  // given by stop(), ends the report wait early
+  SemaphoreHandle_t _ended = nullptr; // given by each task as it ends
 
-  static constexpr size_t device_count = sizeof(_devices) / sizeof(Device *);
+  static constexpr size_t max_devices = sizeof(_devices) / sizeof(Device *);
   static constexpr size_t max_queue_depth = 5;
 };
 } // namespace i2c
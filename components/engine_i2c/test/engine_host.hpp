@@ -0,0 +1,144 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// shared by the engine host tests: the simulated i2c bus (i2c_sim), the messages the engine
+// publishes (captured by the host broker) and commands delivered through it.  each test is a
+// single translation unit.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+
+#include "ArduinoJson.h"
+#include "engine_i2c/i2c.hpp"
+#include "filter/filter.hpp"
+#include "host_broker.hpp"
+#include "host_gpio.h"
+#include "host_rtos.h"
+#include "host_test.h"
+#include "i2c_sim.hpp"
+#include "ruth_mqtt/mqtt.hpp"
+
+using host::Broker;
+
+// filter and mqtt as ruth::Core sets them up, the broker accepts the connection
+inline void hostStart() {
+  static filter::Opts filter_opts{"ruth", "host", "host"};
+  filter::Filter::init(filter_opts);
+
+  ruth::MQTT::ConnOpts conn_opts{"host", "mqtt://broker", "user", "passwd", xTaskGetCurrentTaskHandle()};
+  ruth::MQTT::initAndStart(conn_opts);
+}
+
+// polls (each tick) until done() or timeout_ms passes, returns done()
+template <typename Done> bool waitUntil(Done done, uint32_t timeout_ms) {
+  const auto until_us = host_rtos_now_us() + (timeout_ms * 1000ULL);
+
+  while (!done() && (host_rtos_now_us() < until_us)) vTaskDelay(1);
+
+  return done();
+}
+
+// the ident the engine makes for a device (unique id "host")
+inline std::string identOf(const char *description, uint8_t addr, uint8_t channel = i2c_sim::NO_CHANNEL) {
+  char ident[48];
+  char *p = ident + sprintf(ident, "i2c.host.%s.", description);
+  if (channel != i2c_sim::NO_CHANNEL) p += sprintf(p, "c%u.", channel);
+  sprintf(p, "%02x", addr);
+
+  return ident;
+}
+
+// published messages since since_us of an ident (all i2c devices when nullptr), the time of the
+// last in last_us
+inline size_t countPublished(const char *ident, uint64_t since_us, uint64_t *last_us = nullptr) {
+  const std::string level = ident ? (std::string("/") + ident + "/") : std::string("/i2c.host.");
+  size_t count = 0;
+
+  for (const auto &msg : Broker::published) {
+    if (msg.at_us < since_us) continue;
+    if (msg.topic.find(level) == std::string::npos) continue;
+
+    count++;
+    if (last_us) *last_us = msg.at_us;
+  }
+
+  return count;
+}
+
+// the pins on in the last ok states message of the ident since since_us as a mask, -1 when none
+inline int statesSince(const char *ident, uint64_t since_us, uint64_t *at_us = nullptr) {
+  const std::string level = std::string("/status/") + ident + "/ok";
+  const Broker::Published *last = nullptr;
+
+  for (const auto &msg : Broker::published) {
+    if ((msg.at_us >= since_us) && (msg.topic.find(level) != std::string::npos)) last = &msg;
+  }
+
+  if (last == nullptr) return -1;
+  if (at_us) *at_us = last->at_us;
+
+  StaticJsonDocument<1024> doc; // each pin a nested array
+  deserializeMsgPack(doc, last->data);
+
+  int states = 0;
+  for (JsonArrayConst pin : doc["pins"].as<JsonArrayConst>()) {
+    if (strcmp(pin[1] | "", "on") == 0) states |= 0x01 << (pin[0] | 0);
+  }
+
+  return states;
+}
+
+inline uint64_t mtimeNow() {
+  struct timeval now {};
+  gettimeofday(&now, nullptr);
+
+  return ((uint64_t)now.tv_sec * 1000) + (now.tv_usec / 1000);
+}
+
+// a command (cmd, pin and params as given) for the device with the ident, acked by refid
+inline void sendCommand(const char *ident, const char *refid, JsonDocument &cmd) {
+  cmd["mtime"] = mtimeNow();
+  cmd["ack"] = true;
+
+  std::string packed;
+  serializeMsgPack(cmd, packed);
+
+  Broker::deliver(std::string("ruth/c2/host/i2c/") + ident + "/" + refid, packed);
+}
+
+// true once the command with refid is acked (since since_us), false after timeout_ms
+inline bool commandAcked(const char *refid, uint64_t since_us, uint32_t timeout_ms = 1000) {
+  const std::string level = std::string("/cmdack/") + refid;
+
+  return waitUntil(
+      [&] {
+        for (const auto &msg : Broker::published) {
+          if ((msg.at_us >= since_us) && (msg.topic.find(level) != std::string::npos)) return true;
+        }
+
+        return false;
+      },
+      timeout_ms);
+}
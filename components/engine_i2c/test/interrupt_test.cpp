@@ -0,0 +1,176 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// MCP23008 input changes signalled on the shared INT line: the latency from a change to its
+// states message for changes at random on two devices, changes on both at once and a burst
+// of changes (INT reasserted while the interrupt task is reading) after which the line must
+// still be serviced.  then the register reads an hour of an idle device, interrupt driven
+// compared to polled each report.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "engine_host.hpp"
+
+static constexpr gpio_num_t INT_PIN = GPIO_NUM_27;
+static constexpr uint8_t INPUTS = 0x0f;
+static constexpr uint32_t SEND_MS = 7000;
+static constexpr int EVENTS = 200;
+
+static i2c_sim::MCP23008 mcp_a(0x20);
+static i2c_sim::MCP23008 mcp_b(0x21);
+static i2c_sim::MCP23008 mcp_polled(0x22); // only present for the polled reads
+
+static std::vector<uint64_t> latencies;
+
+// register reads (the register then a repeated START) of the device
+static uint32_t readsOf(const i2c_sim::Device &device) { return device.txns / 2; }
+
+// virtual time from the change until a states message of the device shows it, zero when none
+// within a second
+static uint64_t reported(i2c_sim::MCP23008 &sim, uint64_t changed_at) {
+  const auto ident = identOf("mcp23008", sim.addr);
+  const int want = sim.levels & INPUTS; // outputs are off
+  uint64_t at_us = 0;
+
+  if (!waitUntil([&] { return statesSince(ident.c_str(), changed_at, &at_us) == want; }, 1000)) return 0;
+
+  return at_us - changed_at;
+}
+
+static void change(i2c_sim::MCP23008 &sim, uint8_t levels) {
+  const auto changed_at = host_rtos_now_us();
+  sim.drive(levels);
+
+  const auto latency = reported(sim, changed_at);
+  CHECK(latency, "%02x change %02x not reported", sim.addr, levels);
+  latencies.push_back(latency);
+}
+
+static void atRandom() {
+  uint32_t rng = 0x5eed;
+
+  for (int i = 0; i < EVENTS; i++) {
+    rng = (rng * 1103515245) + 12345;
+    vTaskDelay(pdMS_TO_TICKS(50 + ((rng >> 16) % 2000)));
+
+    auto &sim = (rng & 0x100) ? mcp_a : mcp_b;
+    change(sim, sim.levels ^ (0x01 << ((rng >> 9) % 4)));
+  }
+}
+
+static void together() {
+  // the second asserts INT while the first is being read, the line never goes high between
+  for (int i = 0; i < 10; i++) {
+    const auto changed_at = host_rtos_now_us();
+
+    mcp_a.drive(mcp_a.levels ^ 0x01);
+    host_rtos_wait_us(300);
+    mcp_b.drive(mcp_b.levels ^ 0x02);
+
+    CHECK(reported(mcp_a, changed_at) && reported(mcp_b, changed_at), "together %d not reported", i);
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+}
+
+static void burst() {
+  // inputs chatter (e.g. a bouncing contact) for longer than the interrupt task reads
+  for (int i = 0; i < 40; i++) {
+    mcp_a.drive(mcp_a.levels ^ 0x04);
+    host_rtos_wait_us(250);
+  }
+
+  const auto settled_at = host_rtos_now_us();
+  mcp_a.drive(mcp_a.levels ^ 0x04);
+
+  CHECK(reported(mcp_a, settled_at), "burst end not reported");
+  CHECK(gpio_get_level(INT_PIN) == 1, "INT asserted after the burst");
+
+  // later changes are signalled as usual
+  vTaskDelay(pdMS_TO_TICKS(500));
+  change(mcp_b, mcp_b.levels ^ 0x08);
+  CHECK(latencies.back() < 10000, "after the burst %.1fms", latencies.back() / 1e3);
+}
+
+static uint32_t polledReadsAnHour() {
+  i2c::MCP23008::Opts opts;
+  opts.inputs = INPUTS;
+  i2c::MCP23008 polled(mcp_polled.addr, i2c::Device::NO_CHANNEL, opts);
+
+  const auto reads = readsOf(mcp_polled);
+  for (uint32_t ms = 0; ms < (3600 * 1000); ms += SEND_MS) {
+    polled.report();
+    vTaskDelay(pdMS_TO_TICKS(SEND_MS));
+  }
+
+  return readsOf(mcp_polled) - reads;
+}
+
+static int testMain() {
+  hostStart();
+
+  i2c_sim::int_pin = INT_PIN;
+  for (auto *sim : {&mcp_a, &mcp_b, &mcp_polled}) i2c_sim::add(sim);
+
+  i2c::Device::setUniqueId("host");
+  i2c::Device::initHardware();
+  const auto polled_reads = polledReadsAnHour();
+  mcp_polled.present = false;
+
+  i2c::Engine::Opts opts;
+  opts.unique_id = "host";
+  opts.mcp23008.inputs = INPUTS;
+  opts.mcp23008.int_pin = INT_PIN;
+  opts.report.send_ms = SEND_MS;
+
+  i2c::Engine::start(opts);
+  vTaskDelay(pdMS_TO_TICKS(SEND_MS)); // discovered, configured and reported
+
+  atRandom();
+  together();
+  burst();
+
+  std::sort(latencies.begin(), latencies.end());
+  const auto median = latencies[latencies.size() / 2];
+  const auto max = latencies.back();
+  CHECK(max < 10000, "latency max %.1fms", max / 1e3);
+
+  // idle, only the heartbeat reads the device
+  vTaskDelay(pdMS_TO_TICKS(opts.mcp23008.heartbeat_ms));
+  const auto reads = readsOf(mcp_a);
+  vTaskDelay(pdMS_TO_TICKS(3600 * 1000));
+  const auto interrupt_reads = readsOf(mcp_a) - reads;
+
+  CHECK((interrupt_reads * 4) < polled_reads, "reads an hour interrupt %u polled %u", interrupt_reads,
+        polled_reads);
+
+  i2c::Engine::stop();
+
+  printf("interrupt: %zu changes latency median %.2fms max %.2fms, %u isr calls\n", latencies.size(),
+         median / 1e3, max / 1e3, host_gpio_interrupts(INT_PIN));
+  printf("interrupt: idle reads an hour %u interrupt driven, %u polled every %ums\n", interrupt_reads,
+         polled_reads, SEND_MS);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
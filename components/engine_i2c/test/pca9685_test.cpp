@@ -0,0 +1,125 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// PCA9685 on the simulated bus: found at an address shared with the SHT31 range (0x44) next to
+// an SHT31 (0x45), each identified as what it is.  then the bytes on the bus to apply channel
+// updates: one channel, several within a frame (coalesced into one write) and channels far
+// apart (rewritten from the first through the last).
+
+#include <cstdint>
+#include <cstdio>
+
+#include "engine_host.hpp"
+
+static i2c_sim::PCA9685 pca9685(0x44);
+static i2c_sim::SHT31 sht31(0x45);
+
+static const std::string pca9685_ident = identOf("pca9685", pca9685.addr);
+
+struct Update {
+  uint32_t links;
+  uint32_t bytes;
+};
+
+// bus links and bytes from sending the commands (pin and percent, 100 is on) until flushed
+static Update update(std::initializer_list<std::pair<uint8_t, int>> pins) {
+  static int refids = 0;
+  const auto stats = i2c_sim::stats;
+  const auto sent_at = host_rtos_now_us();
+
+  for (const auto &pin : pins) {
+    char refid[16];
+    snprintf(refid, sizeof(refid), "ref%d", refids++);
+
+    StaticJsonDocument<256> cmd;
+    cmd["pin"] = pin.first;
+    if (pin.second == 100) {
+      cmd["cmd"] = "on";
+    } else {
+      cmd["params"]["type"] = "fixed";
+      cmd["params"]["percent"] = pin.second;
+    }
+
+    sendCommand(pca9685_ident.c_str(), refid, cmd);
+    CHECK(commandAcked(refid, sent_at), "%s pin %u not acked", refid, pin.first);
+  }
+
+  vTaskDelay(pdMS_TO_TICKS(100)); // frames end and are flushed
+
+  return {i2c_sim::stats.links - stats.links, i2c_sim::stats.bytes - stats.bytes};
+}
+
+static void identity() {
+  const auto start_at = host_rtos_now_us();
+
+  i2c::Engine::Opts opts;
+  opts.unique_id = "host";
+  opts.report.send_ms = 60000;
+
+  i2c::Engine::start(opts);
+
+  const auto sht31_ident = identOf("sht31", sht31.addr);
+  CHECK(waitUntil([&] { return countPublished(nullptr, start_at) == 2; }, 2000), "devices not reported");
+  CHECK(countPublished(pca9685_ident.c_str(), start_at) == 1, "%s not reported", pca9685_ident.c_str());
+  CHECK(countPublished(sht31_ident.c_str(), start_at) == 1, "%s not reported", sht31_ident.c_str());
+
+  // configured by the first report, ALLCALL disabled and the prescaler for 1000Hz
+  CHECK(pca9685.regs[0x00] == 0x20, "MODE1 %02x", pca9685.regs[0x00]);
+  CHECK(pca9685.regs[0xfe] == 5, "PRE_SCALE %u", pca9685.regs[0xfe]);
+
+  vTaskDelay(pdMS_TO_TICKS(100)); // every channel, rewritten once configured, is flushed
+}
+
+static void updates() {
+  // one channel: the address, first register and the four channel registers
+  const auto one = update({{3, 100}});
+  CHECK((one.links == 1) && (one.bytes == 6), "one channel %u links %u bytes", one.links, one.bytes);
+  CHECK(pca9685.on(3) == 0x1000, "pin 3 on %04x", pca9685.on(3));
+
+  // four channels within a frame, one write of adjacent channels
+  const auto four = update({{4, 25}, {5, 50}, {6, 75}, {7, 0}});
+  CHECK((four.links == 1) && (four.bytes == 18), "four channels %u links %u bytes", four.links, four.bytes);
+  CHECK(pca9685.off(5) == (((5 * 256) + 2048) & 0x0fff), "pin 5 off %04x", pca9685.off(5));
+  CHECK(pca9685.off(7) == 0x1000, "pin 7 off %04x", pca9685.off(7));
+
+  // the first and last channels, rewritten through every channel between
+  const auto apart = update({{0, 10}, {15, 90}});
+  CHECK((apart.links == 1) && (apart.bytes == 66), "apart %u links %u bytes", apart.links, apart.bytes);
+  CHECK(pca9685.on(3) == 0x1000, "pin 3 after rewrite %04x", pca9685.on(3));
+
+  printf("pca9685: bytes an update one channel %u, four in a frame %u (%u separately), first and last %u\n",
+         one.bytes, four.bytes, one.bytes * 4, apart.bytes);
+}
+
+static int testMain() {
+  hostStart();
+
+  i2c_sim::add(&pca9685);
+  i2c_sim::add(&sht31);
+
+  identity();
+  updates();
+
+  i2c::Engine::stop();
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
@@ -0,0 +1,146 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// discovery through the TCA9548A multiplexer: devices on the bus itself and behind channels
+// (including the same address on two channels and a PCA9685 at power on, answering ALLCALL at
+// the multiplexer address) are each found once with the ident of their channel.  devices not
+// behind the multiplexer answer on every channel and are not found again.  a device missing
+// from its channel is probed by a later discover and reports again once back.
+
+#include <cstdint>
+#include <cstdio>
+
+#include "engine_host.hpp"
+
+static constexpr uint32_t SEND_MS = 1000;
+static constexpr uint32_t LOOPS_PER_DISCOVER = 2;
+
+static i2c_sim::Mux mux;
+static i2c_sim::SHT31 sht31_root(0x44);
+static i2c_sim::MCP23008 mcp23008_root(0x20);
+static i2c_sim::PCA9685 pca9685_c0(0x40, 0);
+static i2c_sim::SHT31 sht31_c2(0x45, 2);
+static i2c_sim::MCP23008 mcp23008_c3(0x21, 3);
+static i2c_sim::PCA9685 pca9685_c3(0x41, 3);
+static i2c_sim::SHT31 sht31_c5(0x45, 5);
+
+static const struct {
+  const char *description;
+  const i2c_sim::Device &device;
+} expected[] = {{"sht31", sht31_root},       {"mcp23008", mcp23008_root}, {"pca9685", pca9685_c0},
+                {"sht31", sht31_c2},         {"mcp23008", mcp23008_c3},   {"pca9685", pca9685_c3},
+                {"sht31", sht31_c5}};
+
+static constexpr size_t EXPECTED = sizeof(expected) / sizeof(expected[0]);
+
+static size_t reportedSince(uint64_t since_us) {
+  size_t count = 0;
+
+  for (const auto &e : expected) {
+    const auto ident = identOf(e.description, e.device.addr, e.device.channel);
+    if (countPublished(ident.c_str(), since_us)) count++;
+  }
+
+  return count;
+}
+
+static void topology() {
+  const auto start_at = host_rtos_now_us();
+  const auto stats_at = i2c_sim::stats;
+
+  i2c::Engine::Opts opts;
+  opts.unique_id = "host";
+  opts.mplex = true;
+  opts.report.send_ms = SEND_MS;
+  opts.report.loops_per_discover = LOOPS_PER_DISCOVER;
+
+  i2c::Engine::start(opts);
+
+  CHECK(waitUntil([&] { return reportedSince(start_at) == EXPECTED; }, 5000), "reported %zu of %zu devices",
+        reportedSince(start_at), EXPECTED);
+
+  // the first pass (discover then a report of each device) is complete, the next is a send
+  // interval away
+  const auto pass_us = host_rtos_now_us() - start_at;
+  const auto links = i2c_sim::stats.links - stats_at.links;
+  const auto bus_us = i2c_sim::stats.bus_us - stats_at.bus_us;
+
+  for (const auto &e : expected) {
+    const auto ident = identOf(e.description, e.device.addr, e.device.channel);
+    const auto count = countPublished(ident.c_str(), start_at);
+
+    CHECK(count == 1, "%s reported %zu times", ident.c_str(), count);
+  }
+
+  const auto all = countPublished(nullptr, start_at);
+  CHECK(all == EXPECTED, "%zu reports for %zu devices", all, EXPECTED);
+
+  // configured, the PCA9685s no longer answer at the multiplexer address
+  CHECK((pca9685_c0.regs[0x00] & 0x01) == 0x00, "pca9685 c0 MODE1 %02x", pca9685_c0.regs[0x00]);
+  CHECK((pca9685_c3.regs[0x00] & 0x01) == 0x00, "pca9685 c3 MODE1 %02x", pca9685_c3.regs[0x00]);
+  CHECK(sht31_c2.measurements && sht31_c5.measurements, "sht31 measurements c2[%u] c5[%u]",
+        sht31_c2.measurements, sht31_c5.measurements);
+
+  printf("topology: %zu devices (%zu behind the multiplexer) in %.1fms, %u links %.1fms on the bus\n",
+         EXPECTED, EXPECTED - 2, pass_us / 1e3, links, bus_us / 1e3);
+}
+
+static void rediscover() {
+  const auto ident = identOf("mcp23008", mcp23008_c3.addr, mcp23008_c3.channel);
+
+  // the failed report marks the device missing, it isn't reported again while absent
+  mcp23008_c3.present = false;
+  vTaskDelay(pdMS_TO_TICKS(SEND_MS * 2));
+
+  const auto absent_at = host_rtos_now_us();
+  vTaskDelay(pdMS_TO_TICKS(SEND_MS * (LOOPS_PER_DISCOVER + 2)));
+  CHECK(countPublished(ident.c_str(), absent_at) == 0, "%s reported while absent", ident.c_str());
+
+  // the next discover probes it again (at most loops per discover passes away)
+  mcp23008_c3.present = true;
+  const auto back_at = host_rtos_now_us();
+
+  uint64_t reported_at = 0;
+  CHECK(waitUntil([&] { return countPublished(ident.c_str(), back_at, &reported_at) > 0; },
+                  SEND_MS * (LOOPS_PER_DISCOVER + 2)),
+        "%s not reported once back", ident.c_str());
+
+  const auto others = countPublished(nullptr, back_at);
+  printf("rediscover: %s reported %.1fs after returning (%zu reports meanwhile)\n", ident.c_str(),
+         (reported_at - back_at) / 1e6, others);
+}
+
+static int testMain() {
+  hostStart();
+
+  for (auto *device : std::initializer_list<i2c_sim::Device *>{
+           &mux, &sht31_root, &mcp23008_root, &pca9685_c0, &sht31_c2, &mcp23008_c3, &pca9685_c3, &sht31_c5}) {
+    i2c_sim::add(device);
+  }
+
+  topology();
+  rediscover();
+
+  i2c::Engine::stop();
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
@@ -24,6 +24,7 @@
 #include <cstdlib>
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include "dev_pwm/pwm.hpp"
@@ -61,8 +62,10 @@ public:
   static void command(void *data);
   static void report(void *data);
 
+  // starts the engine or, when already running, applies the report interval and task
+  // priorities in place.  stack sizes apply the next time the tasks are started.
   static void start(Opts &opts);
-  void stop();
+  static void stop(); // the tasks end and every pin is turned off
 
   void wantMessage(message::InWrapped &msg) override;
 
@@ -76,6 +79,9 @@ private:
   TaskHandle_t _report_task = nullptr;
   uint32_t _report_send_ms = 13000;
   TaskHandle_t _command_task = nullptr;
+  volatile bool _stopping = false;
+  SemaphoreHandle_t _wake = nullptr;  // stop() gives it so the report task ends without waiting
+  SemaphoreHandle_t _ended = nullptr; // each task gives it as it ends
 
   static constexpr size_t _num_devices = sizeof(_known) / sizeof(Device);
   static constexpr size_t _max_queue_depth = 5;
@@ -52,6 +52,9 @@ Engine::Engine(const char *unique_id, uint32_t report_send_ms)
   *p++ = '.';
 
   memccpy(p, unique_id, 0x00, capacity - (p - _ident));
+
+  _wake = xSemaphoreCreateBinary();
+  _ended = xSemaphoreCreateCounting(2, 0); // report and command
 }
 
 static StaticJsonDocument<1024> cmd_doc;
@@ -62,7 +65,7 @@ void Engine::command(void *task_data) {
   pwm->notifyThisTask(Notifies::QUEUED_MSG);
   MQTT::registerHandler(pwm);
 
-  for (;;) {
+  while (pwm->_stopping == false) {
     UBaseType_t notify_val;
     auto msg = pwm->waitForNotifyOrMessage(&notify_val);
 
@@ -84,21 +87,28 @@ void Engine::command(void *task_data) {
           MQTT::send(ack_msg);
         }
       }
-    } else {
+    } else if ((notify_val & Notifies::CMD_ENDING) == 0) {
       ESP_LOGW(TAG_CMD, "unhandled notify: 0x%x", notify_val);
     }
   }
+
+  MQTT::unregisterHandler(pwm);
+
+  for (auto &device : pwm->_known) device.off();
+
+  pwm->_command_task = nullptr;
+  xSemaphoreGive(pwm->_ended);
+  vTaskDelete(nullptr);
 }
 
 void Engine::report(void *data) {
   static TickType_t last_wake;
 
   Engine *pwm = (Engine *)data;
-  const auto send_ms = pwm->_report_send_ms;
 
-  // ESP_LOGI(TAG_RPT, "task started: send_ms[%u]", send_ms);
+  // ESP_LOGI(TAG_RPT, "task started: send_ms[%u]", pwm->_report_send_ms);
 
-  for (;;) {
+  while (pwm->_stopping == false) {
     last_wake = xTaskGetTickCount();
     {
       pwm::Status status(pwm->_ident);
@@ -117,14 +127,37 @@ void Engine::report(void *data) {
       MQTT::send(status);
     }
 
-    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(send_ms));
+    // send_ms is read each pass, a reconfigure takes effect at the next report.  the wait
+    // ends early when stop() gives _wake.
+    const auto elapsed = xTaskGetTickCount() - last_wake;
+    const auto interval = pdMS_TO_TICKS(pwm->_report_send_ms);
+    if (elapsed < interval) xSemaphoreTake(pwm->_wake, interval - elapsed);
   }
+
+  pwm->_report_task = nullptr;
+  xSemaphoreGive(pwm->_ended);
+  vTaskDelete(nullptr);
 }
 
 void Engine::start(Opts &opts) {
-  if (_instance_) return;
+  if (_instance_ == nullptr) _instance_ = new Engine(opts.unique_id, opts.report.send_ms);
+
+  // a stop in progress completes before the tasks are started again, each task gives
+  // _ended on the way out
+  while (_instance_->_stopping && (_instance_->_report_task || _instance_->_command_task)) {
+    xSemaphoreTake(_instance_->_ended, portMAX_DELAY);
+  }
 
-  _instance_ = new Engine(opts.unique_id, opts.report.send_ms);
+  _instance_->_report_send_ms = opts.report.send_ms;
+
+  if ((_instance_->_stopping == false) && _instance_->_command_task) {
+    vTaskPrioritySet(_instance_->_report_task, opts.report.priority);
+    vTaskPrioritySet(_instance_->_command_task, opts.command.priority);
+    return;
+  }
+
+  _instance_->_stopping = false;
+  xSemaphoreTake(_instance_->_wake, 0); // the previous report task may have ended before taking it
   TaskHandle_t &report_task = _instance_->_report_task;
 
   xTaskCreate(&report, TAG_RPT, opts.report.stack, _instance_, opts.report.priority, &report_task);
@@ -133,6 +166,16 @@ void Engine::start(Opts &opts) {
   xTaskCreate(&command, TAG_CMD, opts.command.stack, _instance_, opts.command.priority, &cmd_task);
 }
 
+void Engine::stop() {
+  if ((_instance_ == nullptr) || (_instance_->_command_task == nullptr)) return;
+
+  _instance_->_stopping = true;
+
+  // the command task ends once notified, the report task once woken
+  xTaskNotify(_instance_->_command_task, Notifies::CMD_ENDING, eSetBits);
+  xSemaphoreGive(_instance_->_wake);
+}
+
 void Engine::wantMessage(message::InWrapped &msg) {
   const char *ident = msg->identFromFilter();
 
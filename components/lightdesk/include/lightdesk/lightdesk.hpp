@@ -28,6 +28,7 @@
 #include <freertos/task.h>
 #include <freertos/timers.h>
 
+#include "dev_pwm/curve.hpp"
 #include "dmx/dmx.hpp"
 #include "misc/elapsed.hpp"
 
@@ -39,6 +40,13 @@ public:
     uint32_t dmx_port = 48005;
     uint32_t idle_shutdown_ms = 600000;
     uint32_t idle_check_ms = 1000;
+
+    // dimming curve applied to the levels of each headunit
+    struct {
+      pwm::Curve::Kind discoball = pwm::Curve::LINEAR;
+      pwm::Curve::Kind elwire = pwm::Curve::LINEAR;
+      pwm::Curve::Kind ledforest = pwm::Curve::LINEAR;
+    } curve;
   };
 
 public:
@@ -53,7 +61,7 @@ public:
   void idleWatchDelete();
 
 private:
-  void init();
+  void init(const Opts &opts);
 
 private:
   esp_err_t _init_rc = ESP_FAIL;
@@ -43,7 +43,7 @@ LightDesk::LightDesk(const Opts &opts) {
     _dmx = new Dmx(opts.dmx_port);
   }
 
-  init();
+  init(opts);
   start();
 }
 
@@ -98,15 +98,15 @@ FINISH:
   }
 }
 
-void LightDesk::init() {
+void LightDesk::init(const Opts &opts) {
   ESP_LOGD(TAG, "enabled, starting up");
 
   _dmx->start();
   _dmx->addHeadUnit(std::make_shared<AcPower>());
-  _dmx->addHeadUnit(std::make_shared<DiscoBall>(1)); // pwm 1
-  _dmx->addHeadUnit(std::make_shared<ElWire>(2));    // pwm 2
-  _dmx->addHeadUnit(std::make_shared<ElWire>(3));    // pwm 3
-  _dmx->addHeadUnit(std::make_shared<LedForest>(4)); // pwm 4
+  _dmx->addHeadUnit(std::make_shared<DiscoBall>(1, opts.curve.discoball)); // pwm 1
+  _dmx->addHeadUnit(std::make_shared<ElWire>(2, opts.curve.elwire));       // pwm 2
+  _dmx->addHeadUnit(std::make_shared<ElWire>(3, opts.curve.elwire));       // pwm 3
+  _dmx->addHeadUnit(std::make_shared<LedForest>(4, opts.curve.ledforest)); // pwm 4
 }
 
 void LightDesk::start() {
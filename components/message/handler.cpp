@@ -21,6 +21,7 @@
 #include <esp_log.h>
 
 #include "message/handler.hpp"
+#include "ruth_log/dlog.hpp"
 
 namespace message {
 
@@ -102,7 +103,7 @@ IRAM_ATTR InWrapped Handler::waitForNotifyOrMessage(UBaseType_t *notified) {
 
   // if we got a message from the queue, then return it without waiting for a task notify
   if (q_rc == pdTRUE) {
-    ESP_LOGI("message:handler", "msg was waiting in the queue");
+    DLOGI("message:handler", "msg was waiting in the queue");
     return_msg = InWrapped(received_msg);
     return std::move(return_msg);
   }
@@ -110,7 +111,7 @@ IRAM_ATTR InWrapped Handler::waitForNotifyOrMessage(UBaseType_t *notified) {
   // wait for a task notification.  on any notification do a no wait queue pop and return
   // whatever was popped (or not popped)
   xTaskNotifyWait(0x00, portMAX_DELAY, notified, portMAX_DELAY);
-  ESP_LOGD("message:handler", "notified 0x%0x", *notified);
+  DLOGD("message:handler", "notified 0x%0x", *notified);
 
   // pop it from the queue and return it
   // always do a no wait check for messages in the queue
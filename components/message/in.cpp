@@ -22,6 +22,7 @@
 #include <esp_log.h>
 
 #include "message/in.hpp"
+#include "ruth_log/dlog.hpp"
 
 static const char *TAG = "In";
 
@@ -45,7 +46,7 @@ IRAM_ATTR void In::checkTime(JsonDocument &root) {
   auto mtime = root["mtime"].as<uint64_t>() | 0;
 
   if (mtime == 0) {
-    ESP_LOGI(TAG, "mtime == 0");
+    DLOGI(TAG, "mtime == 0");
     _valid = false;
     return;
   }
@@ -54,7 +55,7 @@ IRAM_ATTR void In::checkTime(JsonDocument &root) {
 
   if (_valid) return;
 
-  ESP_LOGI(TAG, "mtime variance[%llu]", (mtime > now_ms) ? (mtime - now_ms) : (now_ms - mtime));
+  DLOGI(TAG, "mtime variance[%llu]", (mtime > now_ms) ? (mtime - now_ms) : (now_ms - mtime));
 }
 
 IRAM_ATTR InWrapped In::make(const char *filter, const size_t filter_len, const char *packed,
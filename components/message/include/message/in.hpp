@@ -43,6 +43,8 @@ public:
   static std::unique_ptr<In> make(const char *filter, const size_t filter_len, const char *packed,
                                   const size_t packed_len);
 
+  inline const char *packed() const { return _packed.get(); }
+  inline size_t packedLen() const { return _packed_len; }
   inline const char *refidFromFilter() const { return filter(5); }
 
   bool unpack(JsonDocument &doc);
@@ -0,0 +1,67 @@
+/*
+    states_cache.hpp -- Write-through cache of device pin states
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef _ruth_states_cache_hpp
+#define _ruth_states_cache_hpp
+
+#include <cstdint>
+
+#include "misc/elapsed.hpp"
+
+namespace ruth {
+
+// the last known pin states of a device, stored by reports and confirmed writes.
+// commands compute the next states from the cache and skip reading the device
+// unless the cache is invalid (an error occurred) or older than max_age.
+template <typename T = uint8_t> class StatesCache {
+public:
+  StatesCache(int64_t max_age_us = 30 * 1000 * 1000) : _max_age_us(max_age_us) {}
+
+  inline bool get(T &states) const {
+    if (!_valid || ((micros() - _at) > _max_age_us)) return false;
+
+    states = _states;
+    return true;
+  }
+
+  inline void invalidate() { _valid = false; }
+
+  inline void store(T states) {
+    _states = states;
+    _at = micros();
+    _valid = true;
+  }
+
+  // convenience for storing the result of a device read or write
+  inline bool store(bool rc, T states) {
+    rc ? store(states) : invalidate();
+    return rc;
+  }
+
+private:
+  const int64_t _max_age_us;
+  T _states = 0;
+  int64_t _at = 0;
+  bool _valid = false;
+};
+
+} // namespace ruth
+
+#endif
@@ -51,6 +51,8 @@ extern "C" {
 #define OWB_ROM_MATCH         0x55
 #define OWB_ROM_SKIP          0xCC
 #define OWB_ROM_SEARCH_ALARM  0xEC
+#define OWB_ROM_SKIP_OVERDRIVE  0x3C
+#define OWB_ROM_MATCH_OVERDRIVE 0x69
 
 struct owb_driver;
 
@@ -106,9 +108,22 @@ typedef enum
     OWB_STATUS_DEVICE_NOT_RESPONDING,
     OWB_STATUS_CRC_FAILED,
     OWB_STATUS_TOO_MANY_BITS,
-    OWB_STATUS_HW_ERROR
+    OWB_STATUS_HW_ERROR,
+    OWB_STATUS_NOT_SUPPORTED
 } owb_status;
 
+/**
+ * @brief Signalling speed of the 1-Wire bus.
+ *
+ *        Devices enter overdrive after an Overdrive Skip or Overdrive Match ROM command
+ *        and return to standard speed on the next standard speed reset.
+ */
+typedef enum
+{
+    OWB_SPEED_STANDARD,
+    OWB_SPEED_OVERDRIVE
+} owb_speed;
+
 /** NOTE: Driver assumes that (*init) was called prior to any other methods */
 struct owb_driver
 {
@@ -123,6 +138,18 @@ struct owb_driver
 
     /** NOTE: Data is read into the high bits, eg. each bit read is shifted down before the next bit is read */
     owb_status (*read_bits)(const OneWireBus *bus, uint8_t *in, int number_of_bits_to_read);
+
+    /** NOTE: Optional, may be NULL. Writes a buffer of bytes (each lsb first) in as few transactions as
+     *        the driver allows. When NULL owb_write_bytes() falls back to write_bits() per byte. */
+    owb_status (*write_bytes)(const OneWireBus *bus, const uint8_t *out, size_t len);
+
+    /** NOTE: Optional, may be NULL. Reads a buffer of bytes (each lsb first) in as few transactions as
+     *        the driver allows. When NULL owb_read_bytes() falls back to read_bits() per byte. */
+    owb_status (*read_bytes)(const OneWireBus *bus, uint8_t *in, size_t len);
+
+    /** NOTE: Optional, may be NULL. Switches the slot and reset timing used by the driver.
+     *        When NULL the driver only supports standard speed. */
+    owb_status (*set_speed)(const OneWireBus *bus, owb_speed speed);
 };
 
 #define container_of(ptr, type, member) ({                      \
@@ -167,6 +194,16 @@ owb_status owb_verify_rom(const OneWireBus * bus, OneWireBus_ROMCode rom_code, b
  */
 owb_status owb_reset(const OneWireBus * bus, bool* a_device_present);
 
+/**
+ * @brief Set the signalling speed used for subsequent resets and time slots.
+ *        Placing the devices into overdrive (e.g. OWB_ROM_SKIP_OVERDRIVE) is the
+ *        responsibility of the caller.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in] speed Requested speed.
+ * @return status, OWB_STATUS_NOT_SUPPORTED if the driver is standard speed only
+ */
+owb_status owb_set_speed(const OneWireBus * bus, owb_speed speed);
+
 /**
  * @brief Write a single byte to the 1-Wire bus.
  * @param[in] bus Pointer to initialised bus instance.
@@ -249,6 +286,28 @@ owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * sta
  */
 owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool *found_device);
 
+/**
+ * @brief Locates the first device on the 1-Wire bus meeting its alarm / conditional
+ *        search criteria (Conditional Search ROM, 0xEC), if present.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in,out] state Pointer to an existing search state structure.
+ * @param[out] found_device True if a device is found, false if no devices are found.
+ *         If a device is found, the ROM Code can be obtained from the state.
+ * @return status
+ */
+owb_status owb_search_conditional_first(const OneWireBus * bus, OneWireBus_SearchState * state, bool *found_device);
+
+/**
+ * @brief Locates the next device on the 1-Wire bus meeting its alarm / conditional
+ *        search criteria, starting from the provided state.
+ * @param[in] bus Pointer to initialised bus instance.
+ * @param[in,out] state Pointer to an existing search state structure.
+ * @param[out] found_device True if a device is found, false if no devices are found.
+ *         If a device is found, the ROM Code can be obtained from the state.
+ * @return status
+ */
+owb_status owb_search_conditional_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool *found_device);
+
 /**
  * @brief Create a string representation of a ROM code.
  * @param[in] rom_code The ROM code to convert to string representation.
@@ -260,7 +319,11 @@ owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * stat
 char * owb_string_from_rom_code(OneWireBus_ROMCode rom_code, char * buffer, size_t len);
 
 #include "owb_gpio.h"
+
+// the simulated backend (owb_sim.h) is only built for the host, include it directly
+#ifdef ESP_PLATFORM
 #include "owb_rmt.h"
+#endif
 
 #ifdef __cplusplus
 }
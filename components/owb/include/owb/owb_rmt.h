@@ -5,11 +5,14 @@
 #include "freertos/ringbuf.h"
 #include "driver/rmt.h"
 
+struct owb_rmt_timing;
+
 typedef struct {
   int tx_channel;
   int rx_channel;
   RingbufHandle_t rb;
   int gpio;
+  const struct owb_rmt_timing *timing;
 
   OneWireBus bus;
 } owb_rmt_driver_info;
@@ -0,0 +1,105 @@
+#pragma once
+
+// simulated 1-Wire bus.  DS18B20 and DS2408 devices are modeled at the time slot level
+// (rom commands, search, conversion, scratchpad, channel access and crcs) so the ds bus,
+// devices and engine can be exercised and benchmarked on a host without hardware.
+//
+// host only, not part of the firmware component.  test/ drives the owb api directly, the
+// dev_ds and engine_ds host tests pass the simulated bus to ds::Bus::ensure().
+//
+// the simulation does not sleep, the time the slots and resets would occupy the bus is
+// accumulated in bus_time_us and passed to busy_us (when set).  DS18B20 conversions
+// complete by clock_us (e.g. the host rtos virtual clock) or, without a clock, by
+// bus_time_us so they progress only as slots are performed, e.g. by polling with read slots.
+
+#include "owb/owb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OWB_SIM_FAMILY_DS18B20 0x28
+#define OWB_SIM_FAMILY_DS2408  0x29
+
+struct owb_sim_device;
+
+typedef struct
+{
+    // configuration, zero selects the default
+    uint32_t bit_error_ppm;     ///< probability (per million) a read slot returns a flipped bit
+    uint32_t slot_us[2];        ///< time slot duration, indexed by owb_speed
+    uint32_t reset_us[2];       ///< reset and presence detect duration, indexed by owb_speed
+    uint32_t seed;              ///< bit error injection seed
+    uint64_t (*clock_us)(void); ///< optional clock conversions complete by
+    void (*busy_us)(uint32_t);  ///< optional, called with the duration of each reset and slot
+
+    // statistics, may be cleared by the caller between benchmark runs (without clock_us,
+    // only when no DS18B20 conversion is in progress)
+    uint64_t bus_time_us;       ///< simulated time the bus was busy
+    uint32_t slots;             ///< read and write slots performed
+    uint32_t resets;            ///< resets performed
+    uint32_t bit_errors;        ///< read slots flipped by error injection
+
+    struct owb_sim_device *devices;
+    size_t count;
+    size_t capacity;
+    owb_speed speed;
+    uint32_t rng;
+
+    OneWireBus bus;
+} owb_sim_driver_info;
+
+/**
+ * @return OneWireBus*, pass this into the other OneWireBus public API functions
+ */
+OneWireBus* owb_sim_initialize(owb_sim_driver_info *info);
+
+/**
+ * @brief Clean up after a call to owb_sim_initialize(), frees the virtual devices
+ */
+void owb_sim_uninitialize(owb_sim_driver_info *info);
+
+/**
+ * @brief Add a virtual device to the bus.
+ * @param[in] serial 48-bit serial number, the family code and rom crc are added
+ * @return index of the device for the owb_sim_set_*() functions, -1 on failure
+ */
+int owb_sim_add_ds18b20(owb_sim_driver_info *info, uint64_t serial, float celsius, bool parasite);
+int owb_sim_add_ds2408(owb_sim_driver_info *info, uint64_t serial);
+
+/**
+ * @brief The complete rom code (family, serial and crc) of a virtual device.
+ */
+owb_status owb_sim_rom_code(const owb_sim_driver_info *info, int device, OneWireBus_ROMCode *rom_code);
+
+/**
+ * @brief Attach or detach a virtual device.  Attaching is a power on reset (e.g. the DS2408
+ *        conditional search registers are cleared and the power on reset latch is set).
+ */
+void owb_sim_set_present(owb_sim_driver_info *info, int device, bool present);
+
+/**
+ * @brief Temperature measured by the next conversion of a DS18B20.
+ */
+void owb_sim_set_celsius(owb_sim_driver_info *info, int device, float celsius);
+
+/**
+ * @brief Levels externally applied to the pins of a DS2408 (bit set is high / released).
+ *        Changes set the activity latches.
+ */
+void owb_sim_set_inputs(owb_sim_driver_info *info, int device, uint8_t inputs);
+
+/**
+ * @brief The output latch of a DS2408 as last written by channel access write.
+ */
+uint8_t owb_sim_outputs(const owb_sim_driver_info *info, int device);
+
+/**
+ * @brief True when a DS2408 meets its conditional search criteria, as set by its conditional
+ *        search registers, activity latches and power on reset latch.
+ */
+bool owb_sim_conditional(const owb_sim_driver_info *info, int device);
+
+#ifdef __cplusplus
+}
+#endif
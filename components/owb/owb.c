@@ -26,14 +26,13 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "esp_log.h"
-#include "driver/gpio.h"
 
+#include "crc/crc.h"
 #include "owb/owb.h"
 #include "owb/owb_gpio.h"
 
@@ -61,53 +60,11 @@ static bool _is_init(const OneWireBus * bus)
     return ok;
 }
 
-/**
- * @brief 1-Wire 8-bit CRC lookup.
- * @param[in] crc Starting CRC value. Pass in prior CRC to accumulate.
- * @param[in] data Byte to feed into CRC.
- * @return Resultant CRC value.
- */
-static uint8_t _calc_crc(uint8_t crc, uint8_t data)
-{
-    // https://www.maximintegrated.com/en/app-notes/index.mvp/id/27
-    static const uint8_t table[256] = {
-            0, 94, 188, 226, 97, 63, 221, 131, 194, 156, 126, 32, 163, 253, 31, 65,
-            157, 195, 33, 127, 252, 162, 64, 30, 95, 1, 227, 189, 62, 96, 130, 220,
-            35, 125, 159, 193, 66, 28, 254, 160, 225, 191, 93, 3, 128, 222, 60, 98,
-            190, 224, 2, 92, 223, 129, 99, 61, 124, 34, 192, 158, 29, 67, 161, 255,
-            70, 24, 250, 164, 39, 121, 155, 197, 132, 218, 56, 102, 229, 187, 89, 7,
-            219, 133, 103, 57, 186, 228, 6, 88, 25, 71, 165, 251, 120, 38, 196, 154,
-            101, 59, 217, 135, 4, 90, 184, 230, 167, 249, 27, 69, 198, 152, 122, 36,
-            248, 166, 68, 26, 153, 199, 37, 123, 58, 100, 134, 216, 91, 5, 231, 185,
-            140, 210, 48, 110, 237, 179, 81, 15, 78, 16, 242, 172, 47, 113, 147, 205,
-            17, 79, 173, 243, 112, 46, 204, 146, 211, 141, 111, 49, 178, 236, 14, 80,
-            175, 241, 19, 77, 206, 144, 114, 44, 109, 51, 209, 143, 12, 82, 176, 238,
-            50, 108, 142, 208, 83, 13, 239, 177, 240, 174, 76, 18, 145, 207, 45, 115,
-            202, 148, 118, 40, 171, 245, 23, 73, 8, 86, 180, 234, 105, 55, 213, 139,
-            87, 9, 235, 181, 54, 104, 138, 212, 149, 203, 41, 119, 244, 170, 72, 22,
-            233, 183, 85, 11, 136, 214, 52, 106, 43, 117, 151, 201, 74, 20, 246, 168,
-            116, 42, 200, 150, 21, 75, 169, 247, 182, 232, 10, 84, 215, 137, 107, 53
-    };
-
-    return table[crc ^ data];
-}
-
-static uint8_t _calc_crc_block(uint8_t crc, const uint8_t * buffer, size_t len)
-{
-    do
-    {
-        crc = _calc_crc(crc, *buffer++);
-        ESP_LOGD(TAG, "crc 0x%02x, len %d", (int)crc, (int)len);
-    }
-    while (--len > 0);
-    return crc;
-}
-
 /**
  * @param[out] is_found true if a device was found, false if not
  * @return status
  */
-static owb_status _search(const OneWireBus * bus, OneWireBus_SearchState * state, bool *is_found)
+static owb_status _search(const OneWireBus * bus, OneWireBus_SearchState * state, uint8_t command, bool *is_found)
 {
     // Based on https://www.maximintegrated.com/en/app-notes/index.mvp/id/187
 
@@ -140,7 +97,7 @@ static owb_status _search(const OneWireBus * bus, OneWireBus_SearchState * state
         }
 
         // issue the search command
-        bus->driver->write_bits(bus, OWB_ROM_SEARCH, 8);
+        bus->driver->write_bits(bus, command, 8);
 
         // loop to do the search
         do
@@ -347,7 +304,7 @@ owb_status owb_verify_rom(const OneWireBus * bus, OneWireBus_ROMCode rom_code, b
         };
 
         bool is_found;
-        _search(bus, &state, &is_found);
+        _search(bus, &state, OWB_ROM_SEARCH, &is_found);
         if (is_found)
         {
             result = true;
@@ -386,6 +343,27 @@ owb_status owb_reset(const OneWireBus * bus, bool* a_device_present)
     return status;
 }
 
+owb_status owb_set_speed(const OneWireBus * bus, owb_speed speed)
+{
+    owb_status status;
+
+    if(!bus)
+    {
+        status = OWB_STATUS_PARAMETER_NULL;
+    } else if (!_is_init(bus))
+    {
+        status = OWB_STATUS_NOT_INITIALIZED;
+    } else if (bus->driver->set_speed)
+    {
+        status = bus->driver->set_speed(bus, speed);
+    } else
+    {
+        status = (speed == OWB_SPEED_STANDARD) ? OWB_STATUS_OK : OWB_STATUS_NOT_SUPPORTED;
+    }
+
+    return status;
+}
+
 owb_status owb_write_byte(const OneWireBus * bus, uint8_t data)
 {
     owb_status status;
@@ -424,7 +402,7 @@ owb_status owb_read_byte(const OneWireBus * bus, uint8_t *out)
     return status;
 }
 
-owb_status owb_read_bytes(const OneWireBus * bus, uint8_t * buffer, unsigned int len)
+owb_status owb_read_bytes(const OneWireBus * bus, uint8_t * buffer, size_t len)
 {
     owb_status status;
 
@@ -434,9 +412,12 @@ owb_status owb_read_bytes(const OneWireBus * bus, uint8_t * buffer, unsigned int
     } else if (!_is_init(bus))
     {
         status = OWB_STATUS_NOT_INITIALIZED;
+    } else if (bus->driver->read_bytes)
+    {
+        status = bus->driver->read_bytes(bus, buffer, len);
     } else
     {
-        for (int i = 0; i < len; ++i)
+        for (size_t i = 0; i < len; ++i)
         {
             uint8_t out;
             bus->driver->read_bits(bus, &out, 8);
@@ -449,7 +430,7 @@ owb_status owb_read_bytes(const OneWireBus * bus, uint8_t * buffer, unsigned int
     return status;
 }
 
-owb_status owb_write_bytes(const OneWireBus * bus, const uint8_t * buffer, unsigned int len)
+owb_status owb_write_bytes(const OneWireBus * bus, const uint8_t * buffer, size_t len)
 {
     owb_status status;
 
@@ -459,9 +440,12 @@ owb_status owb_write_bytes(const OneWireBus * bus, const uint8_t * buffer, unsig
     } else if (!_is_init(bus))
     {
         status = OWB_STATUS_NOT_INITIALIZED;
+    } else if (bus->driver->write_bytes)
+    {
+        status = bus->driver->write_bytes(bus, buffer, len);
     } else
     {
-        for (int i = 0; i < len; i++)
+        for (size_t i = 0; i < len; i++)
         {
             bus->driver->write_bits(bus, buffer[i], 8);
         }
@@ -493,15 +477,16 @@ owb_status owb_write_rom_code(const OneWireBus * bus, OneWireBus_ROMCode rom_cod
 
 uint8_t owb_crc8_byte(uint8_t crc, uint8_t data)
 {
-    return _calc_crc(crc, data);
+    // table driven, shared with the other 1-Wire and I2C crc users
+    return crc8_maxim_update(crc, &data, 1);
 }
 
 uint8_t owb_crc8_bytes(uint8_t crc, const uint8_t * data, size_t len)
 {
-    return _calc_crc_block(crc, data, len);
+    return crc8_maxim_update(crc, data, len);
 }
 
-owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * state, bool* found_device)
+static owb_status _search_first(const OneWireBus * bus, OneWireBus_SearchState * state, uint8_t command, bool* found_device)
 {
     bool result;
     owb_status status;
@@ -518,7 +503,7 @@ owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * sta
         state->last_discrepancy = 0;
         state->last_family_discrepancy = 0;
         state->last_device_flag = false;
-        _search(bus, state, &result);
+        _search(bus, state, command, &result);
         status = OWB_STATUS_OK;
 
         *found_device = result;
@@ -527,7 +512,7 @@ owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * sta
     return status;
 }
 
-owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool* found_device)
+static owb_status _search_next(const OneWireBus * bus, OneWireBus_SearchState * state, uint8_t command, bool* found_device)
 {
     owb_status status;
     bool result = false;
@@ -540,7 +525,7 @@ owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * stat
         status = OWB_STATUS_NOT_INITIALIZED;
     } else
     {
-        _search(bus, state, &result);
+        _search(bus, state, command, &result);
         status = OWB_STATUS_OK;
 
         *found_device = result;
@@ -549,6 +534,26 @@ owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * stat
     return status;
 }
 
+owb_status owb_search_first(const OneWireBus * bus, OneWireBus_SearchState * state, bool* found_device)
+{
+    return _search_first(bus, state, OWB_ROM_SEARCH, found_device);
+}
+
+owb_status owb_search_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool* found_device)
+{
+    return _search_next(bus, state, OWB_ROM_SEARCH, found_device);
+}
+
+owb_status owb_search_conditional_first(const OneWireBus * bus, OneWireBus_SearchState * state, bool* found_device)
+{
+    return _search_first(bus, state, OWB_ROM_SEARCH_ALARM, found_device);
+}
+
+owb_status owb_search_conditional_next(const OneWireBus * bus, OneWireBus_SearchState * state, bool* found_device)
+{
+    return _search_next(bus, state, OWB_ROM_SEARCH_ALARM, found_device);
+}
+
 char * owb_string_from_rom_code(OneWireBus_ROMCode rom_code, char * buffer, size_t len)
 {
     for (int i = sizeof(rom_code.bytes) - 1; i >= 0; i--)
@@ -252,7 +252,10 @@ static const struct owb_driver gpio_function_table =
     .uninitialize = _uninitialize,
     .reset = _reset,
     .write_bits = _write_bits,
-    .read_bits = _read_bits
+    .read_bits = _read_bits,
+    .write_bytes = NULL,
+    .read_bytes = NULL,
+    .set_speed = NULL
 };
 
 OneWireBus* owb_gpio_initialize(owb_gpio_driver_info *driver_info, int gpio)
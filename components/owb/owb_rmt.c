@@ -57,32 +57,62 @@ sample code bearing this copyright.
 */
 
 #include "owb/owb.h"
+#include "owb/owb_rmt.h"
 
 #include "driver/rmt.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 
+#include <string.h>
+
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
 #undef OW_DEBUG
 
 
-// bus reset: duration of low phase [us]
-#define OW_DURATION_RESET 480
-// overall slot duration
-#define OW_DURATION_SLOT 75
-// write 1 slot and read slot durations [us]
-#define OW_DURATION_1_LOW    2
-#define OW_DURATION_1_HIGH (OW_DURATION_SLOT - OW_DURATION_1_LOW)
-// write 0 slot durations [us]
-#define OW_DURATION_0_LOW   65
-#define OW_DURATION_0_HIGH (OW_DURATION_SLOT - OW_DURATION_0_LOW)
-// sample time for read slot
-#define OW_DURATION_SAMPLE  (15-2)
-// RX idle threshold
-// needs to be larger than any duration occurring during write slots
-#define OW_DURATION_RX_IDLE (OW_DURATION_SLOT + 2)
+// RMT channels tick at 0.1us (80MHz APB / 8) so overdrive slots can be resolved
+#define OW_RMT_CLK_DIV 8
+#define OW_TICKS_PER_US 10
+#define OW_US(us) ((uint16_t)((us) * OW_TICKS_PER_US))
+
+// per speed slot and reset timing, all durations are in RMT ticks
+struct owb_rmt_timing
+{
+    uint16_t reset_low;      // bus reset: duration of low phase
+    uint16_t reset_rx_idle;  // RX idle threshold while waiting for the presence pulse
+    uint16_t slot;           // overall slot duration
+    uint16_t one_low;        // write 1 slot and read slot low duration
+    uint16_t zero_low;       // write 0 slot low duration
+    uint16_t sample;         // sample time for read slot
+    uint16_t rx_idle;        // RX idle threshold, larger than any duration occurring during write slots
+};
+
+static const struct owb_rmt_timing _standard_timing = {
+    .reset_low = OW_US(480),
+    .reset_rx_idle = OW_US(480 + 60),
+    .slot = OW_US(75),
+    .one_low = OW_US(2),
+    .zero_low = OW_US(65),
+    .sample = OW_US(15 - 2),
+    .rx_idle = OW_US(75 + 2),
+};
+
+// overdrive values from https://www.maximintegrated.com/en/app-notes/index.mvp/id/126
+static const struct owb_rmt_timing _overdrive_timing = {
+    .reset_low = OW_US(70),
+    .reset_rx_idle = OW_US(70 + 20),
+    .slot = OW_US(10),
+    .one_low = OW_US(1),
+    .zero_low = OW_US(8),
+    .sample = OW_US(2),
+    .rx_idle = OW_US(10 + 2),
+};
+
+// maximum bytes encoded into a single RMT transaction
+// one item per bit plus the end marker must fit in the channel's single memory block (64 items)
+#define OW_MAX_BYTES_PER_XFER 7
+#define OW_MAX_ITEMS_PER_XFER ((OW_MAX_BYTES_PER_XFER * 8) + 1)
 
 
 static const char * TAG = "owb_rmt";
@@ -111,15 +141,14 @@ static owb_status _reset( const OneWireBus *bus, bool *is_present )
     int res = OWB_STATUS_OK;
 
     owb_rmt_driver_info *i = info_of_driver(bus);
+    const struct owb_rmt_timing *t = i->timing;
 
-    tx_items[0].duration0 = OW_DURATION_RESET;
+    tx_items[0].duration0 = t->reset_low;
     tx_items[0].level0 = 0;
     tx_items[0].duration1 = 0;
     tx_items[0].level1 = 1;
 
-    uint16_t old_rx_thresh;
-    rmt_get_rx_idle_thresh( i->rx_channel, &old_rx_thresh );
-    rmt_set_rx_idle_thresh( i->rx_channel, OW_DURATION_RESET+60 );
+    rmt_set_rx_idle_thresh( i->rx_channel, t->reset_rx_idle );
 
     onewire_flush_rmt_rx_buf(bus);
     rmt_rx_start( i->rx_channel, true );
@@ -142,7 +171,7 @@ static owb_status _reset( const OneWireBus *bus, bool *is_present )
 #endif
 
                 // parse signal and search for presence pulse
-                if ((rx_items[0].level0 == 0) && (rx_items[0].duration0 >= OW_DURATION_RESET - 2))
+                if ((rx_items[0].level0 == 0) && (rx_items[0].duration0 >= t->reset_low - OW_US(2)))
                 {
                     if ((rx_items[0].level1 == 1) && (rx_items[0].duration1 > 0))
                     {
@@ -168,7 +197,7 @@ static owb_status _reset( const OneWireBus *bus, bool *is_present )
     }
 
     rmt_rx_stop( i->rx_channel );
-    rmt_set_rx_idle_thresh( i->rx_channel, old_rx_thresh );
+    rmt_set_rx_idle_thresh( i->rx_channel, t->rx_idle );
 
     *is_present = _is_present;
 
@@ -177,7 +206,7 @@ static owb_status _reset( const OneWireBus *bus, bool *is_present )
     return res;
 }
 
-static rmt_item32_t _encode_write_slot( uint8_t val )
+static rmt_item32_t _encode_write_slot( const struct owb_rmt_timing *t, uint8_t val )
 {
     rmt_item32_t item;
 
@@ -185,12 +214,12 @@ static rmt_item32_t _encode_write_slot( uint8_t val )
     item.level1 = 1;
     if (val) {
         // write "1" slot
-        item.duration0 = OW_DURATION_1_LOW;
-        item.duration1 = OW_DURATION_1_HIGH;
+        item.duration0 = t->one_low;
+        item.duration1 = t->slot - t->one_low;
     } else {
         // write "0" slot
-        item.duration0 = OW_DURATION_0_LOW;
-        item.duration1 = OW_DURATION_0_HIGH;
+        item.duration0 = t->zero_low;
+        item.duration1 = t->slot - t->zero_low;
     }
 
     return item;
@@ -207,7 +236,7 @@ static owb_status _write_bits( const OneWireBus * bus, uint8_t out, int number_o
 
     // write requested bits as pattern to TX buffer
     for (int i = 0; i < number_of_bits_to_write; i++) {
-        tx_items[i] = _encode_write_slot( out & 0x01 );
+        tx_items[i] = _encode_write_slot( info->timing, out & 0x01 );
         out >>= 1;
     }
 
@@ -229,19 +258,30 @@ static owb_status _write_bits( const OneWireBus * bus, uint8_t out, int number_o
     return status;
 }
 
-static rmt_item32_t _encode_read_slot( void )
+static rmt_item32_t _encode_read_slot( const struct owb_rmt_timing *t )
 {
     rmt_item32_t item;
 
     // construct pattern for a single read time slot
     item.level0    = 0;
-    item.duration0 = OW_DURATION_1_LOW;   // shortly force 0
+    item.duration0 = t->one_low;            // shortly force 0
     item.level1    = 1;
-    item.duration1 = OW_DURATION_1_HIGH;  // release high and finish slot
+    item.duration1 = t->slot - t->one_low;  // release high and finish slot
 
     return item;
 }
 
+static uint8_t _decode_read_slot( const struct owb_rmt_timing *t, const rmt_item32_t *item )
+{
+    // rising edge occured before the sample time -> bit 1
+    if ((item->level1 == 1) && (item->level0 == 0) && (item->duration0 < t->sample))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
 /** NOTE: Data is read into the high bits, eg. each bit read is shifted down before the next bit is read */
 static owb_status _read_bits( const OneWireBus * bus, uint8_t *in, int number_of_bits_to_read )
 {
@@ -260,7 +300,7 @@ static owb_status _read_bits( const OneWireBus * bus, uint8_t *in, int number_of
     // generate requested read slots
     for (int i = 0; i < number_of_bits_to_read; i++)
     {
-        tx_items[i] = _encode_read_slot();
+        tx_items[i] = _encode_read_slot( info->timing );
     }
 
     // end marker
@@ -290,13 +330,9 @@ static owb_status _read_bits( const OneWireBus * bus, uint8_t *in, int number_of
                 {
                     read_data >>= 1;
                     // parse signal and identify logical bit
-                    if (rx_items[i].level1 == 1)
+                    if (_decode_read_slot( info->timing, &rx_items[i] ))
                     {
-                        if ((rx_items[i].level0 == 0) && (rx_items[i].duration0 < OW_DURATION_SAMPLE))
-                        {
-                            // rising edge occured before 15us -> bit 1
-                            read_data |= 0x80;
-                        }
+                        read_data |= 0x80;
                     }
                 }
 
@@ -323,6 +359,128 @@ static owb_status _read_bits( const OneWireBus * bus, uint8_t *in, int number_of
     return res;
 }
 
+/** NOTE: Each byte is written lsb first, up to OW_MAX_BYTES_PER_XFER bytes per RMT transaction */
+static owb_status _write_bytes( const OneWireBus * bus, const uint8_t *out, size_t len )
+{
+    rmt_item32_t tx_items[OW_MAX_ITEMS_PER_XFER];
+    owb_rmt_driver_info *info = info_of_driver(bus);
+
+    while (len > 0)
+    {
+        const size_t chunk = (len > OW_MAX_BYTES_PER_XFER) ? OW_MAX_BYTES_PER_XFER : len;
+        const int number_of_bits_to_write = chunk * 8;
+
+        // write requested bytes as pattern to TX buffer
+        for (size_t b = 0; b < chunk; b++)
+        {
+            uint8_t val = out[b];
+
+            for (int i = 0; i < 8; i++)
+            {
+                tx_items[(b * 8) + i] = _encode_write_slot( info->timing, val & 0x01 );
+                val >>= 1;
+            }
+        }
+
+        // end marker
+        tx_items[number_of_bits_to_write].level0 = 1;
+        tx_items[number_of_bits_to_write].duration0 = 0;
+
+        if (rmt_write_items( info->tx_channel, tx_items, number_of_bits_to_write+1, true ) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "rmt_write_items() failed");
+            return OWB_STATUS_HW_ERROR;
+        }
+
+        out += chunk;
+        len -= chunk;
+    }
+
+    return OWB_STATUS_OK;
+}
+
+/** NOTE: Each byte is read lsb first, up to OW_MAX_BYTES_PER_XFER bytes per RMT transaction */
+static owb_status _read_bytes( const OneWireBus * bus, uint8_t *in, size_t len )
+{
+    rmt_item32_t tx_items[OW_MAX_ITEMS_PER_XFER];
+    owb_rmt_driver_info *info = info_of_driver(bus);
+    int res = OWB_STATUS_OK;
+
+    // the read slot pattern is identical for every bit, generate it once
+    for (int i = 0; i < (OW_MAX_ITEMS_PER_XFER - 1); i++)
+    {
+        tx_items[i] = _encode_read_slot( info->timing );
+    }
+
+    while ((len > 0) && (res == OWB_STATUS_OK))
+    {
+        const size_t chunk = (len > OW_MAX_BYTES_PER_XFER) ? OW_MAX_BYTES_PER_XFER : len;
+        const int number_of_bits_to_read = chunk * 8;
+
+        // end marker
+        tx_items[number_of_bits_to_read].level0 = 1;
+        tx_items[number_of_bits_to_read].duration0 = 0;
+
+        memset(in, 0, chunk);
+
+        onewire_flush_rmt_rx_buf(bus);
+        rmt_rx_start( info->rx_channel, true );
+        if (rmt_write_items( info->tx_channel, tx_items, number_of_bits_to_read+1, true ) == ESP_OK)
+        {
+            size_t rx_size;
+            rmt_item32_t* rx_items = (rmt_item32_t *)xRingbufferReceive( info->rb, &rx_size, portMAX_DELAY );
+
+            if (rx_items)
+            {
+                if (rx_size >= number_of_bits_to_read * sizeof( rmt_item32_t ))
+                {
+                    for (int i = 0; i < number_of_bits_to_read; i++)
+                    {
+                        in[i / 8] |= _decode_read_slot( info->timing, &rx_items[i] ) << (i % 8);
+                    }
+                }
+
+                vRingbufferReturnItem( info->rb, (void *)rx_items );
+            } else
+            {
+                ESP_LOGE(TAG, "%s(): rx_items == 0", __func__);
+
+                // time out occurred, this indicates an unconnected / misconfigured bus
+                res = OWB_STATUS_HW_ERROR;
+            }
+        } else {
+            // error in tx channel
+            ESP_LOGE(TAG, "Error tx");
+            res = OWB_STATUS_HW_ERROR;
+        }
+
+        rmt_rx_stop( info->rx_channel );
+
+        // restore the read slot overwritten by the end marker
+        tx_items[number_of_bits_to_read] = _encode_read_slot( info->timing );
+
+        in += chunk;
+        len -= chunk;
+    }
+
+    return res;
+}
+
+static owb_status _set_speed( const OneWireBus * bus, owb_speed speed )
+{
+    owb_rmt_driver_info *info = info_of_driver(bus);
+
+    info->timing = (speed == OWB_SPEED_OVERDRIVE) ? &_overdrive_timing : &_standard_timing;
+
+    if (rmt_set_rx_idle_thresh( info->rx_channel, info->timing->rx_idle ) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "%s(): failed to set rx idle threshold", __func__);
+        return OWB_STATUS_HW_ERROR;
+    }
+
+    return OWB_STATUS_OK;
+}
+
 static owb_status _uninitialize(const OneWireBus *bus)
 {
     owb_rmt_driver_info *info = info_of_driver(bus);
@@ -339,7 +497,10 @@ static struct owb_driver rmt_function_table =
     .uninitialize = _uninitialize,
     .reset = _reset,
     .write_bits = _write_bits,
-    .read_bits = _read_bits
+    .read_bits = _read_bits,
+    .write_bytes = _write_bytes,
+    .read_bytes = _read_bytes,
+    .set_speed = _set_speed
 };
 
 static owb_status _init( owb_rmt_driver_info *info, uint8_t gpio_num,
@@ -351,6 +512,7 @@ static owb_status _init( owb_rmt_driver_info *info, uint8_t gpio_num,
     info->tx_channel = tx_channel;
     info->rx_channel = rx_channel;
     info->gpio = gpio_num;
+    info->timing = &_standard_timing;
 
 #ifdef OW_DEBUG
     ESP_LOGI(TAG, "RMT TX channel: %d", info->tx_channel);
@@ -361,7 +523,7 @@ static owb_status _init( owb_rmt_driver_info *info, uint8_t gpio_num,
     rmt_tx.channel = info->tx_channel;
     rmt_tx.gpio_num = gpio_num;
     rmt_tx.mem_block_num = 1;
-    rmt_tx.clk_div = 80;
+    rmt_tx.clk_div = OW_RMT_CLK_DIV;
     rmt_tx.tx_config.loop_en = false;
     rmt_tx.tx_config.carrier_en = false;
     rmt_tx.tx_config.idle_level = 1;
@@ -374,12 +536,12 @@ static owb_status _init( owb_rmt_driver_info *info, uint8_t gpio_num,
             rmt_config_t rmt_rx;
             rmt_rx.channel = info->rx_channel;
             rmt_rx.gpio_num = gpio_num;
-            rmt_rx.clk_div = 80;
+            rmt_rx.clk_div = OW_RMT_CLK_DIV;
             rmt_rx.mem_block_num = 1;
             rmt_rx.rmt_mode = RMT_MODE_RX;
             rmt_rx.rx_config.filter_en = true;
             rmt_rx.rx_config.filter_ticks_thresh = 30;
-            rmt_rx.rx_config.idle_threshold = OW_DURATION_RX_IDLE;
+            rmt_rx.rx_config.idle_threshold = _standard_timing.rx_idle;
             if (rmt_config( &rmt_rx ) == ESP_OK)
             {
                 if (rmt_driver_install( rmt_rx.channel, 512, ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM | ESP_INTR_FLAG_SHARED ) == ESP_OK)
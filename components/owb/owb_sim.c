@@ -0,0 +1,901 @@
+/*
+    owb_sim.c -- Simulated 1-Wire Bus
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "crc/crc.h"
+#include "owb/owb.h"
+#include "owb/owb_sim.h"
+
+#define info_of_driver(owb) container_of(owb, owb_sim_driver_info, bus)
+
+// default slot (including recovery) and reset (including presence detect) durations
+// from https://www.maximintegrated.com/en/app-notes/index.mvp/id/126
+static const uint32_t _default_slot_us[2] = {70, 10};
+static const uint32_t _default_reset_us[2] = {960, 148};
+
+// DS2408 pio registers (0x88 - 0x8f)
+#define DS2408_REG_BASE 0x88
+#define DS2408_REG_CONTROL_LAST 0x8d
+enum { PIO_LOGIC, OUTPUT_LATCH, ACTIVITY, CS_MASK, CS_POLARITY, CONTROL, NUM_REGS = 8 };
+enum { PLS = 0x01, CT = 0x02, ROS = 0x04, PORL = 0x08, VCCP = 0x80 };
+
+typedef enum
+{
+    SIM_IDLE,        // not selected, ignores slots until the next reset
+    SIM_ROM_CMD,     // receiving the rom command
+    SIM_ROM_MATCH,   // receiving the rom code of a match rom
+    SIM_ROM_READ,    // transmitting the rom code
+    SIM_ROM_SEARCH,  // search triplets (id bit, complement bit, direction)
+    SIM_FUNC_CMD,    // selected, receiving the function command
+    SIM_FUNC_RX,     // receiving function command data
+    SIM_FUNC_TX,     // transmitting function command data
+    SIM_CONVERT      // DS18B20 conversion in progress, read slots are held low
+} sim_state;
+
+struct owb_sim_device
+{
+    OneWireBus_ROMCode rom;
+    bool present;
+    bool overdrive;
+    bool od_match;            // overdrive entered by overdrive match rom, left on a mismatch
+
+    sim_state state;
+    int rom_bit;              // bit of the rom code being matched or searched
+    int search_phase;
+    uint8_t cmd;              // function command
+
+    uint8_t rx[3];            // function command data received
+    size_t rx_len;
+    size_t rx_need;
+    uint8_t rx_byte;
+    int rx_bits;
+
+    uint8_t tx[36];           // function command data to transmit
+    size_t tx_len;
+    size_t tx_bit;
+
+    // DS18B20
+    bool parasite;
+    bool alarm;
+    float celsius;
+    uint8_t scratchpad[9];
+    uint8_t eeprom[3];
+    uint64_t convert_done_at; // time (see _now) the conversion completes
+
+    // DS2408
+    uint8_t regs[NUM_REGS];
+    uint8_t inputs;
+    uint8_t reg_addr;
+};
+
+static uint64_t _now(const owb_sim_driver_info *info)
+{
+    return info->clock_us ? info->clock_us() : info->bus_time_us;
+}
+
+static void _busy(owb_sim_driver_info *info, uint32_t us)
+{
+    info->bus_time_us += us;
+    if (info->busy_us) info->busy_us(us);
+}
+
+static bool _is_ds2408(const struct owb_sim_device *dev)
+{
+    return dev->rom.fields.family[0] == OWB_SIM_FAMILY_DS2408;
+}
+
+static uint16_t _crc16_inverted(uint16_t crc)
+{
+    return ~crc;
+}
+
+static void _tx_load(struct owb_sim_device *dev, const uint8_t *data, size_t len)
+{
+    memcpy(dev->tx, data, len);
+    dev->tx_len = len;
+    dev->tx_bit = 0;
+}
+
+static void _tx_ones(struct owb_sim_device *dev)
+{
+    static const uint8_t ones = 0xff;
+    _tx_load(dev, &ones, 1);
+}
+
+static void _rx_expect(struct owb_sim_device *dev, size_t len)
+{
+    dev->state = SIM_FUNC_RX;
+    dev->rx_len = 0;
+    dev->rx_need = len;
+}
+
+//
+// DS18B20
+//
+
+static void _ds18b20_scratchpad_crc(struct owb_sim_device *dev)
+{
+    dev->scratchpad[8] = crc8_maxim_update(CRC8_MAXIM_INIT, dev->scratchpad, 8);
+}
+
+static bool _ds18b20_converting(const owb_sim_driver_info *info, struct owb_sim_device *dev)
+{
+    if (dev->convert_done_at == 0) return false;
+    if (_now(info) < dev->convert_done_at) return true;
+
+    // conversion complete, the unused low bits are undefined at lower resolutions (cleared here)
+    const int resolution = 9 + ((dev->scratchpad[4] >> 5) & 0x03);
+    int16_t raw = (int16_t)(dev->celsius * 16.0f + ((dev->celsius < 0) ? -0.5f : 0.5f));
+    raw &= ~((1 << (12 - resolution)) - 1);
+
+    dev->scratchpad[0] = raw & 0xff;
+    dev->scratchpad[1] = (raw >> 8) & 0xff;
+    _ds18b20_scratchpad_crc(dev);
+
+    const int whole = raw / 16;
+    dev->alarm = (whole >= (int8_t)dev->scratchpad[2]) || (whole <= (int8_t)dev->scratchpad[3]);
+    dev->convert_done_at = 0;
+
+    return false;
+}
+
+static void _ds18b20_function(owb_sim_driver_info *info, struct owb_sim_device *dev)
+{
+    switch (dev->cmd)
+    {
+    case 0x44: // convert t
+    {
+        const int resolution = 9 + ((dev->scratchpad[4] >> 5) & 0x03);
+        dev->convert_done_at = _now(info) + (93750 << (resolution - 9));
+        dev->state = SIM_CONVERT;
+        break;
+    }
+
+    case 0xbe: // read scratchpad
+        _ds18b20_converting(info, dev);
+        _tx_load(dev, dev->scratchpad, sizeof(dev->scratchpad));
+        dev->state = SIM_FUNC_TX;
+        break;
+
+    case 0x4e: // write scratchpad (th, tl, config)
+        _rx_expect(dev, 3);
+        break;
+
+    case 0x48: // copy scratchpad
+        memcpy(dev->eeprom, &dev->scratchpad[2], sizeof(dev->eeprom));
+        _tx_ones(dev);
+        dev->state = SIM_FUNC_TX;
+        break;
+
+    case 0xb8: // recall eeprom
+        memcpy(&dev->scratchpad[2], dev->eeprom, sizeof(dev->eeprom));
+        _ds18b20_scratchpad_crc(dev);
+        _tx_ones(dev);
+        dev->state = SIM_FUNC_TX;
+        break;
+
+    case 0xb4: // read power supply, parasite powered devices pull the read slots low
+    {
+        const uint8_t powered = dev->parasite ? 0x00 : 0xff;
+        _tx_load(dev, &powered, 1);
+        dev->state = SIM_FUNC_TX;
+        break;
+    }
+
+    default:
+        dev->state = SIM_IDLE;
+    }
+}
+
+static void _ds18b20_data(struct owb_sim_device *dev)
+{
+    // write scratchpad, only the resolution bits of the config register are writable
+    dev->scratchpad[2] = dev->rx[0];
+    dev->scratchpad[3] = dev->rx[1];
+    dev->scratchpad[4] = (dev->rx[2] & 0x60) | 0x1f;
+    _ds18b20_scratchpad_crc(dev);
+
+    dev->state = SIM_IDLE;
+}
+
+//
+// DS2408
+//
+
+static void _ds2408_pins(struct owb_sim_device *dev)
+{
+    // a pin is low when either the output transistor is on (latch zero) or it is driven low
+    const uint8_t logic = dev->regs[OUTPUT_LATCH] & dev->inputs;
+
+    dev->regs[ACTIVITY] |= dev->regs[PIO_LOGIC] ^ logic;
+    dev->regs[PIO_LOGIC] = logic;
+}
+
+static bool _ds2408_condition(const struct owb_sim_device *dev)
+{
+    const uint8_t control = dev->regs[CONTROL];
+    const uint8_t mask = dev->regs[CS_MASK];
+
+    if (control & PORL) return true;
+    if (mask == 0x00) return false;
+
+    const uint8_t source = (control & PLS) ? dev->regs[ACTIVITY] : dev->regs[PIO_LOGIC];
+    const uint8_t matched = ~(source ^ dev->regs[CS_POLARITY]) & mask;
+
+    return (control & CT) ? (matched == mask) : (matched != 0x00);
+}
+
+static void _ds2408_channel_samples(struct owb_sim_device *dev, bool first)
+{
+    // 32 pin state samples followed by the inverted crc16.  the first crc includes the command byte.
+    uint8_t samples[34];
+    memset(samples, dev->regs[PIO_LOGIC], 32);
+
+    uint16_t crc = first ? crc16_maxim_update(CRC16_MAXIM_INIT, &dev->cmd, 1) : CRC16_MAXIM_INIT;
+    crc = _crc16_inverted(crc16_maxim_update(crc, samples, 32));
+    samples[32] = crc & 0xff;
+    samples[33] = crc >> 8;
+
+    _tx_load(dev, samples, sizeof(samples));
+}
+
+static void _ds2408_function(struct owb_sim_device *dev)
+{
+    switch (dev->cmd)
+    {
+    case 0xf5: // channel access read
+        _ds2408_channel_samples(dev, true);
+        dev->state = SIM_FUNC_TX;
+        break;
+
+    case 0x5a: // channel access write (data, inverted data)
+    case 0xf0: // read pio registers (target address)
+    case 0xcc: // write conditional search register (target address, data...)
+        _rx_expect(dev, 2);
+        break;
+
+    case 0xc3: // reset activity latches
+    {
+        static const uint8_t confirm = 0xaa;
+        dev->regs[ACTIVITY] = 0x00;
+        _tx_load(dev, &confirm, 1);
+        dev->state = SIM_FUNC_TX;
+        break;
+    }
+
+    default:
+        dev->state = SIM_IDLE;
+    }
+}
+
+static void _ds2408_data(struct owb_sim_device *dev)
+{
+    switch (dev->cmd)
+    {
+    case 0x5a:
+    {
+        if (dev->rx[0] != (uint8_t)~dev->rx[1])
+        {
+            dev->state = SIM_IDLE;
+            break;
+        }
+
+        dev->regs[OUTPUT_LATCH] = dev->rx[0];
+        _ds2408_pins(dev);
+
+        const uint8_t confirm[] = {0xaa, dev->regs[PIO_LOGIC]};
+        _tx_load(dev, confirm, sizeof(confirm));
+        dev->state = SIM_FUNC_TX;
+        break;
+    }
+
+    case 0xf0:
+    {
+        const uint16_t addr = dev->rx[0] | (dev->rx[1] << 8);
+        if ((addr < DS2408_REG_BASE) || (addr >= (DS2408_REG_BASE + NUM_REGS)))
+        {
+            dev->state = SIM_IDLE;
+            break;
+        }
+
+        // registers from the target address to the end followed by the inverted crc16
+        // of the command, target address and data
+        const size_t len = NUM_REGS - (addr - DS2408_REG_BASE);
+        uint8_t data[NUM_REGS + 2];
+        memcpy(data, &dev->regs[addr - DS2408_REG_BASE], len);
+
+        uint16_t crc = crc16_maxim_update(CRC16_MAXIM_INIT, &dev->cmd, 1);
+        crc = crc16_maxim_update(crc, dev->rx, 2);
+        crc = _crc16_inverted(crc16_maxim_update(crc, data, len));
+        data[len] = crc & 0xff;
+        data[len + 1] = crc >> 8;
+
+        _tx_load(dev, data, len + 2);
+        dev->state = SIM_FUNC_TX;
+        break;
+    }
+
+    case 0xcc:
+    {
+        if (dev->rx_len == 2)
+        {
+            // target address received, the data bytes that follow are written one at a time
+            dev->reg_addr = dev->rx[0];
+            if ((dev->rx[1] != 0x00) || (dev->reg_addr < (DS2408_REG_BASE + CS_MASK)) ||
+                (dev->reg_addr > DS2408_REG_CONTROL_LAST))
+            {
+                dev->state = SIM_IDLE;
+                break;
+            }
+
+            _rx_expect(dev, 1);
+            break;
+        }
+
+        const uint8_t data = dev->rx[0];
+        const int reg = dev->reg_addr - DS2408_REG_BASE;
+
+        if (reg == CONTROL)
+        {
+            // PLS, CT and ROS are writable, writing zero clears the power on reset latch
+            dev->regs[CONTROL] = VCCP | (data & (PLS | CT | ROS)) | (dev->regs[CONTROL] & data & PORL);
+        } else
+        {
+            dev->regs[reg] = data;
+        }
+
+        dev->reg_addr++;
+        if (dev->reg_addr > DS2408_REG_CONTROL_LAST)
+            dev->state = SIM_IDLE;
+        else
+            _rx_expect(dev, 1);
+        break;
+    }
+    }
+}
+
+//
+// slot level behavior common to all devices
+//
+
+static void _rom_command(owb_sim_driver_info *info, struct owb_sim_device *dev, uint8_t cmd)
+{
+    const bool od_capable = _is_ds2408(dev);
+
+    dev->rom_bit = 0;
+    dev->search_phase = 0;
+    dev->od_match = false;
+
+    switch (cmd)
+    {
+    case OWB_ROM_READ:
+        _tx_load(dev, dev->rom.bytes, sizeof(dev->rom.bytes));
+        dev->state = SIM_ROM_READ;
+        break;
+
+    case OWB_ROM_MATCH_OVERDRIVE:
+        if (!od_capable)
+        {
+            dev->state = SIM_IDLE;
+            break;
+        }
+
+        // the rom code that follows is sent at overdrive
+        dev->overdrive = true;
+        dev->od_match = true;
+        // fall through
+
+    case OWB_ROM_MATCH:
+        dev->state = SIM_ROM_MATCH;
+        break;
+
+    case OWB_ROM_SKIP_OVERDRIVE:
+        if (!od_capable)
+        {
+            dev->state = SIM_IDLE;
+            break;
+        }
+
+        dev->overdrive = true;
+        // fall through
+
+    case OWB_ROM_SKIP:
+        dev->state = SIM_FUNC_CMD;
+        break;
+
+    case OWB_ROM_SEARCH_ALARM:
+        if (_is_ds2408(dev) ? !_ds2408_condition(dev) : !dev->alarm)
+        {
+            dev->state = SIM_IDLE;
+            break;
+        }
+        // fall through
+
+    case OWB_ROM_SEARCH:
+        dev->state = SIM_ROM_SEARCH;
+        break;
+
+    default:
+        dev->state = SIM_IDLE;
+    }
+}
+
+static void _rx_byte(owb_sim_driver_info *info, struct owb_sim_device *dev, uint8_t byte)
+{
+    switch (dev->state)
+    {
+    case SIM_ROM_CMD:
+        _rom_command(info, dev, byte);
+        break;
+
+    case SIM_FUNC_CMD:
+        dev->cmd = byte;
+        if (_is_ds2408(dev))
+            _ds2408_function(dev);
+        else
+            _ds18b20_function(info, dev);
+        break;
+
+    case SIM_FUNC_RX:
+        dev->rx[dev->rx_len++] = byte;
+        if (dev->rx_len < dev->rx_need) break;
+
+        if (_is_ds2408(dev))
+            _ds2408_data(dev);
+        else
+            _ds18b20_data(dev);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static int _tx_bit(struct owb_sim_device *dev)
+{
+    const int bit = (dev->tx[dev->tx_bit / 8] >> (dev->tx_bit % 8)) & 0x01;
+
+    if (++dev->tx_bit < (dev->tx_len * 8)) return bit;
+
+    // transmit buffer exhausted, queue what the device sends next
+    if (dev->state == SIM_ROM_READ)
+    {
+        dev->state = SIM_FUNC_CMD;
+    } else if (dev->cmd == 0xf5)
+    {
+        // channel access read continues until reset
+        _ds2408_channel_samples(dev, false);
+    } else if (dev->cmd == 0x5a)
+    {
+        // channel access write accepts another data byte pair
+        _rx_expect(dev, 2);
+    } else if ((dev->cmd == 0xc3) || (dev->cmd == 0xb4))
+    {
+        // reset activity latches and read power supply repeat until reset
+        dev->tx_bit = 0;
+    } else
+    {
+        _tx_ones(dev);
+    }
+
+    return bit;
+}
+
+static void _write_slot(owb_sim_driver_info *info, struct owb_sim_device *dev, int bit)
+{
+    switch (dev->state)
+    {
+    case SIM_ROM_CMD:
+    case SIM_FUNC_CMD:
+    case SIM_FUNC_RX:
+        dev->rx_byte = (dev->rx_byte >> 1) | (bit ? 0x80 : 0x00);
+        if (++dev->rx_bits == 8)
+        {
+            dev->rx_bits = 0;
+            _rx_byte(info, dev, dev->rx_byte);
+        }
+        break;
+
+    case SIM_ROM_MATCH:
+    {
+        const int rom_bit = (dev->rom.bytes[dev->rom_bit / 8] >> (dev->rom_bit % 8)) & 0x01;
+
+        if (bit != rom_bit)
+        {
+            // a match rom at overdrive leaves the devices not matched at overdrive
+            dev->state = SIM_IDLE;
+            if (dev->od_match) dev->overdrive = false;
+        } else if (++dev->rom_bit == 64)
+        {
+            dev->state = SIM_FUNC_CMD;
+        }
+        break;
+    }
+
+    case SIM_ROM_SEARCH:
+    {
+        if (dev->search_phase != 2) break;
+
+        const int rom_bit = (dev->rom.bytes[dev->rom_bit / 8] >> (dev->rom_bit % 8)) & 0x01;
+        dev->search_phase = 0;
+
+        // devices not matching the direction chosen by the master drop out of the search
+        if (bit != rom_bit)
+            dev->state = SIM_IDLE;
+        else if (++dev->rom_bit == 64)
+            dev->state = SIM_FUNC_CMD;
+        break;
+    }
+
+    case SIM_ROM_READ:
+    case SIM_FUNC_TX:
+        // a write one slot is indistinguishable from a read slot
+        _tx_bit(dev);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static int _read_slot(owb_sim_driver_info *info, struct owb_sim_device *dev)
+{
+    switch (dev->state)
+    {
+    case SIM_ROM_READ:
+    case SIM_FUNC_TX:
+        return _tx_bit(dev);
+
+    case SIM_ROM_SEARCH:
+    {
+        const int rom_bit = (dev->rom.bytes[dev->rom_bit / 8] >> (dev->rom_bit % 8)) & 0x01;
+
+        if (dev->search_phase == 2)
+        {
+            _write_slot(info, dev, 1);
+            return 1;
+        }
+
+        return (dev->search_phase++ == 0) ? rom_bit : !rom_bit;
+    }
+
+    case SIM_CONVERT:
+        return _ds18b20_converting(info, dev) ? 0 : 1;
+
+    case SIM_ROM_CMD:
+    case SIM_ROM_MATCH:
+    case SIM_FUNC_CMD:
+    case SIM_FUNC_RX:
+        // a read slot is indistinguishable from a write one slot
+        _write_slot(info, dev, 1);
+        return 1;
+
+    default:
+        return 1;
+    }
+}
+
+static bool _participates(const owb_sim_driver_info *info, const struct owb_sim_device *dev)
+{
+    // devices only recognize slots at the speed they are operating at
+    return dev->present && (dev->overdrive == (info->speed == OWB_SPEED_OVERDRIVE));
+}
+
+static int _bit_error(owb_sim_driver_info *info)
+{
+    if (info->bit_error_ppm == 0) return 0;
+
+    // xorshift32
+    info->rng ^= info->rng << 13;
+    info->rng ^= info->rng >> 17;
+    info->rng ^= info->rng << 5;
+
+    if ((info->rng % 1000000) >= info->bit_error_ppm) return 0;
+
+    info->bit_errors++;
+    return 1;
+}
+
+//
+// owb driver
+//
+
+static owb_status _reset(const OneWireBus * bus, bool * is_present)
+{
+    owb_sim_driver_info *info = info_of_driver(bus);
+    bool present = false;
+
+    info->resets++;
+    _busy(info, info->reset_us[info->speed]);
+
+    for (size_t i = 0; i < info->count; i++)
+    {
+        struct owb_sim_device *dev = &info->devices[i];
+
+        if (!dev->present) continue;
+
+        // a standard speed reset returns every device to standard speed, devices at standard
+        // speed do not recognize an overdrive reset
+        if (info->speed == OWB_SPEED_STANDARD)
+            dev->overdrive = false;
+        else if (!dev->overdrive)
+            continue;
+
+        dev->state = SIM_ROM_CMD;
+        dev->rx_bits = 0;
+        dev->cmd = 0x00;
+        present = true;
+    }
+
+    *is_present = present;
+
+    return OWB_STATUS_OK;
+}
+
+static owb_status _write_bits(const OneWireBus * bus, uint8_t out, int number_of_bits_to_write)
+{
+    owb_sim_driver_info *info = info_of_driver(bus);
+
+    for (int i = 0; i < number_of_bits_to_write; i++)
+    {
+        const int bit = out & 0x01;
+        out >>= 1;
+
+        for (size_t d = 0; d < info->count; d++)
+        {
+            struct owb_sim_device *dev = &info->devices[d];
+
+            if (_participates(info, dev)) _write_slot(info, dev, bit);
+        }
+
+        info->slots++;
+        _busy(info, info->slot_us[info->speed]);
+    }
+
+    return OWB_STATUS_OK;
+}
+
+static owb_status _read_bits(const OneWireBus * bus, uint8_t *in, int number_of_bits_to_read)
+{
+    owb_sim_driver_info *info = info_of_driver(bus);
+    uint8_t result = 0;
+
+    for (int i = 0; i < number_of_bits_to_read; i++)
+    {
+        // wired-and, any device holding the bus low reads zero
+        int bit = 1;
+
+        for (size_t d = 0; d < info->count; d++)
+        {
+            struct owb_sim_device *dev = &info->devices[d];
+
+            if (_participates(info, dev)) bit &= _read_slot(info, dev);
+        }
+
+        bit ^= _bit_error(info);
+
+        result >>= 1;
+        if (bit) result |= 0x80;
+
+        info->slots++;
+        _busy(info, info->slot_us[info->speed]);
+    }
+
+    *in = result;
+
+    return OWB_STATUS_OK;
+}
+
+static owb_status _set_speed(const OneWireBus * bus, owb_speed speed)
+{
+    owb_sim_driver_info *info = info_of_driver(bus);
+
+    info->speed = speed;
+
+    return OWB_STATUS_OK;
+}
+
+static owb_status _uninitialize(const OneWireBus * bus)
+{
+    owb_sim_driver_info *info = info_of_driver(bus);
+
+    free(info->devices);
+    info->devices = NULL;
+    info->count = 0;
+    info->capacity = 0;
+
+    return OWB_STATUS_OK;
+}
+
+static const struct owb_driver sim_function_table =
+{
+    .name = "owb_sim",
+    .uninitialize = _uninitialize,
+    .reset = _reset,
+    .write_bits = _write_bits,
+    .read_bits = _read_bits,
+    .write_bytes = NULL,
+    .read_bytes = NULL,
+    .set_speed = _set_speed
+};
+
+OneWireBus* owb_sim_initialize(owb_sim_driver_info *info)
+{
+    for (int speed = OWB_SPEED_STANDARD; speed <= OWB_SPEED_OVERDRIVE; speed++)
+    {
+        if (info->slot_us[speed] == 0) info->slot_us[speed] = _default_slot_us[speed];
+        if (info->reset_us[speed] == 0) info->reset_us[speed] = _default_reset_us[speed];
+    }
+
+    info->rng = info->seed ? info->seed : 0x2545f491;
+    info->speed = OWB_SPEED_STANDARD;
+    info->bus.driver = &sim_function_table;
+    info->bus.timing = NULL;
+
+    return &(info->bus);
+}
+
+void owb_sim_uninitialize(owb_sim_driver_info *info)
+{
+    _uninitialize(&info->bus);
+}
+
+static struct owb_sim_device *_device(const owb_sim_driver_info *info, int device)
+{
+    if ((device < 0) || ((size_t)device >= info->count)) return NULL;
+
+    return &info->devices[device];
+}
+
+static int _add(owb_sim_driver_info *info, uint8_t family, uint64_t serial)
+{
+    if (info->count == info->capacity)
+    {
+        const size_t capacity = info->capacity ? (info->capacity * 2) : 16;
+        struct owb_sim_device *devices = realloc(info->devices, capacity * sizeof(*devices));
+
+        if (devices == NULL) return -1;
+
+        info->devices = devices;
+        info->capacity = capacity;
+    }
+
+    struct owb_sim_device *dev = &info->devices[info->count];
+    memset(dev, 0x00, sizeof(*dev));
+
+    dev->rom.fields.family[0] = family;
+    for (int i = 0; i < 6; i++)
+    {
+        dev->rom.fields.serial_number[i] = (serial >> (8 * i)) & 0xff;
+    }
+    dev->rom.fields.crc[0] = owb_crc8_bytes(0, dev->rom.bytes, 7);
+
+    return info->count++;
+}
+
+int owb_sim_add_ds18b20(owb_sim_driver_info *info, uint64_t serial, float celsius, bool parasite)
+{
+    const int device = _add(info, OWB_SIM_FAMILY_DS18B20, serial);
+    if (device < 0) return device;
+
+    struct owb_sim_device *dev = &info->devices[device];
+    dev->parasite = parasite;
+    dev->celsius = celsius;
+
+    // factory eeprom: th 75, tl 70, 12-bit resolution
+    dev->eeprom[0] = 0x4b;
+    dev->eeprom[1] = 0x46;
+    dev->eeprom[2] = 0x7f;
+
+    owb_sim_set_present(info, device, true);
+
+    return device;
+}
+
+int owb_sim_add_ds2408(owb_sim_driver_info *info, uint64_t serial)
+{
+    const int device = _add(info, OWB_SIM_FAMILY_DS2408, serial);
+    if (device < 0) return device;
+
+    info->devices[device].inputs = 0xff;
+
+    owb_sim_set_present(info, device, true);
+
+    return device;
+}
+
+owb_status owb_sim_rom_code(const owb_sim_driver_info *info, int device, OneWireBus_ROMCode *rom_code)
+{
+    const struct owb_sim_device *dev = _device(info, device);
+
+    if (!dev || !rom_code) return OWB_STATUS_PARAMETER_NULL;
+
+    *rom_code = dev->rom;
+
+    return OWB_STATUS_OK;
+}
+
+void owb_sim_set_present(owb_sim_driver_info *info, int device, bool present)
+{
+    struct owb_sim_device *dev = _device(info, device);
+
+    if (!dev || (dev->present == present)) return;
+
+    dev->present = present;
+    dev->overdrive = false;
+    dev->state = SIM_IDLE;
+
+    if (!present) return;
+
+    // power on reset
+    if (_is_ds2408(dev))
+    {
+        memset(dev->regs, 0x00, sizeof(dev->regs));
+        dev->regs[OUTPUT_LATCH] = 0xff;
+        dev->regs[CONTROL] = VCCP | PORL;
+        dev->regs[6] = dev->regs[7] = 0xff;
+        dev->regs[PIO_LOGIC] = dev->inputs;
+    } else
+    {
+        static const uint8_t por[] = {0x50, 0x05, 0x00, 0x00, 0x00, 0xff, 0x0c, 0x10};
+        memcpy(dev->scratchpad, por, sizeof(por));
+        memcpy(&dev->scratchpad[2], dev->eeprom, sizeof(dev->eeprom));
+        _ds18b20_scratchpad_crc(dev);
+
+        dev->alarm = false;
+        dev->convert_done_at = 0;
+    }
+}
+
+void owb_sim_set_celsius(owb_sim_driver_info *info, int device, float celsius)
+{
+    struct owb_sim_device *dev = _device(info, device);
+
+    if (dev) dev->celsius = celsius;
+}
+
+void owb_sim_set_inputs(owb_sim_driver_info *info, int device, uint8_t inputs)
+{
+    struct owb_sim_device *dev = _device(info, device);
+
+    if (!dev || !_is_ds2408(dev)) return;
+
+    dev->inputs = inputs;
+    _ds2408_pins(dev);
+}
+
+uint8_t owb_sim_outputs(const owb_sim_driver_info *info, int device)
+{
+    const struct owb_sim_device *dev = _device(info, device);
+
+    return (dev && _is_ds2408(dev)) ? dev->regs[OUTPUT_LATCH] : 0xff;
+}
+
+bool owb_sim_conditional(const owb_sim_driver_info *info, int device)
+{
+    const struct owb_sim_device *dev = _device(info, device);
+
+    return dev && _is_ds2408(dev) && _ds2408_condition(dev);
+}
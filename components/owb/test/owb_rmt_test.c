@@ -0,0 +1,469 @@
+/*
+    owb_rmt_test.c -- RMT 1-Wire Driver Host Test
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// owb_rmt on a fake RMT peripheral.  the fake decodes each transmitted item into a reset or
+// time slot, performs it on the simulated bus and, while the receiver is started, returns
+// the items the receiver would capture.  checks the slot encoding at both speeds and that
+// whole buffers are written and read in transactions of up to seven bytes, then compares
+// transactions and modeled time of the multi-byte entry points against a byte at a time.
+//
+// the model: a transaction occupies the bus for the duration of its items plus a fixed
+// cost for the driver (item copy, start, tx end interrupt, task wake) and, when receiving,
+// for the receiver start / stop and ring buffer round trip.  the fixed costs are estimates,
+// the comparison depends on their size relative to a slot, not on their exact values.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "crc/crc.h"
+#include "driver/gpio.h"
+#include "driver/rmt.h"
+#include "host_test.h"
+#include "owb/owb.h"
+#include "owb/owb_rmt.h"
+#include "owb/owb_sim.h"
+
+#define TX_OVERHEAD_US 25
+#define RX_OVERHEAD_US 15
+
+// owb_rmt timing in RMT ticks (0.1us)
+#define STD_SLOT 750
+#define STD_ONE_LOW 20
+#define STD_ZERO_LOW 650
+#define OD_SLOT 100
+#define OD_ONE_LOW 10
+#define OD_ZERO_LOW 80
+
+#define RMT_MEM_BLOCK_ITEMS 64
+#define MAX_LOG_ITEMS 1024
+
+gpio_dev_t GPIO;
+const uint32_t GPIO_PIN_MUX_REG[40];
+
+static owb_sim_driver_info sim;
+static OneWireBus *sim_bus;
+
+static owb_rmt_driver_info rmt_info;
+static OneWireBus *bus;
+
+// the fake peripheral
+static struct
+{
+    bool rx_started;
+    bool rx_pending;
+    rmt_item32_t rx_items[RMT_MEM_BLOCK_ITEMS];
+    size_t rx_count;
+
+    // statistics
+    uint32_t transactions;
+    uint32_t max_items;
+    uint64_t model_us;    // slots, resets and the fixed costs
+    uint64_t overhead_us; // the fixed costs alone
+
+    // slots and resets transmitted since the log was cleared
+    rmt_item32_t log[MAX_LOG_ITEMS];
+    size_t log_count;
+} rmt;
+
+static void rmt_clear(void)
+{
+    rmt.transactions = 0;
+    rmt.max_items = 0;
+    rmt.model_us = 0;
+    rmt.overhead_us = 0;
+    rmt.log_count = 0;
+}
+
+static void rx_capture(rmt_item32_t item)
+{
+    if (rmt.rx_started && (rmt.rx_count < RMT_MEM_BLOCK_ITEMS)) rmt.rx_items[rmt.rx_count++] = item;
+}
+
+static void fake_reset(const rmt_item32_t *tx)
+{
+    bool present = false;
+
+    owb_set_speed(sim_bus, (tx->duration0 < 2000) ? OWB_SPEED_OVERDRIVE : OWB_SPEED_STANDARD);
+    owb_reset(sim_bus, &present);
+
+    // the released bus then, when a device is present, its presence pulse
+    rmt_item32_t item = {.level0 = 0, .duration0 = tx->duration0, .level1 = 1};
+    item.duration1 = present ? 300 : 0;
+    rx_capture(item);
+
+    if (present)
+    {
+        rmt_item32_t pulse = {.level0 = 0, .duration0 = 1200, .level1 = 1, .duration1 = 0};
+        rx_capture(pulse);
+    }
+}
+
+static void fake_slot(const rmt_item32_t *tx)
+{
+    const uint32_t slot = tx->duration0 + tx->duration1;
+    const int bit = (tx->duration0 * 4) < slot;
+
+    owb_set_speed(sim_bus, (slot <= 200) ? OWB_SPEED_OVERDRIVE : OWB_SPEED_STANDARD);
+
+    if (rmt.rx_started)
+    {
+        // a read slot, a device holding the bus low delays the rising edge past the sample time
+        uint8_t in = 0;
+        sim_bus->driver->read_bits(sim_bus, &in, 1);
+
+        rmt_item32_t item = *tx;
+        if ((in & 0x80) == 0)
+        {
+            item.duration0 = (slot * 4) / 10;
+            item.duration1 = slot - item.duration0;
+        }
+
+        rx_capture(item);
+    } else
+    {
+        sim_bus->driver->write_bits(sim_bus, bit, 1);
+    }
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *items, int item_num,
+                          bool wait_tx_done)
+{
+    (void)channel;
+    (void)wait_tx_done;
+
+    if (item_num > RMT_MEM_BLOCK_ITEMS) return ESP_ERR_INVALID_ARG;
+
+    rmt.transactions++;
+    if ((uint32_t)item_num > rmt.max_items) rmt.max_items = item_num;
+
+    rmt.overhead_us += TX_OVERHEAD_US + (rmt.rx_started ? RX_OVERHEAD_US : 0);
+    rmt.model_us += TX_OVERHEAD_US + (rmt.rx_started ? RX_OVERHEAD_US : 0);
+
+    for (int i = 0; i < item_num; i++)
+    {
+        const rmt_item32_t *tx = &items[i];
+
+        // the end marker
+        if ((tx->level0 == 1) && (tx->duration0 == 0)) break;
+
+        rmt.model_us += (tx->duration0 + tx->duration1) / 10;
+        if (rmt.log_count < MAX_LOG_ITEMS) rmt.log[rmt.log_count++] = *tx;
+
+        if (tx->duration1 == 0)
+            fake_reset(tx);
+        else
+            fake_slot(tx);
+    }
+
+    rmt.rx_pending = rmt.rx_started;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst)
+{
+    (void)channel;
+    (void)rx_idx_rst;
+
+    rmt.rx_started = true;
+    rmt.rx_count = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel)
+{
+    (void)channel;
+    rmt.rx_started = false;
+
+    return ESP_OK;
+}
+
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *size, TickType_t ticks)
+{
+    (void)rb;
+    (void)ticks;
+
+    if (!rmt.rx_pending) return NULL;
+
+    rmt.rx_pending = false;
+    *size = rmt.rx_count * sizeof(rmt_item32_t);
+
+    return rmt.rx_items;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t rb, void *item)
+{
+    (void)rb;
+    (void)item;
+}
+
+esp_err_t rmt_config(const rmt_config_t *config)
+{
+    (void)config;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags)
+{
+    (void)channel;
+    (void)rx_buf_size;
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel)
+{
+    (void)channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t *buf_handle)
+{
+    (void)channel;
+    *buf_handle = NULL;
+    return ESP_OK;
+}
+
+esp_err_t rmt_set_gpio(rmt_channel_t channel, rmt_mode_t mode, int gpio_num, bool invert_signal)
+{
+    (void)channel;
+    (void)mode;
+    (void)gpio_num;
+    (void)invert_signal;
+    return ESP_OK;
+}
+
+esp_err_t rmt_set_rx_idle_thresh(rmt_channel_t channel, uint16_t thresh)
+{
+    (void)channel;
+    (void)thresh;
+    return ESP_OK;
+}
+
+// checks the logged items are the write slots of the bytes, lsb first
+static void check_write_slots(const uint8_t *bytes, size_t len, uint32_t slot, uint32_t one_low,
+                              uint32_t zero_low)
+{
+    CHECK(rmt.log_count == (len * 8), "%zu items for %zu bytes", rmt.log_count, len);
+
+    int bad = 0;
+    for (size_t i = 0; (i < rmt.log_count) && (i < (len * 8)); i++)
+    {
+        const rmt_item32_t *item = &rmt.log[i];
+        const int bit = (bytes[i / 8] >> (i % 8)) & 0x01;
+        const uint32_t low = bit ? one_low : zero_low;
+
+        bad += (item->level0 != 0) || (item->level1 != 1);
+        bad += (item->duration0 != low) || ((item->duration0 + item->duration1) != slot);
+    }
+
+    CHECK(bad == 0, "%d slots encoded incorrectly", bad);
+}
+
+static void encoding(void)
+{
+    uint8_t bytes[20];
+    for (size_t i = 0; i < sizeof(bytes); i++) bytes[i] = (uint8_t)((i * 37) + 0x5a);
+
+    // no device selected, the written slots are only logged
+    owb_set_speed(bus, OWB_SPEED_STANDARD);
+    rmt_clear();
+    owb_write_bytes(bus, bytes, sizeof(bytes));
+
+    // seven bytes (56 slots and the end marker) fit the 64 item channel memory
+    CHECK(rmt.transactions == 3, "%u transactions writing 20 bytes", rmt.transactions);
+    CHECK(rmt.max_items == 57, "%u items in a transaction", rmt.max_items);
+    check_write_slots(bytes, sizeof(bytes), STD_SLOT, STD_ONE_LOW, STD_ZERO_LOW);
+
+    owb_set_speed(bus, OWB_SPEED_OVERDRIVE);
+    rmt_clear();
+    owb_write_bytes(bus, bytes, 5);
+
+    CHECK(rmt.transactions == 1, "%u transactions writing 5 bytes", rmt.transactions);
+    check_write_slots(bytes, 5, OD_SLOT, OD_ONE_LOW, OD_ZERO_LOW);
+
+    // a byte at a time through write_bits encodes the same slots
+    owb_set_speed(bus, OWB_SPEED_STANDARD);
+    rmt_clear();
+    for (size_t i = 0; i < sizeof(bytes); i++) owb_write_byte(bus, bytes[i]);
+
+    CHECK(rmt.transactions == sizeof(bytes), "%u transactions writing bytes singly", rmt.transactions);
+    check_write_slots(bytes, sizeof(bytes), STD_SLOT, STD_ONE_LOW, STD_ZERO_LOW);
+
+    printf("encoding: %zu slots checked\n", rmt.log_count);
+}
+
+static int discover(OneWireBus_ROMCode *roms, int max)
+{
+    OneWireBus_SearchState state = {0};
+    bool more = false;
+    int count = 0;
+
+    owb_search_first(bus, &state, &more);
+    while (more && (count < max))
+    {
+        roms[count++] = state.rom_code;
+        owb_search_next(bus, &state, &more);
+    }
+
+    return count;
+}
+
+static void match_rom(const OneWireBus_ROMCode *rom)
+{
+    bool present = false;
+
+    owb_reset(bus, &present);
+    CHECK(present, "no presence pulse");
+
+    owb_write_byte(bus, OWB_ROM_MATCH);
+    owb_write_rom_code(bus, *rom);
+}
+
+// a DS2408 channel-access read as ds::DS2408::status() performs it
+static bool channel_access_read(const OneWireBus_ROMCode *rom, uint8_t *samples)
+{
+    uint8_t cmd[10];
+    bool present = false;
+
+    cmd[0] = OWB_ROM_MATCH;
+    memcpy(cmd + 1, rom->bytes, 8);
+    cmd[9] = 0xf5;
+
+    owb_reset(bus, &present);
+    owb_write_bytes(bus, cmd, sizeof(cmd));
+    owb_read_bytes(bus, samples, 34);
+
+    // the inverted crc16 of the command byte and samples follows the samples
+    uint16_t crc = crc16_maxim_update(CRC16_MAXIM_INIT, cmd + 9, 1);
+    crc = ~crc16_maxim_update(crc, samples, 32);
+
+    return (samples[32] == (crc & 0xff)) && (samples[33] == (crc >> 8));
+}
+
+static void devices(void)
+{
+    OneWireBus_ROMCode roms[8];
+
+    owb_set_speed(bus, OWB_SPEED_STANDARD);
+    const int count = discover(roms, 8);
+    CHECK(count == 6, "discovered %d devices", count);
+
+    int scratchpads = 0, channels = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (roms[i].fields.family[0] == OWB_SIM_FAMILY_DS18B20)
+        {
+            uint8_t scratchpad[9];
+
+            match_rom(&roms[i]);
+            owb_write_byte(bus, 0xbe);
+            owb_read_bytes(bus, scratchpad, sizeof(scratchpad));
+
+            const int16_t raw = scratchpad[0] | (scratchpad[1] << 8);
+            const bool crc_ok = crc8_maxim_update(CRC8_MAXIM_INIT, scratchpad, sizeof(scratchpad)) == 0;
+
+            CHECK(crc_ok && (raw == (int16_t)(85 * 16)), "scratchpad of device %d", i);
+            scratchpads += crc_ok;
+        } else
+        {
+            uint8_t samples[34];
+
+            const bool crc_ok = channel_access_read(&roms[i], samples);
+            CHECK(crc_ok && (samples[0] == 0xff), "channel access of device %d", i);
+            channels += crc_ok;
+        }
+    }
+
+    printf("devices: %d discovered, %d scratchpads and %d channel access reads\n", count, scratchpads,
+           channels);
+}
+
+static void compare(const char *what, const OneWireBus_ROMCode *rom)
+{
+    struct owb_driver per_byte = *bus->driver;
+    const struct owb_driver *multi_byte = bus->driver;
+    uint8_t samples[34];
+
+    per_byte.write_bytes = NULL;
+    per_byte.read_bytes = NULL;
+
+    rmt_clear();
+    channel_access_read(rom, samples);
+    const uint32_t multi_txns = rmt.transactions;
+    const uint64_t multi_us = rmt.model_us;
+    const uint64_t multi_overhead_us = rmt.overhead_us;
+
+    bus->driver = &per_byte;
+    rmt_clear();
+    const bool crc_ok = channel_access_read(rom, samples);
+    const uint32_t single_txns = rmt.transactions;
+    const uint64_t single_us = rmt.model_us;
+    const uint64_t single_overhead_us = rmt.overhead_us;
+    bus->driver = multi_byte;
+
+    CHECK(crc_ok, "%s channel access read a byte at a time", what);
+
+    // reset, 10 command bytes and 34 samples: 45 transactions a byte at a time, 8 multi-byte
+    CHECK(single_txns == 45, "%s %u transactions a byte at a time", what, single_txns);
+    CHECK(multi_txns == 8, "%s %u transactions multi-byte", what, multi_txns);
+    CHECK(multi_us < single_us, "%s multi-byte is not faster", what);
+
+    // 44 bytes, the slots of a byte take 8 slot durations either way
+    printf("%s channel access read: byte at a time %u txns %.2fms, multi-byte %u txns %.2fms, "
+           "overhead per byte %.1fus -> %.1fus\n",
+           what, single_txns, single_us / 1e3, multi_txns, multi_us / 1e3, single_overhead_us / 44.0,
+           multi_overhead_us / 44.0);
+}
+
+int main(void)
+{
+    OneWireBus_ROMCode rom;
+
+    sim_bus = owb_sim_initialize(&sim);
+
+    for (int i = 0; i < 4; i++) owb_sim_add_ds18b20(&sim, 0x100 + i, 85.0f, false);
+    const int ds2408 = owb_sim_add_ds2408(&sim, 0x200);
+    owb_sim_add_ds2408(&sim, 0x201);
+
+    bus = owb_rmt_initialize(&rmt_info, 14, RMT_CHANNEL_0, RMT_CHANNEL_1);
+    owb_use_crc(bus, true);
+
+    encoding();
+    devices();
+
+    owb_sim_rom_code(&sim, ds2408, &rom);
+    owb_set_speed(bus, OWB_SPEED_STANDARD);
+    compare("standard", &rom);
+
+    // a standard speed reset and overdrive skip rom places the devices into overdrive
+    bool present = false;
+    owb_reset(bus, &present);
+    owb_write_byte(bus, OWB_ROM_SKIP_OVERDRIVE);
+    owb_set_speed(bus, OWB_SPEED_OVERDRIVE);
+    compare("overdrive", &rom);
+
+    owb_sim_uninitialize(&sim);
+
+    return host_test_result();
+}
@@ -0,0 +1,309 @@
+/*
+    owb_sim_test.c -- Simulated 1-Wire Bus Host Test
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// drives the simulated bus through the owb api the way ds::Bus does: discovery, a convert
+// with read slot polling, scratchpad reads, DS2408 channel access at overdrive and
+// conditional search, then discovery with bit errors injected.  prints the simulated bus
+// time and the host time of each.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "crc/crc.h"
+#include "host_test.h"
+#include "owb/owb.h"
+#include "owb/owb_sim.h"
+
+#define DS18B20_COUNT 200
+#define DS2408_COUNT 100
+#define DEVICE_COUNT (DS18B20_COUNT + DS2408_COUNT)
+
+static owb_sim_driver_info info;
+static OneWireBus *bus;
+static OneWireBus_ROMCode roms[DEVICE_COUNT];
+
+static double host_ms(uint64_t start)
+{
+    return (host_test_ns() - start) / 1e6;
+}
+
+static float celsius_of(int device)
+{
+    return 18.0f + (device * 0.0625f);
+}
+
+static int index_of(const OneWireBus_ROMCode *rom)
+{
+    for (int i = 0; i < DEVICE_COUNT; i++)
+    {
+        if (memcmp(rom->bytes, roms[i].bytes, sizeof(rom->bytes)) == 0) return i;
+    }
+
+    return -1;
+}
+
+static bool match_rom(const OneWireBus_ROMCode *rom)
+{
+    bool present = false;
+
+    owb_reset(bus, &present);
+    owb_write_byte(bus, OWB_ROM_MATCH);
+    owb_write_rom_code(bus, *rom);
+
+    return present;
+}
+
+// searches the bus, returns the devices found and marks each in found (when not NULL)
+static int search(bool conditional, bool *found)
+{
+    OneWireBus_SearchState state = {0};
+    bool more = false;
+    int count = 0;
+
+    if (conditional)
+        owb_search_conditional_first(bus, &state, &more);
+    else
+        owb_search_first(bus, &state, &more);
+
+    while (more)
+    {
+        const int device = index_of(&state.rom_code);
+        CHECK(device >= 0, "search found a rom code not on the bus");
+
+        if (device >= 0)
+        {
+            CHECK(!found || !found[device], "device %d found twice", device);
+            if (found) found[device] = true;
+        }
+
+        count++;
+
+        if (conditional)
+            owb_search_conditional_next(bus, &state, &more);
+        else
+            owb_search_next(bus, &state, &more);
+    }
+
+    return count;
+}
+
+static void discover(void)
+{
+    bool found[DEVICE_COUNT] = {false};
+    uint64_t start;
+
+    info.bus_time_us = 0;
+    start = host_test_ns();
+
+    const int count = search(false, found);
+    const double host = host_ms(start);
+
+    CHECK(count == DEVICE_COUNT, "discovered %d of %d devices", count, DEVICE_COUNT);
+
+    printf("discover %d devices: bus %.1fms host %.2fms\n", count, info.bus_time_us / 1e3, host);
+}
+
+static void convert(void)
+{
+    bool present = false;
+    uint8_t slots[7];
+    bool complete = false;
+
+    // skip rom convert then poll with trains of read slots as ds::Bus::convertWait does
+    owb_reset(bus, &present);
+    owb_write_byte(bus, OWB_ROM_SKIP);
+    owb_write_byte(bus, 0x44);
+
+    const uint64_t start_us = info.bus_time_us;
+    int trains = 0;
+
+    while (!complete && (trains < 1000))
+    {
+        owb_read_bytes(bus, slots, sizeof(slots));
+        trains++;
+
+        for (size_t i = 0; i < sizeof(slots); i++) complete = complete || slots[i];
+    }
+
+    const uint64_t elapsed_us = info.bus_time_us - start_us;
+
+    // 12-bit (the factory resolution) conversions take 750ms
+    CHECK(complete, "convert did not complete");
+    CHECK((elapsed_us >= 750000) && (elapsed_us < (750000 + 2 * 56 * 70)), "convert took %lluus",
+          (unsigned long long)elapsed_us);
+
+    printf("convert: bus %.1fms in %d read slot trains\n", elapsed_us / 1e3, trains);
+
+    uint64_t start;
+    int good = 0;
+
+    info.bus_time_us = 0;
+    start = host_test_ns();
+
+    for (int device = 0; device < DS18B20_COUNT; device++)
+    {
+        uint8_t scratchpad[9];
+
+        match_rom(&roms[device]);
+        owb_write_byte(bus, 0xbe);
+        owb_read_bytes(bus, scratchpad, sizeof(scratchpad));
+
+        const int16_t raw = scratchpad[0] | (scratchpad[1] << 8);
+        const bool crc_ok = crc8_maxim_update(CRC8_MAXIM_INIT, scratchpad, sizeof(scratchpad)) == 0;
+
+        CHECK(crc_ok, "device %d scratchpad crc", device);
+        CHECK((raw / 16.0f) == celsius_of(device), "device %d celsius %.4f", device, raw / 16.0f);
+
+        good += crc_ok;
+    }
+
+    printf("read %d scratchpads: bus %.1fms host %.2fms\n", good, info.bus_time_us / 1e3, host_ms(start));
+}
+
+static void channel_access(void)
+{
+    bool present = false;
+    uint64_t start;
+    int good = 0;
+
+    // a standard speed reset and overdrive skip rom places the DS2408s into overdrive
+    owb_set_speed(bus, OWB_SPEED_STANDARD);
+    owb_reset(bus, &present);
+    owb_write_byte(bus, OWB_ROM_SKIP_OVERDRIVE);
+    owb_set_speed(bus, OWB_SPEED_OVERDRIVE);
+
+    info.bus_time_us = 0;
+    start = host_test_ns();
+
+    for (int device = DS18B20_COUNT; device < DEVICE_COUNT; device++)
+    {
+        static const uint8_t cmd = 0xf5;
+        uint8_t samples[34];
+
+        CHECK(match_rom(&roms[device]), "device %d not present at overdrive", device);
+        owb_write_byte(bus, cmd);
+        owb_read_bytes(bus, samples, sizeof(samples));
+
+        uint16_t crc = crc16_maxim_update(CRC16_MAXIM_INIT, &cmd, 1);
+        crc = ~crc16_maxim_update(crc, samples, 32);
+        const bool crc_ok = (samples[32] == (crc & 0xff)) && (samples[33] == (crc >> 8));
+
+        CHECK(crc_ok, "device %d channel access crc", device);
+        good += crc_ok;
+    }
+
+    printf("channel access read %d DS2408s at overdrive: bus %.1fms host %.2fms\n", good,
+           info.bus_time_us / 1e3, host_ms(start));
+
+    // channel access write, the device confirms with 0xaa then the pio logic
+    const int device = DS18B20_COUNT + 7;
+    const uint8_t outputs[] = {0x5a, 0xa5, (uint8_t)~0xa5};
+    uint8_t confirm[2];
+
+    match_rom(&roms[device]);
+    owb_write_bytes(bus, outputs, sizeof(outputs));
+    owb_read_bytes(bus, confirm, sizeof(confirm));
+
+    CHECK(confirm[0] == 0xaa, "channel access write confirm 0x%02x", confirm[0]);
+    CHECK(owb_sim_outputs(&info, device) == 0xa5, "channel access write outputs");
+
+    owb_set_speed(bus, OWB_SPEED_STANDARD);
+    owb_reset(bus, &present);
+}
+
+static void conditional_search(void)
+{
+    bool found[DEVICE_COUNT] = {false};
+    int ds18b20 = 0;
+
+    // DS2408s respond until their power on reset latch is cleared, DS18B20s while their
+    // alarm flag is set (every one here, the factory TL is 70 degrees)
+    const int count = search(true, found);
+
+    for (int device = 0; device < DS18B20_COUNT; device++) ds18b20 += found[device];
+
+    CHECK(count == DEVICE_COUNT, "conditional search found %d", count);
+    CHECK(ds18b20 == DS18B20_COUNT, "conditional search found %d DS18B20s", ds18b20);
+
+    // detached devices no longer respond
+    owb_sim_set_present(&info, 0, false);
+    owb_sim_set_present(&info, DS18B20_COUNT, false);
+
+    CHECK(search(false, NULL) == (DEVICE_COUNT - 2), "search after detaching two devices");
+
+    owb_sim_set_present(&info, 0, true);
+    owb_sim_set_present(&info, DS18B20_COUNT, true);
+}
+
+static void bit_errors(void)
+{
+    owb_sim_driver_info noisy = {.bit_error_ppm = 2000, .seed = 7};
+    OneWireBus *noisy_bus = owb_sim_initialize(&noisy);
+    owb_use_crc(noisy_bus, true);
+
+    for (int i = 0; i < 50; i++) owb_sim_add_ds18b20(&noisy, 0x1000 + i, 21.0f, false);
+
+    int found = 0;
+    for (int round = 0; round < 20; round++)
+    {
+        OneWireBus_SearchState state = {0};
+        bool more = false;
+
+        for (owb_search_first(noisy_bus, &state, &more); more; owb_search_next(noisy_bus, &state, &more))
+        {
+            found++;
+        }
+    }
+
+    CHECK(noisy.bit_errors > 0, "no bit errors injected");
+
+    printf("discover with %u ppm bit errors: %.1f of 50 devices found per search, %u bit errors\n",
+           noisy.bit_error_ppm, found / 20.0, noisy.bit_errors);
+
+    owb_sim_uninitialize(&noisy);
+}
+
+int main(void)
+{
+    bus = owb_sim_initialize(&info);
+    owb_use_crc(bus, true);
+
+    for (int i = 0; i < DEVICE_COUNT; i++)
+    {
+        const uint64_t serial = 0x00a0b0c00000 + (i * 0x10001);
+        const int device = (i < DS18B20_COUNT) ? owb_sim_add_ds18b20(&info, serial, celsius_of(i), false)
+                                               : owb_sim_add_ds2408(&info, serial);
+
+        CHECK(device == i, "add device %d", i);
+        owb_sim_rom_code(&info, device, &roms[i]);
+    }
+
+    discover();
+    convert();
+    channel_access();
+    conditional_search();
+    bit_errors();
+
+    owb_sim_uninitialize(&info);
+
+    return host_test_result();
+}
@@ -0,0 +1,213 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#include "ruth_log/dlog.hpp"
+
+namespace ruth {
+
+static const char *TAG = "DLog";
+
+// slot sequences are stored less the slot index so the zero initialized ring is ready
+// before init() (e.g. records made while booting).  a slot is free for the producer at pos
+// when its sequence is pos and holds a record for the consumer when it is pos + 1.
+DLog::Slot DLog::_slots[capacity];
+std::atomic<uint32_t> DLog::_head{0};
+uint32_t DLog::_tail = 0;
+std::atomic<uint32_t> DLog::_dropped{0};
+DLog::Opts DLog::_opts;
+TaskHandle_t DLog::_task = nullptr;
+
+static constexpr uint32_t slotIndex(uint32_t pos, size_t capacity) { return pos & (capacity - 1); }
+
+IRAM_ATTR bool DLog::reserve(uint32_t &pos) {
+  pos = _head.load(std::memory_order_relaxed);
+
+  for (;;) {
+    const auto idx = slotIndex(pos, capacity);
+    const uint32_t seq = _slots[idx].seq.load(std::memory_order_acquire) + idx;
+    const auto diff = (int32_t)(seq - pos);
+
+    if (diff == 0) {
+      // claim the slot, another producer may have claimed it first
+      if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return true;
+    } else if (diff < 0) {
+      // full, the newest record is dropped so those not yet written survive the burst
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+IRAM_ATTR void DLog::commit(uint32_t pos) {
+  const auto idx = slotIndex(pos, capacity);
+
+  _slots[idx].seq.store(pos + 1 - idx, std::memory_order_release);
+}
+
+void DLog::drain(void *data) {
+  static char buff[192];
+  uint32_t dropped_reported = 0;
+
+  for (;;) {
+    for (;;) {
+      const auto idx = slotIndex(_tail, capacity);
+      auto &slot = _slots[idx];
+
+      const uint32_t seq = slot.seq.load(std::memory_order_acquire) + idx;
+      if (seq != (_tail + 1)) break; // empty (or the record is still being written)
+
+      const Entry &entry = slot.entry;
+      format(entry, buff, sizeof(buff));
+
+      esp_log_write((esp_log_level_t)entry.level, entry.tag, "%c (%u) %s: %s\n", "NEWIDV"[entry.level],
+                    entry.at_ms, entry.tag, buff);
+
+      // free the slot for the producer one lap ahead
+      slot.seq.store(_tail + capacity - idx, std::memory_order_release);
+      _tail++;
+    }
+
+    const uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped != dropped_reported) {
+      ESP_LOGW(TAG, "ring full, dropped[%u]", dropped - dropped_reported);
+      dropped_reported = dropped;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(_opts.drain_ms));
+  }
+}
+
+void DLog::format(const Entry &entry, char *buff, size_t len) {
+  const char *f = entry.format;
+  size_t used = 0;
+  uint8_t arg = 0;
+
+  while (*f && (used < (len - 1))) {
+    if ((f[0] != '%') || (f[1] == '%')) {
+      buff[used++] = *f;
+      f += (f[0] == '%') ? 2 : 1;
+      continue;
+    }
+
+    // the complete conversion spec (flags, width, precision, length) is passed to snprintf
+    // with the arg converted to the type the spec calls for
+    char spec[16];
+    size_t spec_len = 0;
+    size_t longs = 0;
+
+    spec[spec_len++] = *f++;
+    while (*f && (strchr("diouxXcspfFeEgGaA", *f) == nullptr) && (spec_len < (sizeof(spec) - 2))) {
+      if ((*f == 'l') || (*f == 'j')) longs += (*f == 'j') ? 2 : 1;
+      if ((*f == 'z') || (*f == 't')) longs = 1;
+
+      spec[spec_len++] = *f++;
+    }
+
+    const char conv = *f;
+    if (conv == 0x00) break;
+
+    spec[spec_len++] = *f++;
+    spec[spec_len] = 0x00;
+
+    char *out = buff + used;
+    const size_t remain = len - used;
+    int n = 0;
+
+    if (arg >= entry.argc) {
+      n = snprintf(out, remain, "%s", "?");
+    } else {
+      const auto kind = entry.kinds[arg];
+      const auto &val = entry.args[arg];
+      const int64_t num = (kind == REAL) ? (int64_t)val.real : val.num;
+      arg++;
+
+      switch (conv) {
+      case 's':
+        n = snprintf(out, remain, spec, (kind == TEXT) ? (entry.text + val.text_at) : "(?)");
+        break;
+
+      case 'p':
+        n = snprintf(out, remain, spec, (void *)(intptr_t)num);
+        break;
+
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        n = snprintf(out, remain, spec, (kind == REAL) ? val.real : (double)num);
+        break;
+
+      case 'd':
+      case 'i':
+        if (longs >= 2) n = snprintf(out, remain, spec, (long long)num);
+        else if (longs == 1) n = snprintf(out, remain, spec, (long)num);
+        else n = snprintf(out, remain, spec, (int)num);
+        break;
+
+      default: // unsigned conversions and char
+        if (longs >= 2) n = snprintf(out, remain, spec, (unsigned long long)num);
+        else if (longs == 1) n = snprintf(out, remain, spec, (unsigned long)num);
+        else n = snprintf(out, remain, spec, (unsigned int)num);
+        break;
+      }
+    }
+
+    if (n > 0) used += ((size_t)n < remain) ? n : (remain - 1);
+  }
+
+  buff[used] = 0x00;
+}
+
+void DLog::init(const Opts &opts) {
+  if (_task) return;
+
+  _opts = opts;
+  xTaskCreate(&drain, TAG, opts.stack, nullptr, opts.priority, &_task);
+}
+
+IRAM_ATTR void DLog::storeText(Entry &entry, const char *str) {
+  if (str == nullptr) str = "(null)";
+
+  auto *p = entry.text + entry.text_len;
+  const size_t avail = max_text - entry.text_len;
+
+  if (avail == 0) {
+    entry.args[entry.argc - 1].text_at = max_text - 1; // shares the final nul
+    return;
+  }
+
+  // copy, truncated, always nul terminated
+  size_t n = 0;
+  for (; (n < (avail - 1)) && str[n]; n++) p[n] = str[n];
+  p[n] = 0x00;
+
+  entry.text_len += n + 1;
+}
+
+} // namespace ruth
@@ -0,0 +1,158 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#ifndef ruth_log_dlog_hpp
+#define ruth_log_dlog_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// deferred logging for hot paths.  a call records the tag, format (by address, the format
+// string is the id) and raw args into a lock free ring, a low priority task formats and
+// writes them (through esp_log_write) later.  the calling task does a few stores instead
+// of printf style formatting and output.
+//
+// string args are copied (truncated) into the record, all other args are kept as 64 bits
+// and converted to the type the format specifies when written.
+
+#define DLOG_LEVEL(level, tag, format, ...)                                                              \
+  do {                                                                                                   \
+    if (LOG_LOCAL_LEVEL >= level) ruth::DLog::record(level, tag, format, ##__VA_ARGS__);                \
+  } while (0)
+
+#define DLOGE(tag, format, ...) DLOG_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+namespace ruth {
+
+class DLog {
+public:
+  struct Opts {
+    UBaseType_t stack = 3072;
+    UBaseType_t priority = 1;
+    uint32_t drain_ms = 100;
+  };
+
+public:
+  static constexpr size_t max_args = 4;
+  static constexpr size_t max_text = 32; // string args share the record text
+
+  enum Kind : uint8_t { NUMBER = 0, REAL, TEXT };
+
+  struct Entry {
+    const char *tag;
+    const char *format;
+    uint32_t at_ms;
+    uint8_t level;
+    uint8_t argc;
+    uint8_t text_len;
+    Kind kinds[max_args];
+    union {
+      int64_t num;
+      double real;
+      uint8_t text_at;
+    } args[max_args];
+    char text[max_text];
+  };
+
+public:
+  // starts the drain task, records made before are kept (up to the ring capacity)
+  static void init(const Opts &opts);
+
+  template <typename... Args>
+  static inline void record(esp_log_level_t level, const char *tag, const char *format, Args... args) {
+    static_assert(sizeof...(Args) <= max_args, "too many args for a deferred log");
+
+    uint32_t pos;
+    if (reserve(pos) == false) return;
+
+    Entry &entry = _slots[pos & (capacity - 1)].entry;
+    entry.tag = tag;
+    entry.format = format;
+    entry.at_ms = esp_log_timestamp();
+    entry.level = level;
+    entry.argc = 0;
+    entry.text_len = 0;
+
+    (store(entry, args), ...);
+
+    commit(pos);
+  }
+
+  static uint32_t dropped() { return _dropped; }
+
+private:
+  static constexpr size_t capacity = 32; // power of two
+
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    Entry entry;
+  };
+
+private:
+  static void commit(uint32_t pos);
+  static void drain(void *data); // task loop
+  static void format(const Entry &entry, char *buff, size_t len);
+  static bool reserve(uint32_t &pos);
+  static void storeText(Entry &entry, const char *str);
+
+  template <typename T> static inline void store(Entry &entry, T val) {
+    const auto idx = entry.argc++;
+
+    if constexpr (std::is_same_v<T, char *> || std::is_same_v<T, const char *>) {
+      entry.kinds[idx] = TEXT;
+      entry.args[idx].text_at = entry.text_len;
+      storeText(entry, val);
+    } else if constexpr (std::is_floating_point_v<T>) {
+      entry.kinds[idx] = REAL;
+      entry.args[idx].real = val;
+    } else if constexpr (std::is_pointer_v<T>) {
+      entry.kinds[idx] = NUMBER;
+      entry.args[idx].num = (intptr_t)val;
+    } else if constexpr (std::is_signed_v<T>) {
+      entry.kinds[idx] = NUMBER;
+      entry.args[idx].num = val;
+    } else {
+      // unsigned (and enums) are zero extended
+      entry.kinds[idx] = NUMBER;
+      entry.args[idx].num = (int64_t)(uint64_t)val;
+    }
+  }
+
+private:
+  static Slot _slots[capacity];
+  static std::atomic<uint32_t> _head;
+  static uint32_t _tail;
+  static std::atomic<uint32_t> _dropped;
+  static Opts _opts;
+  static TaskHandle_t _task;
+};
+
+} // namespace ruth
+
+#endif
@@ -22,6 +22,7 @@
 #define _ruth_mqtt_hpp
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include "filter/subscribe.hpp"
@@ -49,7 +50,7 @@ public:
   };
 
 public:
-  MQTT() = default;
+  MQTT() { _handlers_mutex = xSemaphoreCreateMutexStatic(&_handlers_mutex_buff); }
   ~MQTT() = default; // connection clean-up handled by shutdown
 
   MQTT(const MQTT &) = delete;
@@ -69,6 +70,7 @@ public:
   void subscribeAck(int msg_id);
 
   static TaskHandle_t taskHandle();
+  static void unregisterHandler(message::Handler *handler);
 
 private:
   // static esp_err_t eventCallback(esp_mqtt_event_handle_t event);
@@ -87,6 +89,10 @@ private:
   static constexpr uint32_t _max_handlers = 10;
   message::Handler *_handlers[_max_handlers];
 
+  // engines register and unregister from their own tasks while the MQTT task dispatches
+  StaticSemaphore_t _handlers_mutex_buff;
+  SemaphoreHandle_t _handlers_mutex;
+
 private:
 };
 } // namespace ruth
@@ -26,6 +26,7 @@
 #include <freertos/task.h>
 #include <mqtt_client.h>
 
+#include "ruth_log/dlog.hpp"
 #include "ruth_mqtt/mqtt.hpp"
 
 namespace ruth {
@@ -111,6 +112,10 @@ IRAM_ATTR static void eventHandler(void *handler_args, esp_event_base_t base, in
 
 IRAM_ATTR void MQTT::incomingMsg(InWrapped msg) {
   bool wanted = false;
+
+  // held while dispatching so a handler can not be unregistered (and its engine torn down)
+  // mid-walk.  accept() only queues the message so the hold is brief.
+  xSemaphoreTake(_handlers_mutex, portMAX_DELAY);
   for (auto i = 0; (i < _max_handlers) && !wanted; i++) {
     message::Handler *registered = _handlers[i];
 
@@ -126,9 +131,10 @@ IRAM_ATTR void MQTT::incomingMsg(InWrapped msg) {
       }
     }
   }
+  xSemaphoreGive(_handlers_mutex);
 
   if (!wanted) {
-    ESP_LOGW(TAG, "unwanted msg: %s", msg->category());
+    DLOGW(TAG, "unwanted msg: %s", msg->category());
   }
 }
 
@@ -164,12 +170,16 @@ void MQTT::registerHandler(message::Handler *handler) {
   auto &handler_list = mqtt._handlers;
   auto &max_handlers = mqtt._max_handlers;
 
+  xSemaphoreTake(mqtt._handlers_mutex, portMAX_DELAY);
   for (auto k = 0; k < max_handlers; k++) {
+    if (handler_list[k] == handler) break; // already registered (e.g. an engine restarted)
+
     if (handler_list[k] == nullptr) {
       handler_list[k] = handler;
       break;
     }
   }
+  xSemaphoreGive(mqtt._handlers_mutex);
 }
 
 void MQTT::subscribeAck(int msg_id) {
@@ -212,4 +222,22 @@ IRAM_ATTR bool MQTT::send(message::Out &msg) {
   return (msg_id >= 0) ? true : false;
 }
 
+void MQTT::unregisterHandler(message::Handler *handler) {
+  auto &mqtt = __singleton__;
+  auto &handler_list = mqtt._handlers;
+
+  // registrations are kept contiguous, incomingMsg() stops at the first empty slot.  once
+  // this returns the MQTT task no longer holds (or will find) the handler.
+  xSemaphoreTake(mqtt._handlers_mutex, portMAX_DELAY);
+  for (auto k = 0; k < _max_handlers; k++) {
+    if (handler_list[k] != handler) continue;
+
+    for (; k < (_max_handlers - 1); k++) handler_list[k] = handler_list[k + 1];
+
+    handler_list[_max_handlers - 1] = nullptr;
+    break;
+  }
+  xSemaphoreGive(mqtt._handlers_mutex);
+}
+
 } // namespace ruth
@@ -0,0 +1,81 @@
+/*
+    watcher/watcher.hpp
+    Ruth Core Watcher Task
+    Copyright (C) 2020  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+#ifndef _ruth_core_watcher_hpp
+#define _ruth_core_watcher_hpp
+
+#include <cstdlib>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+namespace ruth {
+
+// samples the run time (cpu), stack high water mark and core affinity of every task and
+// publishes a compact snapshot each interval.  used to right size the task stacks handed
+// out by the profile and to find cpu hogs.
+class Watcher {
+public:
+  struct Opts {
+    uint32_t interval_ms = 30000;
+    UBaseType_t stack = 3072;
+    UBaseType_t priority = 1; // allow reporting to continue
+  };
+
+private:
+  Watcher(const Opts &opts)
+      : _opts(opts), _wake(xSemaphoreCreateBinary()), _ended(xSemaphoreCreateBinary()) {}
+  ~Watcher() = default;
+
+public:
+  // starts the watcher or, when already running, applies the interval in place
+  static void start(const Opts &opts);
+  static void stop(); // wakes the task, it ends once a snapshot in progress is sent
+
+private:
+  static void run(void *data); // task loop
+  void snapshot();
+  uint32_t runTimePrevious(UBaseType_t number) const;
+
+private:
+  static constexpr size_t max_tasks = 32;
+  static constexpr uint32_t min_interval_ms = 1000; // each snapshot walks every task
+
+  Opts _opts;
+  TaskHandle_t _task = nullptr;
+  volatile bool _stopping = false;
+  SemaphoreHandle_t _wake;  // given by stop() to cut the interval short
+  SemaphoreHandle_t _ended; // given by the task as it ends
+
+  // run time counters are cumulative, cpu is the change since the previous snapshot
+  struct {
+    UBaseType_t number;
+    uint32_t run_time;
+  } _prev[max_tasks] = {};
+  size_t _prev_count = 0;
+  uint32_t _total_prev = 0;
+
+  TaskStatus_t _sys_tasks[max_tasks];
+};
+} // namespace ruth
+
+#endif
@@ -0,0 +1,52 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#include "tasks_msg.hpp"
+
+namespace message {
+
+Tasks::Tasks(uint32_t interval_ms, size_t count) : Out(256 + (count * 96)) {
+  _filter.addLevel("host");
+  _filter.addLevel("watcher");
+
+  JsonObject root = rootObject();
+  root["interval_ms"] = interval_ms;
+
+  // cpu is per mille of one core since the previous snapshot, stack_free is the high water
+  // mark (bytes never used) and core is -1 when the task may run on either core
+  JsonArray cols = root.createNestedArray("cols");
+  for (auto col : {"name", "cpu", "stack_free", "core", "pri"}) cols.add(col);
+
+  _rows = root.createNestedArray("tasks");
+}
+
+void Tasks::add(const char *name, uint32_t cpu, uint32_t stack_free, int core, UBaseType_t priority) {
+  JsonArray row = _rows.createNestedArray();
+
+  row.add(const_cast<char *>(name)); // copied, the task may end before the snapshot is sent
+  row.add(cpu);
+  row.add(stack_free);
+  row.add(core);
+  row.add(priority);
+}
+
+void Tasks::assembleData(JsonObject &data) {}
+
+} // namespace message
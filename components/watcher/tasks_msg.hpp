@@ -0,0 +1,47 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#ifndef watcher_tasks_message_hpp
+#define watcher_tasks_message_hpp
+
+#include <memory>
+
+#include <freertos/FreeRTOS.h>
+
+#include "message/out.hpp"
+
+namespace message {
+
+// one row per task, the columns are named once by "cols"
+class Tasks : public Out {
+public:
+  Tasks(uint32_t interval_ms, size_t count);
+  ~Tasks() = default;
+
+  void add(const char *name, uint32_t cpu, uint32_t stack_free, int core, UBaseType_t priority);
+
+private:
+  void assembleData(JsonObject &data);
+
+private:
+  JsonArray _rows;
+};
+} // namespace message
+#endif
@@ -0,0 +1,127 @@
+/*
+  Ruth
+  (C)opyright 2021  Tim Hughey
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  https://www.wisslanding.com
+*/
+
+#include <algorithm>
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "ruth_mqtt/mqtt.hpp"
+#include "tasks_msg.hpp"
+#include "watcher/watcher.hpp"
+
+namespace ruth {
+
+static const char *TAG = "Watcher";
+static Watcher *_instance_ = nullptr;
+
+void Watcher::run(void *data) {
+  TickType_t last_wake;
+
+  Watcher *watcher = (Watcher *)data;
+
+  while (watcher->_stopping == false) {
+    last_wake = xTaskGetTickCount();
+
+    watcher->snapshot();
+
+    // interval_ms is read each pass, a reconfigure takes effect at the next snapshot
+    const auto elapsed = xTaskGetTickCount() - last_wake;
+    const auto interval = pdMS_TO_TICKS(watcher->_opts.interval_ms);
+    if (elapsed < interval) xSemaphoreTake(watcher->_wake, interval - elapsed);
+  }
+
+  watcher->_task = nullptr;
+  xSemaphoreGive(watcher->_ended);
+  vTaskDelete(nullptr);
+}
+
+uint32_t Watcher::runTimePrevious(UBaseType_t number) const {
+  for (size_t i = 0; i < _prev_count; i++) {
+    if (_prev[i].number == number) return _prev[i].run_time;
+  }
+
+  return 0; // task created since the previous snapshot
+}
+
+void Watcher::snapshot() {
+  uint32_t total = 0;
+  const auto count = uxTaskGetSystemState(_sys_tasks, max_tasks, &total);
+
+  if (count == 0) {
+    ESP_LOGW(TAG, "tasks[%u] exceed max[%u]", uxTaskGetNumberOfTasks(), max_tasks);
+    return;
+  }
+
+  // run time is counted (in microseconds) by each core, a task using all of one core is 1000
+  const uint32_t elapsed = total - _total_prev;
+  message::Tasks msg(_opts.interval_ms, count);
+
+  for (UBaseType_t i = 0; i < count; i++) {
+    const auto &task = _sys_tasks[i];
+    const uint32_t run_time = task.ulRunTimeCounter - runTimePrevious(task.xTaskNumber);
+    const uint32_t cpu = (elapsed > 0) ? (((uint64_t)run_time * 1000) / elapsed) : 0;
+    // from the snapshot, the handle may belong to a task deleted since it was taken.
+    // xCoreID needs CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID (see sdkconfig.defaults).
+    const int core = (task.xCoreID == tskNO_AFFINITY) ? -1 : task.xCoreID;
+
+    msg.add(task.pcTaskName, cpu, task.usStackHighWaterMark, core, task.uxCurrentPriority);
+  }
+
+  for (UBaseType_t i = 0; i < count; i++) {
+    _prev[i].number = _sys_tasks[i].xTaskNumber;
+    _prev[i].run_time = _sys_tasks[i].ulRunTimeCounter;
+  }
+
+  _prev_count = count;
+  _total_prev = total;
+
+  MQTT::send(msg);
+}
+
+void Watcher::start(const Opts &opts) {
+  if (_instance_ == nullptr) _instance_ = new Watcher(opts);
+
+  // a stop in progress completes before the task is started again
+  while (_instance_->_stopping && _instance_->_task) {
+    xSemaphoreTake(_instance_->_ended, portMAX_DELAY);
+  }
+
+  _instance_->_opts.interval_ms = std::max(opts.interval_ms, min_interval_ms);
+
+  if ((_instance_->_stopping == false) && _instance_->_task) {
+    vTaskPrioritySet(_instance_->_task, opts.priority);
+    return;
+  }
+
+  _instance_->_stopping = false;
+  xSemaphoreTake(_instance_->_wake, 0); // not taken if the task ended mid snapshot
+  xTaskCreate(&run, TAG, opts.stack, _instance_, opts.priority, &(_instance_->_task));
+}
+
+void Watcher::stop() {
+  if ((_instance_ == nullptr) || (_instance_->_task == nullptr)) return;
+
+  _instance_->_stopping = true;
+  xSemaphoreGive(_instance_->_wake);
+}
+
+} // namespace ruth
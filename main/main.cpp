@@ -27,6 +27,7 @@
 #include <nvs_flash.h>
 
 #include "core.hpp"
+#include "ruth_log/dlog.hpp"
 
 using namespace ruth;
 
@@ -67,6 +68,9 @@ void app_main() {
 
   ESP_LOGI("Core", "NVS status [%s]", esp_err_to_name(esp_rc));
 
+  // hot paths defer their logging to a ring drained by a low priority task
+  DLog::init(DLog::Opts());
+
   // this is where our implementation begins by starting the Core
   Core::boot();
 
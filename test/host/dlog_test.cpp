@@ -0,0 +1,76 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// the cost of a deferred log call (DLOGx recording into the ring) against formatting the same
+// message with snprintf, the least an immediate ESP_LOGx does before any output.  records are
+// made in batches within the ring capacity, the drain task empties the ring between batches
+// so none are dropped.
+
+#include <cstdint>
+#include <cstdio>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "host_rtos.h"
+#include "host_test.h"
+#include "ruth_log/dlog.hpp"
+
+static const char *TAG = "dlog_test";
+
+static constexpr int BATCHES = 4000;
+static constexpr int BATCH = 16; // half the ring capacity
+
+static int testMain() {
+  ruth::DLog::Opts opts;
+  opts.drain_ms = 10;
+  ruth::DLog::init(opts);
+
+  char buff[128];
+  volatile size_t sink = 0;
+  uint64_t recorded_ns = 0, formatted_ns = 0;
+
+  for (int b = 0; b < BATCHES; b++) {
+    auto start = host_test_ns();
+    for (int i = 0; i < BATCH; i++) DLOGW(TAG, "reset failed: [%d] bus[%u] %s", -i, b, "standard");
+    recorded_ns += host_test_ns() - start;
+
+    start = host_test_ns();
+    for (int i = 0; i < BATCH; i++) {
+      sink += snprintf(buff, sizeof(buff), "reset failed: [%d] bus[%u] %s", -i, b, "standard");
+    }
+    formatted_ns += host_test_ns() - start;
+
+    vTaskDelay(pdMS_TO_TICKS(20)); // drained
+  }
+
+  const double calls = (double)BATCHES * BATCH;
+  const double record = recorded_ns / calls;
+  const double format = formatted_ns / calls;
+
+  CHECK(ruth::DLog::dropped() == 0, "dropped %u records", ruth::DLog::dropped());
+  CHECK(record < format, "recording %.1fns not below formatting %.1fns", record, format);
+
+  printf("ns/call dlog record[%.1f] snprintf[%.1f] (%d calls)\n", record, format, BATCHES * BATCH);
+
+  return host_test_result();
+}
+
+int main() { return host_rtos_run(testMain); }
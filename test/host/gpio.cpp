@@ -0,0 +1,146 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// gpio driver stand-in for the host tests, see host_gpio.h
+
+#include "driver/gpio.h"
+#include "host_gpio.h"
+
+namespace {
+struct Pin {
+  int level = 1;
+  gpio_int_type_t intr = GPIO_INTR_DISABLE;
+  bool intr_enabled = false;
+  gpio_isr_t isr = nullptr;
+  void *arg = nullptr;
+  uint32_t interrupts = 0;
+};
+
+Pin pins[GPIO_NUM_MAX];
+
+Pin *pinOf(gpio_num_t pin) { return ((pin >= 0) && (pin < GPIO_NUM_MAX)) ? &pins[pin] : nullptr; }
+
+void interrupt(Pin &p, int was) {
+  if (!p.intr_enabled || (p.isr == nullptr)) return;
+
+  bool fire = false;
+  switch (p.intr) {
+  case GPIO_INTR_POSEDGE:
+    fire = (was == 0) && (p.level == 1);
+    break;
+  case GPIO_INTR_NEGEDGE:
+    fire = (was == 1) && (p.level == 0);
+    break;
+  case GPIO_INTR_ANYEDGE:
+    fire = (was != p.level);
+    break;
+  case GPIO_INTR_LOW_LEVEL:
+    fire = (p.level == 0);
+    break;
+  case GPIO_INTR_HIGH_LEVEL:
+    fire = (p.level == 1);
+    break;
+  default:
+    break;
+  }
+
+  if (fire) {
+    p.interrupts++;
+    p.isr(p.arg);
+  }
+}
+} // namespace
+
+extern "C" {
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+  for (int i = 0; i < GPIO_NUM_MAX; i++) {
+    if ((config->pin_bit_mask & (1ULL << i)) == 0) continue;
+
+    auto &p = pins[i];
+    p.intr = config->intr_type;
+    p.intr_enabled = (config->intr_type != GPIO_INTR_DISABLE);
+    p.interrupts = 0;
+    if (config->pull_up_en == GPIO_PULLUP_ENABLE) p.level = 1;
+  }
+
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+  auto *p = pinOf(pin);
+  return p ? p->level : 0;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+  auto *p = pinOf(pin);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+
+  p->level = level ? 1 : 0;
+  return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t isr, void *arg) {
+  auto *p = pinOf(pin);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+
+  p->isr = isr;
+  p->arg = arg;
+  return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin) { return gpio_isr_handler_add(pin, nullptr, nullptr); }
+
+esp_err_t gpio_intr_enable(gpio_num_t pin) {
+  auto *p = pinOf(pin);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+
+  p->intr_enabled = true;
+
+  // a level interrupt enabled at the active level is pending
+  if ((p->intr == GPIO_INTR_LOW_LEVEL) || (p->intr == GPIO_INTR_HIGH_LEVEL)) interrupt(*p, p->level);
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin) {
+  auto *p = pinOf(pin);
+  if (p == nullptr) return ESP_ERR_INVALID_ARG;
+
+  p->intr_enabled = false;
+  return ESP_OK;
+}
+
+void host_gpio_drive(gpio_num_t pin, int level) {
+  auto *p = pinOf(pin);
+  if (p == nullptr) return;
+
+  const auto was = p->level;
+  p->level = level ? 1 : 0;
+
+  interrupt(*p, was);
+}
+
+uint32_t host_gpio_interrupts(gpio_num_t pin) {
+  auto *p = pinOf(pin);
+  return p ? p->interrupts : 0;
+}
+}
@@ -0,0 +1,48 @@
+##
+## Host Tests
+##
+## Component sources built and run on Linux.  the few ESP-IDF headers they include
+## are stubbed (see include).  each component test directory is a standalone project,
+## the CMakeLists.txt here collects them all.
+##
+## tests of tasks link the host runtime: FreeRTOS, esp_timer, gpio and esp-mqtt stand-ins on a
+## virtual clock (see include/host_rtos.h) with message, filter, ruth_log and ruth_mqtt
+## built from the components.
+##
+
+include_guard(GLOBAL)
+enable_testing()
+
+set(RUTH_HOST ${CMAKE_CURRENT_LIST_DIR})
+set(RUTH_HOST_STUBS ${CMAKE_CURRENT_LIST_DIR}/include)
+set(RUTH_COMPONENTS ${CMAKE_CURRENT_LIST_DIR}/../../components)
+
+function(ruth_host_test name)
+  add_executable(${name} ${ARGN})
+  target_include_directories(${name} PRIVATE ${RUTH_HOST_STUBS})
+  set_target_properties(${name} PROPERTIES C_STANDARD 11 CXX_STANDARD 17)
+  target_compile_options(${name} PRIVATE -O2 -Wall)
+  add_test(NAME ${name} COMMAND ${name})
+endfunction()
+
+function(ruth_host_runtime target)
+  if(NOT TARGET ruth_host_runtime)
+    find_package(Threads REQUIRED)
+
+    set(c ${RUTH_COMPONENTS})
+    file(GLOB message_srcs ${c}/message/*.cpp ${c}/filter/*.cpp)
+
+    add_library(ruth_host_runtime STATIC ${RUTH_HOST}/rtos.cpp ${RUTH_HOST}/gpio.cpp
+                ${RUTH_HOST}/mqtt_client.cpp ${c}/ruth_mqtt/mqtt.cpp ${c}/ruth_log/dlog.cpp
+                ${message_srcs})
+    target_include_directories(ruth_host_runtime PUBLIC ${RUTH_HOST_STUBS} ${c}/arduino_json/include
+                               ${c}/filter/include ${c}/message/include ${c}/misc/include
+                               ${c}/ruth_log/include ${c}/ruth_mqtt/include)
+    set_target_properties(ruth_host_runtime PROPERTIES CXX_STANDARD 17)
+    target_compile_options(ruth_host_runtime PRIVATE -O2 -Wall)
+    target_compile_options(ruth_host_runtime PUBLIC -include ${RUTH_HOST_STUBS}/host_newlib.h)
+    target_link_libraries(ruth_host_runtime PUBLIC Threads::Threads)
+  endif()
+
+  target_link_libraries(${target} PRIVATE ruth_host_runtime)
+endfunction()
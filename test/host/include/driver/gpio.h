@@ -0,0 +1,89 @@
+// host stand-in of the gpio driver and registers used by the components (owb_rmt attaches its
+// pin through the gpio matrix registers).  the register file is defined by the test using it,
+// the driver functions by the host runtime (gpio.cpp) where the test drives input levels.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  GPIO_NUM_NC = -1,
+  GPIO_NUM_0 = 0,
+  GPIO_NUM_4 = 4,
+  GPIO_NUM_13 = 13,
+  GPIO_NUM_14 = 14,
+  GPIO_NUM_15 = 15,
+  GPIO_NUM_17 = 17,
+  GPIO_NUM_21 = 21,
+  GPIO_NUM_22 = 22,
+  GPIO_NUM_23 = 23,
+  GPIO_NUM_25 = 25,
+  GPIO_NUM_26 = 26,
+  GPIO_NUM_27 = 27,
+  GPIO_NUM_32 = 32,
+  GPIO_NUM_33 = 33,
+  GPIO_NUM_MAX = 40
+} gpio_num_t;
+
+#define GPIO_SEL_13 (1ULL << 13)
+#define GPIO_SEL_15 (1ULL << 15)
+#define GPIO_SEL_21 (1ULL << 21)
+#define GPIO_SEL_27 (1ULL << 27)
+#define GPIO_SEL_32 (1ULL << 32)
+#define GPIO_SEL_33 (1ULL << 33)
+
+typedef enum { GPIO_MODE_DISABLE = 0, GPIO_MODE_INPUT, GPIO_MODE_OUTPUT, GPIO_MODE_INPUT_OUTPUT } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE = 0, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE = 0, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum {
+  GPIO_INTR_DISABLE = 0,
+  GPIO_INTR_POSEDGE,
+  GPIO_INTR_NEGEDGE,
+  GPIO_INTR_ANYEDGE,
+  GPIO_INTR_LOW_LEVEL,
+  GPIO_INTR_HIGH_LEVEL
+} gpio_int_type_t;
+
+typedef struct {
+  uint64_t pin_bit_mask;
+  gpio_mode_t mode;
+  gpio_pullup_t pull_up_en;
+  gpio_pulldown_t pull_down_en;
+  gpio_int_type_t intr_type;
+} gpio_config_t;
+
+typedef void (*gpio_isr_t)(void *arg);
+
+esp_err_t gpio_config(const gpio_config_t *config);
+int gpio_get_level(gpio_num_t pin);
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level);
+esp_err_t gpio_install_isr_service(int flags);
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t isr, void *arg);
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin);
+esp_err_t gpio_intr_enable(gpio_num_t pin);
+esp_err_t gpio_intr_disable(gpio_num_t pin);
+
+typedef struct {
+  uint32_t enable_w1ts;
+  struct {
+    uint32_t data;
+  } enable1_w1ts;
+  struct {
+    uint32_t pad_driver;
+  } pin[40];
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+extern const uint32_t GPIO_PIN_MUX_REG[];
+
+#define PIN_INPUT_ENABLE(reg) ((void)(reg))
+
+#ifdef __cplusplus
+}
+#endif
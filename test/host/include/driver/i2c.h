@@ -0,0 +1,56 @@
+// host stand-in of the i2c master driver.  command links are recorded and executed by
+// i2c_master_cmd_begin() against the simulated devices of the test (see dev_i2c/test/i2c_sim.hpp).
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { I2C_NUM_0 = 0, I2C_NUM_1, I2C_NUM_MAX } i2c_port_t;
+typedef enum { I2C_MODE_SLAVE = 0, I2C_MODE_MASTER } i2c_mode_t;
+typedef enum { I2C_MASTER_WRITE = 0, I2C_MASTER_READ } i2c_rw_t;
+typedef enum { I2C_MASTER_ACK = 0, I2C_MASTER_NACK, I2C_MASTER_LAST_NACK } i2c_ack_type_t;
+
+typedef struct {
+  i2c_mode_t mode;
+  int sda_io_num;
+  int scl_io_num;
+  gpio_pullup_t sda_pullup_en;
+  gpio_pullup_t scl_pullup_en;
+  union {
+    struct {
+      uint32_t clk_speed;
+    } master;
+  };
+} i2c_config_t;
+
+typedef void *i2c_cmd_handle_t;
+
+// the recorded command link (see i2c_sim) fits the buffer of any link size
+#define I2C_LINK_RECOMMENDED_SIZE(TRANSACTIONS) (512 + (TRANSACTIONS))
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size);
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ack_en);
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t *data, size_t len, bool ack_en);
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd);
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks);
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf);
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx_buf, size_t tx_buf, int flags);
+esp_err_t i2c_filter_enable(i2c_port_t port, uint8_t cyc_num);
+esp_err_t i2c_get_timeout(i2c_port_t port, int *timeout);
+esp_err_t i2c_set_timeout(i2c_port_t port, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,5 @@
+// host stub, code placement attributes have no meaning off target
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
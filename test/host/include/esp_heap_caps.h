@@ -0,0 +1,18 @@
+// host stub, a heap with room to spare
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline size_t heap_caps_get_free_size(uint32_t caps) { return 128 * 1024; }
+static inline size_t heap_caps_get_largest_free_block(uint32_t caps) { return 64 * 1024; }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,32 @@
+// host stub, the description of a host build
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  char version[32];
+  char time[16];
+  char date[16];
+  char idf_ver[32];
+} esp_app_desc_t;
+
+static inline const esp_app_desc_t *esp_ota_get_app_description(void) {
+  static const esp_app_desc_t desc = {"host", "00:00:00", "Jan  1 2021", "host"};
+  return &desc;
+}
+
+static inline int esp_ota_get_app_elf_sha256(char *dst, size_t size) {
+  strncpy(dst, "000000000000", size);
+  return (int)size;
+}
+
+#ifdef __cplusplus
+}
+#endif
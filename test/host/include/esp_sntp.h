@@ -0,0 +1,25 @@
+// host stand-in of the sntp client, the tests set the time (see core/test/boot_sim.hpp).  once
+// sntp_init() is called the time sync notification follows at the time the test chooses.
+#pragma once
+
+#include <sys/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SNTP_OPMODE_POLL 0
+
+typedef enum { SNTP_SYNC_MODE_IMMED, SNTP_SYNC_MODE_SMOOTH } sntp_sync_mode_t;
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+void sntp_setoperatingmode(unsigned char operating_mode);
+void sntp_set_sync_mode(sntp_sync_mode_t sync_mode);
+void sntp_setservername(unsigned char idx, const char *server);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+void sntp_init(void);
+void sntp_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+// host stub, esp_random() is a fixed sequence so runs repeat.  restart and the reset reason
+// are provided by the tests that use them (e.g. core/test/boot_sim.cpp).
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+static inline uint32_t esp_random(void) {
+  static uint32_t state = 0x2545f491;
+
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+void esp_restart(void) __attribute__((noreturn));
+esp_reset_reason_t esp_reset_reason(void);
+
+static inline uint32_t esp_get_free_heap_size(void) { return 128 * 1024; }
+static inline uint32_t esp_get_minimum_free_heap_size(void) { return 96 * 1024; }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+// host stub, the types ruth::Net and the run message use.  the tests stand in for Net itself
+// (e.g. core/test/boot_sim.cpp), there is no access point.
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_system.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef enum {
+  WIFI_REASON_UNSPECIFIED = 1,
+  WIFI_REASON_AUTH_EXPIRE = 2,
+  WIFI_REASON_NO_AP_FOUND = 201,
+  WIFI_REASON_AUTH_FAIL = 202,
+} wifi_err_reason_t;
+
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t primary;
+  int8_t rssi;
+} wifi_ap_record_t;
+
+static inline esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info) { return ESP_FAIL; }
+
+#ifdef __cplusplus
+}
+#endif
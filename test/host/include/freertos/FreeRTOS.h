@@ -0,0 +1,54 @@
+// host stand-in (see test/host/rtos.cpp), tasks run one at a time on a virtual clock
+#pragma once
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// as the esp-idf portmacro.h does
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define configTICK_RATE_HZ 500 // CONFIG_FREERTOS_HZ of sdkconfig.defaults
+#define CONFIG_ESP_MAIN_TASK_STACK_SIZE 3584
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define tskNO_AFFINITY 0x7fffffff
+
+// a single cpu, nothing else runs while the running task is between calls
+typedef struct {
+  uint32_t owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+// a task woken from an isr runs once the isr returns
+void host_rtos_yield(void);
+#define portYIELD_FROM_ISR(...) host_rtos_yield()
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,17 @@
+// host stand-in, only the item receive used by owb_rmt (see the fake rmt driver of owb/test)
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_ringbuf *RingbufHandle_t;
+
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *size, TickType_t ticks);
+void vRingbufferReturnItem(RingbufHandle_t rb, void *item);
+
+#ifdef __cplusplus
+}
+#endif
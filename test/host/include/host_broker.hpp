@@ -0,0 +1,62 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// the broker behind the host esp-mqtt client (test/host/mqtt_client.cpp).  ruth_mqtt is
+// built unchanged on top of it: published messages are captured and messages delivered here
+// reach the registered handlers through MQTT::incomingMsg() on the client (mqtt) task.
+// publishes made without a started client (e.g. a test of an engine alone) are captured
+// while the broker is online.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace host {
+
+class Broker {
+public:
+  struct Opts {
+    bool online = true;       // accepts the connection (and publishes) when the client starts
+    bool acks = true;         // acknowledges subscriptions
+    uint32_t connect_ms = 50; // from client start to connected
+    uint32_t ack_ms = 20;     // from a subscribe to its ack (a round trip)
+  };
+
+  struct Published {
+    std::string topic;
+    std::string data; // msgpack
+    uint64_t at_us;
+  };
+
+public:
+  static Opts opts;
+  static std::vector<Published> published;
+
+  // an offline broker comes online, the client connects (and resubscribes on request)
+  static void connect();
+  static bool connected();
+
+  // queues a message for the client task, as if published by another client
+  static void deliver(const std::string &topic, const std::string &packed);
+};
+
+} // namespace host
@@ -0,0 +1,43 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// control of the host gpio stand-in (test/host/gpio.cpp): the test drives the level of input
+// pins (e.g. an open drain INT line) and the handler added for the pin is called, as the isr,
+// by the driving task when its interrupt type matches.  a level interrupt is called on each
+// drive to the active level and when enabled at the active level.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void host_gpio_drive(gpio_num_t pin, int level);
+
+// isr calls of the pin since configured
+uint32_t host_gpio_interrupts(gpio_num_t pin);
+
+#ifdef __cplusplus
+}
+#endif
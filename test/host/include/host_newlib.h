@@ -0,0 +1,55 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// newlib extensions (and declarations its headers make visible) the components use that
+// glibc lacks, included ahead of every source built with the host runtime (see host.cmake)
+
+#pragma once
+
+#include <stdlib.h>
+#include <sys/time.h> // newlib time.h declares gettimeofday()
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline char *itoa(int value, char *str, int base) {
+  char digits[sizeof(int) * 8 + 1];
+  unsigned int v = (value < 0 && base == 10) ? -(unsigned int)value : (unsigned int)value;
+  char *p = str;
+  int n = 0;
+
+  if (value < 0 && base == 10) *p++ = '-';
+
+  do {
+    const unsigned int d = v % base;
+    digits[n++] = (char)((d < 10) ? ('0' + d) : ('a' + d - 10));
+    v /= base;
+  } while (v);
+
+  while (n) *p++ = digits[--n];
+  *p = '\0';
+
+  return str;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,54 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// control of the host FreeRTOS stand-in (test/host/rtos.cpp).
+//
+// tasks are threads but only one runs at a time: the highest priority ready task runs until
+// it blocks or a higher priority task is readied by one of its calls (one cpu, preemption at
+// api calls).  time is virtual, it moves only by host_rtos_busy_us() (e.g. the simulated
+// 1-Wire bus) and, when every task is blocked, jumps to the next timeout.  a test of an
+// hour of reports runs in well under a second and is repeatable.
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// runs main_task as the first task (priority 1, like app_main), returns its result once it
+// returns.  tasks still blocked are abandoned.
+int host_rtos_run(int (*main_task)(void));
+
+uint64_t host_rtos_now_us(void);
+
+// the running task occupies the cpu for us, no other task runs meanwhile
+void host_rtos_busy_us(uint32_t us);
+
+// the running task waits us on hardware (e.g. a 1-Wire slot), other tasks run meanwhile
+void host_rtos_wait_us(uint32_t us);
+
+// context switches since host_rtos_run()
+uint64_t host_rtos_switches(void);
+
+#ifdef __cplusplus
+}
+#endif
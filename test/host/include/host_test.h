@@ -0,0 +1,55 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// checks and timing shared by the host tests (C and C++).  a failed CHECK prints the
+// location and message then continues, main returns host_test_result().
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static int host_test_failures = 0;
+
+#define CHECK(cond, ...)                                                                                 \
+  do {                                                                                                   \
+    if (!(cond)) {                                                                                       \
+      host_test_failures++;                                                                              \
+      printf("FAIL %s:%d ", __FILE__, __LINE__);                                                         \
+      printf(__VA_ARGS__);                                                                               \
+      printf("\n");                                                                                      \
+    }                                                                                                    \
+  } while (0)
+
+// prints the summary line, the return value is the process exit code
+static inline int host_test_result(void) {
+  printf("%s, %d failures\n", host_test_failures ? "FAILED" : "passed", host_test_failures);
+
+  return host_test_failures ? 1 : 0;
+}
+
+// monotonic host time, for the benchmarks
+static inline uint64_t host_test_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
@@ -0,0 +1,4 @@
+// host stub, see esp_sntp.h
+#pragma once
+
+#include "esp_sntp.h"
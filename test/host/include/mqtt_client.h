@@ -0,0 +1,83 @@
+// host stand-in of the esp-mqtt client (see test/host/mqtt_client.cpp and host_broker.hpp)
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_MQTT_TASK_STACK_SIZE 6144
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+  MQTT_EVENT_ANY = -1,
+  MQTT_EVENT_ERROR = 0,
+  MQTT_EVENT_CONNECTED,
+  MQTT_EVENT_DISCONNECTED,
+  MQTT_EVENT_SUBSCRIBED,
+  MQTT_EVENT_UNSUBSCRIBED,
+  MQTT_EVENT_PUBLISHED,
+  MQTT_EVENT_DATA,
+  MQTT_EVENT_BEFORE_CONNECT
+} esp_mqtt_event_id_t;
+
+typedef enum {
+  MQTT_CONNECTION_ACCEPTED = 0,
+  MQTT_CONNECTION_REFUSE_PROTOCOL,
+  MQTT_CONNECTION_REFUSE_ID_REJECTED,
+  MQTT_CONNECTION_REFUSE_SERVER_UNAVAILABLE,
+  MQTT_CONNECTION_REFUSE_BAD_USERNAME,
+  MQTT_CONNECTION_REFUSE_NOT_AUTHORIZED
+} esp_mqtt_connect_return_code_t;
+
+typedef struct {
+  esp_mqtt_connect_return_code_t connect_return_code;
+} esp_mqtt_error_codes_t;
+
+typedef struct {
+  esp_mqtt_event_id_t event_id;
+  esp_mqtt_client_handle_t client;
+  void *user_context;
+  char *data;
+  int data_len;
+  int total_data_len;
+  int current_data_offset;
+  char *topic;
+  int topic_len;
+  int msg_id;
+  int session_present;
+  esp_mqtt_error_codes_t *error_handle;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+typedef struct {
+  const char *uri;
+  bool disable_clean_session;
+  const char *username;
+  const char *password;
+  const char *client_id;
+  int reconnect_timeout_ms;
+  int task_prio;
+  int buffer_size;
+  int out_buffer_size;
+  void *user_context;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *handler_args);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len,
+                            int qos, int retain);
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos);
+
+#ifdef __cplusplus
+}
+#endif
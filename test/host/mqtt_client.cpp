@@ -0,0 +1,175 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// host esp-mqtt client, events are dispatched from the client task (at the configured
+// priority) in the order the broker produces them.  see host_broker.hpp.
+
+#include <string>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <mqtt_client.h>
+
+#include "host_broker.hpp"
+#include "host_rtos.h"
+
+struct esp_mqtt_client {
+  esp_mqtt_client_config_t config;
+  esp_event_handler_t handler = nullptr;
+  void *handler_args = nullptr;
+  QueueHandle_t events = nullptr;
+  bool connected = false;
+  int msg_id = 0;
+};
+
+namespace {
+
+struct Event {
+  esp_mqtt_event_id_t id;
+  int msg_id;
+  std::string topic;
+  std::string data;
+};
+
+esp_mqtt_client *client = nullptr;
+
+void post(Event *event) { xQueueSend(client->events, &event, portMAX_DELAY); }
+
+// posts the event once ms pass (from the esp_timer task), e.g. a reply a round trip later
+void postAfter(uint32_t ms, Event *event) {
+  struct Delayed {
+    esp_timer_handle_t timer;
+    Event *event;
+  };
+
+  auto *delayed = new Delayed{nullptr, event};
+
+  esp_timer_create_args_t args = {};
+  args.callback = [](void *arg) {
+    auto *delayed = static_cast<Delayed *>(arg);
+
+    post(delayed->event);
+    esp_timer_delete(delayed->timer);
+    delete delayed;
+  };
+  args.arg = delayed;
+  args.name = "broker";
+
+  esp_timer_create(&args, &delayed->timer);
+  esp_timer_start_once(delayed->timer, ms * 1000ULL);
+}
+
+void dispatch(Event *event) {
+  esp_mqtt_error_codes_t error = {MQTT_CONNECTION_ACCEPTED};
+
+  esp_mqtt_event_t e = {};
+  e.event_id = event->id;
+  e.client = client;
+  e.user_context = client->config.user_context;
+  e.data = event->data.data();
+  e.data_len = e.total_data_len = event->data.size();
+  e.topic = event->topic.data();
+  e.topic_len = event->topic.size();
+  e.msg_id = event->msg_id;
+  e.error_handle = &error;
+
+  if (event->id == MQTT_EVENT_CONNECTED) client->connected = true;
+
+  client->handler(client->handler_args, "MQTT_EVENTS", event->id, &e);
+}
+
+void clientTask(void *) {
+  vTaskDelay(pdMS_TO_TICKS(host::Broker::opts.connect_ms));
+  if (host::Broker::opts.online) host::Broker::connect();
+
+  for (;;) {
+    Event *event;
+    xQueueReceive(client->events, &event, portMAX_DELAY);
+
+    dispatch(event);
+    delete event;
+  }
+}
+
+} // namespace
+
+namespace host {
+
+Broker::Opts Broker::opts;
+std::vector<Broker::Published> Broker::published;
+
+void Broker::connect() {
+  opts.online = true;
+
+  if (client && !client->connected) post(new Event{MQTT_EVENT_CONNECTED, 0, {}, {}});
+}
+
+bool Broker::connected() { return client && client->connected; }
+
+void Broker::deliver(const std::string &topic, const std::string &packed) {
+  if (client) post(new Event{MQTT_EVENT_DATA, 0, topic, packed});
+}
+
+} // namespace host
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config) {
+  client = new esp_mqtt_client;
+  client->config = *config;
+  client->events = xQueueCreate(32, sizeof(Event *));
+
+  return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t c, esp_mqtt_event_id_t,
+                                         esp_event_handler_t handler, void *handler_args) {
+  c->handler = handler;
+  c->handler_args = handler_args;
+
+  return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t c) {
+  xTaskCreate(clientTask, "mqtt_task", CONFIG_MQTT_TASK_STACK_SIZE, nullptr, c->config.task_prio, nullptr);
+
+  return ESP_OK;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t c, const char *topic, const char *data, int len, int,
+                            int) {
+  const auto online = c ? c->connected : host::Broker::opts.online;
+  if (!online) return -1;
+
+  host::Broker::published.push_back({topic, std::string(data, len), host_rtos_now_us()});
+
+  return c ? ++c->msg_id : 0;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t c, const char *, int) {
+  if (!c->connected) return -1;
+
+  const auto msg_id = ++c->msg_id;
+  if (host::Broker::opts.acks) {
+    postAfter(host::Broker::opts.ack_ms, new Event{MQTT_EVENT_SUBSCRIBED, msg_id, {}, {}});
+  }
+
+  return msg_id;
+}
@@ -0,0 +1,814 @@
+/*
+    Ruth
+    Copyright (C) 2021  Tim Hughey
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    https://www.wisslanding.com
+*/
+
+// FreeRTOS (tasks, notifications, semaphores, queues, timers) and esp_timer stand-ins for the
+// host tests, see host_rtos.h.
+//
+// every call is made by the running task while it holds the baton (rt.running).  a call that
+// blocks or readies a higher priority task picks the next task, hands it the baton and waits
+// on its own condition variable to be picked again.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "host_rtos.h"
+
+static constexpr uint64_t NEVER = UINT64_MAX;
+static constexpr uint64_t tick_us = 1000000 / configTICK_RATE_HZ;
+
+struct host_task {
+  TaskFunction_t fn;
+  void *arg;
+  std::string name;
+  UBaseType_t priority;
+
+  enum State { READY, BLOCKED, DONE } state = READY;
+  uint64_t order = 0;         // ready tasks of equal priority run first come, first served
+  uint64_t wake_at = NEVER;   // timeout of a blocked task
+  bool signaled = false;      // woken by the event it blocked on (not the timeout)
+  bool kill = false;          // deleted by another task, ends when next picked
+  std::deque<host_task *> *waiting_on = nullptr;
+
+  uint32_t notify_value = 0;
+  bool notify_pending = false;
+  bool notify_waiting = false;
+
+  std::condition_variable cv;
+};
+
+struct host_sem {
+  UBaseType_t count;
+  UBaseType_t max;
+  std::deque<host_task *> waiters;
+};
+
+struct host_queue {
+  size_t len;
+  size_t item_size;
+  std::deque<std::vector<uint8_t>> items;
+  std::deque<host_task *> receivers;
+  std::deque<host_task *> senders;
+};
+
+struct host_esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  uint64_t due = NEVER;
+  uint64_t period = 0;
+};
+
+// a FreeRTOS timer is an esp_timer, the callback runs from the esp_timer task
+struct host_timer {
+  esp_timer_handle_t timer;
+  uint64_t period_us;
+  bool auto_reload;
+  void *id;
+  TimerCallbackFunction_t callback;
+};
+
+namespace {
+
+struct TaskDeleted {};
+
+struct Runtime {
+  std::mutex mtx;
+  std::vector<host_task *> tasks; // not yet ended
+  host_task *running = nullptr;
+  uint64_t now_us = 0;
+  uint64_t order = 0;
+  uint64_t switches = 0;
+
+  std::vector<host_esp_timer *> timers;
+  std::deque<host_task *> timer_waiters;
+  host_task *timer_task = nullptr;
+
+  std::condition_variable main_cv;
+  bool main_done = false;
+  int main_rc = 0;
+};
+
+// never destroyed, abandoned tasks may still be waiting on it at exit
+Runtime &rt = *new Runtime;
+
+using Lock = std::unique_lock<std::mutex>;
+
+host_task *pickNext() {
+  host_task *next = nullptr;
+
+  for (auto *t : rt.tasks) {
+    if (t->state != host_task::READY) continue;
+
+    // highest priority, equal priorities in the order they became ready
+    if (!next || (t->priority > next->priority)) {
+      next = t;
+    } else if ((t->priority == next->priority) && (t->order < next->order)) {
+      next = t;
+    }
+  }
+
+  return next;
+}
+
+void ready(host_task *t, bool signaled) {
+  if (t->waiting_on) {
+    auto &list = *t->waiting_on;
+    list.erase(std::remove(list.begin(), list.end(), t), list.end());
+    t->waiting_on = nullptr;
+  }
+
+  t->state = host_task::READY;
+  t->signaled = signaled;
+  t->wake_at = NEVER;
+  t->order = ++rt.order;
+}
+
+// readies the blocked tasks whose timeout has passed
+void expire() {
+  for (auto *t : rt.tasks) {
+    if ((t->state == host_task::BLOCKED) && (t->wake_at <= rt.now_us)) ready(t, false);
+  }
+}
+
+[[noreturn]] void deadlock() {
+  fprintf(stderr, "host rtos: every task is blocked forever at %.3fs:\n", rt.now_us / 1e6);
+  for (auto *t : rt.tasks) fprintf(stderr, "  %s\n", t->name.c_str());
+
+  fflush(stdout);
+  std::abort();
+}
+
+// the running task (self) has blocked, been preempted or ended.  runs the next task, when
+// every task is blocked time moves to the earliest timeout.
+void schedule(Lock &lk, host_task *self) {
+  if (rt.main_done) {
+    // the test is over, abandon the remaining tasks
+    rt.running = nullptr;
+    if (self->state != host_task::DONE) self->cv.wait(lk, [] { return false; });
+    return;
+  }
+
+  auto *next = pickNext();
+
+  while (next == nullptr) {
+    uint64_t wake_at = NEVER;
+    for (auto *t : rt.tasks) {
+      if (t->state == host_task::BLOCKED) wake_at = std::min(wake_at, t->wake_at);
+    }
+
+    if (wake_at == NEVER) deadlock();
+
+    rt.now_us = std::max(rt.now_us, wake_at);
+    expire();
+    next = pickNext();
+  }
+
+  if (next != self) {
+    rt.switches++;
+    rt.running = next;
+    next->cv.notify_one();
+
+    if (self->state == host_task::DONE) return;
+
+    self->cv.wait(lk, [self] { return rt.running == self; });
+  }
+
+  if (self->kill) throw TaskDeleted();
+}
+
+// self gives way when a task of higher priority is ready
+void preempt(Lock &lk, host_task *self) {
+  expire();
+
+  auto *next = pickNext();
+  if (next && (next != self) && (next->priority > self->priority)) schedule(lk, self);
+}
+
+// true when woken by the event (the caller checks the condition again), false on timeout
+bool block(Lock &lk, host_task *self, uint64_t deadline, std::deque<host_task *> *list) {
+  if (deadline <= rt.now_us) return false;
+
+  self->state = host_task::BLOCKED;
+  self->signaled = false;
+  self->wake_at = deadline;
+
+  if (list) {
+    list->push_back(self);
+    self->waiting_on = list;
+  }
+
+  schedule(lk, self);
+
+  return self->signaled;
+}
+
+uint64_t deadlineOf(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) return NEVER;
+  if (ticks == 0) return rt.now_us;
+
+  // like the tick interrupt, timeouts expire on a tick boundary
+  return ((rt.now_us / tick_us) + ticks) * tick_us;
+}
+
+// readies the highest priority waiter (first come among equals)
+bool wakeOne(std::deque<host_task *> &list) {
+  if (list.empty()) return false;
+
+  auto best = list.begin();
+  for (auto it = list.begin(); it != list.end(); ++it) {
+    if ((*it)->priority > (*best)->priority) best = it;
+  }
+
+  ready(*best, true);
+  return true;
+}
+
+host_task *self() { return rt.running; }
+
+void trampoline(host_task *t) {
+  {
+    Lock lk(rt.mtx);
+    t->cv.wait(lk, [t] { return rt.running == t; });
+  }
+
+  try {
+    if (!t->kill) t->fn(t->arg);
+  } catch (const TaskDeleted &) {
+  }
+
+  // returning from a task function is treated as vTaskDelete(nullptr)
+  Lock lk(rt.mtx);
+  t->state = host_task::DONE;
+  rt.tasks.erase(std::remove(rt.tasks.begin(), rt.tasks.end(), t), rt.tasks.end());
+
+  if (rt.running == t) schedule(lk, t);
+}
+
+host_task *create(TaskFunction_t fn, const char *name, void *arg, UBaseType_t priority) {
+  auto *t = new host_task;
+  t->fn = fn;
+  t->arg = arg;
+  t->name = name;
+  t->priority = priority;
+  t->order = ++rt.order;
+
+  rt.tasks.push_back(t);
+  std::thread(trampoline, t).detach();
+
+  return t;
+}
+
+void timerTask(void *) {
+  Lock lk(rt.mtx);
+
+  for (;;) {
+    host_esp_timer *due = nullptr;
+    for (auto *timer : rt.timers) {
+      if (!due || (timer->due < due->due)) due = timer;
+    }
+
+    if (due && (due->due <= rt.now_us)) {
+      due->due = due->period ? (due->due + due->period) : NEVER;
+
+      lk.unlock();
+      due->callback(due->arg);
+      lk.lock();
+    } else {
+      block(lk, rt.timer_task, due ? due->due : NEVER, &rt.timer_waiters);
+    }
+  }
+}
+
+// the timer task recomputes the next due timer
+void timersChanged(Lock &lk) {
+  if (wakeOne(rt.timer_waiters) && self()) preempt(lk, self());
+}
+
+int (*main_fn)(void) = nullptr;
+
+void mainTask(void *) {
+  const int rc = main_fn();
+
+  Lock lk(rt.mtx);
+  rt.main_rc = rc;
+  rt.main_done = true;
+  rt.main_cv.notify_one();
+}
+
+} // namespace
+
+//
+// host control
+//
+
+extern "C" int host_rtos_run(int (*main_task)(void)) {
+  Lock lk(rt.mtx);
+
+  main_fn = main_task;
+  rt.timer_task = create(timerTask, "esp_timer", nullptr, 22);
+  create(mainTask, "main", nullptr, 1);
+
+  rt.running = pickNext();
+  rt.running->cv.notify_one();
+
+  rt.main_cv.wait(lk, [] { return rt.main_done; });
+
+  return rt.main_rc;
+}
+
+extern "C" uint64_t host_rtos_now_us(void) { return rt.now_us; }
+
+// only the running task moves the clock, the baton hand off orders it with every other access
+extern "C" void host_rtos_busy_us(uint32_t us) { rt.now_us += us; }
+
+extern "C" void host_rtos_wait_us(uint32_t us) {
+  Lock lk(rt.mtx);
+  block(lk, self(), rt.now_us + us, nullptr);
+}
+
+extern "C" uint64_t host_rtos_switches(void) { return rt.switches; }
+
+extern "C" void host_rtos_yield(void) {
+  Lock lk(rt.mtx);
+  if (self()) preempt(lk, self());
+}
+
+//
+// tasks
+//
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t, void *arg, UBaseType_t priority,
+                       TaskHandle_t *created) {
+  Lock lk(rt.mtx);
+
+  auto *t = create(fn, name, arg, priority);
+  if (created) *created = t;
+
+  if (self()) preempt(lk, self());
+
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t) {
+  return xTaskCreate(fn, name, stack, arg, priority, created);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  Lock lk(rt.mtx);
+
+  if ((task == nullptr) || (task == self())) throw TaskDeleted();
+
+  // ends when next picked
+  task->kill = true;
+  if (task->state == host_task::BLOCKED) ready(task, false);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  Lock lk(rt.mtx);
+  auto *me = self();
+
+  if (ticks == 0) {
+    // yield to ready tasks of equal priority
+    expire();
+    me->order = ++rt.order;
+    if (pickNext() != me) schedule(lk, me);
+    return;
+  }
+
+  block(lk, me, deadlineOf(ticks), nullptr);
+}
+
+TickType_t xTaskGetTickCount(void) { return rt.now_us / tick_us; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return self(); }
+
+const char *pcTaskGetName(TaskHandle_t task) { return (task ? task : self())->name.c_str(); }
+
+UBaseType_t uxTaskGetNumberOfTasks(void) { return rt.tasks.size(); }
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return (task ? task : self())->priority; }
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+  Lock lk(rt.mtx);
+  auto *me = self();
+
+  (task ? task : me)->priority = priority;
+
+  // lowered below a ready task or raised above the running task
+  if (me) preempt(lk, me);
+}
+
+//
+// notifications
+//
+
+static BaseType_t notify(host_task *task, uint32_t value, eNotifyAction action) {
+  switch (action) {
+  case eNoAction:
+    break;
+  case eSetBits:
+    task->notify_value |= value;
+    break;
+  case eIncrement:
+    task->notify_value++;
+    break;
+  case eSetValueWithOverwrite:
+    task->notify_value = value;
+    break;
+  case eSetValueWithoutOverwrite:
+    if (task->notify_pending) return pdFAIL;
+    task->notify_value = value;
+    break;
+  }
+
+  task->notify_pending = true;
+
+  if (task->notify_waiting && (task->state == host_task::BLOCKED)) ready(task, true);
+
+  return pdPASS;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+  Lock lk(rt.mtx);
+
+  const auto rc = notify(task, value, action);
+  if (self()) preempt(lk, self());
+
+  return rc;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken) {
+  Lock lk(rt.mtx);
+
+  const auto rc = notify(task, value, action);
+  if (woken && self() && (task->state == host_task::READY) && (task->priority > self()->priority)) {
+    *woken = pdTRUE;
+  }
+
+  return rc;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return xTaskNotify(task, 0, eIncrement); }
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyFromISR(task, 0, eIncrement, woken);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value,
+                           TickType_t ticks) {
+  Lock lk(rt.mtx);
+  auto *me = self();
+
+  if (!me->notify_pending) {
+    me->notify_value &= ~clear_on_entry;
+
+    me->notify_waiting = true;
+    block(lk, me, deadlineOf(ticks), nullptr);
+    me->notify_waiting = false;
+  }
+
+  if (value) *value = me->notify_value;
+  if (!me->notify_pending) return pdFALSE;
+
+  me->notify_value &= ~clear_on_exit;
+  me->notify_pending = false;
+
+  return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+  Lock lk(rt.mtx);
+  auto *me = self();
+
+  if (me->notify_value == 0) {
+    me->notify_waiting = true;
+    block(lk, me, deadlineOf(ticks), nullptr);
+    me->notify_waiting = false;
+  }
+
+  const auto value = me->notify_value;
+  if (value) me->notify_value = clear_on_exit ? 0 : (value - 1);
+  me->notify_pending = false;
+
+  return value;
+}
+
+//
+// semaphores
+//
+
+static SemaphoreHandle_t semCreate(UBaseType_t max, UBaseType_t initial) {
+  auto *sem = new host_sem;
+  sem->max = max;
+  sem->count = initial;
+
+  return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return semCreate(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buff) {
+  return buff->sem = semCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) {
+  return semCreate(max, initial);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return semCreate(1, 1); }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buff) { return buff->sem = semCreate(1, 1); }
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+static BaseType_t semGive(SemaphoreHandle_t sem) {
+  if (sem->count >= sem->max) return pdFALSE;
+
+  // the woken waiter takes the count when it runs, like FreeRTOS the giver may take it back first
+  sem->count++;
+  wakeOne(sem->waiters);
+
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  Lock lk(rt.mtx);
+
+  const auto rc = semGive(sem);
+  if (self()) preempt(lk, self());
+
+  return rc;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken) {
+  Lock lk(rt.mtx);
+
+  const auto rc = semGive(sem);
+  if (woken) *woken = pdTRUE;
+
+  return rc;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  Lock lk(rt.mtx);
+  const auto deadline = deadlineOf(ticks);
+
+  while (sem->count == 0) {
+    if (!block(lk, self(), deadline, &sem->waiters)) return pdFALSE;
+  }
+
+  sem->count--;
+
+  return pdTRUE;
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem) { return sem->count; }
+
+//
+// queues
+//
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size) {
+  auto *q = new host_queue;
+  q->len = len;
+  q->item_size = item_size;
+
+  return q;
+}
+
+void vQueueDelete(QueueHandle_t q) { delete q; }
+
+static BaseType_t queueSend(QueueHandle_t q, const void *item, TickType_t ticks, bool front, bool isr) {
+  Lock lk(rt.mtx);
+  const auto deadline = isr ? rt.now_us : deadlineOf(ticks);
+
+  while (q->items.size() >= q->len) {
+    if (!block(lk, self(), deadline, &q->senders)) return errQUEUE_FULL;
+  }
+
+  auto *bytes = static_cast<const uint8_t *>(item);
+  std::vector<uint8_t> copy(bytes, bytes + q->item_size);
+
+  if (front) {
+    q->items.push_front(std::move(copy));
+  } else {
+    q->items.push_back(std::move(copy));
+  }
+
+  wakeOne(q->receivers);
+  if (!isr && self()) preempt(lk, self());
+
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+  Lock lk(rt.mtx);
+  const auto deadline = deadlineOf(ticks);
+
+  while (q->items.empty()) {
+    if (!block(lk, self(), deadline, &q->receivers)) return pdFALSE;
+  }
+
+  memcpy(item, q->items.front().data(), q->item_size);
+  q->items.pop_front();
+
+  wakeOne(q->senders);
+  preempt(lk, self());
+
+  return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks) {
+  return queueSend(q, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken) {
+  if (woken) *woken = pdTRUE;
+  return queueSend(q, item, 0, false, true);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t ticks) {
+  return queueSend(q, item, ticks, false, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t ticks) {
+  return queueSend(q, item, ticks, true, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) { return q->items.size(); }
+
+//
+// esp_timer
+//
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+  Lock lk(rt.mtx);
+
+  auto *timer = new host_esp_timer;
+  timer->callback = args->callback;
+  timer->arg = args->arg;
+
+  rt.timers.push_back(timer);
+  *handle = timer;
+
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  Lock lk(rt.mtx);
+
+  if (timer->due != NEVER) return ESP_ERR_INVALID_STATE;
+
+  rt.timers.erase(std::remove(rt.timers.begin(), rt.timers.end(), timer), rt.timers.end());
+  delete timer;
+
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time(void) { return rt.now_us; }
+
+static esp_err_t timerStart(esp_timer_handle_t timer, uint64_t us, uint64_t period) {
+  Lock lk(rt.mtx);
+
+  if (timer->due != NEVER) return ESP_ERR_INVALID_STATE;
+
+  timer->due = rt.now_us + us;
+  timer->period = period;
+  timersChanged(lk);
+
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return timerStart(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+  return timerStart(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  Lock lk(rt.mtx);
+
+  if (timer->due == NEVER) return ESP_ERR_INVALID_STATE;
+
+  timer->due = NEVER;
+  timersChanged(lk);
+
+  return ESP_OK;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch (code) {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  default:
+    return "ESP_ERR";
+  }
+}
+
+//
+// FreeRTOS timers
+//
+
+static void timerExpired(void *arg) {
+  auto *timer = static_cast<host_timer *>(arg);
+  timer->callback(timer);
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload, void *id,
+                           TimerCallbackFunction_t callback) {
+  auto *timer = new host_timer{nullptr, period * tick_us, auto_reload != pdFALSE, id, callback};
+
+  esp_timer_create_args_t args = {};
+  args.callback = timerExpired;
+  args.arg = timer;
+  args.name = name;
+  esp_timer_create(&args, &timer->timer);
+
+  return timer;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t) {
+  esp_timer_stop(timer->timer);
+  esp_timer_delete(timer->timer);
+  delete timer;
+
+  return pdPASS;
+}
+
+// starting a running timer restarts its period
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t) {
+  esp_timer_stop(timer->timer);
+
+  if (timer->auto_reload) return esp_timer_start_periodic(timer->timer, timer->period_us) == ESP_OK;
+  return esp_timer_start_once(timer->timer, timer->period_us) == ESP_OK;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t) {
+  esp_timer_stop(timer->timer);
+  return pdPASS;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) { return timer->id; }
+
+void vTimerSetTimerID(TimerHandle_t timer, void *id) { timer->id = id; }
+
+//
+// esp_log, written only when HOST_LOG is set in the environment
+//
+
+uint32_t esp_log_timestamp(void) { return rt.now_us / 1000; }
+
+void esp_log_write(esp_log_level_t, const char *, const char *format, ...) {
+  static const bool enabled = getenv("HOST_LOG") != nullptr;
+  if (!enabled) return;
+
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
+}